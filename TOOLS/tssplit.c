@@ -0,0 +1,146 @@
+/*
+ * split an MPEG transport stream into one file per program
+ *
+ * The multiplex is read and parsed only once, demux_ts hands out the
+ * packets of every program as a separate single program TS.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "config.h"
+#include "mp_msg.h"
+#include "stream/stream.h"
+#include "libmpdemux/demuxer.h"
+#include "libmpdemux/demux_ts.h"
+
+// linking hacks
+char *info_name;
+char *info_artist;
+char *info_genre;
+char *info_subject;
+char *info_copyright;
+char *info_sourceform;
+char *info_comment;
+
+char* out_filename = NULL;
+char* force_fourcc=NULL;
+char* passtmpfile="divx2pass.log";
+
+static FILE *out[TS_SPLIT_MAX_PROGRAMS];
+static int64_t written[TS_SPLIT_MAX_PROGRAMS];
+
+static int wanted(int progid, int argc, char **argv)
+{
+  int i;
+  if (argc <= 3)
+    return 1;
+  for (i = 3; i < argc; i++)
+    if (atoi(argv[i]) == progid)
+      return 1;
+  return 0;
+}
+
+// write out whatever the demuxer queued for each program
+static int drain(demuxer_t *demuxer, const char *prefix, int argc, char **argv)
+{
+  int progids[TS_SPLIT_MAX_PROGRAMS];
+  int i, n = demux_ts_get_programs(demuxer, progids, TS_SPLIT_MAX_PROGRAMS);
+
+  for (i = 0; i < n; i++) {
+    demux_stream_t *ds = demux_ts_program_stream(demuxer, progids[i]);
+    while (ds->packs) {
+      unsigned char *start;
+      int len = ds_get_packet(ds, &start);
+      if (len <= 0 || !wanted(progids[i], argc, argv))
+        continue;
+      if (!out[i]) {
+        char name[1024];
+        snprintf(name, sizeof(name), "%s-%d.ts", prefix, progids[i]);
+        out[i] = fopen(name, "wb");
+        if (!out[i]) {
+          mp_msg(MSGT_DEMUX, MSGL_FATAL, "Cannot open %s for writing\n", name);
+          return 0;
+        }
+        mp_msg(MSGT_DEMUX, MSGL_INFO, "Program %d -> %s\n", progids[i], name);
+      }
+      if (fwrite(start, len, 1, out[i]) != 1) {
+        mp_msg(MSGT_DEMUX, MSGL_FATAL, "Write error on program %d\n", progids[i]);
+        return 0;
+      }
+      written[i] += len;
+    }
+  }
+  return 1;
+}
+
+int main(int argc, char **argv)
+{
+  int file_format = DEMUXER_TYPE_MPEG_TS;
+  int progids[TS_SPLIT_MAX_PROGRAMS];
+  stream_t *stream;
+  demuxer_t *demuxer;
+  int i, n, ret = 0;
+
+  if (argc < 3) {
+    printf("Usage: %s <input> <output prefix> [program ...]\n"
+           "Writes every program (or only the ones given) of the transport\n"
+           "stream to <output prefix>-<program>.ts\n", argv[0]);
+    return 1;
+  }
+
+  mp_msg_init();
+
+  stream = open_stream(argv[1], NULL, &file_format);
+  if (!stream) {
+    mp_msg(MSGT_DEMUX, MSGL_FATAL, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+  // no elementary streams needed, only the raw packets of each program,
+  // including the ones read while probing, a pipe can't be read again
+  ts_split = 1;
+  demuxer = demux_open(stream, DEMUXER_TYPE_MPEG_TS, -2, -2, -2, argv[1]);
+  if (!demuxer || !demux_ts_split_programs(demuxer)) {
+    mp_msg(MSGT_DEMUX, MSGL_FATAL, "%s is not an MPEG transport stream\n", argv[1]);
+    free_stream(stream);
+    return 1;
+  }
+
+  while (demux_fill_buffer(demuxer, demuxer->video))
+    if (!drain(demuxer, argv[2], argc, argv)) {
+      ret = 1;
+      break;
+    }
+  if (!ret && !drain(demuxer, argv[2], argc, argv))
+    ret = 1;
+
+  n = demux_ts_get_programs(demuxer, progids, TS_SPLIT_MAX_PROGRAMS);
+  for (i = 0; i < n; i++) {
+    if (!out[i])
+      continue;
+    mp_msg(MSGT_DEMUX, MSGL_INFO, "Program %d: %"PRId64" bytes\n", progids[i], written[i]);
+    fclose(out[i]);
+  }
+
+  free_demuxer(demuxer);
+  free_stream(stream);
+  return ret;
+}
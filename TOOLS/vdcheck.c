@@ -0,0 +1,552 @@
+/*
+ * decoder output conformance and performance check
+ *
+ * Every sample of a corpus is decoded through decode_video() into
+ * vo_md5sum, the per frame hashes are compared against stored references.
+ * Each sample runs in a child process, so a crashing decoder only fails its
+ * own sample and the peak RSS is that of the sample alone.  The results,
+ * including decode speed and heap allocations while decoding, are written
+ * as JSON.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "config.h"
+#include "libavutil/common.h"
+#include "libavutil/avstring.h"
+#include "mp_msg.h"
+#include "mpcommon.h"
+#include "m_option.h"
+#include "m_config.h"
+#include "codec-cfg.h"
+#include "cpudetect.h"
+#include "osdep/timer.h"
+#include "path.h"
+#include "stream/stream.h"
+#include "libmpdemux/demuxer.h"
+#include "libmpdemux/stheader.h"
+#include "libmpcodecs/dec_video.h"
+#include "libmpcodecs/vf.h"
+#include "libvo/video_out.h"
+
+// linking hacks
+char *info_name;
+char *info_artist;
+char *info_genre;
+char *info_subject;
+char *info_copyright;
+char *info_sourceform;
+char *info_comment;
+
+char* out_filename = NULL;
+char* force_fourcc=NULL;
+char* passtmpfile="divx2pass.log";
+
+extern const m_option_t mplayer_opts[];
+extern const m_option_t common_opts[];
+
+enum {
+  RESULT_ERROR,     ///< sample could not be opened or decoded
+  RESULT_PASS,
+  RESULT_FAIL,
+  RESULT_NEW,       ///< reference written
+  RESULT_CRASH,
+};
+
+static const char * const result_name[] = { "error", "pass", "fail", "new", "crash" };
+
+typedef struct {
+  int status;
+  int frames, ref_frames;
+  int mismatches, first_mismatch;
+  double decode_time;
+  uint64_t allocs, alloc_bytes;
+  char codec[32];
+  long peak_rss;    ///< kB, filled in by the parent
+} result_t;
+
+typedef struct {
+  char name[32];
+  int samples, failed;
+  int frames;
+  double decode_time;
+  uint64_t allocs;
+  long peak_rss;
+} codec_stats_t;
+
+#ifdef __GLIBC__
+/*
+ * Count heap allocations by interposing the allocator, this also catches
+ * those made by libraries and decoding threads.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+
+static volatile uint64_t alloc_count, alloc_bytes;
+
+static inline void count_alloc(size_t size)
+{
+  __sync_fetch_and_add(&alloc_count, 1);
+  __sync_fetch_and_add(&alloc_bytes, size);
+}
+
+void *malloc(size_t size)
+{
+  count_alloc(size);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+  count_alloc(nmemb * size);
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  if (!ptr)
+    count_alloc(size);
+  return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t align, size_t size)
+{
+  count_alloc(size);
+  return __libc_memalign(align, size);
+}
+
+int posix_memalign(void **ptr, size_t align, size_t size)
+{
+  void *p;
+  count_alloc(size);
+  p = __libc_memalign(align, size);
+  if (!p)
+    return ENOMEM;
+  *ptr = p;
+  return 0;
+}
+#else
+static uint64_t alloc_count, alloc_bytes;
+#endif
+
+/// number of frames in an md5sum file, hashes are stored in sums if given
+static int read_sums(const char *name, char (**sums)[33])
+{
+  char line[256];
+  int n = 0, alloc = 0;
+  FILE *f = fopen(name, "r");
+  if (!f)
+    return -1;
+  while (fgets(line, sizeof(line), f)) {
+    if (strlen(line) < 32)
+      continue;
+    if (sums) {
+      if (n == alloc) {
+        alloc = alloc ? 2 * alloc : 1024;
+        *sums = realloc(*sums, alloc * sizeof(**sums));
+      }
+      memcpy((*sums)[n], line, 32);
+      (*sums)[n][32] = 0;
+    }
+    n++;
+  }
+  fclose(f);
+  return n;
+}
+
+static int copy_file(const char *src, const char *dst)
+{
+  char buf[4096];
+  size_t len;
+  FILE *in = fopen(src, "rb"), *out = in ? fopen(dst, "wb") : NULL;
+  int ret = !!out;
+  while (out && (len = fread(buf, 1, sizeof(buf), in)) > 0)
+    if (fwrite(buf, len, 1, out) != 1)
+      ret = 0;
+  if (in)
+    fclose(in);
+  if (out && fclose(out))
+    ret = 0;
+  return ret;
+}
+
+/**
+ * \brief reference file of a corpus entry
+ *
+ * The name is the path of the sample relative to the corpus list, so
+ * samples of the same name in different directories keep apart.  Absolute
+ * paths and URLs are flattened into a single file name.
+ */
+static void ref_name(char *ref, int size, const char *refdir,
+                     const char *file, const char *codec)
+{
+  int len = strlen(refdir);
+  char *key;
+
+  snprintf(ref, size, "%s%s%s%s%s.md5", refdir,
+           len && refdir[len - 1] != '/' ? "/" : "",
+           file, codec[0] ? "." : "", codec);
+  if (file[0] != '/' && !strstr(file, "://"))
+    return;
+  key = ref + FFMIN(len + (len && refdir[len - 1] != '/'), size - 1);
+  for (; *key; key++)
+    if (*key == '/' || *key == ':')
+      *key = '_';
+}
+
+/// create the missing directories leading to file
+static void make_dirs(const char *file)
+{
+  char dir[1024], *p;
+  av_strlcpy(dir, file, sizeof(dir));
+  for (p = strchr(dir + 1, '/'); p; p = strchr(p + 1, '/')) {
+    *p = 0;
+    mkdir(dir, 0777);
+    *p = '/';
+  }
+}
+
+static void compare(const char *out, const char *ref, result_t *r)
+{
+  char (*a)[33] = NULL, (*b)[33] = NULL;
+  int i, n;
+
+  r->frames     = read_sums(out, &a);
+  r->ref_frames = read_sums(ref, &b);
+  r->first_mismatch = -1;
+  n = FFMIN(r->frames, r->ref_frames);
+  for (i = 0; i < n; i++)
+    if (strcmp(a[i], b[i])) {
+      if (!r->mismatches++)
+        r->first_mismatch = i;
+    }
+  r->status = r->mismatches || r->frames != r->ref_frames ? RESULT_FAIL : RESULT_PASS;
+  free(a);
+  free(b);
+}
+
+/// decode file into md5 (runs in the child)
+static void run_sample(char *file, const char *codec, const char *md5,
+                       result_t *r)
+{
+  char vo[1024];
+  char *vo_list[2] = { vo, NULL };
+  char *vc_list[2] = { (char *)codec, NULL };
+  int file_format = DEMUXER_TYPE_UNKNOWN;
+  const vo_functions_t *video_out;
+  stream_t *stream;
+  demuxer_t *demuxer;
+  sh_video_t *sh_video;
+  uint64_t allocs, bytes;
+
+  r->status = RESULT_ERROR;
+  stream = open_stream(file, NULL, &file_format);
+  if (!stream)
+    return;
+  demuxer = demux_open(stream, file_format, -2, -1, -2, file);
+  if (!demuxer || !demuxer->video->sh || !video_read_properties(demuxer->video->sh))
+    return;
+  sh_video = demuxer->video->sh;
+
+  // length prefixed so the name may contain ':'
+  snprintf(vo, sizeof(vo), "md5sum:outfile=%%%d%%%s", (int)strlen(md5), md5);
+  video_out = init_best_video_out(vo_list);
+  if (!video_out)
+    return;
+  {
+    char *vf_arg[] = { "_oldargs_", (char *)video_out, NULL };
+    sh_video->vfilter = vf_open_filter(NULL, "vo", vf_arg);
+  }
+  if (!init_best_video_codec(sh_video, codec ? vc_list : NULL, NULL))
+    return;
+  av_strlcpy(r->codec, sh_video->codec->name, sizeof(r->codec));
+
+  allocs = alloc_count;
+  bytes  = alloc_bytes;
+  while (1) {
+    float frame_time;
+    unsigned char *start;
+    unsigned int t;
+    void *mpi;
+    int in_size = video_read_frame(sh_video, &frame_time, &start, 0);
+    t = GetTimer();
+    // the last frames come from the decoder only
+    if (in_size < 0)
+      mpi = decode_video_drain(sh_video);
+    else
+      mpi = decode_video(sh_video, start, in_size, 0, sh_video->pts, NULL);
+    r->decode_time += (GetTimer() - t) * 0.000001;
+    if (in_size < 0 && !mpi)
+      break;
+    if (mpi)
+      filter_video(sh_video, mpi, sh_video->pts);
+  }
+  r->allocs      = alloc_count - allocs;
+  r->alloc_bytes = alloc_bytes - bytes;
+
+  uninit_video(sh_video);
+  video_out->uninit();
+  free_demuxer(demuxer);
+  free_stream(stream);
+  r->status = RESULT_PASS;
+}
+
+static void check_sample(char *file, const char *codec,
+                         const char *ref, int update, result_t *r)
+{
+  char out[1024];
+  struct rusage ru;
+  int fds[2], status;
+  pid_t pid;
+
+  memset(r, 0, sizeof(*r));
+  r->first_mismatch = -1;
+  snprintf(out, sizeof(out), "%s.out", ref);
+  if (pipe(fds)) {
+    r->status = RESULT_ERROR;
+    return;
+  }
+  fflush(NULL);
+  pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    run_sample(file, codec, out, r);
+    if (r->status == RESULT_PASS) {
+      if (update || access(ref, R_OK))
+        r->status = copy_file(out, ref) ? RESULT_NEW : RESULT_ERROR;
+      if (r->status == RESULT_NEW)
+        r->frames = r->ref_frames = read_sums(ref, NULL);
+      else
+        compare(out, ref, r);
+    }
+    unlink(out);
+    if (write(fds[1], r, sizeof(*r)) != sizeof(*r))
+      _exit(1);
+    _exit(0);
+  }
+  close(fds[1]);
+  if (pid < 0 || read(fds[0], r, sizeof(*r)) != sizeof(*r)) {
+    memset(r, 0, sizeof(*r));
+    r->first_mismatch = -1;
+    r->status = RESULT_CRASH;
+  }
+  close(fds[0]);
+  if (pid > 0 && wait4(pid, &status, 0, &ru) == pid) {
+    r->peak_rss = ru.ru_maxrss;
+    if (WIFSIGNALED(status))
+      r->status = RESULT_CRASH;
+  }
+  if (r->status == RESULT_CRASH)
+    unlink(out);
+}
+
+static void json_string(FILE *f, const char *s)
+{
+  fputc('"', f);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      fprintf(f, "\\%c", *s);
+    else if ((unsigned char)*s < 0x20)
+      fprintf(f, "\\u%04x", *s);
+    else
+      fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+static double fps(int frames, double t)
+{
+  return t > 0 ? frames / t : 0;
+}
+
+static void write_sample(FILE *f, const char *file, const result_t *r, int first)
+{
+  fprintf(f, "%s\n    {\"file\": ", first ? "" : ",");
+  json_string(f, file);
+  fprintf(f, ", \"codec\": ");
+  json_string(f, r->codec);
+  fprintf(f, ", \"result\": \"%s\", \"frames\": %d, \"ref_frames\": %d, "
+             "\"mismatches\": %d, \"first_mismatch\": %d, "
+             "\"decode_seconds\": %.6f, \"fps\": %.2f, \"peak_rss_kb\": %ld, "
+             "\"allocations\": %"PRIu64", \"allocated_bytes\": %"PRIu64"}",
+          result_name[r->status], r->frames, r->ref_frames, r->mismatches,
+          r->first_mismatch, r->decode_time, fps(r->frames, r->decode_time),
+          r->peak_rss, r->allocs, r->alloc_bytes);
+}
+
+static codec_stats_t *codec_stats(codec_stats_t **stats, int *n, const char *name)
+{
+  int i;
+  for (i = 0; i < *n; i++)
+    if (!strcmp((*stats)[i].name, name))
+      return &(*stats)[i];
+  *stats = realloc(*stats, (*n + 1) * sizeof(**stats));
+  memset(&(*stats)[*n], 0, sizeof(**stats));
+  av_strlcpy((*stats)[*n].name, name, sizeof((*stats)[*n].name));
+  return &(*stats)[(*n)++];
+}
+
+static void usage(const char *name)
+{
+  printf("Usage: %s [-ref <dir>] [-update] [-json <file>] <corpus> [option[=value] ...]\n"
+         "Decodes every sample listed in <corpus> (one '<file> [codec]' per line)\n"
+         "and compares the frame hashes with <dir>/<file>[.<codec>].md5, where\n"
+         "<file> is the path relative to <corpus>,\n"
+         "missing references are created, -update rewrites all of them.\n"
+         "The options are MPlayer options, e.g. lavdopts=threads=1\n", name);
+}
+
+int main(int argc, char **argv)
+{
+  const char *refdir = NULL, *json = "-";
+  char *corpus, *dir, line[1024];
+  int i, update = 0, failed = 0, nstats = 0, first = 1;
+  codec_stats_t *stats = NULL;
+  m_config_t *config;
+  FILE *list, *out = NULL;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (!strcmp(argv[i], "-update"))
+      update = 1;
+    else if (!strcmp(argv[i], "-ref") && i + 1 < argc)
+      refdir = argv[++i];
+    else if (!strcmp(argv[i], "-json") && i + 1 < argc)
+      json = argv[++i];
+    else
+      break;
+  }
+  if (i >= argc || argv[i][0] == '-') {
+    usage(argv[0]);
+    return 1;
+  }
+  corpus = argv[i++];
+  // messages go to stdout as well, keep them out of the report
+  if (!strcmp(json, "-")) {
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+      fprintf(stderr, "Cannot redirect stdout\n");
+      return 1;
+    }
+  }
+
+  common_preinit();
+  GetCpuCaps(&gCpuCaps);
+  // the builtin table, the results must not depend on local configuration
+  parse_codec_cfg(NULL);
+
+  config = m_config_new();
+  m_config_register_options(config, mplayer_opts);
+  m_config_register_options(config, common_opts);
+  for (; i < argc; i++) {
+    char *param = strchr(argv[i], '=');
+    if (param)
+      *param++ = 0;
+    if (m_config_set_option(config, argv[i], param) < 0) {
+      mp_msg(MSGT_GLOBAL, MSGL_FATAL, "Invalid option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  list = fopen(corpus, "r");
+  if (!list) {
+    mp_msg(MSGT_GLOBAL, MSGL_FATAL, "Cannot open %s\n", corpus);
+    return 1;
+  }
+  if (strcmp(json, "-"))
+    out = fopen(json, "w");
+  if (!out) {
+    mp_msg(MSGT_GLOBAL, MSGL_FATAL, "Cannot open %s for writing\n", json);
+    return 1;
+  }
+  // sample and reference names are relative to the corpus list
+  dir = mp_dirname(corpus);
+  if (!refdir)
+    refdir = dir;
+
+  fprintf(out, "{\n  \"samples\": [");
+  while (fgets(line, sizeof(line), list)) {
+    char file[512], codec[64] = "", path[1024], ref[1024];
+    codec_stats_t *cs;
+    result_t r;
+
+    if (line[0] == '#' || sscanf(line, "%511s %63s", file, codec) < 1)
+      continue;
+    if (file[0] == '/' || strstr(file, "://"))
+      av_strlcpy(path, file, sizeof(path));
+    else
+      snprintf(path, sizeof(path), "%s%s", dir, file);
+    ref_name(ref, sizeof(ref), refdir, file, codec);
+    make_dirs(ref);
+
+    check_sample(path, codec[0] ? codec : NULL, ref, update, &r);
+    if (r.status != RESULT_PASS && r.status != RESULT_NEW)
+      failed++;
+
+    mp_msg(MSGT_GLOBAL, MSGL_INFO, "%-5s %s (%s): %d frames, %.1f fps, %ld kB, %"PRIu64" allocations",
+           result_name[r.status], file, r.codec[0] ? r.codec : "?", r.frames,
+           fps(r.frames, r.decode_time), r.peak_rss, r.allocs);
+    if (r.status == RESULT_FAIL)
+      mp_msg(MSGT_GLOBAL, MSGL_INFO, ", %d of %d frames differ, first %d",
+             r.mismatches + abs(r.frames - r.ref_frames), r.ref_frames, r.first_mismatch);
+    mp_msg(MSGT_GLOBAL, MSGL_INFO, "\n");
+
+    write_sample(out, file, &r, first);
+    first = 0;
+
+    cs = codec_stats(&stats, &nstats, r.codec[0] ? r.codec : "unknown");
+    cs->samples++;
+    cs->failed += r.status != RESULT_PASS && r.status != RESULT_NEW;
+    cs->frames += r.frames;
+    cs->decode_time += r.decode_time;
+    cs->allocs += r.allocs;
+    cs->peak_rss = FFMAX(cs->peak_rss, r.peak_rss);
+  }
+  fprintf(out, "\n  ],\n  \"codecs\": {");
+  for (i = 0; i < nstats; i++) {
+    codec_stats_t *cs = &stats[i];
+    fprintf(out, "%s\n    ", i ? "," : "");
+    json_string(out, cs->name);
+    fprintf(out, ": {\"samples\": %d, \"failed\": %d, \"frames\": %d, "
+                 "\"decode_seconds\": %.6f, \"fps\": %.2f, \"peak_rss_kb\": %ld, "
+                 "\"allocations\": %"PRIu64", \"allocations_per_frame\": %.2f}",
+            cs->samples, cs->failed, cs->frames, cs->decode_time,
+            fps(cs->frames, cs->decode_time), cs->peak_rss, cs->allocs,
+            cs->frames ? (double)cs->allocs / cs->frames : 0);
+  }
+  fprintf(out, "\n  },\n  \"failed\": %d\n}\n", failed);
+
+  fclose(out);
+  fclose(list);
+  free(stats);
+  free(dir);
+  m_config_free(config);
+  return !!failed;
+}
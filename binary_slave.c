@@ -0,0 +1,482 @@
+/*
+ * binary slave mode protocol
+ *
+ * Length prefixed frames on a socket or a pair of pipes, see
+ * DOCS/tech/slave.txt.  Several properties are read or set with one
+ * request, and observed properties are sent only when they change, checked
+ * once per displayed frame.  Every reply carries the position of the frame
+ * on screen.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#if !HAVE_WINSOCK2_H
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#else
+#include <winsock2.h>
+#endif /* HAVE_WINSOCK2_H */
+
+#include "mp_msg.h"
+#include "mp_core.h"
+#include "m_property.h"
+#include "input/input.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/avstring.h"
+#include "binary_slave.h"
+
+#define MAX_FRAME   (64 * 1024)
+#define HEADER_SIZE 9           // size, type, id
+#define REPLY_SIZE  21          // size, type, id, pts, frame
+#define MAX_QUEUED  (1024 * 1024) // unsent replies before giving up on the controller
+
+enum {
+    BIN_COMMAND = 1,
+    BIN_GET,
+    BIN_SET,
+    BIN_OBSERVE,
+    BIN_UNOBSERVE,
+    BIN_STATUS  = 0x81,
+    BIN_VALUES,
+    BIN_NOTIFY,
+};
+
+typedef struct observer {
+    uint32_t id;
+    int num;
+    char **names;
+    char **values;
+    int *status;
+    struct observer *next;
+} observer_t;
+
+char *binary_slave;
+
+static int in_fd = -1, out_fd = -1, failed;
+#if !HAVE_WINSOCK2_H
+static int out_socket;
+#endif
+static unsigned char rbuf[MAX_FRAME + 4];
+static int rlen;
+static unsigned char *wbuf;
+static int wlen, wsize, reply_start;
+static observer_t *observers;
+
+#if HAVE_WINSOCK2_H
+#define read_fd(fd, buf, len)  recv(fd, buf, len, 0)
+#define write_fd(fd, buf, len) send(fd, buf, len, 0)
+#define close_fd(fd)           closesocket(fd)
+#define would_block()          (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#define read_fd(fd, buf, len)  read(fd, buf, len)
+#ifdef MSG_NOSIGNAL
+#define write_fd(fd, buf, len) (out_socket ? send(fd, buf, len, MSG_NOSIGNAL) : write(fd, buf, len))
+#else
+#define write_fd(fd, buf, len) write(fd, buf, len)
+#endif
+#define close_fd(fd)           close(fd)
+#define would_block()          (errno == EAGAIN || errno == EWOULDBLOCK)
+#endif /* HAVE_WINSOCK2_H */
+
+/**
+ * \brief replies must neither block the player nor let a controller that
+ *        went away take it down
+ */
+static void setup_out_fd(void)
+{
+#if HAVE_WINSOCK2_H
+    u_long nonblock = 1;
+    ioctlsocket(out_fd, FIONBIO, &nonblock);
+#else
+    struct stat st;
+    int flags = fcntl(out_fd, F_GETFL);
+    if (flags != -1)
+        fcntl(out_fd, F_SETFL, flags | O_NONBLOCK);
+    out_socket = !fstat(out_fd, &st) && S_ISSOCK(st.st_mode);
+#ifdef MSG_NOSIGNAL
+    if (!out_socket)
+#endif
+        signal(SIGPIPE, SIG_IGN);
+#endif /* HAVE_WINSOCK2_H */
+}
+
+/// "fd", "infd:outfd" or the path of a listening Unix domain socket
+static int open_channel(const char *spec)
+{
+    char *end;
+    long in = strtol(spec, &end, 10), out = in;
+
+    if (end != spec && *end == ':')
+        out = strtol(end + 1, &end, 10);
+    if (end != spec && !*end && in >= 0 && out >= 0) {
+        in_fd  = in;
+        out_fd = out;
+        setup_out_fd();
+        return 0;
+    }
+#if !HAVE_WINSOCK2_H
+    {
+        struct sockaddr_un addr;
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        av_strlcpy(addr.sun_path, spec, sizeof(addr.sun_path));
+        if (fd >= 0 && !connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+            in_fd = out_fd = fd;
+            setup_out_fd();
+            return 0;
+        }
+        if (fd >= 0)
+            close(fd);
+    }
+#endif /* !HAVE_WINSOCK2_H */
+    mp_msg(MSGT_CPLAYER, MSGL_ERR, "Cannot open binary slave connection %s: %s\n",
+           spec, strerror(errno));
+    return -1;
+}
+
+static void free_observer(observer_t *o)
+{
+    int i;
+    for (i = 0; i < o->num; i++) {
+        free(o->names[i]);
+        free(o->values[i]);
+    }
+    free(o->names);
+    free(o->values);
+    free(o->status);
+    free(o);
+}
+
+void binary_slave_uninit(void)
+{
+    if (in_fd >= 0) {
+        if (out_fd != in_fd && out_fd > 2)
+            close_fd(out_fd);
+        if (in_fd > 2)
+            close_fd(in_fd);
+    }
+    in_fd = out_fd = -1;
+    rlen  = wlen = 0;
+    while (observers) {
+        observer_t *o = observers;
+        observers = o->next;
+        free_observer(o);
+    }
+}
+
+static void put_data(const void *data, int len)
+{
+    if (wlen + len > wsize) {
+        wsize = FFMAX(2 * wsize, wlen + len + 4096);
+        wbuf  = realloc(wbuf, wsize);
+    }
+    memcpy(wbuf + wlen, data, len);
+    wlen += len;
+}
+
+static void put_string(const char *str)
+{
+    put_data(str ? str : "", strlen(str ? str : "") + 1);
+}
+
+static void start_reply(MPContext *mpctx, int type, uint32_t id)
+{
+    unsigned char h[REPLY_SIZE];
+    double pts = MP_NOPTS_VALUE;
+    int64_t pts_us = INT64_MIN;
+    unsigned frame = 0;
+
+    if (mpctx->sh_video) {
+        pts   = mpctx->sh_video->pts;
+        frame = mpctx->sh_video->num_frames;
+    } else if (mpctx->sh_audio && mpctx->audio_out)
+        pts = playing_audio_pts(mpctx->sh_audio, mpctx->d_audio, mpctx->audio_out);
+    if (pts != MP_NOPTS_VALUE)
+        pts_us = llrint(pts * 1e6);
+    reply_start = wlen;
+    AV_WB32(h, 0);          // filled in by end_reply()
+    h[4] = type;
+    AV_WB32(h + 5, id);
+    AV_WB64(h + 9, pts_us);
+    AV_WB32(h + 17, frame);
+    put_data(h, REPLY_SIZE);
+}
+
+static void end_reply(void)
+{
+    AV_WB32(wbuf + reply_start, wlen - reply_start - 4);
+}
+
+static void put_value(const char *name, int status, const char *value)
+{
+    unsigned char s = status;
+    put_string(name);
+    put_data(&s, 1);
+    put_string(value);
+}
+
+static void send_status(MPContext *mpctx, uint32_t id, int status)
+{
+    unsigned char s[4];
+    AV_WB32(s, status);
+    start_reply(mpctx, BIN_STATUS, id);
+    put_data(s, 4);
+    end_reply();
+}
+
+/// \return M_PROPERTY_OK with the value in *str or an error code
+static int get_value(MPContext *mpctx, const char *name, char **str)
+{
+    int r = mp_property_do(name, M_PROPERTY_TO_STRING, str, mpctx);
+    if (r <= 0)
+        *str = NULL;
+    return r;
+}
+
+/// split a list of \0 terminated strings, \return the number of strings
+static int split_names(char *payload, int len, char **names)
+{
+    int n = 0;
+    char *p = payload, *end = payload + len;
+    while (p < end) {
+        names[n++] = p;
+        p += strlen(p) + 1;
+    }
+    return n;
+}
+
+static void handle_request(MPContext *mpctx, int type, uint32_t id,
+                           char *payload, int len)
+{
+    char **names;
+    char *val;
+    observer_t *o, **prev;
+    int i, n, r;
+
+    // everything is a \0 terminated string, only UNOBSERVE has no payload
+    if ((!len && type != BIN_UNOBSERVE) || (len && payload[len - 1])) {
+        send_status(mpctx, id, M_PROPERTY_ERROR);
+        return;
+    }
+    names = malloc(len * sizeof(*names));
+    switch (type) {
+    case BIN_COMMAND: {
+        mp_cmd_t *cmd = mp_input_parse_cmd(payload);
+        if (!cmd)
+            r = M_PROPERTY_UNKNOWN;
+        else if (!(r = mp_input_queue_cmd(cmd)))
+            mp_cmd_free(cmd);
+        send_status(mpctx, id, r);
+        break;
+    }
+    case BIN_GET:
+        n = split_names(payload, len, names);
+        start_reply(mpctx, BIN_VALUES, id);
+        for (i = 0; i < n; i++) {
+            r = get_value(mpctx, names[i], &val);
+            put_value(names[i], r, val);
+            free(val);
+        }
+        end_reply();
+        break;
+    case BIN_SET:
+        n = split_names(payload, len, names) & ~1;
+        start_reply(mpctx, BIN_VALUES, id);
+        for (i = 0; i < n; i += 2) {
+            r = mp_property_do(names[i], M_PROPERTY_PARSE, names[i + 1], mpctx);
+            if (r > 0)
+                r = get_value(mpctx, names[i], &val);
+            else
+                val = NULL;
+            put_value(names[i], r, val);
+            free(val);
+        }
+        end_reply();
+        break;
+    case BIN_OBSERVE:
+        n = split_names(payload, len, names);
+        o = calloc(1, sizeof(*o));
+        o->id     = id;
+        o->num    = n;
+        o->names  = calloc(n, sizeof(*o->names));
+        o->values = calloc(n, sizeof(*o->values));
+        o->status = calloc(n, sizeof(*o->status));
+        start_reply(mpctx, BIN_VALUES, id);
+        for (i = 0; i < n; i++) {
+            o->names[i]  = strdup(names[i]);
+            o->status[i] = get_value(mpctx, names[i], &o->values[i]);
+            put_value(names[i], o->status[i], o->values[i]);
+        }
+        end_reply();
+        // a new subscription with the same id replaces the old one
+        for (prev = &observers; *prev; prev = &(*prev)->next)
+            if ((*prev)->id == id) {
+                observer_t *old = *prev;
+                *prev = old->next;
+                free_observer(old);
+                break;
+            }
+        o->next   = observers;
+        observers = o;
+        break;
+    case BIN_UNOBSERVE:
+        r = M_PROPERTY_UNKNOWN;
+        for (prev = &observers; *prev; prev = &(*prev)->next)
+            if ((*prev)->id == id) {
+                o = *prev;
+                *prev = o->next;
+                free_observer(o);
+                r = M_PROPERTY_OK;
+                break;
+            }
+        send_status(mpctx, id, r);
+        break;
+    default:
+        mp_msg(MSGT_CPLAYER, MSGL_WARN, "Binary slave: unknown request %d\n", type);
+        send_status(mpctx, id, M_PROPERTY_NOT_IMPLEMENTED);
+    }
+    free(names);
+}
+
+static void read_requests(MPContext *mpctx)
+{
+    struct timeval tv = { 0, 0 };
+    fd_set fds;
+    int r, pos = 0;
+
+    FD_ZERO(&fds);
+    FD_SET(in_fd, &fds);
+    if (select(in_fd + 1, &fds, NULL, NULL, &tv) <= 0)
+        return;
+    r = read_fd(in_fd, rbuf + rlen, sizeof(rbuf) - rlen);
+    // in_fd can be out_fd, which does not block
+    if (r < 0 && (errno == EINTR || would_block()))
+        return;
+    if (r <= 0) {
+        mp_msg(MSGT_CPLAYER, MSGL_WARN, "Binary slave connection closed.\n");
+        failed = 1;
+        binary_slave_uninit();
+        return;
+    }
+    rlen += r;
+    // all complete requests, several may have arrived at once
+    while (rlen - pos >= 4) {
+        unsigned size = AV_RB32(rbuf + pos);
+        if (size < HEADER_SIZE - 4 || size > MAX_FRAME) {
+            mp_msg(MSGT_CPLAYER, MSGL_ERR, "Binary slave: invalid request size %u\n", size);
+            failed = 1;
+            binary_slave_uninit();
+            return;
+        }
+        if (rlen - pos < size + 4)
+            break;
+        handle_request(mpctx, rbuf[pos + 4], AV_RB32(rbuf + pos + 5),
+                       (char *)rbuf + pos + HEADER_SIZE, size + 4 - HEADER_SIZE);
+        pos += size + 4;
+    }
+    memmove(rbuf, rbuf + pos, rlen - pos);
+    rlen -= pos;
+}
+
+static void check_observers(MPContext *mpctx)
+{
+    observer_t *o;
+    char *val;
+    int i, r;
+
+    for (o = observers; o; o = o->next) {
+        int changed = 0;
+        for (i = 0; i < o->num; i++) {
+            r = get_value(mpctx, o->names[i], &val);
+            if (r == o->status[i] &&
+                (val == o->values[i] || (val && o->values[i] && !strcmp(val, o->values[i])))) {
+                free(val);
+                continue;
+            }
+            if (!changed++)
+                start_reply(mpctx, BIN_NOTIFY, o->id);
+            put_value(o->names[i], r, val);
+            free(o->values[i]);
+            o->values[i] = val;
+            o->status[i] = r;
+        }
+        if (changed)
+            end_reply();
+    }
+}
+
+/// send what the channel takes without blocking, the rest stays queued
+static void flush_replies(void)
+{
+    int pos = 0;
+    while (pos < wlen) {
+        int r = write_fd(out_fd, wbuf + pos, wlen - pos);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0 && would_block())
+            break;
+        if (r <= 0) {
+            mp_msg(MSGT_CPLAYER, MSGL_WARN, "Binary slave: write failed: %s\n",
+                   strerror(errno));
+            failed = 1;
+            binary_slave_uninit();
+            return;
+        }
+        pos += r;
+    }
+    memmove(wbuf, wbuf + pos, wlen - pos);
+    wlen -= pos;
+    if (wlen > MAX_QUEUED) {
+        mp_msg(MSGT_CPLAYER, MSGL_WARN,
+               "Binary slave: %d bytes of replies not read, closing the connection.\n", wlen);
+        failed = 1;
+        binary_slave_uninit();
+    }
+}
+
+/**
+ * \brief answer pending requests and send the observed properties that
+ *        changed, called once per frame and while paused or idle
+ */
+void binary_slave_update(MPContext *mpctx)
+{
+    if (!binary_slave || failed)
+        return;
+    if (in_fd < 0 && open_channel(binary_slave) < 0) {
+        failed = 1;
+        return;
+    }
+    read_requests(mpctx);
+    if (in_fd >= 0)
+        check_observers(mpctx);
+    if (wlen && out_fd >= 0)
+        flush_replies();
+}
@@ -38,6 +38,7 @@
 #include "stream/cdd.h"
 #include "stream/network.h"
 #include "stream/pvr.h"
+#include "stream/rtp.h"
 #include "stream/stream.h"
 #include "stream/stream_radio.h"
 #include "stream/tcp.h"
@@ -183,6 +184,15 @@ const m_option_t mfopts_conf[]={
     {NULL, NULL, 0, 0, 0, 0, NULL}
 };
 
+#if HAVE_PTHREADS
+const m_option_t readahead_conf[]={
+    {"file", &stream_readahead_file, CONF_TYPE_INT, CONF_RANGE, 0, 64, NULL},
+    {"device", &stream_readahead_device, CONF_TYPE_INT, CONF_RANGE, 0, 64, NULL},
+    {"size", &stream_readahead_size, CONF_TYPE_INT, CONF_RANGE, 4, 65536, NULL},
+    {NULL, NULL, 0, 0, 0, 0, NULL}
+};
+#endif /* HAVE_PTHREADS */
+
 #include "libaf/af.h"
 const m_option_t audio_filter_conf[]={
     {"list", &af_cfg.list, CONF_TYPE_STRING_LIST, 0, 0, 0, NULL},
@@ -321,6 +331,15 @@ const m_option_t common_opts[] = {
 #else
     {"cache", "MPlayer was compiled without cache2 support.\n", CONF_TYPE_PRINT, CONF_NOCFG, 0, 0, NULL},
 #endif /* CONFIG_STREAM_CACHE */
+    {"mmap", &stream_file_mmap, CONF_TYPE_FLAG, 0, 0, 1, NULL},
+    {"nommap", &stream_file_mmap, CONF_TYPE_FLAG, 0, 1, 0, NULL},
+    {"stream-buffer", &stream_buffer_max, CONF_TYPE_INT, CONF_RANGE, 2, 65536, NULL},
+    {"reconnect", &stream_reconnect_max, CONF_TYPE_INT, CONF_RANGE, 0, 100, NULL},
+#if HAVE_PTHREADS
+    {"readahead", readahead_conf, CONF_TYPE_SUBCONFIG, 0, 0, 0, NULL},
+#else
+    {"readahead", "MPlayer was compiled without thread support.\n", CONF_TYPE_PRINT, CONF_NOCFG, 0, 0, NULL},
+#endif /* HAVE_PTHREADS */
     {"vcd", "-vcd N has been removed, use vcd://N instead.\n", CONF_TYPE_PRINT, CONF_NOCFG ,0,0, NULL},
     {"cuefile", "-cuefile has been removed, use cue://filename:N where N is the track number.\n", CONF_TYPE_PRINT, 0, 0, 0, NULL},
     {"cdrom-device", &cdrom_device, CONF_TYPE_STRING, 0, 0, 0, NULL},
@@ -354,6 +373,7 @@ const m_option_t common_opts[] = {
     {"user", &network_username, CONF_TYPE_STRING, 0, 0, 0, NULL},
     {"passwd", &network_password, CONF_TYPE_STRING, 0, 0, 0, NULL},
     {"bandwidth", &network_bandwidth, CONF_TYPE_INT, CONF_MIN, 0, 0, NULL},
+    {"http-range", &network_http_range, CONF_TYPE_INT, CONF_RANGE, 0, 1048576, NULL},
     {"http-header-fields", &network_http_header_fields, CONF_TYPE_STRING_LIST, 0, 0, 0, NULL},
     {"user-agent", &network_useragent, CONF_TYPE_STRING, 0, 0, 0, NULL},
     {"referrer", &network_referrer, CONF_TYPE_STRING, 0, 0, 0, NULL},
@@ -397,9 +417,11 @@ const m_option_t common_opts[] = {
 #ifdef CONFIG_NETWORKING
     {"rtsp-port", &rtsp_port, CONF_TYPE_INT, CONF_RANGE, -1, 65535, NULL},
     {"rtsp-destination", &rtsp_destination, CONF_TYPE_STRING, CONF_MIN, 0, 0, NULL},
+    {"rtp-jitter", &rtp_jitter_ms, CONF_TYPE_INT, CONF_RANGE, 0, 10000, NULL},
 #else
     {"rtsp-port", "MPlayer was compiled without networking support.\n", CONF_TYPE_PRINT, CONF_NOCFG, 0, 0, NULL},
     {"rtsp-destination", "MPlayer was compiled without networking support.\n", CONF_TYPE_PRINT, CONF_NOCFG, 0, 0, NULL},
+    {"rtp-jitter", "MPlayer was compiled without networking support.\n", CONF_TYPE_PRINT, CONF_NOCFG, 0, 0, NULL},
 #endif /* CONFIG_NETWORKING */
 
 // ------------------------- demuxer options --------------------
@@ -551,6 +573,9 @@ const m_option_t common_opts[] = {
     {"slices", &vd_use_slices, CONF_TYPE_FLAG, 0, 0, 1, NULL},
     {"noslices", &vd_use_slices, CONF_TYPE_FLAG, 0, 1, 0, NULL},
     {"field-dominance", &field_dominance, CONF_TYPE_INT, CONF_RANGE, -1, 1, NULL},
+    // decode only the keyframes (thumbnails, trick play)
+    {"keyframes-only", &keyframes_only, CONF_TYPE_FLAG, 0, 0, 1, NULL},
+    {"nokeyframes-only", &keyframes_only, CONF_TYPE_FLAG, 0, 1, 0, NULL},
 
 #ifdef CONFIG_FFMPEG
     {"lavdopts", lavc_decode_opts_conf, CONF_TYPE_SUBCONFIG, 0, 0, 0, NULL},
@@ -558,6 +583,9 @@ const m_option_t common_opts[] = {
 #endif
 #ifdef CONFIG_XVID4
     {"xvidopts", xvid_dec_opts, CONF_TYPE_SUBCONFIG, 0, 0, 0, NULL},
+#endif
+#ifdef CONFIG_LIBMPEG2
+    {"libmpeg2opts", libmpeg2_dec_opts, CONF_TYPE_SUBCONFIG, 0, 0, 0, NULL},
 #endif
     {"codecs-file", &codecs_file, CONF_TYPE_STRING, 0, 0, 0, NULL},
 // ------------------------- subtitles options --------------------
@@ -204,6 +204,14 @@ const m_option_t mencoder_opts[]={
     {"pass", "-pass has been removed, use -lavcopts vpass=n, -xvidencopts pass=n\n", CONF_TYPE_PRINT, CONF_NOCFG, 0, 0, NULL},
     {"passlogfile", &passtmpfile, CONF_TYPE_STRING, CONF_GLOBAL, 0, 0, NULL},
 
+    // size of the buffer for writing the output file in a separate thread
+    {"write-cache", &write_cache_size, CONF_TYPE_INT, CONF_RANGE|CONF_GLOBAL, 0, 1048576, NULL},
+    // encode audio in a separate thread
+    {"audio-queue", &audio_queue, CONF_TYPE_INT, CONF_RANGE|CONF_GLOBAL, 0, 64, NULL},
+
+    // encode in parallel processes, one per part of the input
+    {"segments", &segments, CONF_TYPE_INT, CONF_RANGE|CONF_GLOBAL, 1, MAX_SEGMENTS, NULL},
+
     {"vobsubout", &vobsub_out, CONF_TYPE_STRING, CONF_GLOBAL, 0, 0, NULL},
     {"vobsuboutindex", &vobsub_out_index, CONF_TYPE_INT, CONF_RANGE|CONF_GLOBAL, 0, 31, NULL},
     {"vobsuboutid", &vobsub_out_id, CONF_TYPE_STRING, CONF_GLOBAL, 0, 0, NULL},
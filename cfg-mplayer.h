@@ -279,6 +279,7 @@ const m_option_t mplayer_opts[]={
     {"udp-ip", &udp_ip, CONF_TYPE_STRING, 0, 0, 1, NULL},
     {"udp-port", &udp_port, CONF_TYPE_INT, 0, 1, 65535, NULL},
     {"udp-seek-threshold", &udp_seek_threshold, CONF_TYPE_FLOAT, CONF_RANGE, 0.1, 100, NULL},
+    {"binary-slave", &binary_slave, CONF_TYPE_STRING, CONF_GLOBAL, 0, 0, NULL},
 #endif /* CONFIG_NETWORKING */
 
     // dump some stream out instead of playing the file
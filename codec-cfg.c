@@ -3,6 +3,8 @@
  *
  * to compile test application:
  *  cc -I. -DTESTING -o codec-cfg-test codec-cfg.c mp_msg.o osdep/getch2.o -ltermcap
+ * and run it with -check to compare the indexed lookups and the cache with
+ * walking the tables
  * to compile CODECS2HTML:
  *   gcc -DCODECS2HTML -o codecs2html codec-cfg.c
  *
@@ -34,14 +36,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include <ctype.h>
 #include <assert.h>
 #include <string.h>
 
 #include "config.h"
+#if HAVE_SYS_MMAN_H && !defined(CODECS2HTML)
+#include <sys/mman.h>
+#endif
 #include "mp_msg.h"
 #ifdef CODECS2HTML
 #ifdef __GNUC__
@@ -528,6 +537,101 @@ static codecs_t *audio_codecs=NULL;
 static int nr_vcodecs = 0;
 static int nr_acodecs = 0;
 
+/**
+ * One entry per distinct fourcc of a codec, sorted by fourcc and then by
+ * codec position, so the candidates for a fourcc are a contiguous run in
+ * codecs.conf order.
+ */
+typedef struct {
+    unsigned int fourcc;
+    unsigned short codec;   ///< position in video_codecs/audio_codecs
+    unsigned short slot;    ///< first fourcc[] slot of the codec holding it
+} codecs_index_t;
+
+typedef struct {
+    codecs_index_t *entries;
+    int nr_entries;
+    unsigned short *null_codecs;    ///< codecs with the null driver, they take any fourcc
+    int nr_null;
+} codecs_lookup_t;
+
+static codecs_lookup_t video_lookup, audio_lookup;
+/// mapped or read codecs cache the codec tables and indexes point into
+static void *cache_data;
+#if HAVE_SYS_MMAN_H && !defined(CODECS2HTML)
+static size_t cache_size;
+#endif
+
+static int index_cmp(const void *a, const void *b)
+{
+    const codecs_index_t *x = a, *y = b;
+    if (x->fourcc != y->fourcc)
+        return x->fourcc < y->fourcc ? -1 : 1;
+    if (x->codec != y->codec)
+        return x->codec - y->codec;
+    return x->slot - y->slot;
+}
+
+static int build_index(codecs_lookup_t *l, const codecs_t *codecs, int nr)
+{
+    int i, j, n = 0;
+
+    l->entries = malloc(sizeof(*l->entries) * CODECS_MAX_FOURCC * nr + 1);
+    if (!l->entries)
+        return 0;
+    for (i = 0; i < nr; i++)
+        for (j = 0; j < CODECS_MAX_FOURCC; j++)
+            if (codecs[i].fourcc[j] != 0xffffffff) {
+                l->entries[n].fourcc = codecs[i].fourcc[j];
+                l->entries[n].codec  = i;
+                l->entries[n].slot   = j;
+                n++;
+            }
+    qsort(l->entries, n, sizeof(*l->entries), index_cmp);
+    // only the first slot of a fourcc listed twice by a codec is ever used
+    for (i = j = 0; i < n; i++)
+        if (!j || l->entries[i].fourcc != l->entries[j - 1].fourcc ||
+            l->entries[i].codec != l->entries[j - 1].codec)
+            l->entries[j++] = l->entries[i];
+    l->nr_entries = j;
+    return 1;
+}
+
+static int find_null_codecs(codecs_lookup_t *l, const codecs_t *codecs, int nr)
+{
+    int i;
+
+    l->nr_null = 0;
+    l->null_codecs = malloc(sizeof(*l->null_codecs) * nr + 1);
+    if (!l->null_codecs)
+        return 0;
+    for (i = 0; i < nr; i++)
+        // FIXME: do NOT hardwire 'null' name here:
+        if (codecs[i].drv && !strcmp(codecs[i].drv, "null"))
+            l->null_codecs[l->nr_null++] = i;
+    return 1;
+}
+
+static void free_lookup(codecs_lookup_t *l, int free_entries)
+{
+    if (free_entries)
+        free(l->entries);
+    free(l->null_codecs);
+    memset(l, 0, sizeof(*l));
+}
+
+static void init_lookups(void)
+{
+    if (!build_index(&video_lookup, video_codecs, nr_vcodecs) ||
+        !build_index(&audio_lookup, audio_codecs, nr_acodecs) ||
+        !find_null_codecs(&video_lookup, video_codecs, nr_vcodecs) ||
+        !find_null_codecs(&audio_lookup, audio_codecs, nr_acodecs)) {
+        // find_codec() falls back to walking the tables
+        free_lookup(&video_lookup, 1);
+        free_lookup(&audio_lookup, 1);
+    }
+}
+
 int parse_codec_cfg(const char *cfgfile)
 {
     codecs_t *codec = NULL; // current codec
@@ -551,6 +655,7 @@ int parse_codec_cfg(const char *cfgfile)
         audio_codecs = builtin_audio_codecs;
         nr_vcodecs = sizeof(builtin_video_codecs)/sizeof(codecs_t);
         nr_acodecs = sizeof(builtin_audio_codecs)/sizeof(codecs_t);
+        init_lookups();
         return 1;
 #endif
     }
@@ -756,6 +861,7 @@ out:
     free(line);
     line=NULL;
     fclose(fp);
+    init_lookups();
     return 1;
 
 err_out_parse_error:
@@ -792,6 +898,19 @@ static void codecs_free(codecs_t* codecs,int count) {
 }
 
 void codecs_uninit_free(void) {
+    free_lookup(&video_lookup, !cache_data);
+    free_lookup(&audio_lookup, !cache_data);
+    if (cache_data) {
+        // the tables and their strings live in the cache
+#if HAVE_SYS_MMAN_H && !defined(CODECS2HTML)
+        munmap(cache_data, cache_size);
+#else
+        free(cache_data);
+#endif
+        cache_data = NULL;
+        video_codecs = audio_codecs = NULL;
+        return;
+    }
     if (video_codecs)
     codecs_free(video_codecs,nr_vcodecs);
     video_codecs=NULL;
@@ -800,6 +919,292 @@ void codecs_uninit_free(void) {
     audio_codecs=NULL;
 }
 
+#ifndef CODECS2HTML
+/*
+ * codecs cache, a parsed codecs.conf as it is in memory:
+ *
+ *   header
+ *   video codecs, nr_vcodecs + 1 entries including the terminating one
+ *   audio codecs, nr_acodecs + 1 entries
+ *   video index, audio index
+ *   strings, every char * of the codecs holds 1 + its offset in here
+ *
+ * It is mapped privately and the string pointers are fixed up in place.
+ * The cache is only valid for the same source file, modification time and
+ * size and for the same build, otherwise the text is parsed and the cache
+ * written again.
+ */
+#define CODECS_CACHE_MAGIC   "MPCODECS"
+#define CODECS_CACHE_VERSION 1
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t codec_size;    ///< sizeof(codecs_t), catches other builds
+    int64_t  src_mtime;
+    int64_t  src_size;
+    uint32_t src_name;      ///< offset of the source file name in the strings
+    uint32_t release;
+    uint32_t nr_vcodecs, nr_acodecs;
+    uint32_t nr_vindex, nr_aindex;
+    uint32_t strings_size;
+    uint32_t reserved;
+} codecs_cache_header_t;
+
+static size_t cache_tables_size(const codecs_cache_header_t *h)
+{
+    return sizeof(*h) +
+           sizeof(codecs_t) * ((size_t)h->nr_vcodecs + h->nr_acodecs + 2) +
+           sizeof(codecs_index_t) * ((size_t)h->nr_vindex + h->nr_aindex);
+}
+
+static int relocate_string(char **p, char *strings, uint32_t size)
+{
+    uintptr_t off = (uintptr_t)*p;
+    if (!off)
+        return 1;
+    if (off > size)
+        return 0;
+    *p = strings + off - 1;
+    return 1;
+}
+
+static int relocate_codecs(codecs_t *c, int nr, char *strings, uint32_t size)
+{
+    int i;
+    for (i = 0; i < nr; i++, c++)
+        if (!relocate_string(&c->name,    strings, size) ||
+            !relocate_string(&c->info,    strings, size) ||
+            !relocate_string(&c->comment, strings, size) ||
+            !relocate_string(&c->dll,     strings, size) ||
+            !relocate_string(&c->drv,     strings, size))
+            return 0;
+    return 1;
+}
+
+static int check_index(const codecs_index_t *e, int nr, int nr_codecs)
+{
+    int i;
+    for (i = 0; i < nr; i++)
+        if (e[i].codec >= nr_codecs || e[i].slot >= CODECS_MAX_FOURCC ||
+            (i && index_cmp(&e[i - 1], &e[i]) >= 0))
+            return 0;
+    return 1;
+}
+
+static int load_codecs_cache(const char *cachefile, const char *cfgfile,
+                             const struct stat *st)
+{
+    codecs_cache_header_t h;
+    struct stat cst;
+    size_t size;
+    char *data, *strings;
+    int fd = open(cachefile, O_RDONLY | O_BINARY);
+
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &cst) || read(fd, &h, sizeof(h)) != sizeof(h))
+        goto err;
+    size = cache_tables_size(&h);
+    if (memcmp(h.magic, CODECS_CACHE_MAGIC, sizeof(h.magic)) ||
+        h.version != CODECS_CACHE_VERSION || h.codec_size != sizeof(codecs_t) ||
+        h.src_mtime != st->st_mtime || h.src_size != st->st_size ||
+        h.release < CODEC_CFG_MIN || !h.strings_size ||
+        h.nr_vcodecs > 0xffff || h.nr_acodecs > 0xffff ||
+        h.src_name >= h.strings_size ||
+        cst.st_size != (off_t)(size + h.strings_size))
+        goto err;
+    size += h.strings_size;
+#if HAVE_SYS_MMAN_H
+    data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+        goto err;
+    cache_size = size;
+#else
+    if (!(data = malloc(size)) || lseek(fd, 0, SEEK_SET) ||
+        (size_t)read(fd, data, size) != size) {
+        free(data);
+        goto err;
+    }
+#endif
+    close(fd);
+    cache_data = data;
+
+    strings = data + size - h.strings_size;
+    if (strings[h.strings_size - 1] || strcmp(strings + h.src_name, cfgfile))
+        goto err_unmap;
+    video_codecs = (codecs_t *)(data + sizeof(h));
+    audio_codecs = video_codecs + h.nr_vcodecs + 1;
+    video_lookup.entries    = (codecs_index_t *)(audio_codecs + h.nr_acodecs + 1);
+    video_lookup.nr_entries = h.nr_vindex;
+    audio_lookup.entries    = video_lookup.entries + h.nr_vindex;
+    audio_lookup.nr_entries = h.nr_aindex;
+    nr_vcodecs = h.nr_vcodecs;
+    nr_acodecs = h.nr_acodecs;
+    if (!relocate_codecs(video_codecs, nr_vcodecs + 1, strings, h.strings_size) ||
+        !relocate_codecs(audio_codecs, nr_acodecs + 1, strings, h.strings_size) ||
+        !check_index(video_lookup.entries, h.nr_vindex, nr_vcodecs) ||
+        !check_index(audio_lookup.entries, h.nr_aindex, nr_acodecs) ||
+        !find_null_codecs(&video_lookup, video_codecs, nr_vcodecs) ||
+        !find_null_codecs(&audio_lookup, audio_codecs, nr_acodecs))
+        goto err_unmap;
+    codecs_conf_release = h.release;
+    mp_msg(MSGT_CODECCFG, MSGL_V, "Using codecs cache %s for %s.\n",
+           cachefile, cfgfile);
+    mp_msg(MSGT_CODECCFG,MSGL_INFO,MSGTR_AudioVideoCodecTotals, nr_acodecs, nr_vcodecs);
+    return 1;
+
+err_unmap:
+    codecs_uninit_free();
+    nr_vcodecs = nr_acodecs = 0;
+    mp_msg(MSGT_CODECCFG, MSGL_V, "Codecs cache %s is damaged.\n", cachefile);
+    return 0;
+err:
+    close(fd);
+    mp_msg(MSGT_CODECCFG, MSGL_V, "Codecs cache %s is outdated.\n", cachefile);
+    return 0;
+}
+
+static char *cache_string(char *strings, uint32_t *pos, const char *str)
+{
+    size_t len;
+    char *off;
+    if (!str)
+        return NULL;
+    len = strlen(str) + 1;
+    memcpy(strings + *pos, str, len);
+    off = (char *)(uintptr_t)(*pos + 1);
+    *pos += len;
+    return off;
+}
+
+static void cache_codecs(codecs_t *dst, const codecs_t *src, int nr,
+                         char *strings, uint32_t *pos)
+{
+    int i;
+    memcpy(dst, src, sizeof(*dst) * nr);
+    for (i = 0; i < nr; i++) {
+        dst[i].name    = cache_string(strings, pos, src[i].name);
+        dst[i].info    = cache_string(strings, pos, src[i].info);
+        dst[i].comment = cache_string(strings, pos, src[i].comment);
+        dst[i].dll     = cache_string(strings, pos, src[i].dll);
+        dst[i].drv     = cache_string(strings, pos, src[i].drv);
+    }
+}
+
+static size_t codecs_strings_size(const codecs_t *c, int nr)
+{
+    size_t size = 0;
+    for (; nr--; c++) {
+        size += c->name    ? strlen(c->name)    + 1 : 0;
+        size += c->info    ? strlen(c->info)    + 1 : 0;
+        size += c->comment ? strlen(c->comment) + 1 : 0;
+        size += c->dll     ? strlen(c->dll)     + 1 : 0;
+        size += c->drv     ? strlen(c->drv)     + 1 : 0;
+    }
+    return size;
+}
+
+/// write the tables just parsed from cfgfile, failing is harmless
+static void write_codecs_cache(const char *cachefile, const char *cfgfile,
+                               const struct stat *st)
+{
+    codecs_cache_header_t h;
+    codecs_t *codecs;
+    char *data, *tmpfile;
+    uint32_t pos = 0;
+    size_t size, strings_size;
+    int fd, ok;
+
+    if (!video_lookup.null_codecs)
+        return;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CODECS_CACHE_MAGIC, sizeof(h.magic));
+    h.version    = CODECS_CACHE_VERSION;
+    h.codec_size = sizeof(codecs_t);
+    h.src_mtime  = st->st_mtime;
+    h.src_size   = st->st_size;
+    h.release    = codecs_conf_release;
+    h.nr_vcodecs = nr_vcodecs;
+    h.nr_acodecs = nr_acodecs;
+    h.nr_vindex  = video_lookup.nr_entries;
+    h.nr_aindex  = audio_lookup.nr_entries;
+    strings_size = strlen(cfgfile) + 1 +
+                   codecs_strings_size(video_codecs, nr_vcodecs) +
+                   codecs_strings_size(audio_codecs, nr_acodecs);
+    if (strings_size > UINT32_MAX)
+        return;
+    h.strings_size = strings_size;
+    size = cache_tables_size(&h);
+    if (!(data = calloc(1, size + strings_size)))
+        return;
+
+    // the source file name comes first, h.src_name stays 0
+    memcpy(data, &h, sizeof(h));
+    codecs = (codecs_t *)(data + sizeof(h));
+    cache_string(data + size, &pos, cfgfile);
+    // the terminating entries stay zeroed
+    if (video_codecs)
+        cache_codecs(codecs, video_codecs, nr_vcodecs, data + size, &pos);
+    codecs += nr_vcodecs + 1;
+    if (audio_codecs)
+        cache_codecs(codecs, audio_codecs, nr_acodecs, data + size, &pos);
+    codecs += nr_acodecs + 1;
+    memcpy(codecs, video_lookup.entries,
+           sizeof(codecs_index_t) * video_lookup.nr_entries);
+    memcpy((codecs_index_t *)codecs + video_lookup.nr_entries,
+           audio_lookup.entries,
+           sizeof(codecs_index_t) * audio_lookup.nr_entries);
+
+    // several players may start at once, each writes its own file
+    tmpfile = malloc(strlen(cachefile) + 16);
+    if (!tmpfile) {
+        free(data);
+        return;
+    }
+    sprintf(tmpfile, "%s.%d", cachefile, (int)getpid());
+    fd = open(tmpfile, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    ok = fd >= 0 &&
+         (size_t)write(fd, data, size + strings_size) == size + strings_size;
+    if (fd >= 0)
+        ok &= !close(fd);
+#if defined(__MINGW32__) || defined(__OS2__)
+    // rename() does not replace existing files there
+    if (ok)
+        unlink(cachefile);
+#endif
+    if (ok && !rename(tmpfile, cachefile))
+        mp_msg(MSGT_CODECCFG, MSGL_V, "Wrote codecs cache %s.\n", cachefile);
+    else {
+        mp_msg(MSGT_CODECCFG, MSGL_V, "Could not write codecs cache %s.\n",
+               cachefile);
+        unlink(tmpfile);
+    }
+    free(tmpfile);
+    free(data);
+}
+
+int parse_codec_cfg_cached(const char *cfgfile, const char *cachefile)
+{
+    struct stat st;
+
+    if (!cfgfile || !cachefile || stat(cfgfile, &st))
+        return parse_codec_cfg(cfgfile);
+    codecs_uninit_free();
+    nr_vcodecs = nr_acodecs = 0;
+    if (load_codecs_cache(cachefile, cfgfile, &st))
+        return 1;
+    if (!parse_codec_cfg(cfgfile))
+        return 0;
+    write_codecs_cache(cachefile, cfgfile, &st);
+    return 1;
+}
+#endif /* CODECS2HTML */
+
 codecs_t *find_audio_codec(unsigned int fourcc, unsigned int *fourccmap,
                            codecs_t *start, int force)
 {
@@ -812,6 +1217,48 @@ codecs_t *find_video_codec(unsigned int fourcc, unsigned int *fourccmap,
     return find_codec(fourcc, fourccmap, start, 0, force);
 }
 
+/**
+ * Same result as walking the table: the first codec after start either
+ * listing fourcc or using the null driver.
+ */
+static codecs_t *lookup_codec(const codecs_lookup_t *l, codecs_t *codecs,
+                              int nr, unsigned int fourcc,
+                              unsigned int *fourccmap, const codecs_t *start)
+{
+    int first = start ? start - codecs + 1 : 0;
+    int lo = 0, hi = l->nr_entries, i, best = nr, slot = 0;
+
+    if (first < 0)
+        first = 0;
+    // first entry not before (fourcc, first)
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        const codecs_index_t *e = &l->entries[mid];
+        if (e->fourcc < fourcc || (e->fourcc == fourcc && e->codec < first))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < l->nr_entries && l->entries[lo].fourcc == fourcc) {
+        best = l->entries[lo].codec;
+        slot = l->entries[lo].slot;
+    }
+    for (i = 0; i < l->nr_null; i++)
+        if (l->null_codecs[i] >= first) {
+            // the null driver matches before the first fourcc slot
+            if (l->null_codecs[i] <= best) {
+                best = l->null_codecs[i];
+                slot = 0;
+            }
+            break;
+        }
+    if (best >= nr)
+        return NULL;
+    if (fourccmap)
+        *fourccmap = codecs[best].fourccmap[slot];
+    return &codecs[best];
+}
+
 codecs_t* find_codec(unsigned int fourcc,unsigned int *fourccmap,
                      codecs_t *start, int audioflag, int force)
 {
@@ -832,14 +1279,20 @@ codecs_t* find_codec(unsigned int fourcc,unsigned int *fourccmap,
     } else
 #endif
     {
+        codecs_lookup_t *l;
         if (audioflag) {
             i = nr_acodecs;
             c = audio_codecs;
+            l = &audio_lookup;
         } else {
             i = nr_vcodecs;
             c = video_codecs;
+            l = &video_lookup;
         }
         if(!i) return NULL;
+        // unused fourcc slots hold 0xffffffff, only walking finds those
+        if (l->null_codecs && !force && fourcc != 0xffffffff)
+            return lookup_codec(l, c, i, fourcc, fourccmap, start);
         for (/* NOTHING */; i--; c++) {
             if(start && c<=start) continue;
             for (j = 0; j < CODECS_MAX_FOURCC; j++) {
@@ -1178,11 +1631,112 @@ int main(int argc, char* argv[])
 #endif
 
 #ifdef TESTING
-int main(void)
+/// the lookup as it was done before the fourcc index
+static codecs_t *linear_find_codec(unsigned int fourcc, unsigned int *fourccmap,
+                                   codecs_t *start, int audioflag)
+{
+    codecs_t *c = audioflag ? audio_codecs : video_codecs;
+    int i = audioflag ? nr_acodecs : nr_vcodecs, j;
+    for (/* NOTHING */; i--; c++) {
+        if (start && c <= start) continue;
+        for (j = 0; j < CODECS_MAX_FOURCC; j++)
+            if (c->fourcc[j] == fourcc || !strcmp(c->drv, "null")) {
+                *fourccmap = c->fourccmap[j];
+                return c;
+            }
+    }
+    return NULL;
+}
+
+/// every fourcc of every codec, followed through all candidates
+static int check_lookups(const char *what)
+{
+    int audioflag, fail = 0, lookups = 0;
+
+    for (audioflag = 0; audioflag < 2; audioflag++) {
+        codecs_t *codecs = audioflag ? audio_codecs : video_codecs;
+        int nr = audioflag ? nr_acodecs : nr_vcodecs, i, j;
+        for (i = 0; i <= nr; i++)
+            for (j = 0; j < CODECS_MAX_FOURCC; j++) {
+                // an unknown fourcc with the last one
+                unsigned int fourcc = i < nr ? codecs[i].fourcc[j] : 0x12345678;
+                unsigned int map_a = 0, map_b = 0;
+                codecs_t *a = NULL, *b = NULL;
+                if (fourcc == 0xffffffff || (i == nr && j))
+                    continue;
+                do {
+                    a = find_codec(fourcc, &map_a, a, audioflag, 0);
+                    b = linear_find_codec(fourcc, &map_b, b, audioflag);
+                    lookups++;
+                    if (a != b || (a && map_a != map_b)) {
+                        printf("%s: %08X gives %s instead of %s\n", what, fourcc,
+                               a ? a->name : "nothing", b ? b->name : "nothing");
+                        fail = 1;
+                        break;
+                    }
+                } while (a);
+            }
+    }
+    printf("%s: %s, %d lookups\n", what, fail ? "FAILED" : "ok", lookups);
+    return fail;
+}
+
+static int check_cache(const char *cfgfile, const char *cachefile)
+{
+    codecs_t *v, *a;
+    int nv, na, i, fail = 0;
+
+    unlink(cachefile);
+    if (!parse_codec_cfg_cached(cfgfile, cachefile))
+        return 1;
+    // keep the parsed tables to compare with
+    v = video_codecs;  nv = nr_vcodecs;  video_codecs = NULL;
+    a = audio_codecs;  na = nr_acodecs;  audio_codecs = NULL;
+    codecs_uninit_free();
+    if (!parse_codec_cfg_cached(cfgfile, cachefile) || !cache_data ||
+        nv != nr_vcodecs || na != nr_acodecs)
+        fail = 1;
+    for (i = 0; i < nv + na && !fail; i++) {
+        codecs_t *x = i < nv ? &v[i] : &a[i - nv];
+        codecs_t *y = i < nv ? &video_codecs[i] : &audio_codecs[i - nv];
+        fail = memcmp(x->fourcc, y->fourcc, offsetof(codecs_t, name)) ||
+               strcmp(x->name, y->name) || strcmp(x->info, y->info) ||
+               strcmp(x->drv, y->drv) ||
+               (x->dll ? !y->dll || strcmp(x->dll, y->dll) : !!y->dll) ||
+               (x->comment ? !y->comment || strcmp(x->comment, y->comment)
+                           : !!y->comment) ||
+               memcmp(&x->guid, &y->guid, sizeof(x->guid)) ||
+               x->flags != y->flags || x->status != y->status ||
+               x->cpuflags != y->cpuflags;
+        if (fail)
+            printf("cache: codec %s differs\n", x->name);
+    }
+    printf("cache: %s, %d video and %d audio codecs\n",
+           fail ? "FAILED" : "ok", nv, na);
+    codecs_free(v, nv);
+    codecs_free(a, na);
+    fail |= check_lookups("cached lookups");
+    unlink(cachefile);
+    return fail;
+}
+
+int main(int argc, char *argv[])
 {
     codecs_t *c;
     int i,j, nr_codecs, state;
 
+    if (argc > 1 && !strcmp(argv[1], "-check")) {
+        int fail = 0;
+        if (parse_codec_cfg(NULL))
+            fail |= check_lookups("builtin lookups");
+        // the builtin tables are not ours to free
+        video_codecs = audio_codecs = NULL;
+        if (!parse_codec_cfg("etc/codecs.conf"))
+            return 1;
+        fail |= check_lookups("lookups");
+        fail |= check_cache("etc/codecs.conf", "codecs.cache.test");
+        return fail;
+    }
     if (!(parse_codec_cfg("etc/codecs.conf")))
         return 0;
     if (!video_codecs)
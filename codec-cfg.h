@@ -77,6 +77,8 @@ typedef struct codecs {
 } codecs_t;
 
 int parse_codec_cfg(const char *cfgfile);
+/// like parse_codec_cfg(), reusing the tables saved in cachefile if still valid
+int parse_codec_cfg_cached(const char *cfgfile, const char *cachefile);
 codecs_t* find_video_codec(unsigned int fourcc, unsigned int *fourccmap,
                            codecs_t *start, int force);
 codecs_t* find_audio_codec(unsigned int fourcc, unsigned int *fourccmap,
@@ -362,6 +362,36 @@ static int mp_property_stream_length(m_option_t *prop, int action,
     return M_PROPERTY_NOT_IMPLEMENTED;
 }
 
+/// Number of times the stream connection was reopened (RO)
+static int mp_property_stream_reconnects(m_option_t *prop, int action,
+                                         void *arg, MPContext *mpctx)
+{
+    if (!mpctx->demuxer || !mpctx->demuxer->stream)
+        return M_PROPERTY_UNAVAILABLE;
+    return m_property_int_ro(prop, action, arg,
+                             mpctx->demuxer->stream->reconnects);
+}
+
+/// Number of failed reconnect attempts (RO)
+static int mp_property_stream_reconnect_retries(m_option_t *prop, int action,
+                                                void *arg, MPContext *mpctx)
+{
+    if (!mpctx->demuxer || !mpctx->demuxer->stream)
+        return M_PROPERTY_UNAVAILABLE;
+    return m_property_int_ro(prop, action, arg,
+                             mpctx->demuxer->stream->reconnect_retries);
+}
+
+/// Total time spent reconnecting in seconds (RO)
+static int mp_property_stream_reconnect_time(m_option_t *prop, int action,
+                                             void *arg, MPContext *mpctx)
+{
+    if (!mpctx->demuxer || !mpctx->demuxer->stream)
+        return M_PROPERTY_UNAVAILABLE;
+    return m_property_time_ro(prop, action, arg,
+                              mpctx->demuxer->stream->reconnect_time);
+}
+
 /// Current stream position in seconds (RO)
 static int mp_property_stream_time_pos(m_option_t *prop, int action,
                                        void *arg, MPContext *mpctx)
@@ -2133,6 +2163,12 @@ static const m_option_t mp_properties[] = {
      M_OPT_MIN, 0, 0, NULL },
     { "stream_time_pos", mp_property_stream_time_pos, CONF_TYPE_TIME,
      M_OPT_MIN, 0, 0, NULL },
+    { "stream_reconnects", mp_property_stream_reconnects, CONF_TYPE_INT,
+     M_OPT_MIN, 0, 0, NULL },
+    { "stream_reconnect_retries", mp_property_stream_reconnect_retries,
+     CONF_TYPE_INT, M_OPT_MIN, 0, 0, NULL },
+    { "stream_reconnect_time", mp_property_stream_reconnect_time,
+     CONF_TYPE_TIME, M_OPT_MIN, 0, 0, NULL },
     { "length", mp_property_length, CONF_TYPE_TIME,
      M_OPT_MIN, 0, 0, NULL },
     { "percent_pos", mp_property_percent_pos, CONF_TYPE_INT,
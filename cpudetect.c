@@ -23,6 +23,10 @@
 CpuCaps gCpuCaps;
 
 #include <stdlib.h>
+#include <unistd.h>
+#ifdef __MINGW32__
+#include <windows.h>
+#endif
 
 #if ARCH_X86
 
@@ -537,3 +541,21 @@ void GetCpuCaps( CpuCaps *caps)
         mp_msg(MSGT_CPUDETECT,MSGL_V, "CPU: Tensilica Xtensa\n" );
 }
 #endif /* !ARCH_X86 */
+
+/**
+ * \brief number of processors available, used for the default thread count
+ * \return 1 if it cannot be determined
+ */
+int GetCpuCount(void)
+{
+#ifdef __MINGW32__
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors > 0 ? si.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+#else
+    return 1;
+#endif
+}
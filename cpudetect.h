@@ -28,6 +28,14 @@
 
 #include "libavutil/x86_cpu.h"
 
+/* Clobber list entries for the XMM registers used by inline asm, the
+ * compiler only knows them when it may keep floats in SSE registers. */
+#ifdef __SSE__
+#define XMM_CLOBBERS(...) , __VA_ARGS__
+#else
+#define XMM_CLOBBERS(...)
+#endif
+
 typedef struct cpucaps_s {
     int cpuType;
     int cpuModel;
@@ -53,6 +61,8 @@ void do_cpuid(unsigned int ax, unsigned int *p);
 
 void GetCpuCaps(CpuCaps *caps);
 
+int GetCpuCount(void);
+
 /* returned value is malloc()'ed so free() it after use */
 char *GetCpuFriendlyName(unsigned int regs[], unsigned int regs2[]);
 
@@ -28,6 +28,17 @@
 #include <sys/time.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#if HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+#if HAVE_POLL_H
+#include <sys/poll.h>
+#endif
+#if HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
 
 #include "input.h"
 #include "mouse.h"
@@ -211,6 +222,15 @@ static const mp_cmd_t mp_cmds[] = {
   { 0, NULL, 0, {} }
 };
 
+#define CMD_HASH_SIZE 512
+
+/// Full command names, each mapped to the command an abbreviation of the
+/// same letters would select, index + 1 or 0 for unused entries.
+static struct {
+  short name, cmd;
+} cmd_hash[CMD_HASH_SIZE];
+static int cmd_hash_init;
+
 /// The names of the keys as used in input.conf
 /// If you add some new keys, you also need to add them here
 
@@ -537,6 +557,7 @@ typedef struct mp_input_fd {
   unsigned got_cmd : 1;
   unsigned no_select : 1;
   unsigned no_readfunc_retval : 1;
+  unsigned ready : 1;
   // These fields are for the cmd fds.
   char* buffer;
   int pos,size;
@@ -637,6 +658,237 @@ static const m_option_t mp_input_opts[] = {
 static int
 mp_input_default_cmd_func(int fd,char* buf, int l);
 
+// Waiting for the input fds: epoll keeps the set registered, poll
+// rebuilds its array only when the fds change.  A write to the wakeup fd
+// (an eventfd or a pipe) makes a waiting read_events() return early.
+static int reactor_init_done;
+static int wakeup_fds[2] = { -1, -1 };
+#if HAVE_EPOLL
+static int epoll_fd = -1;
+#endif
+#if HAVE_POLL_H
+static struct pollfd poll_fds[MP_MAX_KEY_FD + MP_MAX_CMD_FD + 1];
+static int num_poll_fd, poll_dirty = 1;
+#endif
+
+static void
+reactor_add(int fd) {
+#if HAVE_EPOLL
+  if(epoll_fd >= 0) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    // the same fd may be registered as key and as cmd fd
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0 && errno != EEXIST) {
+      // regular files (stdin redirected from a file) cannot be epolled
+      mp_msg(MSGT_INPUT, MSGL_V, "Cannot epoll fd %d (%s), using poll()\n",
+             fd, strerror(errno));
+      close(epoll_fd);
+      epoll_fd = -1;
+    }
+  }
+#endif
+#if HAVE_POLL_H
+  poll_dirty = 1;
+#endif
+}
+
+static void
+reactor_del(int fd) {
+  unsigned int i;
+  for(i = 0; i < num_key_fd; i++)
+    if(key_fds[i].fd == fd && !key_fds[i].no_select)
+      return;
+  for(i = 0; i < num_cmd_fd; i++)
+    if(cmd_fds[i].fd == fd && !cmd_fds[i].no_select)
+      return;
+#if HAVE_EPOLL
+  if(epoll_fd >= 0)
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+#if HAVE_POLL_H
+  poll_dirty = 1;
+#endif
+}
+
+static void
+reactor_init(void) {
+  unsigned int i;
+  if(reactor_init_done)
+    return;
+  reactor_init_done = 1;
+#if HAVE_EPOLL
+  epoll_fd = epoll_create(MP_MAX_KEY_FD + MP_MAX_CMD_FD + 1);
+  if(epoll_fd >= 0)
+    fcntl(epoll_fd, F_SETFD, FD_CLOEXEC);
+#endif
+#if HAVE_EVENTFD
+  wakeup_fds[0] = wakeup_fds[1] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#elif HAVE_POLL_H || defined(HAVE_POSIX_SELECT)
+  if(pipe(wakeup_fds) < 0)
+    wakeup_fds[0] = wakeup_fds[1] = -1;
+  else
+    for(i = 0; i < 2; i++) {
+      fcntl(wakeup_fds[i], F_SETFD, FD_CLOEXEC);
+      fcntl(wakeup_fds[i], F_SETFL, fcntl(wakeup_fds[i], F_GETFL) | O_NONBLOCK);
+    }
+#endif
+  if(wakeup_fds[0] >= 0)
+    reactor_add(wakeup_fds[0]);
+  // fds registered before the first wait
+  for(i = 0; i < num_key_fd; i++)
+    if(!key_fds[i].no_select)
+      reactor_add(key_fds[i].fd);
+  for(i = 0; i < num_cmd_fd; i++)
+    if(!cmd_fds[i].no_select)
+      reactor_add(cmd_fds[i].fd);
+}
+
+static void
+reactor_uninit(void) {
+#if HAVE_EPOLL
+  if(epoll_fd >= 0)
+    close(epoll_fd);
+  epoll_fd = -1;
+#endif
+  if(wakeup_fds[1] >= 0 && wakeup_fds[1] != wakeup_fds[0])
+    close(wakeup_fds[1]);
+  if(wakeup_fds[0] >= 0)
+    close(wakeup_fds[0]);
+  wakeup_fds[0] = wakeup_fds[1] = -1;
+  reactor_init_done = 0;
+}
+
+void
+mp_input_wakeup(void) {
+#if HAVE_EVENTFD
+  uint64_t one = 1;
+#else
+  char one = 1;
+#endif
+  // when it fails a wakeup is pending anyway
+  if(wakeup_fds[1] >= 0 && write(wakeup_fds[1], &one, sizeof(one)) < 0)
+    return;
+}
+
+static void
+mark_ready(int fd) {
+  unsigned int i;
+  if(fd == wakeup_fds[0]) {
+    char buf[64];
+    while(read(fd, buf, sizeof(buf)) > 0)
+      /* NOTHING */;
+    return;
+  }
+  for(i = 0; i < num_key_fd; i++)
+    if(key_fds[i].fd == fd)
+      key_fds[i].ready = 1;
+  for(i = 0; i < num_cmd_fd; i++)
+    if(cmd_fds[i].fd == fd)
+      cmd_fds[i].ready = 1;
+}
+
+/**
+ * \brief wait until one of the fds can be read or time ms have passed
+ * \param time negative to wait without timeout
+ */
+static void
+wait_events(int time) {
+  unsigned int i;
+  int n;
+
+  reactor_init();
+  for(i = 0; i < num_key_fd; i++)
+    key_fds[i].ready = 0;
+  for(i = 0; i < num_cmd_fd; i++)
+    cmd_fds[i].ready = 0;
+
+#if HAVE_EPOLL
+  if(epoll_fd >= 0) {
+    struct epoll_event ev[MP_MAX_KEY_FD + MP_MAX_CMD_FD + 1];
+    n = epoll_wait(epoll_fd, ev, MP_MAX_KEY_FD + MP_MAX_CMD_FD + 1, time);
+    if(n < 0 && errno != EINTR)
+      mp_msg(MSGT_INPUT, MSGL_ERR, MSGTR_INPUT_INPUT_ErrSelect, strerror(errno));
+    for(i = 0; (int)i < n; i++)
+      mark_ready(ev[i].data.fd);
+    return;
+  }
+#endif
+#if HAVE_POLL_H
+  if(poll_dirty) {
+    num_poll_fd = 0;
+    if(wakeup_fds[0] >= 0)
+      poll_fds[num_poll_fd++].fd = wakeup_fds[0];
+    for(i = 0; i < num_key_fd; i++)
+      if(!key_fds[i].no_select)
+        poll_fds[num_poll_fd++].fd = key_fds[i].fd;
+    for(i = 0; i < num_cmd_fd; i++)
+      if(!cmd_fds[i].no_select)
+        poll_fds[num_poll_fd++].fd = cmd_fds[i].fd;
+    for(n = 0; n < num_poll_fd; n++)
+      poll_fds[n].events = POLLIN;
+    poll_dirty = 0;
+  }
+  if(!num_poll_fd) {
+    if(time > 0)
+      usec_sleep(time * 1000);
+    return;
+  }
+  n = poll(poll_fds, num_poll_fd, time);
+  if(n < 0 && errno != EINTR)
+    mp_msg(MSGT_INPUT, MSGL_ERR, MSGTR_INPUT_INPUT_ErrSelect, strerror(errno));
+  for(i = 0; n > 0 && (int)i < num_poll_fd; i++)
+    if(poll_fds[i].revents)
+      mark_ready(poll_fds[i].fd);
+#elif defined(HAVE_POSIX_SELECT)
+  {
+    struct timeval tv, *time_val = NULL;
+    fd_set fds;
+    int max_fd = wakeup_fds[0];
+    FD_ZERO(&fds);
+    if(wakeup_fds[0] >= 0)
+      FD_SET(wakeup_fds[0], &fds);
+    for(i = 0; i < num_key_fd; i++) {
+      if(key_fds[i].no_select)
+        continue;
+      if(key_fds[i].fd > max_fd)
+        max_fd = key_fds[i].fd;
+      FD_SET(key_fds[i].fd, &fds);
+    }
+    for(i = 0; i < num_cmd_fd; i++) {
+      if(cmd_fds[i].no_select)
+        continue;
+      if(cmd_fds[i].fd > max_fd)
+        max_fd = cmd_fds[i].fd;
+      FD_SET(cmd_fds[i].fd, &fds);
+    }
+    if(max_fd < 0) {
+      if(time > 0)
+        usec_sleep(time * 1000);
+      return;
+    }
+    if(time >= 0) {
+      tv.tv_sec = time / 1000;
+      tv.tv_usec = (time % 1000) * 1000;
+      time_val = &tv;
+    }
+    if(select(max_fd + 1, &fds, NULL, NULL, time_val) < 0) {
+      if(errno != EINTR)
+        mp_msg(MSGT_INPUT, MSGL_ERR, MSGTR_INPUT_INPUT_ErrSelect,
+               strerror(errno));
+      FD_ZERO(&fds);
+    }
+    for(n = 0; n <= max_fd; n++)
+      if(FD_ISSET(n, &fds))
+        mark_ready(n);
+  }
+#else
+  if(time > 0)
+    usec_sleep(time * 1000);
+#endif
+}
+
 static char*
 mp_input_get_key_name(int key);
 
@@ -658,6 +910,8 @@ mp_input_add_cmd_fd(int fd, int select, mp_cmd_func_t read_func, mp_close_func_t
   cmd_fds[num_cmd_fd].close_func = close_func;
   cmd_fds[num_cmd_fd].no_select = !select;
   num_cmd_fd++;
+  if(select && reactor_init_done)
+    reactor_add(fd);
 
   return 1;
 }
@@ -679,6 +933,7 @@ mp_input_rm_cmd_fd(int fd) {
   if(i + 1 < num_cmd_fd)
     memmove(&cmd_fds[i],&cmd_fds[i+1],(num_cmd_fd - i - 1)*sizeof(mp_input_fd_t));
   num_cmd_fd--;
+  reactor_del(fd);
 }
 
 void
@@ -697,6 +952,7 @@ mp_input_rm_key_fd(int fd) {
   if(i + 1 < num_key_fd)
     memmove(&key_fds[i],&key_fds[i+1],(num_key_fd - i - 1)*sizeof(mp_input_fd_t));
   num_key_fd--;
+  reactor_del(fd);
 }
 
 int
@@ -716,6 +972,8 @@ mp_input_add_key_fd(int fd, int select, mp_key_func_t read_func, mp_close_func_t
   key_fds[num_key_fd].close_func = close_func;
   key_fds[num_key_fd].no_select = !select;
   num_key_fd++;
+  if(select && reactor_init_done)
+    reactor_add(fd);
 
   return 1;
 }
@@ -738,6 +996,8 @@ mp_input_add_event_fd(int fd, void (*read_func)(void))
   key_fds[num_key_fd].close_func = NULL;
   key_fds[num_key_fd].no_readfunc_retval = 1;
   num_key_fd++;
+  if(reactor_init_done)
+    reactor_add(fd);
 
   return 1;
 }
@@ -770,6 +1030,39 @@ int mp_input_parse_and_queue_cmds(const char *str) {
     return cmd_num;
 }
 
+static int
+find_cmd(const char* str, int l) {
+  unsigned int h;
+  int i, j;
+
+  if(!cmd_hash_init) {
+    for(i=0; mp_cmds[i].name != NULL; i++) {
+      h = m_option_hash_name(mp_cmds[i].name, INT_MAX) % CMD_HASH_SIZE;
+      while(cmd_hash[h].name)
+        h = (h + 1) % CMD_HASH_SIZE;
+      for(j=0; strncasecmp(mp_cmds[j].name,mp_cmds[i].name,strlen(mp_cmds[i].name)); j++)
+        /* NOTHING */;
+      cmd_hash[h].name = i + 1;
+      cmd_hash[h].cmd = j + 1;
+    }
+    cmd_hash_init = 1;
+  }
+
+  h = m_option_hash_name(str, l) % CMD_HASH_SIZE;
+  for( ; cmd_hash[h].name ; h = (h + 1) % CMD_HASH_SIZE) {
+    const char* name = mp_cmds[cmd_hash[h].name-1].name;
+    if(strlen(name) == l && strncasecmp(name,str,l) == 0)
+      return cmd_hash[h].cmd - 1;
+  }
+
+  // abbreviated, the first command starting with it
+  for(i=0; mp_cmds[i].name != NULL; i++) {
+    if(strncasecmp(mp_cmds[i].name,str,l) == 0)
+      break;
+  }
+  return i;
+}
+
 mp_cmd_t*
 mp_input_parse_cmd(char* str) {
   int i,l;
@@ -810,10 +1103,7 @@ mp_input_parse_cmd(char* str) {
   if(l == 0)
     return NULL;
 
-  for(i=0; mp_cmds[i].name != NULL; i++) {
-    if(strncasecmp(mp_cmds[i].name,str,l) == 0)
-      break;
-  }
+  i = find_cmd(str, l);
 
   if(mp_cmds[i].name == NULL)
     return NULL;
@@ -1219,9 +1509,6 @@ static mp_cmd_t *read_events(int time, int paused)
     int i;
     int got_cmd = 0;
     mp_cmd_t *autorepeat_cmd;
-#ifdef HAVE_POSIX_SELECT
-    fd_set fds;
-#endif
     for (i = 0; i < num_key_fd; i++)
 	if (key_fds[i].dead) {
 	    mp_input_rm_key_fd(key_fds[i].fd);
@@ -1234,55 +1521,12 @@ static mp_cmd_t *read_events(int time, int paused)
 	}
 	else if (cmd_fds[i].got_cmd)
 	    got_cmd = 1;
-#ifdef HAVE_POSIX_SELECT
-    FD_ZERO(&fds);
-    if (!got_cmd) {
-	int max_fd = 0, num_fd = 0;
-	for (i = 0; i < num_key_fd; i++) {
-	    if (key_fds[i].no_select)
-		continue;
-	    if (key_fds[i].fd > max_fd)
-		max_fd = key_fds[i].fd;
-	    FD_SET(key_fds[i].fd, &fds);
-	    num_fd++;
-	}
-	for (i = 0; i < num_cmd_fd; i++) {
-	    if (cmd_fds[i].no_select)
-		continue;
-	    if (cmd_fds[i].fd > max_fd)
-		max_fd = cmd_fds[i].fd;
-	    FD_SET(cmd_fds[i].fd, &fds);
-	    num_fd++;
-	}
-	if (num_fd > 0) {
-	    struct timeval tv, *time_val;
-	    if (time >= 0) {
-		tv.tv_sec = time / 1000;
-		tv.tv_usec = (time % 1000) * 1000;
-		time_val = &tv;
-	    }
-	    else
-		time_val = NULL;
-	    if (select(max_fd + 1, &fds, NULL, NULL, time_val) < 0) {
-		if (errno != EINTR)
-		    mp_msg(MSGT_INPUT, MSGL_ERR, MSGTR_INPUT_INPUT_ErrSelect,
-			    strerror(errno));
-		FD_ZERO(&fds);
-	    }
-	}
-    }
-#else
-    if (!got_cmd && time)
-	usec_sleep(time * 1000);
-#endif
-
+    wait_events(got_cmd ? 0 : time);
 
     for (i = 0; i < num_key_fd; i++) {
 	int code;
-#ifdef HAVE_POSIX_SELECT
-	if (!key_fds[i].no_select && !FD_ISSET(key_fds[i].fd, &fds))
+	if (!key_fds[i].no_select && !key_fds[i].ready)
 	    continue;
-#endif
 
 	if (key_fds[i].no_readfunc_retval) {   // getch2 handler special-cased for now
 	    ((void (*)(void))key_fds[i].read_func)();
@@ -1315,11 +1559,9 @@ static mp_cmd_t *read_events(int time, int paused)
     for (i = 0; i < num_cmd_fd; i++) {
 	char *cmd;
 	int r;
-#ifdef HAVE_POSIX_SELECT
-	if (!cmd_fds[i].no_select && !FD_ISSET(cmd_fds[i].fd, &fds) &&
+	if (!cmd_fds[i].no_select && !cmd_fds[i].ready &&
 	    !cmd_fds[i].got_cmd)
 	    continue;
-#endif
 	r = mp_input_read_cmd(&cmd_fds[i], &cmd);
 	if (r >= 0) {
 	    mp_cmd_t *ret = mp_input_parse_cmd(cmd);
@@ -1852,6 +2094,7 @@ mp_input_uninit(void) {
     cmd_binds_section=bind_section;
   }
   cmd_binds_section=NULL;
+  reactor_uninit();
 }
 
 void
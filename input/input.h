@@ -271,6 +271,10 @@ int mp_input_add_event_fd(int fd, void (*read_func)(void));
 
 void mp_input_rm_event_fd(int fd);
 
+// Makes mp_input_get_cmd() return at once when it is waiting for input,
+// can be called from other threads and signal handlers.
+void mp_input_wakeup(void);
+
 /// Get input key from its name.
 int mp_input_get_key_from_name(const char *name);
 
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "osdep/strsep.h"
+#include "osdep/timer.h"
 #include "libmpcodecs/dec_audio.h"
 
 #include "af.h"
@@ -572,12 +573,31 @@ af_data_t* af_play(af_stream_t* s, af_data_t* data)
   // Iterate through all filters
   do{
     if (data->len <= 0) break;
-    data=af->play(af,data);
+    if (s->cfg.benchmark) {
+      unsigned int t = GetTimer();
+      af->audio_len += (double)data->len /
+                       (data->rate * data->nch * data->bps);
+      data=af->play(af,data);
+      af->time_usage += (GetTimer() - t) * 0.000001;
+    } else
+      data=af->play(af,data);
     af=af->next;
   }while(af && data);
   return data;
 }
 
+void af_print_benchmark(af_stream_t* s)
+{
+  af_instance_t* af=s->first;
+  while(af){
+    mp_msg(MSGT_AFILTER, MSGL_INFO,
+           "BENCHMARKaf: %-14s %8.3fs for %8.3fs of audio = %8.1fx realtime\n",
+           af->info->name, af->time_usage, af->audio_len,
+           af->time_usage > 0 ? af->audio_len / af->time_usage : 0);
+    af=af->next;
+  }
+}
+
 /* Calculate the minimum output buffer size for given input data d
  * when using the RESIZE_LOCAL_BUFFER macro. The +t+1 part ensures the
  * value is >= len*mul rounded upwards to whole samples even if the
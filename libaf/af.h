@@ -78,6 +78,8 @@ typedef struct af_instance_s
 		 * corresponding output */
   double mul; /* length multiplier: how much does this instance change
 		 the length of the buffer. */
+  double time_usage; // benchmark: seconds spent in play()
+  double audio_len;  // benchmark: seconds of audio passed to play()
 }af_instance_t;
 
 // Initialization flags
@@ -103,6 +105,7 @@ typedef struct af_cfg_s{
   int force;	// Initialization type
   char** list;	/* list of names of filters that are added to filter
 		   list during first initialization of stream */
+  int benchmark;	// measure the time spent in each filter
 }af_cfg_t;
 
 // Current audio stream
@@ -224,6 +227,11 @@ double af_calc_filter_multiplier(af_stream_t* s);
  */
 double af_calc_delay(af_stream_t* s);
 
+/**
+ * \brief print the time spent in each filter, needs cfg.benchmark
+ */
+void af_print_benchmark(af_stream_t* s);
+
 /** \} */ // end of af_chain group
 
 // Helper functions and macros used inside the audio filters
@@ -35,7 +35,9 @@
 #include <string.h>
 #include <limits.h>
 
+#include "config.h"
 #include "af.h"
+#include "cpudetect.h"
 #include "libavutil/common.h"
 #include "subopt-helper.h"
 #include "help_mp.h"
@@ -68,12 +70,16 @@ typedef struct af_scaletempo_s
   int     num_channels;
   void*   buf_pre_corr;
   void*   table_window;
+  int     search_step;
+  int     samples_pre_corr;
+  float   (*corr_float)(const float* ppc, const float* ps, int len);
   int     (*best_overlap_offset)(struct af_scaletempo_s* s);
   // command line
   float   scale_nominal;
   float   ms_stride;
   float   percent_overlap;
   float   ms_search;
+  int     search_coarse;
   short   speed_tempo;
   short   speed_pitch;
 } af_scaletempo_t;
@@ -117,11 +123,94 @@ static int fill_queue(struct af_instance_s* af, af_data_t* data, int offset)
 
 #define UNROLL_PADDING (4*4)
 
+static float corr_float_c(const float *ppc, const float *ps, int len)
+{
+  float corr = 0;
+  int i;
+  for (i=0; i<len; i++) {
+    corr += *ppc++ * *ps++;
+  }
+  return corr;
+}
+
+#if HAVE_SSE
+/* len must be a multiple of 4, buf_pre_corr is zero padded accordingly */
+static float corr_float_sse(const float *ppc, const float *ps, int len)
+{
+  float corr;
+  x86_reg i = -4 * len;
+  __asm__ volatile(
+    "xorps         %%xmm0, %%xmm0 \n\t"
+    "1: \n\t"
+    "movups      (%2,%0), %%xmm1 \n\t"
+    "movups      (%3,%0), %%xmm2 \n\t"
+    "mulps         %%xmm2, %%xmm1 \n\t"
+    "addps         %%xmm1, %%xmm0 \n\t"
+    "add              $16, %0     \n\t"
+    "jl 1b \n\t"
+    "movhlps       %%xmm0, %%xmm1 \n\t"
+    "addps         %%xmm1, %%xmm0 \n\t"
+    "movaps        %%xmm0, %%xmm1 \n\t"
+    "shufps   $0x55, %%xmm1, %%xmm1 \n\t"
+    "addss         %%xmm1, %%xmm0 \n\t"
+    "movss         %%xmm0, %1     \n\t"
+    : "+&r"(i), "=m"(corr)
+    : "r"(ppc + len), "r"(ps + len)
+    : "memory"
+  );
+  return corr;
+}
+#endif
+
+static inline int64_t corr_s16(const int32_t *ppc, const int16_t *ps, long len)
+{
+  int64_t corr = 0;
+  long i = -len;
+  ppc += len;
+  ps  += len;
+  do {
+    corr += ppc[i+0] * ps[i+0];
+    corr += ppc[i+1] * ps[i+1];
+    corr += ppc[i+2] * ps[i+2];
+    corr += ppc[i+3] * ps[i+3];
+    i += 4;
+  } while (i < 0);
+  return corr;
+}
+
+/*
+ * With a search step > 1 only every step-th offset is tested first, then
+ * the neighbourhood of the best coarse match is searched exhaustively.
+ */
+#define SEARCH_OFFSETS(corr_type, corr_expr)                              \
+  for (off=0; off<s->frames_search; off+=step) {                          \
+    corr_type corr = corr_expr;                                           \
+    if (corr > best_corr) {                                               \
+      best_corr = corr;                                                   \
+      best_off  = off;                                                    \
+    }                                                                     \
+  }                                                                       \
+  if (step > 1) {                                                         \
+    int coarse_off = best_off;                                            \
+    int end = FFMIN(coarse_off + step, s->frames_search);                 \
+    for (off=FFMAX(coarse_off - step + 1, 0); off<end; off++) {           \
+      corr_type corr;                                                     \
+      if (off == coarse_off)                                              \
+        continue;                                                         \
+      corr = corr_expr;                                                   \
+      if (corr > best_corr) {                                             \
+        best_corr = corr;                                                 \
+        best_off  = off;                                                  \
+      }                                                                   \
+    }                                                                     \
+  }
+
 static int best_overlap_offset_float(af_scaletempo_t* s)
 {
   float *pw, *po, *ppc, *search_start;
   float best_corr = INT_MIN;
   int best_off = 0;
+  int step = s->search_step;
   int i, off;
 
   pw  = s->table_window;
@@ -133,19 +222,10 @@ static int best_overlap_offset_float(af_scaletempo_t* s)
   }
 
   search_start = (float*)s->buf_queue + s->num_channels;
-  for (off=0; off<s->frames_search; off++) {
-    float corr = 0;
-    float* ps = search_start;
-    ppc = s->buf_pre_corr;
-    for (i=s->num_channels; i<s->samples_overlap; i++) {
-      corr += *ppc++ * *ps++;
-    }
-    if (corr > best_corr) {
-      best_corr = corr;
-      best_off  = off;
-    }
-    search_start += s->num_channels;
-  }
+  SEARCH_OFFSETS(float,
+                 s->corr_float(s->buf_pre_corr,
+                               search_start + off * s->num_channels,
+                               s->samples_pre_corr))
 
   return best_off * 4 * s->num_channels;
 }
@@ -156,6 +236,7 @@ static int best_overlap_offset_s16(af_scaletempo_t* s)
   int16_t *po, *search_start;
   int64_t best_corr = INT64_MIN;
   int best_off = 0;
+  int step = s->search_step;
   int off;
   long i;
 
@@ -168,26 +249,10 @@ static int best_overlap_offset_s16(af_scaletempo_t* s)
   }
 
   search_start = (int16_t*)s->buf_queue + s->num_channels;
-  for (off=0; off<s->frames_search; off++) {
-    int64_t corr = 0;
-    int16_t* ps = search_start;
-    ppc = s->buf_pre_corr;
-    ppc += s->samples_overlap - s->num_channels;
-    ps  += s->samples_overlap - s->num_channels;
-    i  = -(s->samples_overlap - s->num_channels);
-    do {
-      corr += ppc[i+0] * ps[i+0];
-      corr += ppc[i+1] * ps[i+1];
-      corr += ppc[i+2] * ps[i+2];
-      corr += ppc[i+3] * ps[i+3];
-      i += 4;
-    } while (i < 0);
-    if (corr > best_corr) {
-      best_corr = corr;
-      best_off  = off;
-    }
-    search_start += s->num_channels;
-  }
+  SEARCH_OFFSETS(int64_t,
+                 corr_s16(s->buf_pre_corr,
+                          search_start + off * s->num_channels,
+                          s->samples_overlap - s->num_channels))
 
   return best_off * 2 * s->num_channels;
 }
@@ -367,6 +432,8 @@ static int control(struct af_instance_s* af, int cmd, void* arg)
     }
 
     s->frames_search = (frames_overlap > 1) ? srate * s->ms_search : 0;
+    // coarse steps of ~1/12 ms keep the peak of the correlation in reach
+    s->search_step = s->search_coarse ? FFMAX(data->rate / 12000, 1) : 1;
     if (s->frames_search <= 0) {
       s->best_overlap_offset = NULL;
     } else {
@@ -391,12 +458,21 @@ static int control(struct af_instance_s* af, int cmd, void* arg)
         s->best_overlap_offset = best_overlap_offset_s16;
       } else {
         float* pw;
-        s->buf_pre_corr = realloc(s->buf_pre_corr, s->bytes_overlap);
+        s->buf_pre_corr = realloc(s->buf_pre_corr, s->bytes_overlap + UNROLL_PADDING);
         s->table_window = realloc(s->table_window, s->bytes_overlap - nch * bps);
         if(!s->buf_pre_corr || !s->table_window) {
           mp_msg(MSGT_AFILTER, MSGL_FATAL, "[scaletempo] Out of memory\n");
           return AF_ERROR;
         }
+        memset((char *)s->buf_pre_corr + s->bytes_overlap - nch * bps, 0, UNROLL_PADDING);
+        s->samples_pre_corr = s->samples_overlap - nch;
+        s->corr_float = corr_float_c;
+#if HAVE_SSE
+        if (gCpuCaps.hasSSE) {
+          s->samples_pre_corr = (s->samples_pre_corr + 3) & ~3;
+          s->corr_float = corr_float_sse;
+        }
+#endif
         pw = s->table_window;
         for (i=1; i<frames_overlap; i++) {
           float v = i * (frames_overlap - i);
@@ -418,15 +494,18 @@ static int control(struct af_instance_s* af, int cmd, void* arg)
       mp_msg(MSGT_AFILTER, MSGL_FATAL, "[scaletempo] Out of memory\n");
       return AF_ERROR;
     }
+    // read by the unrolled correlation past the end of the queue
+    memset(s->buf_queue + s->bytes_queue, 0, UNROLL_PADDING);
 
     mp_msg (MSGT_AFILTER, MSGL_DBG2, "[scaletempo] "
             "%.2f stride_in, %i stride_out, %i standing, "
-            "%i overlap, %i search, %i queue, %s mode\n",
+            "%i overlap, %i search, %i step, %i queue, %s mode\n",
             s->frames_stride_scaled,
             (int)(s->bytes_stride / nch / bps),
             (int)(s->bytes_standing / nch / bps),
             (int)(s->bytes_overlap / nch / bps),
             s->frames_search,
+            s->search_step,
             (int)(s->bytes_queue / nch / bps),
             (use_int?"s16":"float"));
 
@@ -463,6 +542,7 @@ static int control(struct af_instance_s* af, int cmd, void* arg)
       {"stride",  OPT_ARG_FLOAT, &s->ms_stride, NULL},
       {"overlap", OPT_ARG_FLOAT, &s->percent_overlap, NULL},
       {"search",  OPT_ARG_FLOAT, &s->ms_search, NULL},
+      {"coarse",  OPT_ARG_BOOL,  &s->search_coarse, NULL},
       {"speed",   OPT_ARG_STR,   &speed, NULL},
       {NULL},
     };
@@ -36,7 +36,7 @@
 #include "osdep/timer.h"
 #include "subopt-helper.h"
 
-#include "libavutil/fifo.h"
+#include "audio_ring.h"
 
 #include <jack/jack.h>
 
@@ -71,7 +71,7 @@ static volatile float callback_time = 0;
 #define BUFFSIZE (NUM_CHUNKS * CHUNK_SIZE)
 
 //! buffer for audio data
-static AVFifoBuffer *buffer;
+static audio_ring_t *buffer;
 
 /**
  * \brief insert len bytes into buffer
@@ -82,9 +82,7 @@ static AVFifoBuffer *buffer;
  * If there is not enough room, the buffer is filled up
  */
 static int write_buffer(unsigned char* data, int len) {
-  int free = av_fifo_space(buffer);
-  if (len > free) len = free;
-  return av_fifo_generic_write(buffer, data, len, NULL);
+  return audio_ring_write(buffer, data, len);
 }
 
 static void silence(float **bufs, int cnt, int num_bufs);
@@ -125,12 +123,12 @@ static void deinterleave(void *info, void *src, int len) {
  */
 static int read_buffer(float **bufs, int cnt, int num_bufs) {
   struct deinterleave di = {bufs, num_bufs, 0, 0};
-  int buffered = av_fifo_size(buffer);
+  int buffered = audio_ring_buffered(buffer);
   if (cnt * sizeof(float) * num_bufs > buffered) {
     silence(bufs, cnt, num_bufs);
     cnt = buffered / sizeof(float) / num_bufs;
   }
-  av_fifo_generic_read(buffer, &di, cnt * num_bufs * sizeof(float), deinterleave);
+  audio_ring_generic_read(buffer, &di, cnt * num_bufs * sizeof(float), deinterleave);
   return cnt;
 }
 
@@ -165,9 +163,11 @@ static int outputaudio(jack_nframes_t nframes, void *arg) {
   int i;
   for (i = 0; i < num_ports; i++)
     bufs[i] = jack_port_get_buffer(ports[i], nframes);
-  if (paused || underrun)
+  if (paused || underrun) {
     silence(bufs, nframes, num_ports);
-  else
+    // still apply resets so the player sees the freed space
+    audio_ring_read(buffer, NULL, 0);
+  } else
     if (read_buffer(bufs, nframes, num_ports) < nframes)
       underrun = 1;
   if (estimate) {
@@ -238,7 +238,7 @@ static int init(int rate, int channels, int format, int flags) {
     mp_msg(MSGT_AO, MSGL_FATAL, "[JACK] cannot open server\n");
     goto err_out;
   }
-  buffer = av_fifo_alloc(BUFFSIZE);
+  buffer = audio_ring_alloc(BUFFSIZE);
   jack_set_process_callback(client, outputaudio, 0);
 
   // list matching ports
@@ -296,7 +296,7 @@ err_out:
   free(client_name);
   if (client)
     jack_client_close(client);
-  av_fifo_free(buffer);
+  audio_ring_free(buffer);
   buffer = NULL;
   return 0;
 }
@@ -309,7 +309,7 @@ static void uninit(int immed) {
   reset();
   usec_sleep(100 * 1000);
   jack_client_close(client);
-  av_fifo_free(buffer);
+  audio_ring_free(buffer);
   buffer = NULL;
 }
 
@@ -317,9 +317,7 @@ static void uninit(int immed) {
  * \brief stop playing and empty buffers (for seeking/pause)
  */
 static void reset(void) {
-  paused = 1;
-  av_fifo_reset(buffer);
-  paused = 0;
+  audio_ring_reset(buffer);
 }
 
 /**
@@ -337,7 +335,7 @@ static void audio_resume(void) {
 }
 
 static int get_space(void) {
-  return av_fifo_space(buffer);
+  return audio_ring_space(buffer);
 }
 
 /**
@@ -351,7 +349,7 @@ static int play(void *data, int len, int flags) {
 }
 
 static float get_delay(void) {
-  int buffered = av_fifo_size(buffer); // could be less
+  int buffered = audio_ring_buffered(buffer); // could be less
   float in_jack = jack_latency;
   if (estimate && callback_interval > 0) {
     float elapsed = (float)GetTimer() / 1000000.0 - callback_time;
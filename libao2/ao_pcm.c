@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include "libavutil/common.h"
+#include "libavutil/md5.h"
 #include "mpbswap.h"
 #include "subopt-helper.h"
 #include "libaf/af_format.h"
@@ -54,6 +55,8 @@ LIBAO_EXTERN(pcm)
 static char *ao_outputfilename = NULL;
 static int ao_pcm_waveheader = 1;
 static int fast = 0;
+static int md5 = 0;
+static struct AVMD5 *md5_context;
 
 #define WAV_ID_RIFF 0x46464952 /* "RIFF" */
 #define WAV_ID_WAVE 0x45564157 /* "WAVE" */
@@ -142,10 +145,12 @@ static int init(int rate,int channels,int format,int flags){
         {"waveheader", OPT_ARG_BOOL, &ao_pcm_waveheader, NULL},
         {"file",       OPT_ARG_MSTRZ, &ao_outputfilename, NULL},
         {"fast",       OPT_ARG_BOOL, &fast, NULL},
+        {"md5",        OPT_ARG_BOOL, &md5, NULL},
         {NULL}
     };
     // set defaults
     ao_pcm_waveheader = 1;
+    md5 = 0;
 
     if (subopt_parse(ao_subdevice, subopts) != 0) {
         return 0;
@@ -186,6 +191,13 @@ static int init(int rate,int channels,int format,int flags){
            (channels > 1) ? "Stereo" : "Mono", af_fmt2str_short(format));
     mp_msg(MSGT_AO, MSGL_INFO, MSGTR_AO_PCM_HintInfo);
 
+    if (md5) {
+        md5_context = malloc(av_md5_size);
+        if (!md5_context)
+            return 0;
+        av_md5_init(md5_context);
+    }
+
     fp = fopen(ao_outputfilename, "wb");
     if(fp) {
         if(ao_pcm_waveheader){ /* Reserve space for wave header */
@@ -195,6 +207,8 @@ static int init(int rate,int channels,int format,int flags){
     }
     mp_msg(MSGT_AO, MSGL_ERR, MSGTR_AO_PCM_CantOpenOutputFile,
                ao_outputfilename);
+    free(md5_context);
+    md5_context = NULL;
     return 0;
 }
 
@@ -221,6 +235,19 @@ static void uninit(int immed){
     fclose(fp);
     free(ao_outputfilename);
     ao_outputfilename = NULL;
+
+    if (md5_context) {
+        uint8_t sum[16];
+        char str[33];
+        int i;
+        av_md5_final(md5_context, sum);
+        for (i = 0; i < 16; i++)
+            sprintf(str + 2 * i, "%02x", sum[i]);
+        mp_msg(MSGT_AO, MSGL_INFO, "[AO PCM] MD5 of written samples: %s\n", str);
+        mp_msg(MSGT_IDENTIFY, MSGL_INFO, "ID_AUDIO_MD5=%s\n", str);
+        free(md5_context);
+        md5_context = NULL;
+    }
 }
 
 // stop playing and empty buffers (for seeking/pause)
@@ -264,6 +291,8 @@ static int play(void* data,int len,int flags){
 
     //printf("PCM: Writing chunk!\n");
     fwrite(data,len,1,fp);
+    if (md5_context)
+        av_md5_update(md5_context, data, len);
 
     if(ao_pcm_waveheader)
         data_length += len;
@@ -0,0 +1,190 @@
+/*
+ * null audio output driven by a pulling realtime thread
+ *
+ * Behaves like a callback based sound card: a separate thread wakes up
+ * once per period and consumes one period of audio from the ring buffer,
+ * counting underruns.  Useful to test the pull mode audio path without
+ * any sound hardware.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "config.h"
+#include "mp_msg.h"
+#include "libaf/af_format.h"
+#include "audio_out.h"
+#include "audio_out_internal.h"
+#include "audio_ring.h"
+#include "osdep/timer.h"
+#include "subopt-helper.h"
+
+static const ao_info_t info =
+{
+    "Null audio output pulled by a realtime thread (for testing)",
+    "pull",
+    "",
+    ""
+};
+
+LIBAO_EXTERN(pull)
+
+static audio_ring_t *buffer;
+static unsigned char *period_buf;
+static int period_bytes;
+static int period_usec;
+static pthread_t thread;
+static volatile int running;
+static volatile int paused;
+static volatile int underruns;
+static volatile unsigned callback_time;
+
+static void *pull_thread(void *arg)
+{
+    unsigned next = GetTimer();
+    while (running) {
+        int delay;
+        if (paused) {
+            audio_ring_read(buffer, NULL, 0);
+        } else {
+            int got = audio_ring_read(buffer, period_buf, period_bytes);
+            if (got && got < period_bytes)
+                underruns++;
+        }
+        callback_time = GetTimer();
+        next += period_usec;
+        delay = (int)(next - callback_time);
+        if (delay > 0)
+            usec_sleep(delay);
+        else
+            next = callback_time;
+    }
+    return NULL;
+}
+
+static int control(int cmd, void *arg)
+{
+    return CONTROL_UNKNOWN;
+}
+
+static int init(int rate, int channels, int format, int flags)
+{
+    int samplesize = af_fmt2bits(format) / 8;
+    int period_ms = 10;
+    int buffer_ms = 200;
+    const opt_t subopts[] = {
+        {"period", OPT_ARG_INT, &period_ms, int_pos},
+        {"buffer", OPT_ARG_INT, &buffer_ms, int_pos},
+        {NULL}
+    };
+    if (subopt_parse(ao_subdevice, subopts) != 0) {
+        mp_msg(MSGT_AO, MSGL_FATAL,
+               "\n-ao pull commandline help:\n"
+               "  period=<ms>\n"
+               "    Time between two pulls of the audio thread (default 10)\n"
+               "  buffer=<ms>\n"
+               "    Size of the buffer between player and audio thread (default 200)\n");
+        return 0;
+    }
+
+    ao_data.channels   = channels;
+    ao_data.samplerate = rate;
+    ao_data.format     = format;
+    ao_data.bps        = channels * rate * samplesize;
+    period_bytes = (int)((int64_t)ao_data.bps * period_ms / 1000);
+    period_bytes -= period_bytes % (channels * samplesize);
+    if (period_bytes <= 0)
+        period_bytes = channels * samplesize;
+    period_usec  = period_ms * 1000;
+    ao_data.outburst = period_bytes;
+
+    buffer     = audio_ring_alloc((int64_t)ao_data.bps * buffer_ms / 1000);
+    period_buf = malloc(period_bytes);
+    if (!buffer || !period_buf)
+        goto err_out;
+    ao_data.buffersize = audio_ring_size(buffer);
+
+    underruns = 0;
+    paused    = 0;
+    running   = 1;
+    callback_time = GetTimer();
+    if (pthread_create(&thread, NULL, pull_thread, NULL)) {
+        mp_msg(MSGT_AO, MSGL_ERR, "[AO PULL] Cannot create thread\n");
+        goto err_out;
+    }
+    return 1;
+
+err_out:
+    running = 0;
+    audio_ring_free(buffer);
+    buffer = NULL;
+    free(period_buf);
+    period_buf = NULL;
+    return 0;
+}
+
+static void uninit(int immed)
+{
+    if (!immed)
+        usec_sleep(get_delay() * 1000 * 1000);
+    running = 0;
+    pthread_join(thread, NULL);
+    mp_msg(MSGT_AO, MSGL_V, "[AO PULL] %d underruns\n", underruns);
+    audio_ring_free(buffer);
+    buffer = NULL;
+    free(period_buf);
+    period_buf = NULL;
+}
+
+static void reset(void)
+{
+    audio_ring_reset(buffer);
+}
+
+static void audio_pause(void)
+{
+    paused = 1;
+}
+
+static void audio_resume(void)
+{
+    paused = 0;
+}
+
+static int get_space(void)
+{
+    return audio_ring_space(buffer);
+}
+
+static int play(void *data, int len, int flags)
+{
+    if (!(flags & AOPLAY_FINAL_CHUNK))
+        len -= len % ao_data.outburst;
+    return audio_ring_write(buffer, data, len);
+}
+
+static float get_delay(void)
+{
+    int in_period = period_usec - (int)(GetTimer() - callback_time);
+    if (in_period < 0)
+        in_period = 0;
+    return (float)audio_ring_buffered(buffer) / ao_data.bps +
+           in_period / 1000000.0;
+}
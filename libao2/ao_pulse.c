@@ -20,6 +20,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <pulse/pulseaudio.h>
@@ -29,6 +30,7 @@
 #include "mp_msg.h"
 #include "audio_out.h"
 #include "audio_out_internal.h"
+#include "audio_ring.h"
 
 #define PULSE_CLIENT_NAME "MPlayer"
 
@@ -51,6 +53,13 @@ static struct pa_threaded_mainloop *mainloop;
 
 static int broken_pause;
 
+/** Buffer between play() and the stream write callback */
+static audio_ring_t *ring;
+static void *ring_out;
+
+/** Set when the write callback could not fully serve a server request */
+static volatile int starved;
+
 LIBAO_EXTERN(pulse)
 
 #define GENERIC_ERR_MSG(ctx, str) \
@@ -77,7 +86,28 @@ static void stream_state_cb(pa_stream *s, void *userdata) {
     }
 }
 
+/**
+ * \brief move up to length bytes from the ring buffer to the server
+ *
+ * Must be called with the mainloop lock held.
+ */
+static void pull_audio(size_t length) {
+    int frame = pa_frame_size(pa_stream_get_sample_spec(stream));
+    int len = audio_ring_buffered(ring);
+    if (len > length)
+        len = length;
+    len -= len % frame;
+    starved = len < length;
+    if (len <= 0)
+        return;
+    // copied out since the ring buffer may wrap in the middle of a frame
+    audio_ring_read(ring, ring_out, len);
+    if (pa_stream_write(stream, ring_out, len, NULL, 0, PA_SEEK_RELATIVE) < 0)
+        GENERIC_ERR_MSG(context, "pa_stream_write() failed");
+}
+
 static void stream_request_cb(pa_stream *s, size_t length, void *userdata) {
+    pull_audio(length);
     pa_threaded_mainloop_signal(mainloop, 0);
 }
 
@@ -186,6 +216,14 @@ static int init(int rate_hz, int channels, int format, int flags) {
     pa_channel_map_init_auto(&map, ss.channels, PA_CHANNEL_MAP_ALSA);
     ao_data.bps = pa_bytes_per_second(&ss);
 
+    ring = audio_ring_alloc(ao_data.bps / 4);
+    ring_out = ring ? malloc(audio_ring_size(ring)) : NULL;
+    if (!ring_out) {
+        mp_msg(MSGT_AO, MSGL_ERR, "AO: [pulse] Failed to allocate buffer\n");
+        goto fail;
+    }
+    starved = 0;
+
     if (!(mainloop = pa_threaded_mainloop_new())) {
         mp_msg(MSGT_AO, MSGL_ERR, "AO: [pulse] Failed to allocate main loop\n");
         goto fail;
@@ -250,6 +288,16 @@ fail:
 static void uninit(int immed) {
     if (stream && !immed) {
             pa_threaded_mainloop_lock(mainloop);
+            while (audio_ring_buffered(ring) >=
+                   pa_frame_size(pa_stream_get_sample_spec(stream))) {
+                size_t l = pa_stream_writable_size(stream);
+                if (l == (size_t)-1)
+                    break;
+                if (l)
+                    pull_audio(l);
+                else
+                    pa_threaded_mainloop_wait(mainloop);
+            }
             waitop(pa_stream_drain(stream, success_cb, NULL));
     }
 
@@ -272,16 +320,29 @@ static void uninit(int immed) {
         pa_threaded_mainloop_free(mainloop);
         mainloop = NULL;
     }
+
+    audio_ring_free(ring);
+    ring = NULL;
+    free(ring_out);
+    ring_out = NULL;
 }
 
-/** Play the specified data to the pulseaudio server */
+/**
+ * \brief queue the specified data for the pulseaudio server
+ *
+ * The data is normally sent from the stream write callback, only if that
+ * ran out of data the mainloop has to be locked here to catch up.
+ */
 static int play(void* data, int len, int flags) {
-    pa_threaded_mainloop_lock(mainloop);
-    if (pa_stream_write(stream, data, len, NULL, 0, PA_SEEK_RELATIVE) < 0) {
-        GENERIC_ERR_MSG(context, "pa_stream_write() failed");
-        len = -1;
+    len = audio_ring_write(ring, data, len);
+    if (starved) {
+        size_t l;
+        pa_threaded_mainloop_lock(mainloop);
+        l = pa_stream_writable_size(stream);
+        if (l != (size_t)-1)
+            pull_audio(l);
+        pa_threaded_mainloop_unlock(mainloop);
     }
-    pa_threaded_mainloop_unlock(mainloop);
     return len;
 }
 
@@ -311,18 +372,16 @@ static void audio_resume(void) {
 static void reset(void) {
     int success = 0;
     pa_threaded_mainloop_lock(mainloop);
+    // the write callback cannot run while we hold the lock
+    audio_ring_clear(ring);
     if (!waitop(pa_stream_flush(stream, success_cb, &success)) ||
         !success)
         GENERIC_ERR_MSG(context, "pa_stream_flush() failed");
 }
 
-/** Return number of bytes that may be written to the server without blocking */
+/** Return number of bytes that may be queued without blocking */
 static int get_space(void) {
-    size_t l;
-    pa_threaded_mainloop_lock(mainloop);
-    l = pa_stream_writable_size(stream);
-    pa_threaded_mainloop_unlock(mainloop);
-    return l;
+    return audio_ring_space(ring);
 }
 
 /** Return the current latency in seconds */
@@ -338,7 +397,8 @@ static float get_delay(void) {
         pa_threaded_mainloop_wait(mainloop);
     }
     pa_threaded_mainloop_unlock(mainloop);
-    return latency == (pa_usec_t) -1 ? 0 : latency / 1000000.0;
+    return (latency == (pa_usec_t) -1 ? 0 : latency / 1000000.0) +
+           (float)audio_ring_buffered(ring) / ao_data.bps;
 }
 
 /** A callback function that is called when the
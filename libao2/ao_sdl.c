@@ -38,7 +38,7 @@
 #endif
 #include "osdep/timer.h"
 
-#include "libavutil/fifo.h"
+#include "audio_ring.h"
 
 static const ao_info_t info =
 {
@@ -64,16 +64,14 @@ LIBAO_EXTERN(sdl)
 #define NUM_CHUNKS 8
 #define BUFFSIZE (NUM_CHUNKS * CHUNK_SIZE)
 
-static AVFifoBuffer *buffer;
+static audio_ring_t *buffer;
 
 #ifdef USE_SDL_INTERNAL_MIXER
 static unsigned char volume=SDL_MIX_MAXVOLUME;
 #endif
 
 static int write_buffer(unsigned char* data,int len){
-  int free = av_fifo_space(buffer);
-  if (len > free) len = free;
-  return av_fifo_generic_write(buffer, data, len, NULL);
+  return audio_ring_write(buffer, data, len);
 }
 
 #ifdef USE_SDL_INTERNAL_MIXER
@@ -83,14 +81,11 @@ static void mix_audio(void *dst, void *src, int len) {
 #endif
 
 static int read_buffer(unsigned char* data,int len){
-  int buffered = av_fifo_size(buffer);
-  if (len > buffered) len = buffered;
 #ifdef USE_SDL_INTERNAL_MIXER
-  av_fifo_generic_read(buffer, data, len, mix_audio);
+  return audio_ring_generic_read(buffer, data, len, mix_audio);
 #else
-  av_fifo_generic_read(buffer, data, len, NULL);
+  return audio_ring_read(buffer, data, len);
 #endif
-  return len;
 }
 
 // end ring buffer stuff
@@ -137,7 +132,7 @@ static int init(int rate,int channels,int format,int flags){
 	SDL_AudioSpec aspec, obtained;
 
 	/* Allocate ring-buffer memory */
-	buffer = av_fifo_alloc(BUFFSIZE);
+	buffer = audio_ring_alloc(BUFFSIZE);
 
 	mp_msg(MSGT_AO,MSGL_INFO,MSGTR_AO_SDL_INFO, rate, (channels > 1) ? "Stereo" : "Mono", af_fmt2str_short(format));
 
@@ -253,7 +248,7 @@ static void uninit(int immed){
 	  usec_sleep(get_delay() * 1000 * 1000);
 	SDL_CloseAudio();
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
-	av_fifo_free(buffer);
+	audio_ring_free(buffer);
 }
 
 // stop playing and empty buffers (for seeking/pause)
@@ -262,8 +257,8 @@ static void reset(void){
 	//printf("SDL: reset called!\n");
 
 	SDL_PauseAudio(1);
-	/* Reset ring-buffer state */
-	av_fifo_reset(buffer);
+	/* Reset ring-buffer state, the callback is not running while paused */
+	audio_ring_clear(buffer);
 	SDL_PauseAudio(0);
 }
 
@@ -286,7 +281,7 @@ static void audio_resume(void)
 
 // return: how many bytes can be played without blocking
 static int get_space(void){
-    return av_fifo_space(buffer);
+    return audio_ring_space(buffer);
 }
 
 // plays 'len' bytes of 'data'
@@ -313,6 +308,6 @@ static int play(void* data,int len,int flags){
 
 // return: delay in seconds between first and last sample in buffer
 static float get_delay(void){
-    int buffered = av_fifo_size(buffer); // could be less
+    int buffered = audio_ring_buffered(buffer); // could be less
     return (float)(buffered + ao_data.buffersize)/(float)ao_data.bps;
 }
@@ -0,0 +1,190 @@
+/*
+ * lock-free ring buffer between the player and pull mode audio outputs
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "audio_ring.h"
+
+/*
+ * Positions are free running byte counters, only the low bits are used to
+ * index the buffer.  write_pos is only ever modified by the producer,
+ * read_pos only by the consumer.  A reset from the producer is handed to
+ * the consumer as a "discard everything before discard_pos" request.
+ */
+struct audio_ring {
+    unsigned char *buf;
+    unsigned size;
+    unsigned mask;
+    volatile unsigned write_pos;
+    volatile unsigned read_pos;
+    volatile unsigned discard_pos;
+    volatile unsigned discard_req;
+    volatile unsigned discard_ack;
+};
+
+#define ring_barrier() __sync_synchronize()
+
+audio_ring_t *audio_ring_alloc(int size)
+{
+    audio_ring_t *r = calloc(1, sizeof(*r));
+    unsigned s = 1;
+    if (!r || size <= 0)
+        goto fail;
+    while (s < (unsigned)size)
+        s <<= 1;
+    r->buf = malloc(s);
+    if (!r->buf)
+        goto fail;
+    r->size = s;
+    r->mask = s - 1;
+    return r;
+
+fail:
+    free(r);
+    return NULL;
+}
+
+void audio_ring_free(audio_ring_t *r)
+{
+    if (!r)
+        return;
+    free(r->buf);
+    free(r);
+}
+
+int audio_ring_size(audio_ring_t *r)
+{
+    return r->size;
+}
+
+int audio_ring_buffered(audio_ring_t *r)
+{
+    unsigned w = r->write_pos;
+    unsigned rd = r->read_pos;
+    int discard = (int)(r->discard_pos - rd);
+    if (r->discard_req != r->discard_ack && discard > 0)
+        rd += discard;
+    return w - rd;
+}
+
+int audio_ring_space(audio_ring_t *r)
+{
+    return r->size - (r->write_pos - r->read_pos);
+}
+
+int audio_ring_write(audio_ring_t *r, const void *data, int len)
+{
+    unsigned w = r->write_pos;
+    unsigned idx = w & r->mask;
+    int space = audio_ring_space(r);
+    int first;
+    if (len > space)
+        len = space;
+    if (len <= 0)
+        return 0;
+    first = r->size - idx;
+    if (first > len)
+        first = len;
+    memcpy(r->buf + idx, data, first);
+    memcpy(r->buf, (const unsigned char *)data + first, len - first);
+    // data must be visible before the consumer sees the new write position
+    ring_barrier();
+    r->write_pos = w + len;
+    return len;
+}
+
+/**
+ * \brief drop all buffered data
+ *
+ * Data written after this call is kept, even if the consumer only notices
+ * the reset later.
+ */
+void audio_ring_reset(audio_ring_t *r)
+{
+    r->discard_pos = r->write_pos;
+    ring_barrier();
+    r->discard_req++;
+}
+
+/**
+ * \brief drop all buffered data immediately
+ *
+ * Only allowed while the consumer is known not to run, e.g. with the
+ * driver callback paused or its lock held.
+ */
+void audio_ring_clear(audio_ring_t *r)
+{
+    r->discard_ack = r->discard_req;
+    r->read_pos = r->write_pos;
+}
+
+/**
+ * \brief read data, passing each contiguous chunk to func
+ * \param func called as func(dest, chunk, chunk_len), if NULL the data is
+ *             copied to dest
+ * \return number of bytes read
+ *
+ * A read with len 0 only applies a pending reset.
+ */
+int audio_ring_generic_read(audio_ring_t *r, void *dest, int len,
+                            void (*func)(void *, void *, int))
+{
+    unsigned rd = r->read_pos;
+    unsigned idx;
+    int avail, first;
+    if (r->discard_req != r->discard_ack) {
+        r->discard_ack = r->discard_req;
+        ring_barrier();
+        if ((int)(r->discard_pos - rd) > 0)
+            rd = r->discard_pos;
+    }
+    avail = r->write_pos - rd;
+    // do not read data older than the write position we just loaded
+    ring_barrier();
+    if (len > avail)
+        len = avail;
+    if (len <= 0) {
+        r->read_pos = rd;
+        return 0;
+    }
+    idx = rd & r->mask;
+    first = r->size - idx;
+    if (first > len)
+        first = len;
+    if (func) {
+        func(dest, r->buf + idx, first);
+        if (len > first)
+            func(dest, r->buf, len - first);
+    } else {
+        memcpy(dest, r->buf + idx, first);
+        memcpy((unsigned char *)dest + first, r->buf, len - first);
+    }
+    // make sure the data is consumed before the producer may overwrite it
+    ring_barrier();
+    r->read_pos = rd + len;
+    return len;
+}
+
+int audio_ring_read(audio_ring_t *r, void *dest, int len)
+{
+    return audio_ring_generic_read(r, dest, len, NULL);
+}
@@ -0,0 +1,51 @@
+/*
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPLAYER_AUDIO_RING_H
+#define MPLAYER_AUDIO_RING_H
+
+/**
+ * \file
+ * Lock-free single producer / single consumer ring buffer for audio
+ * outputs that are pulled from a callback running in its own thread.
+ *
+ * The producer is the player thread calling ao play(), get_space() and
+ * reset(), the consumer is the driver callback.  Neither side ever blocks.
+ */
+
+typedef struct audio_ring audio_ring_t;
+
+audio_ring_t *audio_ring_alloc(int size);
+void audio_ring_free(audio_ring_t *r);
+
+/* producer side */
+int audio_ring_write(audio_ring_t *r, const void *data, int len);
+int audio_ring_space(audio_ring_t *r);
+void audio_ring_reset(audio_ring_t *r);
+void audio_ring_clear(audio_ring_t *r);
+
+/* consumer side */
+int audio_ring_read(audio_ring_t *r, void *dest, int len);
+int audio_ring_generic_read(audio_ring_t *r, void *dest, int len,
+                            void (*func)(void *, void *, int));
+
+/* both sides */
+int audio_ring_buffered(audio_ring_t *r);
+int audio_ring_size(audio_ring_t *r);
+
+#endif /* MPLAYER_AUDIO_RING_H */
@@ -53,6 +53,7 @@ typedef struct audio_encoder_s {
 	int decode_buffer_size;
 	int decode_buffer_len;
 	void *priv;
+	void *thread;	//encoding thread, see ae_thread.c
 	int (*bind)(struct audio_encoder_s*, muxer_stream_t*);
 	int (*get_frame_size)(struct audio_encoder_s*);
 	int (*set_decoded_len)(struct audio_encoder_s *encoder, int len);
@@ -63,4 +64,12 @@ typedef struct audio_encoder_s {
 
 audio_encoder_t *new_audio_encoder(muxer_stream_t *stream, audio_encoding_params_t *params);
 
+int ae_thread_start(audio_encoder_t *encoder, int size, double bps);
+void ae_thread_put(audio_encoder_t *encoder, unsigned char *src, int len);
+int ae_thread_get(audio_encoder_t *encoder, unsigned char *dest, int size);
+void ae_thread_flush(audio_encoder_t *encoder);
+double ae_thread_delay(audio_encoder_t *encoder);
+void ae_thread_stats(audio_encoder_t *encoder, double *encode_time, double *wait_time);
+void ae_thread_uninit(audio_encoder_t *encoder);
+
 #endif /* MPLAYER_AE_H */
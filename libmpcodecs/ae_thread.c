@@ -0,0 +1,337 @@
+/*
+ * audio encoding in a separate thread
+ *
+ * MEncoder demuxes and decodes the audio in its main thread and queues the
+ * decoded blocks here.  A thread runs the audio encoder on them and cuts
+ * its output into the chunks the muxer expects, the main thread fetches
+ * those and muxes them.  The encoder works on a private copy of the muxer
+ * stream, so its buffer is never touched by the main thread.  The queue of
+ * decoded blocks is bounded, a full queue blocks the main thread.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "config.h"
+#include "mp_msg.h"
+#include "libavutil/common.h"
+#include "osdep/timer.h"
+#include "libmpdemux/muxer.h"
+#include "ae.h"
+
+typedef struct chunk {
+    struct chunk *next;
+    int len;
+    double time;            ///< duration in the muxer stream
+    unsigned char data[];
+} chunk_t;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;    ///< signalled whenever the queues or quit change
+    muxer_stream_t stream;  ///< the encoder's copy of the muxer stream
+    muxer_stream_t *mux;
+    unsigned char **block;  ///< ring of decoded blocks
+    int *block_len;
+    int size;
+    int start, fill;
+    int busy;               ///< the thread is encoding block[start]
+    int quit;
+    int frame_size;         ///< VBR frame the encoder is in the middle of
+    chunk_t *first, *last;  ///< encoded chunks waiting for the muxer
+    double bps;             ///< bytes per second of the decoded audio
+    double queued;          ///< seconds of audio in both queues
+    double encode_time, wait_time; ///< seconds
+} ae_thread_t;
+
+static void add_chunk(ae_thread_t *c, unsigned char *data, int len)
+{
+    muxer_stream_t *s = &c->stream;
+    chunk_t *chunk = malloc(sizeof(*chunk) + len);
+
+    if (!chunk) {
+        mp_msg(MSGT_MENCODER, MSGL_ERR, "Audio encoding thread: out of memory, dropping %d bytes\n", len);
+        return;
+    }
+    chunk->next = NULL;
+    chunk->len  = len;
+    chunk->time = 0;
+    if (s->h.dwRate)
+        chunk->time = (s->h.dwSampleSize ? (double)len / s->h.dwSampleSize : 1) *
+                      s->h.dwScale / s->h.dwRate;
+    memcpy(chunk->data, data, len);
+    pthread_mutex_lock(&c->lock);
+    if (c->last)
+        c->last->next = chunk;
+    else
+        c->first = chunk;
+    c->last = chunk;
+    c->queued += chunk->time;
+    pthread_mutex_unlock(&c->lock);
+}
+
+/// what MEncoder does with decoded audio without the thread
+static void encode_block(audio_encoder_t *encoder, ae_thread_t *c,
+                         unsigned char *src, int len)
+{
+    muxer_stream_t *s = &c->stream;
+
+    s->buffer_len += encoder->encode(encoder, s->buffer + s->buffer_len, src,
+                                     len, s->buffer_size - s->buffer_len);
+    while (1) {
+        int sz;
+        if (s->h.dwSampleSize) { // CBR, whole blocks
+            sz = s->wf->nBlockAlign * (s->buffer_len / s->wf->nBlockAlign);
+        } else {                 // VBR, one frame at a time
+            if (!c->frame_size)
+                c->frame_size = encoder->get_frame_size(encoder);
+            sz = c->frame_size <= s->buffer_len ? c->frame_size : 0;
+        }
+        if (sz <= 0)
+            break;
+        add_chunk(c, s->buffer, sz);
+        c->frame_size = 0;
+        s->buffer_len -= sz;
+        memmove(s->buffer, s->buffer + sz, s->buffer_len);
+    }
+}
+
+static void *encode_thread(void *arg)
+{
+    audio_encoder_t *encoder = arg;
+    ae_thread_t *c = encoder->thread;
+
+    pthread_mutex_lock(&c->lock);
+    while (1) {
+        unsigned int t;
+        int len;
+        while (!c->fill && !c->quit)
+            pthread_cond_wait(&c->cond, &c->lock);
+        if (!c->fill)
+            break;
+        // the main thread only fills the free blocks, this one stays
+        // untouched while the lock is released
+        len = c->block_len[c->start];
+        c->busy = 1;
+        pthread_mutex_unlock(&c->lock);
+
+        t = GetTimer();
+        encode_block(encoder, c, c->block[c->start], len);
+        t = GetTimer() - t;
+
+        pthread_mutex_lock(&c->lock);
+        c->encode_time += t * 0.000001;
+        c->queued -= len / c->bps;
+        c->start = (c->start + 1) % c->size;
+        c->fill--;
+        c->busy  = 0;
+        pthread_cond_broadcast(&c->cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+static void free_thread(ae_thread_t *c)
+{
+    int i;
+
+    while (c->first) {
+        chunk_t *next = c->first->next;
+        free(c->first);
+        c->first = next;
+    }
+    for (i = 0; i < c->size; i++)
+        free(c->block[i]);
+    free(c->block);
+    free(c->block_len);
+    free(c->stream.buffer);
+    free(c);
+}
+
+/**
+ * \brief encode in a thread from now on
+ * \param size number of decoded blocks that can be queued
+ * \param bps bytes per second of the decoded audio
+ * \return 1 if the thread runs, 0 if size is 0, -1 if it could not be set up
+ */
+int ae_thread_start(audio_encoder_t *encoder, int size, double bps)
+{
+    muxer_stream_t *mux = encoder->stream;
+    ae_thread_t *c;
+    int i;
+
+    if (size <= 0 || bps <= 0 || encoder->thread)
+        return 0;
+    c = calloc(1, sizeof(*c));
+    if (!c)
+        return -1;
+    c->size      = size;
+    c->block     = calloc(size, sizeof(*c->block));
+    c->block_len = calloc(size, sizeof(*c->block_len));
+    c->stream    = *mux;
+    c->stream.buffer = malloc(mux->buffer_size);
+    if (!c->block || !c->block_len || !c->stream.buffer) {
+        free_thread(c);
+        return -1;
+    }
+    for (i = 0; i < size; i++)
+        if (!(c->block[i] = malloc(encoder->decode_buffer_size))) {
+            free_thread(c);
+            return -1;
+        }
+    // whatever the encoder left in the buffer so far
+    memcpy(c->stream.buffer, mux->buffer, mux->buffer_len);
+    c->mux = mux;
+    c->bps = bps;
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    encoder->thread = c;
+    encoder->stream = &c->stream;
+    mux->buffer_len = 0;
+    if (pthread_create(&c->thread, NULL, encode_thread, encoder)) {
+        encoder->thread = NULL;
+        encoder->stream = mux;
+        mux->buffer_len = c->stream.buffer_len;
+        memcpy(mux->buffer, c->stream.buffer, mux->buffer_len);
+        pthread_cond_destroy(&c->cond);
+        pthread_mutex_destroy(&c->lock);
+        free_thread(c);
+        return -1;
+    }
+    mp_msg(MSGT_MENCODER, MSGL_V, "Audio encoding thread: %d blocks of %d bytes\n",
+           size, encoder->decode_buffer_size);
+    return 1;
+}
+
+/// queue len bytes of decoded audio, waits while the queue is full
+void ae_thread_put(audio_encoder_t *encoder, unsigned char *src, int len)
+{
+    ae_thread_t *c = encoder->thread;
+    int end;
+
+    pthread_mutex_lock(&c->lock);
+    if (c->fill == c->size) {
+        unsigned int t = GetTimer();
+        while (c->fill == c->size)
+            pthread_cond_wait(&c->cond, &c->lock);
+        c->wait_time += (GetTimer() - t) * 0.000001;
+    }
+    end = (c->start + c->fill) % c->size;
+    len = FFMIN(len, encoder->decode_buffer_size);
+    memcpy(c->block[end], src, len);
+    c->block_len[end] = len;
+    c->fill++;
+    c->queued += len / c->bps;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+}
+
+/**
+ * \brief fetch the next encoded chunk
+ * \return its length, 0 if there is none yet
+ */
+int ae_thread_get(audio_encoder_t *encoder, unsigned char *dest, int size)
+{
+    ae_thread_t *c = encoder->thread;
+    chunk_t *chunk;
+    int len;
+
+    pthread_mutex_lock(&c->lock);
+    chunk = c->first;
+    if (chunk) {
+        c->first = chunk->next;
+        if (!c->first)
+            c->last = NULL;
+        c->queued -= chunk->time;
+    }
+    pthread_mutex_unlock(&c->lock);
+    if (!chunk)
+        return 0;
+    len = FFMIN(chunk->len, size);
+    memcpy(dest, chunk->data, len);
+    free(chunk);
+    return len;
+}
+
+/// wait until everything queued is encoded, the chunks remain to be fetched
+void ae_thread_flush(audio_encoder_t *encoder)
+{
+    ae_thread_t *c = encoder->thread;
+    unsigned int t = GetTimer();
+
+    pthread_mutex_lock(&c->lock);
+    while (c->fill || c->busy)
+        pthread_cond_wait(&c->cond, &c->lock);
+    c->wait_time += (GetTimer() - t) * 0.000001;
+    pthread_mutex_unlock(&c->lock);
+}
+
+/// seconds of audio queued or encoded but not muxed yet
+double ae_thread_delay(audio_encoder_t *encoder)
+{
+    ae_thread_t *c = encoder->thread;
+    double delay;
+
+    pthread_mutex_lock(&c->lock);
+    delay = c->queued;
+    pthread_mutex_unlock(&c->lock);
+    return delay;
+}
+
+/**
+ * \brief time spent encoding and waiting for the encoder
+ * \param encode_time seconds the thread spent in the encoder
+ * \param wait_time seconds the caller was blocked by a full queue or a flush
+ */
+void ae_thread_stats(audio_encoder_t *encoder, double *encode_time, double *wait_time)
+{
+    ae_thread_t *c = encoder->thread;
+
+    *encode_time = *wait_time = 0;
+    if (!c)
+        return;
+    pthread_mutex_lock(&c->lock);
+    *encode_time = c->encode_time;
+    *wait_time   = c->wait_time;
+    pthread_mutex_unlock(&c->lock);
+}
+
+/// stop the thread, the encoder works on the muxer stream again
+void ae_thread_uninit(audio_encoder_t *encoder)
+{
+    ae_thread_t *c = encoder->thread;
+
+    if (!c)
+        return;
+    pthread_mutex_lock(&c->lock);
+    c->quit = 1;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    pthread_join(c->thread, NULL);
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->lock);
+    encoder->stream = c->mux;
+    encoder->thread = NULL;
+    // an incomplete frame stays in the buffer as without the thread
+    c->mux->buffer_len = c->stream.buffer_len;
+    memcpy(c->mux->buffer, c->stream.buffer, c->stream.buffer_len);
+    free_thread(c);
+}
@@ -36,6 +36,7 @@
 #include "libaf/af_format.h"
 
 #include "libaf/af.h"
+#include "osdep/timer.h"
 
 #ifdef CONFIG_DYNAMIC_PLUGINS
 #include <dlfcn.h>
@@ -49,6 +50,10 @@ int fakemono = 0;
 int audio_output_channels = 2;
 af_cfg_t af_cfg = { 1, NULL };	// Configuration for audio filters
 
+// benchmark: time spent in the decoder and amount of audio it produced
+static double decode_time_usage;
+static double decoded_audio_len;
+
 void afm_help(void)
 {
     int i;
@@ -137,6 +142,9 @@ static int init_audio_codec(sh_audio_t *sh_audio)
     sh_audio->a_out_buffer = NULL;
     sh_audio->a_out_buffer_len = 0;
 
+    decode_time_usage = 0;
+    decoded_audio_len = 0;
+
     return 1;
 }
 
@@ -298,6 +306,15 @@ int init_best_audio_codec(sh_audio_t *sh_audio, char **audio_codec_list,
 
 void uninit_audio(sh_audio_t *sh_audio)
 {
+    if (af_cfg.benchmark && sh_audio->initialized) {
+	mp_msg(MSGT_DECAUDIO, MSGL_INFO,
+	       "BENCHMARKad: %s (%s) %8.3fs for %8.3fs of audio = %8.1fx realtime\n",
+	       sh_audio->codec->name, sh_audio->codec->drv,
+	       decode_time_usage, decoded_audio_len,
+	       decode_time_usage > 0 ? decoded_audio_len / decode_time_usage : 0);
+	if (sh_audio->afilter)
+	    af_print_benchmark(sh_audio->afilter);
+    }
     if (sh_audio->afilter) {
 	mp_msg(MSGT_DECAUDIO, MSGL_V, "Uninit audio filters...\n");
 	af_uninit(sh_audio->afilter);
@@ -389,10 +406,17 @@ static int filter_n_bytes(sh_audio_t *sh, int len)
 	unsigned char *buf = sh->a_buffer + sh->a_buffer_len;
 	int minlen = len - sh->a_buffer_len;
 	int maxlen = sh->a_buffer_size - sh->a_buffer_len;
+	unsigned int t = af_cfg.benchmark ? GetTimer() : 0;
 	int ret = sh->ad_driver->decode_audio(sh, buf, minlen, maxlen);
 	int format_change = sh->samplerate != filter_input.rate ||
 	                    sh->channels != filter_input.nch ||
 	                    sh->sample_format != filter_input.format;
+	if (af_cfg.benchmark) {
+	    decode_time_usage += (GetTimer() - t) * 0.000001;
+	    if (ret > 0)
+		decoded_audio_len += (double)ret / (sh->samplerate *
+		                     sh->channels * sh->samplesize);
+	}
 	if (ret <= 0 || format_change) {
 	    error = format_change ? -2 : -1;
 	    len = sh->a_buffer_len;
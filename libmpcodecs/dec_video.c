@@ -54,6 +54,10 @@ int field_dominance = -1;
 
 int divx_quality = 0;
 
+// -keyframes-only throughput
+static unsigned int keyframes_decoded;
+static unsigned int keyframes_start;
+
 const vd_functions_t *mpvdec = NULL;
 
 int get_video_quality_max(sh_video_t *sh_video)
@@ -175,6 +179,12 @@ void uninit_video(sh_video_t *sh_video)
     if (!sh_video->initialized)
         return;
     mp_msg(MSGT_DECVIDEO, MSGL_V, MSGTR_UninitVideoStr, sh_video->codec->drv);
+    if (keyframes_only) {
+        double t = (GetTimerMS() - keyframes_start) * 0.001;
+        mp_msg(MSGT_DECVIDEO, MSGL_INFO,
+               "Keyframes only: %u frames in %.3f s (%.1f frames/s)\n",
+               keyframes_decoded, t, t > 0 ? keyframes_decoded / t : 0);
+    }
     mpvdec->uninit(sh_video);
     mpvdec = NULL;
 #ifdef CONFIG_DYNAMIC_PLUGINS
@@ -314,6 +324,8 @@ static int init_video(sh_video_t *sh_video, char *codecname, char *vfm,
         }
         // Yeah! We got it!
         sh_video->initialized = 1;
+        keyframes_decoded = 0;
+        keyframes_start   = GetTimerMS();
         return 1;
     }
     return 0;
@@ -434,8 +446,9 @@ void *decode_video(sh_video_t *sh_video, unsigned char *start, int in_size,
     tt = t * 0.000001f;
     video_time_usage += tt;
 
-    if (!mpi || drop_frame)
+    if (!mpi || (drop_frame & VDFLAGS_DROPFRAME))
         return NULL;            // error / skipped frame
+    keyframes_decoded++;
 
     if (field_dominance == 0)
         mpi->fields |= MP_IMGFIELD_TOP_FIRST;
@@ -471,6 +484,19 @@ void *decode_video(sh_video_t *sh_video, unsigned char *start, int in_size,
     return mpi;
 }
 
+/**
+ * \brief get a picture the decoder still holds back at the end of the
+ *        stream, e.g. for B-frames or frame threads
+ * \return NULL once there is none left
+ */
+void *decode_video_drain(sh_video_t *sh_video)
+{
+    // only decoders that report their lag hold pictures back
+    if (get_current_video_decoder_lag(sh_video) < 0)
+        return NULL;
+    return decode_video(sh_video, NULL, 0, VDFLAGS_DRAIN, MP_NOPTS_VALUE, NULL);
+}
+
 int filter_video(sh_video_t *sh_video, void *frame, double pts)
 {
     mp_image_t *mpi = frame;
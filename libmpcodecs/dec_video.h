@@ -30,6 +30,7 @@ int init_best_video_codec(sh_video_t *sh_video, char** video_codec_list, char**
 void uninit_video(sh_video_t *sh_video);
 
 void *decode_video(sh_video_t *sh_video, unsigned char *start, int in_size, int drop_frame, double pts, int *full_frame);
+void *decode_video_drain(sh_video_t *sh_video);
 int filter_video(sh_video_t *sh_video, void *frame, double pts);
 
 int get_video_quality_max(sh_video_t *sh_video);
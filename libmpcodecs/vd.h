@@ -51,6 +51,7 @@ extern float screen_size_xy;
 
 extern const m_option_t lavc_decode_opts_conf[];
 extern const m_option_t xvid_dec_opts[];
+extern const m_option_t libmpeg2_dec_opts[];
 
 #define VDCTRL_QUERY_FORMAT 3 /* test for availabilty of a format */
 #define VDCTRL_QUERY_MAX_PP_LEVEL 4 /* test for postprocessing support (max level) */
@@ -66,5 +67,6 @@ mp_image_t* mpcodecs_get_image(sh_video_t *sh, int mp_imgtype, int mp_imgflag, i
 void mpcodecs_draw_slice(sh_video_t *sh, unsigned char** src, int* stride, int w,int h, int x, int y);
 
 #define VDFLAGS_DROPFRAME 3
+#define VDFLAGS_DRAIN 4 /* no more data, return a picture held back */
 
 #endif /* MPLAYER_VD_H */
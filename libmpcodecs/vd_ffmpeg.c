@@ -33,6 +33,7 @@
 
 #include "vd_internal.h"
 #include "vd_ffmpeg.h"
+#include "cpudetect.h"
 
 static const vd_info_t info = {
     "FFmpeg's libavcodec codec family",
@@ -76,6 +77,10 @@ typedef struct {
 
 #include "m_option.h"
 
+#define MAX_THREADS       64
+// the slice threaded decoders refuse more threads than this
+#define MAX_SLICE_THREADS 16
+
 static int get_buffer(AVCodecContext *avctx, AVFrame *pic);
 static void release_buffer(AVCodecContext *avctx, AVFrame *pic);
 static void draw_slice(struct AVCodecContext *s, const AVFrame *src, int offset[4],
@@ -100,7 +105,7 @@ static char *lavc_param_lowres_str=NULL;
 static char *lavc_param_skip_loop_filter_str = NULL;
 static char *lavc_param_skip_idct_str = NULL;
 static char *lavc_param_skip_frame_str = NULL;
-static int lavc_param_threads=1;
+static int lavc_param_threads=0;
 static int lavc_param_bitexact=0;
 static char *lavc_avopt = NULL;
 static enum AVDiscard skip_idct;
@@ -127,7 +132,7 @@ const m_option_t lavc_decode_opts_conf[]={
     {"skiploopfilter", &lavc_param_skip_loop_filter_str , CONF_TYPE_STRING  , 0, 0, 0, NULL},
     {"skipidct"      , &lavc_param_skip_idct_str        , CONF_TYPE_STRING  , 0, 0, 0, NULL},
     {"skipframe"     , &lavc_param_skip_frame_str       , CONF_TYPE_STRING  , 0, 0, 0, NULL},
-    {"threads"       , &lavc_param_threads              , CONF_TYPE_INT     , CONF_RANGE, 1, 8, NULL},
+    {"threads"       , &lavc_param_threads              , CONF_TYPE_INT     , CONF_RANGE, 0, MAX_THREADS, NULL},
     {"bitexact"      , &lavc_param_bitexact             , CONF_TYPE_FLAG    , 0, 0, CODEC_FLAG_BITEXACT, NULL},
     {"o"             , &lavc_avopt                      , CONF_TYPE_STRING  , 0, 0, 0, NULL},
     {NULL, NULL, 0, 0, 0, 0, NULL}
@@ -275,9 +280,7 @@ static int init(sh_video_t *sh){
     AVCodec *lavc_codec;
     int lowres_w=0;
     int do_vis_debug= lavc_param_vismv || (lavc_param_debug&(FF_DEBUG_VIS_MB_TYPE|FF_DEBUG_VIS_QP));
-    // slice is rather broken with threads, so disable that combination unless
-    // explicitly requested
-    int use_slices = vd_use_slices > 0 || (vd_use_slices <  0 && lavc_param_threads <= 1);
+    int threads = lavc_param_threads ? lavc_param_threads : FFMIN(GetCpuCount(), MAX_THREADS);
 
     init_avcodec();
 
@@ -293,10 +296,18 @@ static int init(sh_video_t *sh){
         return 0;
     }
 
-    if(use_slices && (lavc_codec->capabilities&CODEC_CAP_DRAW_HORIZ_BAND) && !do_vis_debug)
+    if(vd_use_slices && (lavc_codec->capabilities&CODEC_CAP_DRAW_HORIZ_BAND) && !do_vis_debug)
         ctx->do_slices=1;
 
-    if(lavc_codec->capabilities&CODEC_CAP_DR1 && !do_vis_debug && lavc_codec->id != CODEC_ID_H264 && lavc_codec->id != CODEC_ID_INTERPLAY_VIDEO && lavc_codec->id != CODEC_ID_ROQ && lavc_codec->id != CODEC_ID_VP8 && lavc_codec->id != CODEC_ID_LAGARITH)
+    // hardware decoding has to stay in the calling thread
+    if(lavc_codec->capabilities & (CODEC_CAP_HWACCEL | CODEC_CAP_HWACCEL_VDPAU))
+        threads = 1;
+    else if(!(lavc_codec->capabilities & CODEC_CAP_FRAME_THREADS))
+        threads = FFMIN(threads, MAX_SLICE_THREADS);
+
+    // H.264 needs more pictures than IPB offers, with frame threads
+    // numbered buffers are used (see get_buffer)
+    if(lavc_codec->capabilities&CODEC_CAP_DR1 && !do_vis_debug && (lavc_codec->id != CODEC_ID_H264 || threads > 1) && lavc_codec->id != CODEC_ID_INTERPLAY_VIDEO && lavc_codec->id != CODEC_ID_ROQ && lavc_codec->id != CODEC_ID_VP8 && lavc_codec->id != CODEC_ID_LAGARITH)
         ctx->do_dr1=1;
     ctx->b_age= ctx->ip_age[0]= ctx->ip_age[1]= 256*256*256*64;
     ctx->ip_count= ctx->b_count= 0;
@@ -357,6 +368,8 @@ static int init(sh_video_t *sh){
     }
 
     skip_idct = avctx->skip_idct;
+    if (keyframes_only && avctx->skip_frame < AVDISCARD_NONKEY)
+        avctx->skip_frame = AVDISCARD_NONKEY;
     skip_frame = avctx->skip_frame;
 
     mp_dbg(MSGT_DECVIDEO, MSGL_DBG2, "libavcodec.size: %d x %d\n", avctx->width, avctx->height);
@@ -445,8 +458,11 @@ static int init(sh_video_t *sh){
     if(sh->bih)
         avctx->bits_per_coded_sample= sh->bih->biBitCount;
 
-    avctx->thread_count = lavc_param_threads;
+    avctx->thread_count = threads;
     avctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    // get_buffer and release_buffer use the filter chain and must be called
+    // from this thread, libavcodec forwards them from the decoding threads
+    avctx->thread_safe_callbacks = 0;
     if(lavc_codec->capabilities & CODEC_CAP_HWACCEL)
         // HACK around badly placed checks in mpeg_mc_decode_init
         set_format_params(avctx, PIX_FMT_XVMC_MPEG2_IDCT);
@@ -460,6 +476,22 @@ static int init(sh_video_t *sh){
     // this is necessary in case get_format was never called and init_vo is
     // too late e.g. for H.264 VDPAU
     set_format_params(avctx, avctx->pix_fmt);
+    // draw_horiz_band would be called from the decoding threads, at the
+    // same time and out of order, the filters and VOs are not made for that
+    if (avctx->active_thread_type && vd_use_slices < 0)
+        ctx->do_slices = 0;
+    if (!(avctx->active_thread_type & FF_THREAD_FRAME) &&
+        lavc_codec->id == CODEC_ID_H264 && ctx->do_dr1) {
+        ctx->do_dr1 = 0;
+        avctx->get_buffer     = avcodec_default_get_buffer;
+        avctx->release_buffer = avcodec_default_release_buffer;
+        avctx->reget_buffer   = avcodec_default_reget_buffer;
+    }
+    if (avctx->active_thread_type)
+        mp_msg(MSGT_DECVIDEO, MSGL_V, "[ffmpeg] Using %d %s threads%s\n",
+               avctx->thread_count,
+               avctx->active_thread_type & FF_THREAD_FRAME ? "frame" : "slice",
+               ctx->do_dr1 ? ", direct rendering" : "");
     mp_msg(MSGT_DECVIDEO, MSGL_V, "INFO: libavcodec init OK!\n");
     return 1; //mpcodecs_config_vo(sh, sh->disp_w, sh->disp_h, IMGFMT_YV12);
 }
@@ -540,9 +572,13 @@ static void draw_slice(struct AVCodecContext *s,
 }
 
 
-static int init_vo(sh_video_t *sh, enum PixelFormat pix_fmt){
+/**
+ * \param avctx the context of the decoding thread the picture belongs to,
+ *              its dimensions can be ahead of the main context
+ */
+static int init_vo(sh_video_t *sh, AVCodecContext *avctx){
     vd_ffmpeg_ctx *ctx = sh->context;
-    AVCodecContext *avctx = ctx->avctx;
+    enum PixelFormat pix_fmt = avctx->pix_fmt;
     float aspect= av_q2d(avctx->sample_aspect_ratio) * avctx->width / avctx->height;
     int width, height;
 
@@ -604,7 +640,9 @@ static int get_buffer(AVCodecContext *avctx, AVFrame *pic){
     avcodec_align_dimensions(avctx, &width, &height);
 //printf("get_buffer %d %d %d\n", pic->reference, ctx->ip_count, ctx->b_count);
 
-    if (pic->buffer_hints) {
+    if (avctx->active_thread_type & FF_THREAD_FRAME) {
+        flags|= MP_IMGFLAG_PRESERVE|MP_IMGFLAG_READABLE;
+    } else if (pic->buffer_hints) {
         mp_msg(MSGT_DECVIDEO, MSGL_DBG2, "Buffer hints: %u\n", pic->buffer_hints);
         type = MP_IMGTYPE_TEMP;
         if (pic->buffer_hints & FF_BUFFER_HINTS_READABLE)
@@ -632,7 +670,7 @@ static int get_buffer(AVCodecContext *avctx, AVFrame *pic){
         }
     }
 
-    if(init_vo(sh, avctx->pix_fmt) < 0){
+    if(init_vo(sh, avctx) < 0){
         avctx->release_buffer= avcodec_default_release_buffer;
         avctx->get_buffer= avcodec_default_get_buffer;
         avctx->reget_buffer= avcodec_default_reget_buffer;
@@ -644,6 +682,11 @@ static int get_buffer(AVCodecContext *avctx, AVFrame *pic){
     if (IMGFMT_IS_HWACCEL(ctx->best_csp)) {
         type =  MP_IMGTYPE_NUMBERED | (0xffff << 16);
     } else
+    if (avctx->active_thread_type & FF_THREAD_FRAME) {
+        // every thread holds pictures of its own, IP/IPB would hand out the
+        // same buffers again, numbered ones stay in use until released
+        type = MP_IMGTYPE_NUMBERED | (0xffff << 16);
+    } else
     if (!pic->buffer_hints) {
         if(ctx->b_count>1 || ctx->ip_count>2){
             mp_msg(MSGT_DECVIDEO, MSGL_WARN, MSGTR_MPCODECS_DRIFailure);
@@ -667,6 +710,16 @@ static int get_buffer(AVCodecContext *avctx, AVFrame *pic){
     if (ctx->best_csp == IMGFMT_RGB8 || ctx->best_csp == IMGFMT_BGR8)
         flags |= MP_IMGFLAG_RGB_PALETTE;
     mpi= mpcodecs_get_image(sh, type, flags, width, height);
+    if (!mpi && (type & 0xff) == MP_IMGTYPE_NUMBERED && !IMGFMT_IS_HWACCEL(ctx->best_csp)) {
+        // out of numbered images, this many threads need internal buffers
+        mp_msg(MSGT_DECVIDEO, MSGL_WARN, MSGTR_MPCODECS_DRIFailure);
+        ctx->do_dr1=0;
+        // avctx can be the copy of a decoding thread, the main context
+        // passes the change on to all of them
+        ctx->avctx->get_buffer= avctx->get_buffer= avcodec_default_get_buffer;
+        ctx->avctx->reget_buffer= avctx->reget_buffer= avcodec_default_reget_buffer;
+        return avctx->get_buffer(avctx, pic);
+    }
     if (!mpi) return -1;
 
     // ok, let's see what did we get:
@@ -766,7 +819,14 @@ static void release_buffer(struct AVCodecContext *avctx, AVFrame *pic){
 
 //printf("release buffer %d %d %d\n", mpi ? mpi->flags&MP_IMGFLAG_PRESERVE : -99, ctx->ip_count, ctx->b_count);
 
-    if(ctx->ip_count <= 2 && ctx->b_count<=1){
+    // opaque is stale for internal buffers after a switch away from DR
+    if(pic->type!=FF_BUFFER_TYPE_USER){
+        avcodec_default_release_buffer(avctx, pic);
+        return;
+    }
+
+    if(!(avctx->active_thread_type & FF_THREAD_FRAME) &&
+       ctx->ip_count <= 2 && ctx->b_count<=1){
         if(mpi->flags&MP_IMGFLAG_PRESERVE)
             ctx->ip_count--;
         else
@@ -777,15 +837,10 @@ static void release_buffer(struct AVCodecContext *avctx, AVFrame *pic){
         // Palette support: free palette buffer allocated in get_buffer
         if (mpi->bpp == 8)
             av_freep(&mpi->planes[1]);
-        // release mpi (in case MPI_IMGTYPE_NUMBERED is used, e.g. for VDPAU)
+        // release mpi (MP_IMGTYPE_NUMBERED with frame threads or VDPAU)
         mpi->usage_count--;
     }
 
-    if(pic->type!=FF_BUFFER_TYPE_USER){
-        avcodec_default_release_buffer(avctx, pic);
-        return;
-    }
-
     for(i=0; i<4; i++){
         pic->data[i]= NULL;
     }
@@ -820,7 +875,8 @@ static mp_image_t *decode(sh_video_t *sh, void *data, int len, int flags){
     int dr1= ctx->do_dr1;
     AVPacket pkt;
 
-    if(len<=0) return NULL; // skipped frame
+    // an empty packet at the end returns the pictures held back
+    if(len<=0 && !(flags&VDFLAGS_DRAIN)) return NULL; // skipped frame
 
 //ffmpeg interlace (mpeg2) bug have been fixed. no need of -noslices
     if (!dr1)
@@ -839,16 +895,17 @@ static mp_image_t *decode(sh_video_t *sh, void *data, int len, int flags){
     avctx->skip_frame = skip_frame;
 
     if (flags&3) {
-        avctx->skip_frame = AVDISCARD_NONREF;
+        avctx->skip_frame = FFMAX(skip_frame, AVDISCARD_NONREF);
         if (flags&2)
             avctx->skip_idct = AVDISCARD_ALL;
     }
 
-    mp_msg(MSGT_DECVIDEO, MSGL_DBG2, "vd_ffmpeg data: %04x, %04x, %04x, %04x\n",
-           ((int *)data)[0], ((int *)data)[1], ((int *)data)[2], ((int *)data)[3]);
+    if (len > 0)
+        mp_msg(MSGT_DECVIDEO, MSGL_DBG2, "vd_ffmpeg data: %04x, %04x, %04x, %04x\n",
+               ((int *)data)[0], ((int *)data)[1], ((int *)data)[2], ((int *)data)[3]);
     av_init_packet(&pkt);
-    pkt.data = data;
-    pkt.size = len;
+    pkt.data = len > 0 ? data : NULL;
+    pkt.size = FFMAX(len, 0);
     // HACK: make PNGs decode normally instead of as CorePNG delta frames
     pkt.flags = AV_PKT_FLAG_KEY;
     ret = avcodec_decode_video2(avctx, pic, &got_picture, &pkt);
@@ -938,7 +995,7 @@ static mp_image_t *decode(sh_video_t *sh, void *data, int len, int flags){
 	    return NULL;    // skipped image
     }
 
-    if(init_vo(sh, avctx->pix_fmt) < 0) return NULL;
+    if(init_vo(sh, avctx) < 0) return NULL;
 
     if(dr1 && pic->opaque){
         mpi= (mp_image_t *)pic->opaque;
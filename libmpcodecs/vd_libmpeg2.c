@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include "mp_msg.h"
+#include "m_option.h"
 
 #include "vd_internal.h"
 
@@ -44,6 +45,13 @@ LIBVD_EXTERN(libmpeg2)
 
 #include "cpudetect.h"
 
+static int threads = 1;
+
+const m_option_t libmpeg2_dec_opts[] = {
+    {"threads", &threads, CONF_TYPE_INT, CONF_RANGE, 1, 16, NULL},
+    {NULL, NULL, 0, 0, 0, 0, NULL}
+};
+
 typedef struct {
     mpeg2dec_t *mpeg2dec;
     int quant_store_idx;
@@ -54,6 +62,7 @@ typedef struct {
     double aspect;
     unsigned char *pending_buffer;
     int pending_length;
+    int threads;
 } vd_libmpeg2_ctx_t;
 
 // to set/get/query special features/parameters
@@ -117,6 +126,14 @@ static int init(sh_video_t *sh){
     context->mpeg2dec = mpeg2dec;
     sh->context = context;
 
+#ifdef CONFIG_LIBMPEG2_INTERNAL
+    context->threads = mpeg2_threads(mpeg2dec, threads);
+    if (context->threads > 1)
+        mp_msg(MSGT_DECVIDEO, MSGL_V, "[libmpeg2] Using %d slice threads\n", context->threads);
+#else
+    context->threads = 1;
+#endif
+
     return 1;
 }
 
@@ -224,13 +241,15 @@ static mp_image_t* decode(sh_video_t *sh,void* data,int len,int flags){
 
 	    drop_frame = framedrop && (mpeg2dec->decoder.coding_type == B_TYPE);
             drop_frame |= framedrop>=2; // hard drop
+            drop_frame |= keyframes_only && type != PIC_FLAG_CODING_TYPE_I;
             if (drop_frame) {
                mpeg2_skip(mpeg2dec, 1);
 	       break;
 	    }
             mpeg2_skip(mpeg2dec, 0); //mpeg2skip skips frames until set again to 0
 
-	    use_callback = (!framedrop && vd_use_slices &&
+	    // slice callbacks would force in order, single threaded decoding
+	    use_callback = (!framedrop && vd_use_slices && context->threads == 1 &&
 	    		    (info->current_picture->flags&PIC_FLAG_PROGRESSIVE_FRAME)) ?
 			    MP_IMGFLAG_DRAW_CALLBACK:0;
 
@@ -288,7 +307,8 @@ static mp_image_t* decode(sh_video_t *sh,void* data,int len,int flags){
 	case STATE_END:
 	case STATE_INVALID_END:
 	    // decoding done:
-	    if(info->display_fbuf) {
+	    if(info->display_fbuf && !(keyframes_only && info->display_picture &&
+	       (info->display_picture->flags&PIC_MASK_CODING_TYPE) != PIC_FLAG_CODING_TYPE_I)) {
 		mp_image_t* mpi = info->display_fbuf->id;
 		if (context->pending_length == 0) {
 		    context->pending_length = mpeg2dec->buf_end - mpeg2dec->buf_start;
@@ -38,7 +38,8 @@ typedef struct vf_info_s {
     const void* opts;
 } vf_info_t;
 
-#define NUM_NUMBERED_MPI 50
+// enough for 64 frame threads plus the H.264 references and delay
+#define NUM_NUMBERED_MPI 128
 
 typedef struct vf_image_context_s {
     mp_image_t* static_images[2];
@@ -210,6 +210,19 @@ static uint32_t avi_find_id(stream_t *stream) {
   return id;
 }
 
+/// -keyframes-only: drop video chunks the index marks as delta frames unread
+static int avi_skip_delta_frame(demuxer_t *demux, demux_stream_t *ds,
+                                AVIINDEXENTRY *idx)
+{
+  avi_priv_t *priv = demux->priv;
+  if (!keyframes_only || ds != demux->video || priv->skip_video_frames ||
+      (idx->dwFlags & AVIIF_KEYFRAME))
+    return 0;
+  // the video pts is derived from the frame count
+  ++priv->video_pack_no;
+  return 1;
+}
+
 // return value:
 //     0 = EOF or no stream found
 //     1 = successfully read a packet
@@ -236,10 +249,13 @@ do{
         mp_msg(MSGT_DEMUX, MSGL_WARN, "Looks like unaligned chunk in index, broken AVI file!\n");
       priv->warned_unaligned = 1;
     }
-    if(!demux_avi_select_stream(demux,idx->ckid)){
+    ds=demux_avi_select_stream(demux,idx->ckid);
+    if(!ds){
       mp_dbg(MSGT_DEMUX,MSGL_DBG3,"Skip chunk %.4s (0x%X)  \n",(char *)&idx->ckid,(unsigned int)idx->ckid);
       continue; // skip this chunk
     }
+    if(avi_skip_delta_frame(demux,ds,idx))
+      continue;
 
     pos = (off_t)priv->idx_offset+AVI_IDX_OFFSET(idx);
     if((pos<demux->movi_start || pos>=demux->movi_end) && (demux->movi_end>demux->movi_start) && (demux->stream->flags & MP_STREAM_SEEK)){
@@ -344,6 +360,8 @@ do{
       mp_dbg(MSGT_DEMUX,MSGL_DBG3,"Skip chunk %.4s (0x%X)  \n",(char *)&idx->ckid,(unsigned int)idx->ckid);
       continue; // skip this chunk
     }
+    if(avi_skip_delta_frame(demux,demux_avi_select_stream(demux,idx->ckid),idx))
+      continue;
 
     pos = priv->idx_offset+AVI_IDX_OFFSET(idx);
     if((pos<demux->movi_start || pos>=demux->movi_end) && (demux->movi_end>demux->movi_start)){
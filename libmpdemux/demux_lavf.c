@@ -414,6 +414,8 @@ static void handle_stream(demuxer_t *demuxer, AVFormatContext *avfc, int i) {
             }
             if(demuxer->video->id != i)
                 st->discard= AVDISCARD_ALL;
+            else if(keyframes_only)
+                st->discard= AVDISCARD_NONKEY;
             stream_id = priv->video_streams++;
             break;
         }
@@ -623,6 +625,11 @@ static int demux_lavf_fill_buffer(demuxer_t *demux, demux_stream_t *dsds){
             ds->sh=demux->v_streams[id];
             mp_msg(MSGT_DEMUX,MSGL_V,"Auto-selected LAVF video ID = %d\n",ds->id);
         }
+        // not every format honours AVDISCARD_NONKEY
+        if(keyframes_only && !(pkt.flags & AV_PKT_FLAG_KEY)){
+            av_free_packet(&pkt);
+            return 1;
+        }
     } else if(id==demux->sub->id){
         // subtitle
         ds=demux->sub;
@@ -756,7 +763,8 @@ static int demux_lavf_control(demuxer_t *demuxer, int cmd, void *arg)
 	            priv->avfc->streams[ds->id]->discard = AVDISCARD_ALL;
 	        *((int*)arg) = ds->id = newid;
 	        if(newid >= 0)
-	            priv->avfc->streams[newid]->discard = AVDISCARD_NONE;
+	            priv->avfc->streams[newid]->discard =
+	                keyframes_only && ds == demuxer->video ? AVDISCARD_NONKEY : AVDISCARD_NONE;
 	        return DEMUXER_CTRL_OK;
 	    }
         }
@@ -2595,7 +2595,7 @@ static int handle_block(demuxer_t *demuxer, uint8_t *block, uint64_t length,
         use_this_block = 0;
     else if (num == demuxer->video->id) {
         ds = demuxer->video;
-        if (mkv_d->v_skip_to_keyframe) {
+        if (mkv_d->v_skip_to_keyframe || keyframes_only) {
             if (simpleblock) {
                 if (!(flags & 0x80))    /*current frame isn't a keyframe */
                     use_this_block = 0;
@@ -2765,12 +2765,15 @@ static int demux_mkv_fill_buffer(demuxer_t *demuxer, demux_stream_t *ds)
                 case MATROSKA_ID_SIMPLEBLOCK:
                 {
                     int res;
+                    uint8_t *mapped;
                     block_length = ebml_read_length(s, &tmp);
                     if (block_length > SIZE_MAX)
                         return 0;
-                    block = malloc(block_length);
                     demuxer->filepos = stream_tell(s);
-                    if (stream_read(s, block, block_length) !=
+                    // parse the block right in the mapped file if possible
+                    mapped = stream_read_ptr(s, block_length);
+                    block = mapped ? mapped : malloc(block_length);
+                    if (!mapped && stream_read(s, block, block_length) !=
                         (int) block_length) {
                         free(block);
                         return 0;
@@ -2779,7 +2782,8 @@ static int demux_mkv_fill_buffer(demuxer_t *demuxer, demux_stream_t *ds)
                     res = handle_block(demuxer, block, block_length,
                                        block_duration, block_bref,
                                        block_fref, 1);
-                    free(block);
+                    if (!mapped)
+                        free(block);
                     mkv_d->cluster_size -= l + il;
                     if (res < 0)
                         return 0;
@@ -2107,6 +2107,20 @@ static mov_track_t *stream_track(mov_priv_t *priv, demux_stream_t *ds) {
   return NULL;
 }
 
+/// -keyframes-only: move a video track to the next sync sample
+static void mov_skip_to_keyframe(mov_track_t *trak)
+{
+    int lo = 0, hi = trak->keyframes_size;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (trak->keyframes[mid] < trak->pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    trak->pos = lo < trak->keyframes_size ? trak->keyframes[lo] : trak->samples_size;
+}
+
 // return value:
 //     0 = EOF or no stream found
 //     1 = successfully read a packet
@@ -2159,7 +2173,10 @@ if(trak->samplesize){
     } /* MOV_TRAK_AUDIO */
     pos=trak->chunks[trak->pos].pos;
 } else {
-    int frame=trak->pos;
+    int frame;
+    if(keyframes_only && trak->type == MOV_TRAK_VIDEO && trak->keyframes_size)
+	mov_skip_to_keyframe(trak);
+    frame=trak->pos;
     // editlist support:
     if(trak->type == MOV_TRAK_VIDEO && trak->editlist_size>=1){
 	// find the right editlist entry:
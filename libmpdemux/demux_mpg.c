@@ -36,6 +36,7 @@
 #include "stheader.h"
 #include "mp3_hdr.h"
 #include "demux_mpg.h"
+#include "mpeg_seek.h"
 
 //#define MAX_PS_PACKETSIZE 2048
 #define MAX_PS_PACKETSIZE (224*1024)
@@ -50,6 +51,8 @@
 #define AUDIO_LPCM_BE   0x10001
 #define AUDIO_AAC       mmioFOURCC('M', 'P', '4', 'A')
 
+#define PS_SEEK_WINDOW  (256*1024)
+
 typedef struct mpg_demuxer {
   float last_pts;
   float first_pts;              // first pts found in stream
@@ -59,6 +62,7 @@ typedef struct mpg_demuxer {
   unsigned int es_map[0x40];	//es map of stream types (associated to the pes id) from 0xb0 to 0xef
   int num_a_streams;
   int a_stream_ids[MAX_A_STREAMS];
+  mpeg_seek_index_t *seek_index; // SCR based position index
 } mpg_demuxer_t;
 
 static int mpeg_pts_error=0;
@@ -150,6 +154,8 @@ static float read_first_mpeg_pts_at_position(demuxer_t* demuxer, off_t stream_po
 
   found_pts3 = found_pts2 = found_pts1 = mpg_d->last_pts;
   stream_seek(s, stream_pos);
+  if(mpg_d->seek_index)
+    mpeg_seek_index_lost(mpg_d->seek_index);
 
   //We look for pts.
   //However, we do not stop at the first found one, as timestamps may reset
@@ -196,6 +202,10 @@ static demuxer_t* demux_mpg_open(demuxer_t* demuxer) {
     demuxer->priv = mpg_d;
     mpg_d->last_pts = -1.0;
     mpg_d->first_pts = -1.0;
+    if(demuxer->seekable
+       && (demuxer->stream->type == STREAMTYPE_FILE
+           || demuxer->stream->type == STREAMTYPE_VCD))
+      mpg_d->seek_index = mpeg_seek_index_alloc();
 
     //if seeking is allowed set has_valid_timestamps if appropriate
     if(demuxer->seekable
@@ -240,6 +250,8 @@ static demuxer_t* demux_mpg_open(demuxer_t* demuxer) {
       demuxer->audio->eof=0;
 
       stream_seek(s,pos);
+      if(mpg_d->seek_index)
+        mpeg_seek_index_lost(mpg_d->seek_index);
       ds_fill_buffer(demuxer->video);
     } // if ( demuxer->seekable )
   } // if ( mpg_d )
@@ -248,9 +260,57 @@ static demuxer_t* demux_mpg_open(demuxer_t* demuxer) {
 
 static void demux_close_mpg(demuxer_t* demuxer) {
   mpg_demuxer_t* mpg_d = demuxer->priv;
+  if(mpg_d)
+    mpeg_seek_index_free(mpg_d->seek_index);
   free(mpg_d);
 }
 
+/// SCR of an MPEG-1 or MPEG-2 pack header, b points after the start code
+static int ps_read_scr(const unsigned char *b, uint64_t *scr)
+{
+  if((b[0] & 0xC0) == 0x40) { // MPEG-2
+    if(!(b[0] & 0x04) || !(b[2] & 0x04) || !(b[4] & 0x04))
+      return 0;
+    *scr = ((uint64_t)((b[0] >> 3) & 7) << 30) | ((uint64_t)(b[0] & 3) << 28) |
+           (b[1] << 20) | ((b[2] >> 3) << 15) | ((b[2] & 3) << 13) |
+           (b[3] << 5) | (b[4] >> 3);
+    return 1;
+  }
+  if((b[0] & 0xF0) == 0x20) { // MPEG-1
+    if(!(b[0] & 1) || !(b[2] & 1) || !(b[4] & 1))
+      return 0;
+    *scr = ((uint64_t)((b[0] >> 1) & 7) << 30) | (b[1] << 22) |
+           ((b[2] >> 1) << 15) | (b[3] << 7) | (b[4] >> 1);
+    return 1;
+  }
+  return 0;
+}
+
+/// find the first pack header in [pos, pos+max_len) for the seek index
+static off_t ps_probe_scr(demuxer_t *demuxer, off_t pos, off_t max_len, uint64_t *scr)
+{
+  stream_t *s = demuxer->stream;
+  unsigned int head = 0xFFFFFFFF;
+  unsigned char b[5];
+
+  stream_seek(s, pos);
+  s->eof = 0;
+  while(stream_tell(s) < pos + max_len) {
+    int c = stream_read_char(s);
+    if(c < 0)
+      break;
+    head = (head << 8) | c;
+    if(head != 0x1BA)
+      continue;
+    if(stream_read(s, b, 5) != 5)
+      break;
+    if(ps_read_scr(b, scr))
+      return stream_tell(s) - 9;
+    stream_skip(s, -5);
+  }
+  return -1;
+}
+
 
 static unsigned long long read_mpeg_timestamp(stream_t *s,int c){
   unsigned int d,e;
@@ -308,7 +368,14 @@ static int demux_mpg_read_packet(demuxer_t *demux,int id){
 //    return -1;
 //}
 
-//  if(id==0x1BA) packet_start_pos=stream_tell(demux->stream);
+  if(id==0x1BA) {
+    unsigned char b[5];
+    uint64_t scr;
+    if(priv && priv->seek_index && stream_read(demux->stream, b, 5) == 5 &&
+       ps_read_scr(b, &scr))
+      mpeg_seek_index_add(priv->seek_index, stream_tell(demux->stream) - 9, scr, 0);
+    return -1;
+  }
   if((id<0x1BC || id>=0x1F0) && id != 0x1FD) return -1;
   if(id==0x1BE) return -1; // padding stream
   if(id==0x1BF) return -1; // private2
@@ -900,6 +967,28 @@ do{
   return 1;
 }
 
+//bisects the file by SCR, returns -1 if that isn't possible
+static off_t ps_seek_scr(demuxer_t *demuxer, float rel_seek_secs, int flags)
+{
+    mpg_demuxer_t *mpg_d = demuxer->priv;
+    double time = rel_seek_secs;
+
+    if(!mpg_d || !mpg_d->seek_index)
+        return -1;
+    if(!(flags & SEEK_ABSOLUTE)) {
+        double cur = -1;
+        if(mpg_d->last_pts >= 0)
+            cur = mpeg_seek_index_pts_to_time(mpg_d->seek_index, mpg_d->last_pts);
+        if(cur < 0)
+            cur = mpeg_seek_index_current(mpg_d->seek_index);
+        if(cur < 0)
+            return -1;
+        time += cur;
+    }
+    return mpeg_seek_index_find(mpg_d->seek_index, demuxer, time < 0 ? 0 : time,
+                                ps_probe_scr, PS_SEEK_WINDOW);
+}
+
 static void demux_seek_mpg(demuxer_t *demuxer, float rel_seek_secs,
                            float audio_delay, int flags)
 {
@@ -913,6 +1002,8 @@ static void demux_seek_mpg(demuxer_t *demuxer, float rel_seek_secs,
     off_t oldpos = demuxer->filepos;
     float newpts = 0;
     off_t newpos = (flags & SEEK_ABSOLUTE) ? demuxer->movi_start : oldpos;
+    off_t pos;
+    int indexed = 0;
 
     if(mpg_d)
       oldpts = mpg_d->last_pts;
@@ -931,6 +1022,11 @@ static void demux_seek_mpg(demuxer_t *demuxer, float rel_seek_secs,
     if(flags&SEEK_FACTOR){
 	// float seek 0..1
 	newpos+=(demuxer->movi_end-demuxer->movi_start)*rel_seek_secs;
+    } else if((pos = ps_seek_scr(demuxer, rel_seek_secs, flags)) >= 0) {
+        // exact position from the SCR index, no need to refine
+        newpos = pos;
+        precision = 0;
+        indexed = 1;
     } else {
 	// time seek (secs)
         if (mpg_d && mpg_d->has_valid_timestamps) {
@@ -951,6 +1047,9 @@ static void demux_seek_mpg(demuxer_t *demuxer, float rel_seek_secs,
 	}
 
         stream_seek(demuxer->stream,newpos);
+        demuxer->stream->eof=0;
+        if(mpg_d && mpg_d->seek_index && !indexed)
+          mpeg_seek_index_lost(mpg_d->seek_index);
 
         // re-sync video:
         videobuf_code_len=0; // reset ES stream buffer
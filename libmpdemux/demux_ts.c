@@ -39,6 +39,7 @@
 #include "ms_hdr.h"
 #include "mpeg_hdr.h"
 #include "demux_ts.h"
+#include "mpeg_seek.h"
 
 #define TS_PH_PACKET_SIZE 192
 #define TS_FEC_PACKET_SIZE 204
@@ -48,6 +49,9 @@
 #define MAX_HEADER_SIZE 6			/* enough for PES header + length */
 #define MAX_CHECK_SIZE	65535
 #define NUM_CONSECUTIVE_TS_PACKETS 32
+#define TS_BLOCK_PACKETS 64			/* packets read from the stream at once */
+#define TS_SEEK_WINDOW (1024*1024)			/* max bytes searched for a PCR when seeking */
+#define TS_SPLIT_MAX_BYTES (16*1024*1024)		//don't let a program nobody reads grow without bounds
 #define NUM_CONSECUTIVE_AUDIO_PACKETS 348
 #define MAX_A52_FRAME_SIZE 3840
 
@@ -61,6 +65,7 @@
 
 int ts_prog;
 int ts_keep_broken=0;
+int ts_split = 0;
 off_t ts_probe = 0;
 int audio_substream_id = -1;
 
@@ -113,6 +118,17 @@ typedef struct {
 	struct {
 		uint8_t au_start, au_end, last_au_end;
 	} sl;
+	struct {			//-keyframes-only, random access indicator
+		uint8_t seen;		//the stream signals random access points
+		uint8_t skip;		//drop the current PES packet
+	} rai;
+	struct {			//PAT/PMT information about this pid
+		int gen;		//valid if equal to priv->tables_gen
+		struct pmt_t_s *pmt;
+		int32_t type, progid;
+		uint8_t *lang;
+		uint64_t split_mask;	//programs in split mode that contain this pid
+	} tab;
 } ES_stream_t;
 
 typedef struct {
@@ -194,7 +210,7 @@ typedef struct {
 	ts_section_t section;
 } pat_t;
 
-typedef struct {
+typedef struct pmt_t_s {
 	uint16_t progid;
 	uint8_t skip;
 	uint8_t table_id;
@@ -228,6 +244,16 @@ typedef struct {
 	double last_pts;
 } TS_stream_info;
 
+typedef struct {
+	int progid;
+	uint16_t pmt_pid;
+	demux_stream_t *ds;	//raw TS packets of this program
+	demux_packet_t *dp;	//block being filled
+	int len;
+	int pat_cc;
+	int dropped;
+} ts_split_prog_t;
+
 typedef struct {
 	MpegTSContext ts;
 	int last_pid;
@@ -241,7 +267,22 @@ typedef struct {
 	int last_aid;
 	int last_vid;
 	int last_sid;
-	char packet[TS_FEC_PACKET_SIZE];
+	int tables_gen;		//bumped whenever the PAT/PMT or the program change
+	unsigned char *blk;	//raw packets read ahead from the stream
+	unsigned char *blk_buf;	//blk unless it points into the mapped file
+	int blk_len, blk_pos;
+	int blk_synced;		//sync bytes up to here were already checked
+	off_t blk_start;	//stream position of blk[0]
+	off_t blk_end;		//stream position after the last read into blk
+	mpeg_seek_index_t *seek_index;
+	struct {			//see demux_ts_split_programs()
+		int enabled;
+		int probe;		//also split while probing, the stream can't go back
+		int gen;		//programs are up to date if equal to tables_gen
+		int flushed;		//a block was queued since ts_parse() last returned
+		int cnt;
+		ts_split_prog_t prog[TS_SPLIT_MAX_PROGRAMS];
+	} split;
 	TS_stream_info vstr, astr;
 } ts_priv_t;
 
@@ -295,7 +336,9 @@ static int IS_SUB(es_stream_type_t type)
 	return 0;
 }
 
-static int ts_parse(demuxer_t *demuxer, ES_stream_t *es, unsigned char *packet, int probe);
+static int ts_parse(demuxer_t *demuxer, ES_stream_t *es, int probe);
+static off_t ts_tell(demuxer_t *demuxer);
+static int ts_eof(demuxer_t *demuxer);
 
 static uint8_t get_packet_size(const unsigned char *buf, int size)
 {
@@ -666,7 +709,6 @@ static off_t ts_detect_streams(demuxer_t *demuxer, tsdemux_init_t *param)
 	int32_t p, chosen_pid = 0;
 	off_t pos=0, ret = 0, init_pos, end_pos;
 	ES_stream_t es;
-	unsigned char tmp[TS_FEC_PACKET_SIZE];
 	ts_priv_t *priv = (ts_priv_t*) demuxer->priv;
 	struct {
 		char *buf;
@@ -682,16 +724,16 @@ static off_t ts_detect_streams(demuxer_t *demuxer, tsdemux_init_t *param)
 
 	has_tables = 0;
 	memset(pes_priv1, 0, sizeof(pes_priv1));
-	init_pos = stream_tell(demuxer->stream);
+	init_pos = ts_tell(demuxer);
 	mp_msg(MSGT_DEMUXER, MSGL_V, "PROBING UP TO %"PRIu64", PROG: %d\n", (uint64_t) param->probe, param->prog);
 	end_pos = init_pos + (param->probe ? param->probe : TS_MAX_PROBE_SIZE);
 	while(1)
 	{
-		pos = stream_tell(demuxer->stream);
-		if(pos > end_pos || demuxer->stream->eof)
+		pos = ts_tell(demuxer);
+		if(pos > end_pos || ts_eof(demuxer))
 			break;
 
-		if(ts_parse(demuxer, &es, tmp, 1))
+		if(ts_parse(demuxer, &es, 1))
 		{
 			//Non PES-aligned A52 audio may escape detection if PMT is not present;
 			//in this case we try to find at least 3 A52 syncwords
@@ -761,7 +803,7 @@ static off_t ts_detect_streams(demuxer_t *demuxer, tsdemux_init_t *param)
 
 			if((ret == 0) && chosen_pid)
 			{
-				ret = stream_tell(demuxer->stream);
+				ret = ts_tell(demuxer);
 			}
 
 			p = progid_for_pid(priv, es.pid, param->prog);
@@ -1011,7 +1053,20 @@ static demuxer_t *demux_open_ts(demuxer_t * demuxer)
 	priv->pmt_cnt = 0;
 
 	priv->keep_broken = ts_keep_broken;
+	priv->split.enabled = ts_split;
+	priv->split.probe = ts_split && !(demuxer->stream->flags & MP_STREAM_SEEK_BW);
 	priv->ts.packet_size = packet_size;
+	priv->tables_gen = 1;
+	priv->blk = priv->blk_buf = malloc(TS_BLOCK_PACKETS * TS_FEC_PACKET_SIZE);
+	priv->blk_end = -1;
+	priv->seek_index = mpeg_seek_index_alloc();
+	if(priv->blk == NULL || priv->seek_index == NULL)
+	{
+		free(priv->blk_buf);
+		mpeg_seek_index_free(priv->seek_index);
+		free(priv);
+		return NULL;
+	}
 
 
 	demuxer->priv = priv;
@@ -1040,6 +1095,7 @@ static demuxer_t *demux_open_ts(demuxer_t * demuxer)
 
 	demuxer->sub->id = params.spid;
 	priv->prog = params.prog;
+	priv->tables_gen++;
 
 	if(params.vtype != UNKNOWN)
 	{
@@ -1068,13 +1124,17 @@ static demuxer_t *demux_open_ts(demuxer_t * demuxer)
 	mp_msg(MSGT_DEMUXER,MSGL_V, "Opened TS demuxer, audio: %x(pid %d), video: %x(pid %d)...POS=%"PRIu64", PROBE=%"PRIu64"\n", params.atype, demuxer->audio->id, params.vtype, demuxer->video->id, (uint64_t) start_pos, ts_probe);
 
 
-	start_pos = start_pos <= priv->ts.packet_size ?
+	start_pos = start_pos <= priv->ts.packet_size || priv->split.enabled ?
                     demuxer->stream->start_pos :
                     start_pos - priv->ts.packet_size;
 	demuxer->movi_start = start_pos;
 	demuxer->reference_clock = MP_NOPTS_VALUE;
-	stream_reset(demuxer->stream);
-	stream_seek(demuxer->stream, start_pos);	//IF IT'S FROM A PIPE IT WILL FAIL, BUT WHO CARES?
+	// the split streams already got the packets read while probing
+	if(!priv->split.probe)
+	{
+		stream_reset(demuxer->stream);
+		stream_seek(demuxer->stream, start_pos);	//IF IT'S FROM A PIPE IT WILL FAIL, BUT WHO CARES?
+	}
 
 
 	priv->last_pid = 8192;		//invalid pid
@@ -1130,6 +1190,14 @@ static void demux_close_ts(demuxer_t * demuxer)
 				free_demux_packet(priv->fifo[i].pack);
 			priv->fifo[i].pack = NULL;
 		}
+		for (i = 0; i < priv->split.cnt; i++)
+		{
+			if (priv->split.prog[i].dp)
+				free_demux_packet(priv->split.prog[i].dp);
+			free_demuxer_stream(priv->split.prog[i].ds);
+		}
+		free(priv->blk_buf);
+		mpeg_seek_index_free(priv->seek_index);
 		free(priv);
 	}
 	demuxer->priv=NULL;
@@ -1629,15 +1697,157 @@ static int pes_parse2(unsigned char *buf, uint16_t packet_len, ES_stream_t *es,
 
 
 
-static int ts_sync(stream_t *stream)
+/*
+ * Packets are read from the stream TS_BLOCK_PACKETS at a time and parsed in
+ * place, the payload is then copied only once, into the demux packet.
+ * For a mapped file the block is not copied at all, blk points right into
+ * the mapping.
+ * If something else moves the stream (e.g. a seek) the block is dropped.
+ */
+static void ts_check_block(demuxer_t *demuxer)
 {
-	mp_msg(MSGT_DEMUX, MSGL_DBG3, "TS_SYNC \n");
+	ts_priv_t *priv = demuxer->priv;
+	off_t pos = stream_tell(demuxer->stream);
 
-	while (!stream->eof)
-		if (stream_read_char(stream) == 0x47)
-			return 1;
+	if(pos != priv->blk_end)
+	{
+		priv->blk_start = priv->blk_end = pos;
+		priv->blk_len = priv->blk_pos = priv->blk_synced = 0;
+	}
+}
 
-	return 0;
+static off_t ts_tell(demuxer_t *demuxer)
+{
+	ts_priv_t *priv = demuxer->priv;
+
+	ts_check_block(demuxer);
+	return priv->blk_start + priv->blk_pos;
+}
+
+static int ts_eof(demuxer_t *demuxer)
+{
+	ts_priv_t *priv = demuxer->priv;
+
+	ts_check_block(demuxer);
+	return demuxer->stream->eof && priv->blk_len - priv->blk_pos < priv->ts.packet_size;
+}
+
+static int ts_fill_block(demuxer_t *demuxer)
+{
+	ts_priv_t *priv = demuxer->priv;
+	int size = priv->ts.packet_size;
+	int left = priv->blk_len - priv->blk_pos;
+	int want = TS_BLOCK_PACKETS * size - left;
+	int len, i;
+	stream_t *s = demuxer->stream;
+	unsigned char *map = NULL;
+
+	//the rest of a block in the mapping is followed by the next one
+	if(!left || priv->blk != priv->blk_buf)
+		map = stream_read_ptr(s, want);
+	if(map)
+	{
+		priv->blk = map - left;
+		len = want;
+	}
+	else
+	{
+		memmove(priv->blk_buf, priv->blk + priv->blk_pos, left);
+		priv->blk = priv->blk_buf;
+	}
+	priv->blk_start += priv->blk_pos;
+	priv->blk_pos = 0;
+
+	if(!map)
+	{
+		//on live streams don't wait for more than one packet
+		if(s->type == STREAMTYPE_STREAM || s->type == STREAMTYPE_DVB)
+			want = FFMIN(want, FFMAX(size - left, s->buf_len - s->buf_pos));
+
+		len = stream_read(s, (char *)priv->blk + left, want);
+	}
+	priv->blk_len = left + len;
+	priv->blk_end = stream_tell(s);
+
+	//check the sync bytes of the whole block at once
+	for(i = 0; i + size <= priv->blk_len && priv->blk[i] == 0x47; i += size)
+		;
+	priv->blk_synced = i;
+
+	return len > 0;
+}
+
+//returns the next packet, starting with the sync byte, or NULL on EOF
+static unsigned char *ts_get_packet(demuxer_t *demuxer)
+{
+	ts_priv_t *priv = demuxer->priv;
+	int size = priv->ts.packet_size;
+	unsigned char *p;
+
+	ts_check_block(demuxer);
+	while(priv->blk_pos >= priv->blk_synced)
+	{
+		if(priv->blk_len - priv->blk_pos < size)
+		{
+			if(! ts_fill_block(demuxer))
+				return NULL;
+			continue;
+		}
+
+		if(priv->blk[priv->blk_pos] == 0x47)
+			break;
+
+		mp_msg(MSGT_DEMUX, MSGL_DBG3, "TS_SYNC \n");
+		p = priv->blk + priv->blk_pos;
+		//if possible also check the sync byte of the following packet
+		do
+			p = memchr(p + 1, 0x47, priv->blk + priv->blk_len - p - 1);
+		while(p && p + size < priv->blk + priv->blk_len && p[size] != 0x47);
+		priv->blk_pos = p ? p - priv->blk : priv->blk_len;
+		priv->blk_synced = 0;
+	}
+
+	p = priv->blk + priv->blk_pos;
+	priv->blk_pos += size;
+
+	return p;
+}
+
+//33 bit 90 kHz base of the PCR in an adaptation field
+static uint64_t ts_read_pcr(const uint8_t *pcrbuf)
+{
+	uint64_t pcr;
+
+	pcr  = (int64_t)(pcrbuf[0]) << 25;
+	pcr |=  pcrbuf[1]         << 17 ;
+	pcr |= (pcrbuf[2]) << 9;
+	pcr |=  pcrbuf[3]  <<  1 ;
+	pcr |= (pcrbuf[4] & 0x80) >>  7;
+
+	return pcr;
+}
+
+//finds the first PCR of the current program at or after pos
+static off_t ts_probe_pcr(demuxer_t *demuxer, off_t pos, off_t max_len, uint64_t *pcr)
+{
+	ts_priv_t *priv = demuxer->priv;
+	int pcr_pid = prog_pcr_pid(priv, priv->prog);
+	unsigned char *packet;
+
+	stream_seek(demuxer->stream, pos);
+	demuxer->stream->eof = 0;
+	while(ts_tell(demuxer) < pos + max_len && (packet = ts_get_packet(demuxer)))
+	{
+		int pid = ((packet[1] & 0x1f) << 8) | packet[2];
+
+		if(pid == pcr_pid && (packet[3] & 0x20) && packet[4] >= 7 && (packet[5] & 0x10))
+		{
+			*pcr = ts_read_pcr(&packet[6]);
+			return ts_tell(demuxer) - priv->ts.packet_size;
+		}
+	}
+
+	return -1;
 }
 
 
@@ -1755,6 +1965,7 @@ static int parse_pat(ts_priv_t * priv, int is_start, unsigned char *buff, int si
 	skip = collect_section(section, is_start, buff, size);
 	if(! skip)
 		return 0;
+	priv->tables_gen++;
 
 	ptr = &(section->buffer[skip]);
 	//PARSING
@@ -2439,6 +2650,7 @@ static int parse_pmt(ts_priv_t * priv, uint16_t progid, uint16_t pid, int is_sta
 		memset(&(priv->pmt[idx]), 0, sizeof(pmt_t));
 		priv->pmt_cnt++;
 		priv->pmt[idx].progid = progid;
+		priv->tables_gen++;
 	}
 
 	pmt = &(priv->pmt[idx]);
@@ -2447,6 +2659,7 @@ static int parse_pmt(ts_priv_t * priv, uint16_t progid, uint16_t pid, int is_sta
 	skip = collect_section(section, is_start, buff, size);
 	if(! skip)
 		return 0;
+	priv->tables_gen++;
 
 	base = &(section->buffer[skip]);
 
@@ -2763,15 +2976,236 @@ static int fill_extradata(mp4_decoder_config_t * mp4_dec, ES_stream_t *tss)
 	return tss->extradata_len;
 }
 
+static uint64_t ts_split_mask(ts_priv_t *priv, int pid)
+{
+	uint64_t mask = 0;
+	int i, idx;
+
+	for(i = 0; i < priv->split.cnt; i++)
+	{
+		ts_split_prog_t *sp = &priv->split.prog[i];
+		pmt_t *pmt;
+
+		if(pid == sp->pmt_pid)
+		{
+			mask |= 1ULL << i;
+			continue;
+		}
+		idx = progid_idx_in_pmt(priv, sp->progid);
+		if(idx == -1)
+			continue;
+		pmt = &priv->pmt[idx];
+		if(pmt->PCR_PID == pid || es_pid_in_pmt(pmt, pid) != -1)
+			mask |= 1ULL << i;
+	}
+
+	return mask;
+}
+
+//caches what the PAT and PMTs say about a pid, so that it needn't be looked up for every packet
+static void update_pid_tables(ts_priv_t *priv, ES_stream_t *tss)
+{
+	mp4_decoder_config_t *mp4_dec = NULL;
+
+	tss->tab.pmt = pmt_of_pid(priv, tss->pid, &mp4_dec);
+	tss->tab.type = pid_type_from_pmt(priv, tss->pid);
+	tss->tab.lang = pid_lang_from_pmt(priv, tss->pid);
+	tss->tab.progid = prog_id_in_pat(priv, tss->pid);
+	tss->tab.split_mask = priv->split.enabled ? ts_split_mask(priv, tss->pid) : 0;
+	tss->tab.gen = priv->tables_gen;
+
+	if(mp4_dec)
+	{
+		fill_extradata(mp4_dec, tss);
+		if(IS_VIDEO(mp4_dec->object_type) || IS_AUDIO(mp4_dec->object_type))
+		{
+			tss->type = SL_PES_STREAM;
+			tss->subtype = mp4_dec->object_type;
+		}
+	}
+}
+
+static void ts_split_flush(ts_priv_t *priv, ts_split_prog_t *sp)
+{
+	if(! sp->dp)
+		return;
+
+	if(sp->ds->bytes < TS_SPLIT_MAX_BYTES)
+	{
+		resize_demux_packet(sp->dp, sp->len);
+		ds_add_packet(sp->ds, sp->dp);
+		priv->split.flushed = 1;
+	}
+	else
+	{
+		if(! sp->dropped++)
+			mp_msg(MSGT_DEMUX, MSGL_WARN, "TS split: program %d isn't read, dropping its packets\n", sp->progid);
+		free_demux_packet(sp->dp);
+	}
+	sp->dp = NULL;
+}
+
+static void ts_split_queue(demuxer_t *demuxer, ts_split_prog_t *sp, const unsigned char *packet)
+{
+	ts_priv_t *priv = demuxer->priv;
+
+	if(! sp->dp)
+	{
+		sp->dp = new_demux_packet(TS_BLOCK_PACKETS * TS_PACKET_SIZE);
+		if(! sp->dp)
+			return;
+		sp->dp->pos = ts_tell(demuxer) - priv->ts.packet_size;
+		sp->len = 0;
+	}
+
+	memcpy(sp->dp->buffer + sp->len, packet, TS_PACKET_SIZE);
+	sp->len += TS_PACKET_SIZE;
+	if(sp->len == TS_BLOCK_PACKETS * TS_PACKET_SIZE)
+		ts_split_flush(priv, sp);
+}
+
+static uint32_t ts_crc32(const uint8_t *buf, int len)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	int i;
+
+	while(len--)
+	{
+		crc ^= (uint32_t)*buf++ << 24;
+		for(i = 0; i < 8; i++)
+			crc = (crc << 1) ^ (crc & 0x80000000 ? 0x04C11DB7 : 0);
+	}
+
+	return crc;
+}
+
+//queues a PAT that lists only this program
+static void ts_split_pat(demuxer_t *demuxer, ts_split_prog_t *sp)
+{
+	ts_priv_t *priv = demuxer->priv;
+	unsigned char packet[TS_PACKET_SIZE], *sec = &packet[5];
+	uint32_t crc;
+
+	memset(packet, 0xFF, TS_PACKET_SIZE);
+	packet[0] = 0x47;
+	packet[1] = 0x40;	//payload unit start, pid 0
+	packet[2] = 0;
+	packet[3] = 0x10 | (sp->pat_cc++ & 0x0F);
+	packet[4] = 0;		//pointer field
+
+	sec[0] = 0;		//table id
+	sec[1] = 0xB0;
+	sec[2] = 13;		//section length
+	sec[3] = priv->pat.ts_id >> 8;
+	sec[4] = priv->pat.ts_id & 0xFF;
+	sec[5] = 0xC1 | ((priv->pat.version_number & 0x1F) << 1);
+	sec[6] = sec[7] = 0;	//section 0 of 0
+	sec[8] = sp->progid >> 8;
+	sec[9] = sp->progid & 0xFF;
+	sec[10] = 0xE0 | (sp->pmt_pid >> 8);
+	sec[11] = sp->pmt_pid & 0xFF;
+	crc = ts_crc32(sec, 12);
+	sec[12] = crc >> 24;
+	sec[13] = crc >> 16;
+	sec[14] = crc >> 8;
+	sec[15] = crc;
+
+	ts_split_queue(demuxer, sp, packet);
+}
+
+//adds a split stream for every program the PAT lists
+static void ts_split_update(demuxer_t *demuxer)
+{
+	ts_priv_t *priv = demuxer->priv;
+	int i, j;
+
+	for(i = 0; i < priv->pat.progs_cnt; i++)
+	{
+		struct pat_progs_t *prog = &priv->pat.progs[i];
+		ts_split_prog_t *sp;
+
+		if(prog->id == 0)	//network PID
+			continue;
+		for(j = 0; j < priv->split.cnt; j++)
+			if(priv->split.prog[j].progid == prog->id)
+				break;
+		sp = &priv->split.prog[j];
+		if(j < priv->split.cnt)
+		{
+			sp->pmt_pid = prog->pmt_pid;
+			continue;
+		}
+		if(j == TS_SPLIT_MAX_PROGRAMS)
+		{
+			mp_msg(MSGT_DEMUX, MSGL_WARN, "TS split: too many programs, ignoring %d\n", prog->id);
+			continue;
+		}
+
+		memset(sp, 0, sizeof(*sp));
+		sp->ds = new_demuxer_stream(demuxer, prog->id);
+		sp->progid = prog->id;
+		sp->pmt_pid = prog->pmt_pid;
+		priv->split.cnt++;
+		mp_msg(MSGT_DEMUX, MSGL_V, "TS split: new program %d, PMT pid %d\n", sp->progid, sp->pmt_pid);
+		ts_split_pat(demuxer, sp);
+	}
+	priv->split.gen = priv->tables_gen;
+}
+
+//copies a raw packet to the streams of all the programs it belongs to
+static void ts_split_packet(demuxer_t *demuxer, ES_stream_t *tss, const unsigned char *packet)
+{
+	ts_priv_t *priv = demuxer->priv;
+	int i;
+
+	if(priv->split.gen != priv->tables_gen)
+		ts_split_update(demuxer);
+	if(tss->tab.gen != priv->tables_gen)
+		update_pid_tables(priv, tss);
+
+	if(tss->pid == 0)
+	{
+		//every program gets its own PAT in place of the original one
+		if(packet[1] & 0x40)
+			for(i = 0; i < priv->split.cnt; i++)
+				ts_split_pat(demuxer, &priv->split.prog[i]);
+		return;
+	}
+
+	for(i = 0; i < priv->split.cnt; i++)
+		if(tss->tab.split_mask & (1ULL << i))
+			ts_split_queue(demuxer, &priv->split.prog[i], packet);
+}
+
+static void ts_split_reset(ts_priv_t *priv, int flush)
+{
+	int i;
+
+	for(i = 0; i < priv->split.cnt; i++)
+	{
+		ts_split_prog_t *sp = &priv->split.prog[i];
+
+		if(flush)
+			ts_split_flush(priv, sp);
+		else
+		{
+			if(sp->dp)
+				free_demux_packet(sp->dp);
+			sp->dp = NULL;
+			ds_free_packs(sp->ds);
+		}
+	}
+}
+
 // 0 = EOF or no stream found
 // else = [-] number of bytes written to the packet
-static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet, int probe)
+static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, int probe)
 {
 	ES_stream_t *tss;
+	unsigned char *packet;
 	int buf_size, is_start, pid, base;
 	int len, cc, cc_ok, afc, retv = 0, is_video, is_audio, is_sub;
 	ts_priv_t * priv = (ts_priv_t*) demuxer->priv;
-	stream_t *stream = demuxer->stream;
 	char *p;
 	demux_stream_t *ds = NULL;
 	demux_packet_t **dp = NULL;
@@ -2779,19 +3213,23 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 	int32_t progid, pid_type, bad, ts_error;
 	int junk = 0, rap_flag = 0;
 	pmt_t *pmt;
-	mp4_decoder_config_t *mp4_dec;
 	TS_stream_info *si;
 
 
 	memset(es, 0, sizeof(*es));
 	while(1)
 	{
+		if(priv->split.flushed && !probe)
+		{
+			priv->split.flushed = 0;
+			return 1;
+		}
+
 		bad = ts_error = 0;
 		ds = NULL;
 		dp = NULL;
 		dp_offset = buffer_size = NULL;
 		rap_flag = 0;
-		mp4_dec = NULL;
 		es->is_synced = 0;
 		es->lang[0] = 0;
 		si = NULL;
@@ -2799,27 +3237,25 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 		junk = priv->ts.packet_size - TS_PACKET_SIZE;
 		buf_size = priv->ts.packet_size - junk;
 
-		if(stream_eof(stream))
+		packet = ts_get_packet(demuxer);
+		if(packet == NULL)
 		{
 			if(! probe)
 			{
 				ts_dump_streams(priv);
-				demuxer->filepos = stream_tell(demuxer->stream);
-			}
-
-			return 0;
-		}
+				demuxer->filepos = ts_tell(demuxer);
 
+				ts_split_reset(priv, 1);
+				if(priv->split.flushed)
+				{
+					priv->split.flushed = 0;
+					return 1;
+				}
+			}
 
-		if(! ts_sync(stream))
-		{
-			mp_msg(MSGT_DEMUX, MSGL_INFO, "TS_PARSE: COULDN'T SYNC\n");
 			return 0;
 		}
 
-		len = stream_read(stream, &packet[1], 3);
-		if (len != 3)
-			return 0;
 		buf_size -= 4;
 
 		if((packet[1]  >> 7) & 0x01)	//transport error
@@ -2837,6 +3273,9 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 				continue;
 		}
 
+		if(priv->split.enabled && (!probe || priv->split.probe))
+			ts_split_packet(demuxer, tss, packet);
+
 		cc = (packet[3] & 0xf);
 		cc_ok = (tss->last_cc < 0) || ((((tss->last_cc + 1) & 0x0f) == cc));
 		tss->last_cc = cc;
@@ -2845,10 +3284,7 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 		if(bad)
 		{
 			if(priv->keep_broken == 0)
-			{
-				stream_skip(stream, buf_size-1+junk);
 				continue;
-			}
 
 			is_start = 0;	//queued to the packet data
 		}
@@ -2857,42 +3293,32 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 			tss->is_synced = 1;
 
 		if((!is_start && !tss->is_synced) || ((pid > 1) && (pid < 16)) || (pid == 8191))		//invalid pid
-		{
-			stream_skip(stream, buf_size-1+junk);
 			continue;
-		}
 
 
 		afc = (packet[3] >> 4) & 3;
 		if(! (afc % 2))	//no payload in this TS packet
-		{
-			stream_skip(stream, buf_size-1+junk);
 			continue;
-		}
 
 		if(afc > 1)
 		{
 			int c;
-			c = stream_read_char(stream);
+			c = packet[4];
 			buf_size--;
-			if(c < 0 || c > 183)	//broken from the stream layer or invalid
-			{
-				stream_skip(stream, buf_size-1+junk);
+			if(c > 183)	//invalid
 				continue;
-			}
 
 			//c==0 is allowed!
 			if(c > 0)
 			{
-				uint8_t pcrbuf[188];
-				int flags = stream_read_char(stream);
+				uint8_t *pcrbuf = &packet[6];
+				int flags = packet[5];
 				int has_pcr;
 				rap_flag = (flags & 0x40) >> 6;
 				has_pcr = flags & 0x10;
 
 				buf_size--;
 				c--;
-				stream_read(stream, pcrbuf, c);
 
 				if(has_pcr)
 				{
@@ -2901,11 +3327,10 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 					{
 						uint64_t pcr, pcr_ext;
 
-						pcr  = (int64_t)(pcrbuf[0]) << 25;
-						pcr |=  pcrbuf[1]         << 17 ;
-						pcr |= (pcrbuf[2]) << 9;
-						pcr |=  pcrbuf[3]  <<  1 ;
-						pcr |= (pcrbuf[4] & 0x80) >>  7;
+						pcr = ts_read_pcr(pcrbuf);
+						if(! probe)
+							mpeg_seek_index_add(priv->seek_index, ts_tell(demuxer) - priv->ts.packet_size,
+							                    pcr, flags & 0x80);
 
 						pcr_ext = (pcrbuf[4] & 0x01) << 8;
 						pcr_ext |= pcrbuf[5];
@@ -2924,28 +3349,21 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 
 		//find the program that the pid belongs to; if (it's the right one or -1) && pid_type==SL_SECTION
 		//call parse_sl_section()
-		pmt = pmt_of_pid(priv, pid, &mp4_dec);
-		if(mp4_dec)
-		{
-			fill_extradata(mp4_dec, tss);
-			if(IS_VIDEO(mp4_dec->object_type) || IS_AUDIO(mp4_dec->object_type))
-			{
-				tss->type = SL_PES_STREAM;
-				tss->subtype = mp4_dec->object_type;
-			}
-		}
+		if(tss->tab.gen != priv->tables_gen)
+			update_pid_tables(priv, tss);
+		pmt = tss->tab.pmt;
 
 
 		//TABLE PARSING
 
-		base = priv->ts.packet_size - buf_size;
+		base = TS_PACKET_SIZE - buf_size;
 
 		priv->last_pid = pid;
 
 		is_video = IS_VIDEO(tss->type) || (tss->type==SL_PES_STREAM && IS_VIDEO(tss->subtype));
 		is_audio = IS_AUDIO(tss->type) || (tss->type==SL_PES_STREAM && IS_AUDIO(tss->subtype)) || (tss->type == PES_PRIVATE1);
 		is_sub	= IS_SUB(tss->type);
-		pid_type = pid_type_from_pmt(priv, pid);
+		pid_type = tss->tab.type;
 
 			// PES CONTENT STARTS HERE
 		if(! probe)
@@ -2984,10 +3402,7 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 					buffer_size = &priv->fifo[2].buffer_size;
 				}
 				else
-				{
-					stream_skip(stream, buf_size+junk);
 					continue;
-				}
 			}
 
 			//IS IT TIME TO QUEUE DATA to the dp_packet?
@@ -3013,7 +3428,7 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 		}
 
 
-		if(probe || !dp)	//dp is NULL for tables and sections
+		if(probe || !dp)	//dp is NULL for tables and sections, parse in place
 		{
 			p = &packet[base];
 		}
@@ -3025,16 +3440,9 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 				resize_demux_packet(*dp, *buffer_size);
 			}
 			p = &((*dp)->buffer[*dp_offset]);
+			memcpy(p, &packet[base], buf_size);
 		}
 
-		len = stream_read(stream, p, buf_size);
-		if(len < buf_size)
-		{
-			mp_msg(MSGT_DEMUX, MSGL_DBG2,  "\r\nts_parse() couldn't read enough data: %d < %d\r\n", len, buf_size);
-			continue;
-		}
-		stream_skip(stream, junk);
-
 		if(pid  == 0)
 		{
 			parse_pat(priv, is_start, p, buf_size);
@@ -3055,14 +3463,15 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 				if(pmt->es[k].mp4_es_id == mp4_es_id)
 				{
 					section = &(tss->section);
-					parse_sl_section(pmt, section, is_start, &packet[base], buf_size);
+					if(parse_sl_section(pmt, section, is_start, &packet[base], buf_size))
+						priv->tables_gen++;
 				}
 			}
 			continue;
 		}
 		else
 		{
-			progid = prog_id_in_pat(priv, pid);
+			progid = tss->tab.progid;
 			if(progid != -1)
 			{
 				if(pid != demuxer->video->id && pid != demuxer->audio->id && pid != demuxer->sub->id)
@@ -3094,7 +3503,7 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 			tss->is_synced |= es->is_synced || rap_flag;
 			tss->payload_size = es->payload_size;
 
-			if((is_sub || is_audio) && (lang = pid_lang_from_pmt(priv, es->pid)))
+			if((is_sub || is_audio) && (lang = tss->tab.lang))
 			{
 				memcpy(es->lang, lang, 3);
 				es->lang[3] = 0;
@@ -3122,16 +3531,24 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 				mp_msg(MSGT_DEMUX, MSGL_DBG2, "ts_parse, NEW pid=%d, PSIZE: %u, type=%X, start=%p, len=%d\n",
 					es->pid, es->payload_size, es->type, es->start, es->size);
 
-				demuxer->filepos = stream_tell(demuxer->stream) - es->size;
+				demuxer->filepos = ts_tell(demuxer) - es->size;
 
 				if(es->size < 0 || es->size > buf_size) {
 					mp_msg(MSGT_DEMUX, MSGL_ERR, "Broken ES packet size\n");
 					es->size = 0;
 				}
+				if(is_video && keyframes_only)
+				{
+					tss->rai.seen |= rap_flag;
+					tss->rai.skip = tss->rai.seen && !rap_flag;
+					// not advancing the offset makes fill_packet() drop it
+					if(tss->rai.skip)
+						es->size = 0;
+				}
 				memmove(p, es->start, es->size);
 				*dp_offset += es->size;
 				(*dp)->flags = 0;
-				(*dp)->pos = stream_tell(demuxer->stream);
+				(*dp)->pos = ts_tell(demuxer);
 				(*dp)->pts = es->pts;
 				// subtitle packets must be returned immediately if possible
 				if (is_sub && !tss->payload_size)
@@ -3151,7 +3568,7 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 			es->type = tss->type;
 			es->subtype = tss->subtype;
 			es->pts = tss->pts = tss->last_pts;
-			es->start = &packet[base];
+			es->start = p;
 
 
 			if(tss->payload_size > 0)
@@ -3175,7 +3592,8 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 
 			if(! probe)
 			{
-				*dp_offset += sz;
+				if(! tss->rai.skip)
+					*dp_offset += sz;
 
 				// subtitle packets must be returned immediately if possible
 				if(*dp_offset >= MAX_PACK_BYTES || (is_sub && !tss->payload_size))
@@ -3189,8 +3607,6 @@ static int ts_parse(demuxer_t *demuxer , ES_stream_t *es, unsigned char *packet,
 			}
 			else
 			{
-				memmove(es->start, p, sz);
-
 				if(es->size)
 					return es->size;
 				else
@@ -3239,6 +3655,33 @@ static void reset_fifos(demuxer_t *demuxer, int a, int v, int s)
 }
 
 
+//bisects the file by PCR, returns -1 if that isn't possible
+static off_t ts_seek_pcr(demuxer_t *demuxer, float rel_seek_secs, int flags)
+{
+	ts_priv_t *priv = demuxer->priv;
+	sh_common_t *sh = demuxer->video->sh ? demuxer->video->sh : demuxer->audio->sh;
+	int pcr_pid = prog_pcr_pid(priv, priv->prog);
+	double time = rel_seek_secs;
+
+	if(demuxer->stream->type != STREAMTYPE_FILE || pcr_pid <= 0 || pcr_pid >= 8191)
+		return -1;
+
+	if(!(flags & SEEK_ABSOLUTE))
+	{
+		double cur = -1;
+
+		if(sh && sh->pts != MP_NOPTS_VALUE)
+			cur = mpeg_seek_index_pts_to_time(priv->seek_index, sh->pts);
+		if(cur < 0)
+			cur = mpeg_seek_index_current(priv->seek_index);
+		if(cur < 0)
+			return -1;
+		time += cur;
+	}
+
+	return mpeg_seek_index_find(priv->seek_index, demuxer, FFMAX(time, 0), ts_probe_pcr, TS_SEEK_WINDOW);
+}
+
 static void demux_seek_ts(demuxer_t *demuxer, float rel_seek_secs, float audio_delay, int flags)
 {
 	demux_stream_t *d_audio=demuxer->audio;
@@ -3247,12 +3690,13 @@ static void demux_seek_ts(demuxer_t *demuxer, float rel_seek_secs, float audio_d
 	sh_video_t *sh_video=d_video->sh;
 	ts_priv_t * priv = (ts_priv_t*) demuxer->priv;
 	int i, video_stats;
-	off_t newpos;
+	off_t newpos, pos;
 
 	//================= seek in MPEG-TS ==========================
 
 	ts_dump_streams(demuxer->priv);
 	reset_fifos(demuxer, sh_audio != NULL, sh_video != NULL, demuxer->sub->id > 0);
+	ts_split_reset(priv, 0);
 
 	demux_flush(demuxer);
 
@@ -3270,7 +3714,12 @@ static void demux_seek_ts(demuxer_t *demuxer, float rel_seek_secs, float audio_d
 
 	newpos = (flags & SEEK_ABSOLUTE) ? demuxer->movi_start : demuxer->filepos;
 	if(flags & SEEK_FACTOR) // float seek 0..1
+	{
 		newpos+=(demuxer->movi_end-demuxer->movi_start)*rel_seek_secs;
+		mpeg_seek_index_lost(priv->seek_index);
+	}
+	else if((pos = ts_seek_pcr(demuxer, rel_seek_secs, flags)) >= 0)
+		newpos = pos;
 	else
 	{
 		// time seek (secs)
@@ -3278,6 +3727,7 @@ static void demux_seek_ts(demuxer_t *demuxer, float rel_seek_secs, float audio_d
 			newpos += 2324*75*rel_seek_secs; // 174.3 kbyte/sec
 		else
 			newpos += video_stats*rel_seek_secs;
+		mpeg_seek_index_lost(priv->seek_index);
 	}
 
 
@@ -3285,6 +3735,7 @@ static void demux_seek_ts(demuxer_t *demuxer, float rel_seek_secs, float audio_d
   		newpos = demuxer->movi_start;	//begininng of stream
 
 	stream_seek(demuxer->stream, newpos);
+	demuxer->stream->eof = 0;
 	for(i = 0; i < NB_PID_MAX; i++)
 		if(priv->ts.pids[i] != NULL)
 			priv->ts.pids[i]->is_synced = 0;
@@ -3335,9 +3786,8 @@ static void demux_seek_ts(demuxer_t *demuxer, float rel_seek_secs, float audio_d
 static int demux_ts_fill_buffer(demuxer_t * demuxer, demux_stream_t *ds)
 {
 	ES_stream_t es;
-	ts_priv_t *priv = (ts_priv_t *)demuxer->priv;
 
-	return -ts_parse(demuxer, &es, priv->packet, 0);
+	return -ts_parse(demuxer, &es, 0);
 }
 
 
@@ -3505,6 +3955,7 @@ static int demux_ts_control(demuxer_t *demuxer, int cmd, void *arg)
 			}
 
 			priv->prog = prog->progid = pmt->progid;
+			priv->tables_gen++;
 			return DEMUXER_CTRL_OK;
 		}
 
@@ -3513,6 +3964,56 @@ static int demux_ts_control(demuxer_t *demuxer, int cmd, void *arg)
 	}
 }
 
+/**
+ * \brief feed every program of the multiplex into its own demux stream
+ *
+ * From now on each packet read by the demuxer is also copied to the stream
+ * of every program it belongs to (PMT, PCR and elementary stream pids), so
+ * one read and parse pass serves any number of consumers.  The streams carry
+ * a valid single program TS, the PAT is rewritten to list only that program.
+ * Streams appear as programs are found in the PAT, see
+ * demux_ts_get_programs().  Packets read before are not in the streams, set
+ * ts_split before opening the demuxer to get all of them.
+ * \return 0 if the demuxer isn't a TS demuxer
+ */
+int demux_ts_split_programs(demuxer_t *demuxer)
+{
+	ts_priv_t *priv = demuxer->priv;
+
+	if(demuxer->type != DEMUXER_TYPE_MPEG_TS || !priv)
+		return 0;
+	priv->split.enabled = 1;
+	priv->tables_gen++;
+	return 1;
+}
+
+/// fills progids with up to max program numbers, returns how many there are
+int demux_ts_get_programs(demuxer_t *demuxer, int *progids, int max)
+{
+	ts_priv_t *priv = demuxer->priv;
+	int i;
+
+	if(demuxer->type != DEMUXER_TYPE_MPEG_TS || !priv)
+		return 0;
+	for(i = 0; i < priv->split.cnt && i < max; i++)
+		progids[i] = priv->split.prog[i].progid;
+	return priv->split.cnt;
+}
+
+/// returns the stream carrying the raw TS packets of progid or NULL
+demux_stream_t *demux_ts_program_stream(demuxer_t *demuxer, int progid)
+{
+	ts_priv_t *priv = demuxer->priv;
+	int i;
+
+	if(demuxer->type != DEMUXER_TYPE_MPEG_TS || !priv)
+		return NULL;
+	for(i = 0; i < priv->split.cnt; i++)
+		if(priv->split.prog[i].progid == progid)
+			return priv->split.prog[i].ds;
+	return NULL;
+}
+
 
 const demuxer_desc_t demuxer_desc_mpeg_ts = {
   "MPEG-TS demuxer",
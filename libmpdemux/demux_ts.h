@@ -21,11 +21,21 @@
 
 #include <sys/types.h>
 
+#include "demuxer.h"
+
 #define TS_MAX_PROBE_SIZE 2000000
+#define TS_SPLIT_MAX_PROGRAMS 64
 
 extern off_t ts_probe;
 extern int   ts_prog;
 extern int   ts_keep_broken;
+/// open in split mode, see demux_ts_split_programs(); only TOOLS/tssplit
+/// sets it, MPlayer and MEncoder have no option for it
+extern int   ts_split;
 extern int audio_substream_id;
 
+int demux_ts_split_programs(demuxer_t *demuxer);
+int demux_ts_get_programs(demuxer_t *demuxer, int *progids, int max);
+demux_stream_t *demux_ts_program_stream(demuxer_t *demuxer, int progid);
+
 #endif /* MPLAYER_DEMUX_TS_H */
@@ -983,6 +983,9 @@ int extension_parsing = 1; // 0=off 1=mixed (used only for unstable formats)
 
 int correct_pts = 0;
 int user_correct_pts = -1;
+/* only pass video keyframes on, demuxers with an index skip the rest
+ * without reading it */
+int keyframes_only = 0;
 
 /*
   NOTE : Several demuxers may be opened at the same time so
@@ -182,6 +182,7 @@ extern int sub_demuxer_type;
 extern int audio_stream_cache;
 extern int correct_pts;
 extern int user_correct_pts;
+extern int keyframes_only;
 
 extern char *demuxer_name;
 extern char *audio_demuxer_name;
@@ -0,0 +1,287 @@
+/*
+ * timestamp based seeking in MPEG-PS and MPEG-TS files
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+
+#include "config.h"
+#include "mp_msg.h"
+#include "libavutil/common.h"
+#include "mpeg_seek.h"
+
+#define TS_MASK        ((1ULL << 33) - 1)
+#define TS_PERIOD      ((TS_MASK + 1) / 90000.0)
+/* larger steps between two consecutive timestamps are discontinuities */
+#define MAX_TS_JUMP    10.0
+/* minimum distance between two index entries in seconds */
+#define INDEX_INTERVAL 1.0
+/* stop bisecting once the interval is smaller than this */
+#define MIN_RANGE      (64 * 1024)
+#define MAX_PROBES     20
+
+typedef struct {
+    off_t pos;
+    uint64_t ts;
+    double time;
+} index_entry_t;
+
+struct mpeg_seek_index {
+    index_entry_t *e;
+    int num, alloc;
+    int have_cur;
+    index_entry_t cur;  ///< last timestamp seen while reading linearly
+};
+
+/// a - b in seconds, or a negative value if a looks older than b
+static double ts_diff(uint64_t a, uint64_t b)
+{
+    double d = ((a - b) & TS_MASK) / 90000.0;
+    return d > TS_PERIOD / 2 ? -1 : d;
+}
+
+/// index of the first entry after pos
+static int index_upper(mpeg_seek_index_t *idx, off_t pos)
+{
+    int lo = 0, hi = idx->num;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (idx->e[mid].pos <= pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void index_insert(mpeg_seek_index_t *idx, const index_entry_t *n)
+{
+    int i = index_upper(idx, n->pos);
+    // keep the index sparse and monotonic
+    if (i > 0 && n->time < idx->e[i - 1].time + INDEX_INTERVAL)
+        return;
+    if (i < idx->num && n->time > idx->e[i].time - INDEX_INTERVAL)
+        return;
+    if (idx->num == idx->alloc) {
+        int alloc = idx->alloc ? 2 * idx->alloc : 256;
+        index_entry_t *e = realloc(idx->e, alloc * sizeof(*e));
+        if (!e)
+            return;
+        idx->e     = e;
+        idx->alloc = alloc;
+    }
+    memmove(idx->e + i + 1, idx->e + i, (idx->num - i) * sizeof(*idx->e));
+    idx->e[i] = *n;
+    idx->num++;
+}
+
+/// average bytes per second over the index, 0 if unknown
+static double index_rate(mpeg_seek_index_t *idx)
+{
+    index_entry_t *first = &idx->e[0], *last = &idx->e[idx->num - 1];
+    if (last->time - first->time < INDEX_INTERVAL)
+        return 0;
+    return (last->pos - first->pos) / (last->time - first->time);
+}
+
+/**
+ * A timestamp only continues the one at lo if it is newer and the bitrate
+ * in between is not too far off, otherwise there is a discontinuity.
+ */
+static int continues(double rate, const index_entry_t *lo, index_entry_t *n)
+{
+    double d = ts_diff(n->ts, lo->ts), t;
+    if (d < 0)
+        return 0;
+    n->time = lo->time + d;
+    if (rate <= 0)
+        return 1;
+    t = (n->pos - lo->pos) / rate;
+    return d >= t / 4 - 1 && d <= t * 4 + 1;
+}
+
+/// derive the time of n from the index entry before it
+static int entry_time(mpeg_seek_index_t *idx, index_entry_t *n)
+{
+    int i = index_upper(idx, n->pos);
+    if (!idx->num) {
+        n->time = 0;
+        return 1;
+    }
+    if (i == 0 || !continues(index_rate(idx), &idx->e[i - 1], n))
+        return 0;
+    return i == idx->num || n->time <= idx->e[i].time;
+}
+
+mpeg_seek_index_t *mpeg_seek_index_alloc(void)
+{
+    return calloc(1, sizeof(mpeg_seek_index_t));
+}
+
+void mpeg_seek_index_free(mpeg_seek_index_t *idx)
+{
+    if (!idx)
+        return;
+    free(idx->e);
+    free(idx);
+}
+
+/**
+ * \brief add a timestamp the demuxer found at pos while reading
+ * \param discontinuity set if the stream signals a timebase change
+ */
+void mpeg_seek_index_add(mpeg_seek_index_t *idx, off_t pos, uint64_t ts,
+                         int discontinuity)
+{
+    index_entry_t n;
+    n.pos = pos;
+    n.ts  = ts & TS_MASK;
+    if (idx->have_cur && pos >= idx->cur.pos) {
+        double d = ts_diff(n.ts, idx->cur.ts);
+        n.time = idx->cur.time;
+        if (discontinuity || d < 0 || d > MAX_TS_JUMP)
+            mp_msg(MSGT_DEMUX, MSGL_DBG2, "timestamp discontinuity at %"PRId64"\n",
+                   (int64_t)pos);
+        else
+            n.time += d;
+    } else if (!entry_time(idx, &n))
+        return;
+    idx->cur      = n;
+    idx->have_cur = 1;
+    index_insert(idx, &n);
+}
+
+/// the next timestamp does not follow the last one (the stream was moved)
+void mpeg_seek_index_lost(mpeg_seek_index_t *idx)
+{
+    idx->have_cur = 0;
+}
+
+/// time of the last timestamp read, -1 if unknown
+double mpeg_seek_index_current(mpeg_seek_index_t *idx)
+{
+    return idx->have_cur ? idx->cur.time : -1;
+}
+
+/// convert a PTS (in seconds) near the last timestamp read to index time
+double mpeg_seek_index_pts_to_time(mpeg_seek_index_t *idx, double pts)
+{
+    double d;
+    if (!idx->have_cur)
+        return -1;
+    d = fmod(pts - idx->cur.ts / 90000.0, TS_PERIOD);
+    if (d > TS_PERIOD / 2)
+        d -= TS_PERIOD;
+    else if (d < -TS_PERIOD / 2)
+        d += TS_PERIOD;
+    return idx->cur.time + d;
+}
+
+/**
+ * \brief find the position to read from to get to time
+ * \param window bytes to search for a timestamp at each probe position
+ * \return file position or -1 if the index cannot help
+ *
+ * Leaves the stream at an arbitrary position.
+ */
+off_t mpeg_seek_index_find(mpeg_seek_index_t *idx, demuxer_t *demuxer,
+                           double time, mpeg_seek_probe_func probe,
+                           off_t window)
+{
+    index_entry_t lo, hi = { 0 }, n;
+    int i, probes = 0, hi_known = 1;
+    double rate;
+
+    if (!idx->num) {
+        n.pos = probe(demuxer, demuxer->movi_start, window, &n.ts);
+        if (n.pos < 0)
+            return -1;
+        n.time = 0;
+        index_insert(idx, &n);
+    }
+    rate = index_rate(idx);
+
+    for (i = 0; i < idx->num && idx->e[i].time <= time; i++)
+        ;
+    if (i == 0) {
+        idx->cur      = idx->e[0];
+        idx->have_cur = 1;
+        return demuxer->movi_start;
+    }
+    lo = idx->e[i - 1];
+    if (i < idx->num)
+        hi = idx->e[i];
+    else {
+        // beyond the index, try to get an upper bound from the end of the file
+        off_t end = FFMAX(lo.pos, demuxer->movi_end - window);
+        hi.pos = demuxer->movi_end;
+        hi_known = 0;
+        n.pos = probe(demuxer, end, window, &n.ts);
+        if (n.pos > lo.pos && continues(rate, &lo, &n)) {
+            index_insert(idx, &n);
+            if (n.time <= time)
+                lo = n;
+            hi = n;
+            hi_known = 1;
+        }
+    }
+    if (!hi_known && rate <= 0)
+        return -1;
+
+    while (hi.pos - lo.pos > MIN_RANGE && lo.time < time && probes++ < MAX_PROBES) {
+        off_t range = hi.pos - lo.pos;
+        off_t mid = lo.pos + range / 2;
+        // interpolate, but make sure the interval shrinks reasonably
+        if (!hi_known)
+            mid = lo.pos + (time - lo.time) * rate;
+        else if (hi.time > lo.time)
+            mid = lo.pos + range * ((time - lo.time) / (hi.time - lo.time));
+        mid = FFMAX(mid, lo.pos + range / 8);
+        mid = FFMIN(mid, hi.pos - range / 8);
+
+        n.pos = probe(demuxer, mid, FFMIN(window, hi.pos - mid), &n.ts);
+        if (n.pos < 0 || n.pos >= hi.pos) {
+            hi.pos = mid;
+            continue;
+        }
+        if (!continues(rate, &lo, &n) || (hi_known && n.time > hi.time)) {
+            // discontinuity between lo and n, the target can only be reached
+            // through lo without reading linearly across it
+            mp_msg(MSGT_DEMUX, MSGL_V, "seek: discontinuity between %"PRId64" and %"PRId64"\n",
+                   (int64_t)lo.pos, (int64_t)n.pos);
+            hi.pos = mid;
+            continue;
+        }
+        index_insert(idx, &n);
+        if (n.time <= time)
+            lo = n;
+        else {
+            hi = n;
+            hi_known = 1;
+        }
+    }
+
+    mp_msg(MSGT_DEMUX, MSGL_V, "seek: %f s found at %"PRId64" (%f s) after %d probes\n",
+           time, (int64_t)lo.pos, lo.time, probes);
+    idx->cur      = lo;
+    idx->have_cur = 1;
+    return lo.pos;
+}
@@ -0,0 +1,64 @@
+/*
+ * timestamp based seeking in MPEG-PS and MPEG-TS files
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPLAYER_MPEG_SEEK_H
+#define MPLAYER_MPEG_SEEK_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "demuxer.h"
+
+/**
+ * \file
+ * Sparse position -> time index for MPEG system streams.
+ *
+ * The demuxer feeds every PCR/SCR it comes across during playback into the
+ * index, a seek then bisects between the nearest known entries, reading
+ * only a small window at each probe position.  Times are kept on a
+ * continuous timeline starting at 0 with the first timestamp seen, 33 bit
+ * wraparounds are unwrapped and discontinuities are stitched together.
+ */
+
+typedef struct mpeg_seek_index mpeg_seek_index_t;
+
+/**
+ * \brief find the first 90 kHz timestamp at or after pos
+ * \param max_len maximum number of bytes to search
+ * \return position of the packet carrying the timestamp or -1
+ */
+typedef off_t (*mpeg_seek_probe_func)(demuxer_t *demuxer, off_t pos,
+                                      off_t max_len, uint64_t *ts);
+
+mpeg_seek_index_t *mpeg_seek_index_alloc(void);
+void mpeg_seek_index_free(mpeg_seek_index_t *idx);
+
+void mpeg_seek_index_add(mpeg_seek_index_t *idx, off_t pos, uint64_t ts,
+                         int discontinuity);
+void mpeg_seek_index_lost(mpeg_seek_index_t *idx);
+
+double mpeg_seek_index_current(mpeg_seek_index_t *idx);
+double mpeg_seek_index_pts_to_time(mpeg_seek_index_t *idx, double pts);
+
+off_t mpeg_seek_index_find(mpeg_seek_index_t *idx, demuxer_t *demuxer,
+                           double time, mpeg_seek_probe_func probe,
+                           off_t window);
+
+#endif /* MPLAYER_MPEG_SEEK_H */
@@ -0,0 +1,143 @@
+/*
+ * check the PCR/SCR bisection seeking on a synthetic stream
+ *
+ * The "file" carries a timestamp every PCR_DIST bytes at a constant
+ * bitrate.  The clock wraps around 2^33 in the first part and restarts
+ * from a small value in the middle of the file, so seeks have to unwrap
+ * the clock and must not be misled by the discontinuity.  Every seek has
+ * to land on a timestamp shortly before the target time, once with an
+ * index built by reading the whole file and once with only the
+ * discontinuity seen.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "config.h"
+#include "mp_msg.h"
+#include "demuxer.h"
+#include "mpeg_seek.h"
+
+#define RATE       1000000              // bytes per second
+#define FILE_SIZE  ((off_t)200 * RATE)
+#define DISCONT    ((off_t)120 * RATE)  // the clock restarts here
+#define PCR_DIST   ((off_t)40000)
+#define TS_START   ((1ULL << 33) - 50 * 90000ULL) // wraps after 50 s
+#define TS_RESTART (10 * 90000ULL)
+#define WINDOW     (256 * 1024)
+#define MAX_ERROR  0.2                  // seconds before the target
+
+static int probes;
+
+/// the timestamp carried at pos, which must be a multiple of PCR_DIST
+static uint64_t ts_at(off_t pos)
+{
+    if (pos < DISCONT)
+        return (TS_START + pos * 90000 / RATE) & ((1ULL << 33) - 1);
+    return TS_RESTART + (pos - DISCONT) * 90000 / RATE;
+}
+
+static off_t probe(demuxer_t *demuxer, off_t pos, off_t max_len, uint64_t *ts)
+{
+    off_t p = (pos + PCR_DIST - 1) / PCR_DIST * PCR_DIST;
+    probes++;
+    if (p - pos >= max_len || p >= demuxer->movi_end)
+        return -1;
+    *ts = ts_at(p);
+    return p;
+}
+
+static int check_seek(mpeg_seek_index_t *idx, demuxer_t *demuxer,
+                      double time, int must_find)
+{
+    off_t pos;
+    double found;
+
+    probes = 0;
+    pos = mpeg_seek_index_find(idx, demuxer, time, probe, WINDOW);
+    if (pos < 0) {
+        if (!must_find)
+            return 0;
+        printf("seek to %.2f s failed\n", time);
+        return 1;
+    }
+    // on this stream the position is the time, whatever the clock says,
+    // except that the jump of the clock itself takes no time when stitched
+    found = (double)(pos < DISCONT ? pos : pos - PCR_DIST) / RATE;
+    if (found > time + 1.0 / 90000 || found < time - MAX_ERROR) {
+        printf("seek to %.2f s ended at %.2f s after %d probes\n",
+               time, found, probes);
+        return 1;
+    }
+    return 0;
+}
+
+/// as if the demuxer read from..to, the index notices the clock jump itself
+static void read_linear(mpeg_seek_index_t *idx, off_t from, off_t to)
+{
+    off_t pos;
+    mpeg_seek_index_lost(idx);
+    for (pos = from; pos < to; pos += PCR_DIST)
+        mpeg_seek_index_add(idx, pos, ts_at(pos), 0);
+}
+
+static int run(const char *name, int full_index)
+{
+    demuxer_t demuxer;
+    mpeg_seek_index_t *idx = mpeg_seek_index_alloc();
+    int fail = 0, seeks = 0;
+    double t;
+
+    memset(&demuxer, 0, sizeof(demuxer));
+    demuxer.movi_start = 0;
+    demuxer.movi_end   = FILE_SIZE;
+    if (full_index)
+        read_linear(idx, 0, FILE_SIZE);
+    else {
+        // the start and a few seconds around the restart of the clock
+        read_linear(idx, 0, 2 * RATE);
+        read_linear(idx, DISCONT - 3 * RATE, DISCONT + 3 * RATE);
+    }
+    for (t = 0.5; t < (double)FILE_SIZE / RATE - 1; t += 3.7) {
+        fail |= check_seek(idx, &demuxer, t, full_index || t < DISCONT / RATE);
+        seeks++;
+    }
+    // backwards too, the index grew while seeking
+    for (t = (double)FILE_SIZE / RATE - 1.3; t > 0; t -= 5.3) {
+        fail |= check_seek(idx, &demuxer, t, 1);
+        seeks++;
+    }
+    printf("%s: %s, %d seeks\n", name, fail ? "FAILED" : "ok", seeks);
+    mpeg_seek_index_free(idx);
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    int fail = 0;
+
+    mp_msg_init();
+    if (argc > 1 && !strcmp(argv[1], "-v"))
+        verbose = 1;
+    fail |= run("full index", 1);
+    fail |= run("sparse index", 0);
+    return fail;
+}
@@ -26,6 +26,9 @@
 #include <string.h>	/* memcmp/memset, try to remove */
 #include <stdlib.h>
 #include <inttypes.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #include "mpeg2.h"
 #include "attributes.h"
@@ -147,6 +150,202 @@ mpeg2_state_t mpeg2_seek_header (mpeg2dec_t * mpeg2dec)
 	    mpeg2_header_end (mpeg2dec) : mpeg2_parse_header (mpeg2dec));
 }
 
+#if HAVE_PTHREADS
+/*
+ * Slice threads: the slices of a picture are kept in the chunk buffer
+ * instead of being decoded right away and handed out to the worker threads
+ * once the picture is complete.  Slices don't depend on each other, so each
+ * thread only needs its own copy of the decoder state.  The calling thread
+ * decodes slices as well and returns once all of them are done.
+ */
+
+#define MPEG2_MAX_THREADS 16
+
+typedef struct {
+    int code;
+    const uint8_t * buffer;
+} slice_job_t;
+
+typedef struct mpeg2_threads_s {
+    int count;				/* including the calling thread */
+    pthread_t thread[MPEG2_MAX_THREADS];
+    mpeg2_decoder_t * decoder[MPEG2_MAX_THREADS];
+
+    slice_job_t * job;
+    int jobs;
+    int jobs_alloc;
+    int next_job;
+    int busy;				/* workers still decoding */
+    int batch;				/* bumped for every set of jobs */
+    int quit;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+} mpeg2_threads_t;
+
+typedef struct {
+    mpeg2_threads_t * threads;
+    int index;
+} slice_worker_arg_t;
+
+static void run_jobs (mpeg2_threads_t * t, mpeg2_decoder_t * decoder)
+{
+    while (1) {
+	int j;
+
+	pthread_mutex_lock (&t->lock);
+	j = t->next_job++;
+	pthread_mutex_unlock (&t->lock);
+	if (j >= t->jobs)
+	    break;
+	mpeg2_slice (decoder, t->job[j].code, t->job[j].buffer);
+    }
+}
+
+static void * slice_worker (void * arg)
+{
+    slice_worker_arg_t * a = arg;
+    mpeg2_threads_t * t = a->threads;
+    mpeg2_decoder_t * decoder = t->decoder[a->index];
+    int batch = 0;
+
+    free (a);
+    pthread_mutex_lock (&t->lock);
+    while (1) {
+	while (batch == t->batch && !t->quit)
+	    pthread_cond_wait (&t->start, &t->lock);
+	if (t->quit)
+	    break;
+	batch = t->batch;
+	pthread_mutex_unlock (&t->lock);
+
+	run_jobs (t, decoder);
+
+	pthread_mutex_lock (&t->lock);
+	if (!--t->busy)
+	    pthread_cond_signal (&t->done);
+    }
+    pthread_mutex_unlock (&t->lock);
+    return NULL;
+}
+
+static void threads_free (mpeg2_threads_t * t)
+{
+    int i;
+
+    pthread_mutex_lock (&t->lock);
+    t->quit = 1;
+    pthread_cond_broadcast (&t->start);
+    pthread_mutex_unlock (&t->lock);
+    for (i = 1; i < t->count; i++) {
+	pthread_join (t->thread[i], NULL);
+	mpeg2_free (t->decoder[i]);
+    }
+    pthread_mutex_destroy (&t->lock);
+    pthread_cond_destroy (&t->start);
+    pthread_cond_destroy (&t->done);
+    free (t->job);
+    free (t);
+}
+
+static mpeg2_threads_t * threads_alloc (int count)
+{
+    mpeg2_threads_t * t;
+
+    t = calloc (1, sizeof (mpeg2_threads_t));
+    if (!t)
+	return NULL;
+    pthread_mutex_init (&t->lock, NULL);
+    pthread_cond_init (&t->start, NULL);
+    pthread_cond_init (&t->done, NULL);
+    for (t->count = 1; t->count < count; t->count++) {
+	slice_worker_arg_t * a = malloc (sizeof (slice_worker_arg_t));
+	t->decoder[t->count] = (mpeg2_decoder_t *)
+	    mpeg2_malloc (sizeof (mpeg2_decoder_t), MPEG2_ALLOC_MPEG2DEC);
+	if (!a || !t->decoder[t->count]) {
+	    free (a);
+	    mpeg2_free (t->decoder[t->count]);
+	    break;
+	}
+	a->threads = t;
+	a->index = t->count;
+	if (pthread_create (&t->thread[t->count], NULL, slice_worker, a)) {
+	    free (a);
+	    mpeg2_free (t->decoder[t->count]);
+	    break;
+	}
+    }
+    if (t->count < 2) {
+	threads_free (t);
+	return NULL;
+    }
+    return t;
+}
+
+/* decodes all queued slices, the chunk buffer can be reused afterwards */
+static void slice_flush (mpeg2dec_t * mpeg2dec)
+{
+    mpeg2_threads_t * t = mpeg2dec->threads;
+    int i;
+
+    if (!t || !t->jobs)
+	return;
+
+    /* the picture state is the same for every slice */
+    for (i = 1; i < t->count; i++)
+	memcpy (t->decoder[i], &(mpeg2dec->decoder), sizeof (mpeg2_decoder_t));
+
+    pthread_mutex_lock (&t->lock);
+    t->next_job = 0;
+    t->busy = t->count - 1;
+    t->batch++;
+    pthread_cond_broadcast (&t->start);
+    pthread_mutex_unlock (&t->lock);
+
+    run_jobs (t, &(mpeg2dec->decoder));
+
+    pthread_mutex_lock (&t->lock);
+    while (t->busy)
+	pthread_cond_wait (&t->done, &t->lock);
+    pthread_mutex_unlock (&t->lock);
+
+    t->jobs = 0;
+    mpeg2dec->chunk_start = mpeg2dec->chunk_ptr = mpeg2dec->chunk_buffer;
+}
+
+/* returns 0 if the slice has to be decoded right away */
+static int slice_queue (mpeg2dec_t * mpeg2dec)
+{
+    mpeg2_threads_t * t = mpeg2dec->threads;
+
+    /* slice callbacks have to be made in order */
+    if (!t || mpeg2dec->decoder.convert)
+	return 0;
+
+    if (t->jobs == t->jobs_alloc) {
+	int n = t->jobs_alloc ? 2 * t->jobs_alloc : 256;
+	slice_job_t * job = realloc (t->job, n * sizeof (slice_job_t));
+	if (!job)
+	    return 0;
+	t->job = job;
+	t->jobs_alloc = n;
+    }
+    t->job[t->jobs].code = mpeg2dec->code;
+    t->job[t->jobs].buffer = mpeg2dec->chunk_start;
+    t->jobs++;
+
+    /* keep the slice data, but leave room for the next one */
+    mpeg2dec->chunk_start = mpeg2dec->chunk_ptr;
+    if (mpeg2dec->chunk_buffer + BUFFER_SIZE / 2 < mpeg2dec->chunk_ptr)
+	slice_flush (mpeg2dec);
+    return 1;
+}
+#else
+#define slice_flush(mpeg2dec)
+#define slice_queue(mpeg2dec) 0
+#endif
+
 #define RECEIVED(code,state) (((state) << 8) + (code))
 
 mpeg2_state_t mpeg2_parse (mpeg2dec_t * mpeg2dec)
@@ -185,13 +384,18 @@ mpeg2_state_t mpeg2_parse (mpeg2dec_t * mpeg2dec)
 	    }
 	    mpeg2dec->bytes_since_tag += copied;
 
-	    mpeg2_slice (&(mpeg2dec->decoder), mpeg2dec->code,
-			 mpeg2dec->chunk_start);
+	    if (!slice_queue (mpeg2dec)) {
+		mpeg2_slice (&(mpeg2dec->decoder), mpeg2dec->code,
+			     mpeg2dec->chunk_start);
+		mpeg2dec->chunk_ptr = mpeg2dec->chunk_start;
+	    }
 	    mpeg2dec->code = mpeg2dec->buf_start[-1];
-	    mpeg2dec->chunk_ptr = mpeg2dec->chunk_start;
 	}
-	if ((unsigned) (mpeg2dec->code - 1) >= 0xb0 - 1)
+	if ((unsigned) (mpeg2dec->code - 1) >= 0xb0 - 1) {
+	    /* end of the picture */
+	    slice_flush (mpeg2dec);
 	    break;
+	}
 	if (seek_chunk (mpeg2dec) == STATE_BUFFER)
 	    return STATE_BUFFER;
     }
@@ -365,6 +569,23 @@ void mpeg2_skip (mpeg2dec_t * mpeg2dec, int skip)
     mpeg2dec->nb_decode_slices = skip ? 0 : (0xb0 - 1);
 }
 
+/* returns the number of threads that will be used */
+int mpeg2_threads (mpeg2dec_t * mpeg2dec, int threads)
+{
+#if HAVE_PTHREADS
+    if (mpeg2dec->threads)
+	threads_free (mpeg2dec->threads);
+    mpeg2dec->threads = NULL;
+    if (threads > MPEG2_MAX_THREADS)
+	threads = MPEG2_MAX_THREADS;
+    if (threads > 1)
+	mpeg2dec->threads = threads_alloc (threads);
+    return mpeg2dec->threads ? mpeg2dec->threads->count : 1;
+#else
+    return 1;
+#endif
+}
+
 void mpeg2_slice_region (mpeg2dec_t * mpeg2dec, int start, int end)
 {
     start = (start < 1) ? 1 : (start > 0xb0) ? 0xb0 : start;
@@ -396,6 +617,11 @@ uint32_t mpeg2_accel (uint32_t accel)
 
 void mpeg2_reset (mpeg2dec_t * mpeg2dec, int full_reset)
 {
+#if HAVE_PTHREADS
+    /* drop the slices of an unfinished picture */
+    if (mpeg2dec->threads)
+	mpeg2dec->threads->jobs = 0;
+#endif
     mpeg2dec->buf_start = mpeg2dec->buf_end = NULL;
     mpeg2dec->num_tags = 0;
     mpeg2dec->shift = 0xffffff00;
@@ -432,6 +658,7 @@ mpeg2dec_t * mpeg2_init (void)
     mpeg2dec->chunk_buffer = (uint8_t *) mpeg2_malloc (BUFFER_SIZE + 4,
 						       MPEG2_ALLOC_CHUNK);
 
+    mpeg2dec->threads = NULL;
     mpeg2dec->sequence.width = (unsigned)-1;
     mpeg2_reset (mpeg2dec, 1);
 
@@ -440,6 +667,7 @@ mpeg2dec_t * mpeg2_init (void)
 
 void mpeg2_close (mpeg2dec_t * mpeg2dec)
 {
+    mpeg2_threads (mpeg2dec, 1);
     mpeg2_header_state_init (mpeg2dec);
     mpeg2_free (mpeg2dec->chunk_buffer);
     mpeg2_free (mpeg2dec);
@@ -0,0 +1,244 @@
+/*
+ * check the x86 SIMD motion compensation and IDCT against the C versions
+ *
+ * Motion compensation must match motion_comp.c bit for bit.  The SIMD
+ * IDCTs use a different (IEEE 1180 compliant) approximation than idct.c,
+ * so full blocks may differ by one, the DC only shortcut has to match.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/time.h>
+
+#include "config.h"
+#include "cpudetect.h"
+#include "mpeg2.h"
+#include "attributes.h"
+#include "mpeg2_internal.h"
+#include "mmx.h"
+
+// linking hacks, the scan tables are only patched by the IDCT init code
+uint8_t mpeg2_scan_norm[64];
+uint8_t mpeg2_scan_alt[64];
+
+extern void (* mpeg2_idct_copy) (int16_t * block, uint8_t * dest, int stride);
+extern void (* mpeg2_idct_add) (int last, int16_t * block,
+                                uint8_t * dest, int stride);
+
+#define STRIDE_MAX 96
+#define MC_RUNS    20000
+#define IDCT_RUNS  20000
+#define BENCH_RUNS 200000
+
+static const char * const mc_name[8] = {
+    "o_16", "x_16", "y_16", "xy_16", "o_8", "x_8", "y_8", "xy_8"
+};
+
+static unsigned int GetTimer(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static inline void cpu_done(void)
+{
+#if HAVE_MMX
+    if (gCpuCaps.hasMMX)
+        emms();
+#endif
+}
+
+static int test_mc(const char *name, const mpeg2_mc_t *mc)
+{
+    static uint8_t ref[STRIDE_MAX * 18], dst_c[STRIDE_MAX * 17],
+                   dst_s[STRIDE_MAX * 17];
+    int f, run, i, fail = 0;
+    unsigned int t;
+
+    for (f = 0; f < 16; f++) {
+        mpeg2_mc_fct *fc = f < 8 ? mpeg2_mc_c.put[f] : mpeg2_mc_c.avg[f - 8];
+        mpeg2_mc_fct *fs = f < 8 ? mc->put[f] : mc->avg[f - 8];
+        int width = f & 4 ? 8 : 16;
+        for (run = 0; run < MC_RUNS; run++) {
+            // unaligned rows on both sides, field (2 * stride) steps
+            int stride = width + 1 + rand() % (STRIDE_MAX / 2 - width);
+            int height = width >> (rand() % 3);
+            int roff   = rand() % 16, doff = rand() % 16;
+            for (i = 0; i < sizeof(ref); i++)
+                ref[i] = rand();
+            for (i = 0; i < sizeof(dst_c); i++)
+                dst_c[i] = dst_s[i] = rand();
+            if (rand() & 1)
+                stride *= 2;
+            if (stride * (height + 1) + 32 > sizeof(dst_c))
+                height /= 2;
+            fc(dst_c + doff, ref + roff, stride, height);
+            fs(dst_s + doff, ref + roff, stride, height);
+            cpu_done();
+            if (memcmp(dst_c, dst_s, sizeof(dst_c))) {
+                printf("%s %s_%s: mismatch (stride %d, height %d)\n", name,
+                       f < 8 ? "put" : "avg", mc_name[f & 7], stride, height);
+                fail = 1;
+                break;
+            }
+        }
+    }
+
+    t = GetTimer();
+    for (run = 0; run < BENCH_RUNS; run++) {
+        mc->put[3](dst_s, ref, 32, 16);
+        mc->avg[3](dst_s, ref, 32, 16);
+    }
+    cpu_done();
+    t = GetTimer() - t;
+    printf("%-7s mc  : %s, xy_16 put+avg %.1f ns\n", name,
+           fail ? "FAILED" : "ok", t * 1000.0 / BENCH_RUNS);
+    return fail;
+}
+
+typedef void idct_copy_fct(int16_t *block, uint8_t *dest, int stride);
+typedef void idct_add_fct(int last, int16_t *block, uint8_t *dest, int stride);
+
+/// coefficient position j in the input order of an IDCT implementation
+static int perm_c(int j)
+{
+    return ((j & 0x36) >> 1) | ((j & 0x09) << 2);
+}
+
+static int perm_mmx(int j)
+{
+    return (j & 0x38) | ((j & 6) >> 1) | ((j & 1) << 2);
+}
+
+static void make_block(int16_t *block, const int16_t *coef, int (*perm)(int))
+{
+    int j;
+    memset(block, 0, 64 * sizeof(*block));
+    for (j = 0; j < 64; j++)
+        block[perm(j)] = coef[j];
+}
+
+static int test_idct(const char *name, idct_copy_fct *copy, idct_add_fct *add,
+                     idct_copy_fct *copy_c, idct_add_fct *add_c)
+{
+    static int16_t block_c[64] ATTR_ALIGN(16), block_s[64] ATTR_ALIGN(16);
+    static uint8_t dst_c[8 * 24], dst_s[8 * 24];
+    int16_t coef[64];
+    int run, i, diff, maxdiff = 0, dc_fail = 0, fail = 0;
+    unsigned int t;
+
+    for (run = 0; run < IDCT_RUNS; run++) {
+        int dc_only = run & 1, n = 1 + rand() % 8;
+        memset(coef, 0, sizeof(coef));
+        coef[0] = (rand() % 4096) - 2048;
+        if (dc_only) {
+            // values the DC shortcut does not handle go through the IDCT
+            if ((coef[0] & (7 << 4)) == (4 << 4))
+                coef[0] ^= 1 << 4;
+        } else
+            while (n--)
+                coef[rand() % 64] = (rand() % 512) - 256;
+        make_block(block_c, coef, perm_c);
+        make_block(block_s, coef, perm_mmx);
+        for (i = 0; i < sizeof(dst_c); i++)
+            dst_c[i] = dst_s[i] = rand();
+        if (run & 2) {
+            add_c(dc_only ? 129 : 63, block_c, dst_c, 24);
+            add(dc_only ? 129 : 63, block_s, dst_s, 24);
+        } else {
+            copy_c(block_c, dst_c, 24);
+            copy(block_s, dst_s, 24);
+        }
+        cpu_done();
+        for (i = 0; i < 64; i++)
+            if (block_s[i]) {
+                printf("%s idct: block not cleared\n", name);
+                return 1;
+            }
+        for (i = 0; i < sizeof(dst_c); i++) {
+            diff = abs(dst_c[i] - dst_s[i]);
+            if (diff > maxdiff)
+                maxdiff = diff;
+            if (diff && dc_only && (run & 2))
+                dc_fail = 1;
+        }
+    }
+    fail = dc_fail || maxdiff > 1;
+
+    memset(block_s, 0, sizeof(block_s));
+    t = GetTimer();
+    for (run = 0; run < BENCH_RUNS; run++) {
+        block_s[0] = 1024;
+        block_s[9] = 100;
+        add(63, block_s, dst_s, 24);
+        block_s[0] = 1024;
+        add(129, block_s, dst_s, 24);
+    }
+    cpu_done();
+    t = GetTimer() - t;
+    printf("%-7s idct: %s, max diff %d%s, full+DC add %.1f ns\n", name,
+           fail ? "FAILED" : "ok", maxdiff, dc_fail ? " (DC only)" : "",
+           t * 1000.0 / BENCH_RUNS);
+    return fail;
+}
+
+int main(void)
+{
+    idct_copy_fct *copy_c;
+    idct_add_fct *add_c;
+    int fail = 0;
+
+    GetCpuCaps(&gCpuCaps);
+    srand(1);
+
+    mpeg2_idct_init(0);
+    copy_c = mpeg2_idct_copy;
+    add_c  = mpeg2_idct_add;
+
+    fail |= test_mc("c", &mpeg2_mc_c);
+#if HAVE_MMX
+    if (gCpuCaps.hasMMX) {
+        fail |= test_mc("mmx", &mpeg2_mc_mmx);
+        fail |= test_idct("mmx", mpeg2_idct_copy_mmx, mpeg2_idct_add_mmx,
+                          copy_c, add_c);
+    }
+#endif
+#if HAVE_MMX2
+    if (gCpuCaps.hasMMX2) {
+        fail |= test_mc("mmxext", &mpeg2_mc_mmxext);
+        fail |= test_idct("mmxext", mpeg2_idct_copy_mmxext,
+                          mpeg2_idct_add_mmxext, copy_c, add_c);
+    }
+#endif
+#if HAVE_AMD3DNOW
+    if (gCpuCaps.has3DNow)
+        fail |= test_mc("3dnow", &mpeg2_mc_3dnow);
+#endif
+#if HAVE_SSE2
+    if (gCpuCaps.hasSSE2) {
+        fail |= test_mc("sse2", &mpeg2_mc_sse2);
+        fail |= test_idct("sse2", mpeg2_idct_copy_sse2, mpeg2_idct_add_sse2,
+                          copy_c, add_c);
+    }
+#endif
+    return fail;
+}
@@ -1222,6 +1222,34 @@ static inline void block_add_DC (int16_t * const block, uint8_t * dest,
     movq_r2m (mm3, *(dest + 2*stride));
 }
 
+/* two rows per register, otherwise the same as block_add_DC */
+#define ADD_DC_SSE2_2ROW(row)				\
+do {							\
+    movq_m2r (*(dest+(row)*stride), xmm2);		\
+    movhps_m2r (*(dest+(row+1)*stride), xmm2);		\
+    paddusb_r2r (xmm0, xmm2);				\
+    psubusb_r2r (xmm1, xmm2);				\
+    movq_r2m (xmm2, *(dest+(row)*stride));		\
+    movhps_r2m (xmm2, *(dest+(row+1)*stride));		\
+} while (0)
+
+static inline void sse2_block_add_DC (int16_t * const block, uint8_t * dest,
+				      const int stride)
+{
+    movd_v2r ((block[0] + 64) >> 7, xmm0);
+    pxor_r2r (xmm1, xmm1);
+    punpcklwd_r2r (xmm0, xmm0);
+    pshufd_r2r (xmm0, xmm0, 0x00);
+    psubsw_r2r (xmm0, xmm1);
+    packuswb_r2r (xmm0, xmm0);
+    packuswb_r2r (xmm1, xmm1);
+    block[0] = block[63] = 0;
+    ADD_DC_SSE2_2ROW (0);
+    ADD_DC_SSE2_2ROW (2);
+    ADD_DC_SSE2_2ROW (4);
+    ADD_DC_SSE2_2ROW (6);
+}
+
 void mpeg2_idct_copy_sse2 (int16_t * const block, uint8_t * const dest,
 			   const int stride)
 {
@@ -1238,7 +1266,7 @@ void mpeg2_idct_add_sse2 (const int last, int16_t * const block,
 	sse2_block_add (block, dest, stride);
 	sse2_block_zero (block);
     } else
-	block_add_DC (block, dest, stride, CPU_MMXEXT);
+	sse2_block_add_DC (block, dest, stride);
 }
 
 
@@ -282,6 +282,9 @@ typedef	union {
 #define	movdqa_r2m(reg,var)	mmx_r2m (movdqa, reg, var)
 #define	movdqa_r2r(regs,regd)	mmx_r2r (movdqa, regs, regd)
 
+#define	movhps_m2r(var,reg)	mmx_m2r (movhps, var, reg)
+#define	movhps_r2m(reg,var)	mmx_r2m (movhps, reg, var)
+
 #define	pshufd_r2r(regs,regd,imm)	mmx_r2ri(pshufd, regs, regd, imm)
 
 #define	pshufw_m2r(var,reg,imm)		mmx_m2ri(pshufw, var, reg, imm)
@@ -1010,4 +1010,212 @@ MPEG2_MC_EXTERN (3dnow)
 
 #endif /* HAVE_AMD3DNOW */
 
+#if HAVE_SSE2
+/*
+ * SSE2 code: a 16 pixel row fits in one register.  All loads and stores
+ * are unaligned, neither the reference nor the destination row start on
+ * a 16 byte boundary in general.  8 pixel blocks already use the whole
+ * register in the MMXEXT code, so that is used for them.
+ */
+
+static sse_t mask_one_sse2 = {{0x0101010101010101LL, 0x0101010101010101LL}};
+
+static inline void MC_put1_16_sse2 (int height, uint8_t * dest,
+				    const uint8_t * ref, const int stride)
+{
+    do {
+	movdqu_m2r (*ref, xmm0);
+	movdqu_m2r (*(ref+stride), xmm1);
+	ref += 2*stride;
+	movdqu_r2m (xmm0, *dest);
+	movdqu_r2m (xmm1, *(dest+stride));
+	dest += 2*stride;
+    } while (height -= 2);
+}
+
+static inline void MC_avg1_16_sse2 (int height, uint8_t * dest,
+				    const uint8_t * ref, const int stride)
+{
+    do {
+	movdqu_m2r (*ref, xmm0);
+	movdqu_m2r (*dest, xmm1);
+	pavgb_r2r (xmm1, xmm0);
+	ref += stride;
+	movdqu_r2m (xmm0, *dest);
+	dest += stride;
+    } while (--height);
+}
+
+static inline void MC_put2_16_sse2 (int height, uint8_t * dest,
+				    const uint8_t * ref, const int stride,
+				    const int offset)
+{
+    do {
+	movdqu_m2r (*ref, xmm0);
+	movdqu_m2r (*(ref+offset), xmm1);
+	pavgb_r2r (xmm1, xmm0);
+	ref += stride;
+	movdqu_r2m (xmm0, *dest);
+	dest += stride;
+    } while (--height);
+}
+
+static inline void MC_avg2_16_sse2 (int height, uint8_t * dest,
+				    const uint8_t * ref, const int stride,
+				    const int offset)
+{
+    do {
+	movdqu_m2r (*ref, xmm0);
+	movdqu_m2r (*(ref+offset), xmm1);
+	movdqu_m2r (*dest, xmm2);
+	pavgb_r2r (xmm1, xmm0);
+	pavgb_r2r (xmm2, xmm0);
+	ref += stride;
+	movdqu_r2m (xmm0, *dest);
+	dest += stride;
+    } while (--height);
+}
+
+/*
+ * Same rounding correction as MC_put4_8, the horizontal average of each
+ * row is reused for the next one.
+ */
+static inline void MC_4_16_sse2 (int height, uint8_t * dest,
+				 const uint8_t * ref, const int stride,
+				 const int avg)
+{
+    movdqu_m2r (*ref, xmm0);
+    movdqu_m2r (*(ref+1), xmm1);
+    movdqa_r2r (xmm0, xmm7);
+    pxor_r2r (xmm1, xmm7);
+    pavgb_r2r (xmm1, xmm0);
+    ref += stride;
+
+    do {
+	movdqu_m2r (*ref, xmm2);
+	movdqu_m2r (*(ref+1), xmm3);
+	movdqa_r2r (xmm2, xmm6);
+	pxor_r2r (xmm3, xmm6);
+	pavgb_r2r (xmm3, xmm2);
+	movdqa_r2r (xmm0, xmm5);
+	pxor_r2r (xmm2, xmm5);
+	por_r2r (xmm6, xmm7);
+	pand_r2r (xmm5, xmm7);
+	pand_m2r (mask_one_sse2, xmm7);
+	pavgb_r2r (xmm2, xmm0);
+	psubusb_r2r (xmm7, xmm0);
+	if (avg) {
+	    movdqu_m2r (*dest, xmm1);
+	    pavgb_r2r (xmm1, xmm0);
+	}
+	ref += stride;
+	movdqu_r2m (xmm0, *dest);
+	dest += stride;
+
+	movdqa_r2r (xmm6, xmm7);
+	movdqa_r2r (xmm2, xmm0);
+    } while (--height);
+}
+
+static void MC_avg_o_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_avg1_16_sse2 (height, dest, ref, stride);
+}
+
+static void MC_avg_o_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_avg1_8 (height, dest, ref, stride, CPU_MMXEXT);
+}
+
+static void MC_put_o_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_put1_16_sse2 (height, dest, ref, stride);
+}
+
+static void MC_put_o_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_put1_8 (height, dest, ref, stride);
+}
+
+static void MC_avg_x_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_avg2_16_sse2 (height, dest, ref, stride, 1);
+}
+
+static void MC_avg_x_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_avg2_8 (height, dest, ref, stride, 1, CPU_MMXEXT);
+}
+
+static void MC_put_x_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_put2_16_sse2 (height, dest, ref, stride, 1);
+}
+
+static void MC_put_x_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_put2_8 (height, dest, ref, stride, 1, CPU_MMXEXT);
+}
+
+static void MC_avg_y_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_avg2_16_sse2 (height, dest, ref, stride, stride);
+}
+
+static void MC_avg_y_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_avg2_8 (height, dest, ref, stride, stride, CPU_MMXEXT);
+}
+
+static void MC_put_y_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_put2_16_sse2 (height, dest, ref, stride, stride);
+}
+
+static void MC_put_y_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_put2_8 (height, dest, ref, stride, stride, CPU_MMXEXT);
+}
+
+static void MC_avg_xy_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			       int stride, int height)
+{
+    MC_4_16_sse2 (height, dest, ref, stride, 1);
+}
+
+static void MC_avg_xy_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_avg4_8 (height, dest, ref, stride, CPU_MMXEXT);
+}
+
+static void MC_put_xy_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			       int stride, int height)
+{
+    MC_4_16_sse2 (height, dest, ref, stride, 0);
+}
+
+static void MC_put_xy_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_put4_8 (height, dest, ref, stride, CPU_MMXEXT);
+}
+
+
+MPEG2_MC_EXTERN (sse2)
+
+#endif /* HAVE_SSE2 */
+
 #endif
@@ -182,6 +182,7 @@ mpeg2_state_t mpeg2_parse (mpeg2dec_t * mpeg2dec);
 void mpeg2_reset (mpeg2dec_t * mpeg2dec, int full_reset);
 void mpeg2_skip (mpeg2dec_t * mpeg2dec, int skip);
 void mpeg2_slice_region (mpeg2dec_t * mpeg2dec, int start, int end);
+int mpeg2_threads (mpeg2dec_t * mpeg2dec, int threads);
 
 void mpeg2_tag_picture (mpeg2dec_t * mpeg2dec, uint32_t tag, uint32_t tag2);
 
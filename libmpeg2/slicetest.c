@@ -0,0 +1,275 @@
+/*
+ * check that slice threads decode exactly like a single thread
+ *
+ * A small MPEG-2 stream is generated: I and P pictures with one slice per
+ * macroblock row, intra macroblocks with random DC and a few AC
+ * coefficients, motion compensated macroblocks with random vectors.  It
+ * is decoded once single threaded and once with several threads, every
+ * displayed picture has to be identical.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/time.h>
+
+#include "config.h"
+#include "cpudetect.h"
+#include "mpeg2.h"
+
+#define WIDTH    720
+#define HEIGHT   576
+#define MB_W     (WIDTH / 16)
+#define MB_H     (HEIGHT / 16)
+#define PICTURES 24
+#define GOP      6
+#define THREADS  4
+#define FRAME_SIZE (WIDTH * HEIGHT * 3 / 2)
+
+static uint8_t bits[4 << 20];
+static int bitpos;
+
+static void put_bits(int n, unsigned int v)
+{
+    while (n--) {
+        if ((v >> n) & 1)
+            bits[bitpos >> 3] |= 0x80 >> (bitpos & 7);
+        bitpos++;
+    }
+}
+
+static void start_code(int code)
+{
+    bitpos = (bitpos + 7) & ~7;
+    put_bits(24, 1);
+    put_bits(8, code);
+}
+
+static void put_sequence(void)
+{
+    start_code(0xb3);
+    put_bits(12, WIDTH);
+    put_bits(12, HEIGHT);
+    put_bits(4, 1);             // square pixels
+    put_bits(4, 3);             // 25 fps
+    put_bits(18, 20000);
+    put_bits(1, 1);
+    put_bits(10, 112);
+    put_bits(3, 0);             // not constrained, default matrices
+
+    start_code(0xb5);           // sequence extension
+    put_bits(4, 1);
+    put_bits(8, 0x48);          // main profile, main level
+    put_bits(1, 1);             // progressive
+    put_bits(2, 1);             // 4:2:0
+    put_bits(4, 0);
+    put_bits(12, 0);
+    put_bits(1, 1);
+    put_bits(8, 0);
+    put_bits(1, 0);             // no low delay
+    put_bits(7, 0);
+}
+
+static void put_picture(int n, int intra)
+{
+    if (!(n % GOP)) {
+        start_code(0xb8);
+        put_bits(12, 0);        // time code, hours and minutes
+        put_bits(1, 1);
+        put_bits(12, 0);        // seconds and pictures
+        put_bits(2, 2);         // closed GOP
+    }
+    start_code(0x00);
+    put_bits(10, n % GOP);
+    put_bits(3, intra ? 1 : 2);
+    put_bits(16, 0xffff);
+    if (!intra)
+        put_bits(4, 7);         // f_code is in the extension
+    put_bits(1, 0);
+
+    start_code(0xb5);           // picture coding extension
+    put_bits(4, 8);
+    put_bits(8, intra ? 0xff : 0x11);
+    put_bits(8, 0xff);
+    put_bits(2, 0);             // 8 bit DC
+    put_bits(2, 3);             // frame picture
+    put_bits(1, 0);
+    put_bits(1, 1);             // frame_pred_frame_dct
+    put_bits(5, 0);
+    put_bits(2, 3);             // chroma_420_type, progressive_frame
+    put_bits(1, 0);
+}
+
+static void put_dc(int chroma, int *pred)
+{
+    static const unsigned int luma_code[5][2] = {
+        {4, 3}, {0, 2}, {1, 2}, {5, 3}, {6, 3}
+    };
+    static const unsigned int chroma_code[5][2] = {
+        {0, 2}, {1, 2}, {2, 2}, {6, 3}, {14, 4}
+    };
+    int d = rand() % 31 - 15, size = 0;
+
+    if (*pred + d < 24 || *pred + d > 232)
+        d = -d;
+    *pred += d;
+    while ((abs(d) >> size))
+        size++;
+    if (chroma)
+        put_bits(chroma_code[size][1], chroma_code[size][0]);
+    else
+        put_bits(luma_code[size][1], luma_code[size][0]);
+    if (size)
+        put_bits(size, d > 0 ? d : d + (1 << size) - 1);
+}
+
+static void put_intra_blocks(int *dc_pred)
+{
+    int b;
+    for (b = 0; b < 6; b++) {
+        int c = rand() % 4;
+        put_dc(b >= 4, &dc_pred[b < 4 ? 0 : b - 3]);
+        while (c--)
+            switch (rand() % 3) {
+            case 0: put_bits(3, 6 | (rand() & 1)); break;   // run 0, level 1
+            case 1: put_bits(4, 6 | (rand() & 1)); break;   // run 1, level 1
+            case 2: put_bits(5, 8 | (rand() & 1)); break;   // run 0, level 2
+            }
+        put_bits(2, 2);         // end of block
+    }
+}
+
+static void put_motion_code(int *pmv)
+{
+    int d = rand() % 7 - 3;
+    if (abs(*pmv + d) > 8)
+        d = -d;
+    *pmv += d;
+    if (!d)
+        put_bits(1, 1);
+    else
+        put_bits(abs(d) + 2, 2 | (d < 0));
+}
+
+static void put_slices(int intra)
+{
+    int x, y;
+    for (y = 0; y < MB_H; y++) {
+        int dc_pred[3], pmv[2] = { 0, 0 }, last_intra = 0;
+        start_code(y + 1);
+        put_bits(5, 8);         // quantiser_scale_code
+        put_bits(1, 0);
+        for (x = 0; x < MB_W; x++) {
+            put_bits(1, 1);     // address increment 1
+            if (intra || !(rand() % 8)) {
+                if (!intra)
+                    put_bits(5, 3);
+                else
+                    put_bits(1, 1);
+                if (!last_intra)
+                    dc_pred[0] = dc_pred[1] = dc_pred[2] = 128;
+                put_intra_blocks(dc_pred);
+                pmv[0] = pmv[1] = 0;
+                last_intra = 1;
+            } else {
+                put_bits(3, 1);     // motion compensated, not coded
+                put_motion_code(&pmv[0]);
+                put_motion_code(&pmv[1]);
+                last_intra = 0;
+            }
+        }
+    }
+}
+
+static int build_stream(void)
+{
+    int n;
+    srand(1);
+    memset(bits, 0, sizeof(bits));
+    bitpos = 0;
+    put_sequence();
+    for (n = 0; n < PICTURES; n++) {
+        put_picture(n, !(n % GOP));
+        put_slices(!(n % GOP));
+    }
+    start_code(0xb7);
+    return bitpos >> 3;
+}
+
+/// decode the stream, returns the number of pictures stored in out
+static int decode(int threads, int len, uint8_t *out, int *used_threads,
+                  unsigned int *usec)
+{
+    mpeg2dec_t *dec = mpeg2_init();
+    const mpeg2_info_t *info = mpeg2_info(dec);
+    struct timeval t0, t1;
+    int pictures = 0;
+
+    *used_threads = mpeg2_threads(dec, threads);
+    gettimeofday(&t0, NULL);
+    mpeg2_buffer(dec, bits, bits + len);
+    while (1) {
+        mpeg2_state_t state = mpeg2_parse(dec);
+        if (state == STATE_BUFFER)
+            break;
+        if ((state == STATE_SLICE || state == STATE_END ||
+             state == STATE_INVALID_END) && info->display_fbuf &&
+            pictures < PICTURES) {
+            uint8_t *p = out + pictures++ * FRAME_SIZE;
+            int i;
+            for (i = 0; i < HEIGHT; i++)
+                memcpy(p + i * WIDTH, info->display_fbuf->buf[0] + i * WIDTH, WIDTH);
+            p += WIDTH * HEIGHT;
+            for (i = 0; i < HEIGHT; i++)
+                memcpy(p + i * WIDTH / 2,
+                       info->display_fbuf->buf[1 + (i & 1)] + i / 2 * WIDTH / 2,
+                       WIDTH / 2);
+        }
+    }
+    gettimeofday(&t1, NULL);
+    *usec = (t1.tv_sec - t0.tv_sec) * 1000000 + t1.tv_usec - t0.tv_usec;
+    mpeg2_close(dec);
+    return pictures;
+}
+
+int main(void)
+{
+    static uint8_t single[PICTURES * FRAME_SIZE], multi[PICTURES * FRAME_SIZE];
+    int len, n1, n2, t1, t2, i, fail = 0;
+    unsigned int time1, time2;
+
+    GetCpuCaps(&gCpuCaps);
+    len = build_stream();
+    n1 = decode(1, len, single, &t1, &time1);
+    n2 = decode(THREADS, len, multi, &t2, &time2);
+    if (n1 != PICTURES || n2 != n1) {
+        printf("decoded %d pictures single threaded and %d with %d threads "
+               "instead of %d\n", n1, n2, t2, PICTURES);
+        fail = 1;
+    }
+    for (i = 0; i < n1 && i < n2 && !fail; i++)
+        if (memcmp(single + i * FRAME_SIZE, multi + i * FRAME_SIZE, FRAME_SIZE)) {
+            printf("picture %d differs with %d threads\n", i, t2);
+            fail = 1;
+        }
+    printf("slices: %s, %d pictures, %u us with 1 thread, %u us with %d\n",
+           fail ? "FAILED" : "ok", n1, time1, time2, t2);
+    return fail;
+}
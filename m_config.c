@@ -25,6 +25,8 @@
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #ifdef MP_DEBUG
 #include <assert.h>
 #endif
@@ -223,6 +225,9 @@ m_config_free(m_config_t* config) {
     free(p->opts);
     free(p);
   }
+  free(config->name_hash);
+  free(config->var_hash);
+  free(config->wildcards);
   free(config->self_opts);
   free(config);
 }
@@ -301,6 +306,66 @@ m_config_pop(m_config_t* config) {
   mp_msg(MSGT_CFGPARSER, MSGL_DBG2,"Config poped level=%d\n",config->lvl);
 }
 
+static int
+is_wildcard(const m_config_option_t *co) {
+  return (co->opt->type->flags & M_OPT_TYPE_ALLOW_WILDCARD) &&
+         co->name[strlen(co->name) - 1] == '*';
+}
+
+static unsigned int
+hash_var(const void *p) {
+  return (unsigned int)((uintptr_t)p >> 3) * 2654435761U;
+}
+
+// Both tables keep the most recently registered option, like the
+// front of the option list.
+static void
+m_config_hash_option(m_config_t *config, m_config_option_t *co) {
+  unsigned int mask = config->hash_size - 1, i;
+
+  if(!is_wildcard(co)) {
+    i = m_option_hash_name(co->name, INT_MAX) & mask;
+    while(config->name_hash[i] && strcasecmp(config->name_hash[i]->name, co->name))
+      i = (i + 1) & mask;
+    if(!config->name_hash[i] || config->name_hash[i]->id < co->id)
+      config->name_hash[i] = co;
+  }
+  if(co->opt->p && !(co->opt->type->flags & M_OPT_TYPE_HAS_CHILD)) {
+    i = hash_var(co->opt->p) & mask;
+    while(config->var_hash[i] && config->var_hash[i]->opt->p != co->opt->p)
+      i = (i + 1) & mask;
+    if(!config->var_hash[i] || config->var_hash[i]->id < co->id)
+      config->var_hash[i] = co;
+  }
+}
+
+/// make room for one more option, at most half of the table is used
+static void
+m_config_grow_hash(m_config_t *config) {
+  m_config_option_t *co;
+  int size = config->hash_size ? config->hash_size : 256;
+
+  while(2 * (config->num_opts + 1) > size)
+    size *= 2;
+  if(size == config->hash_size)
+    return;
+  free(config->name_hash);
+  free(config->var_hash);
+  config->name_hash = calloc(size, sizeof(*config->name_hash));
+  config->var_hash = calloc(size, sizeof(*config->var_hash));
+  config->hash_size = size;
+  for(co = config->opts ; co ; co = co->next)
+    m_config_hash_option(config, co);
+}
+
+static m_config_option_t*
+m_config_find_var(const m_config_t *config, const void *p) {
+  unsigned int mask = config->hash_size - 1, i = hash_var(p) & mask;
+  while(config->var_hash[i] && config->var_hash[i]->opt->p != p)
+    i = (i + 1) & mask;
+  return config->var_hash[i];
+}
+
 static void
 m_config_add_option(m_config_t *config, const m_option_t *arg, const char* prefix) {
   m_config_option_t *co;
@@ -315,6 +380,7 @@ m_config_add_option(m_config_t *config, const m_option_t *arg, const char* prefi
   // Allocate a new entry for this option
   co = calloc(1,sizeof(m_config_option_t) + arg->type->size);
   co->opt = arg;
+  m_config_grow_hash(config);
 
   // Fill in the full name
   if(prefix && strlen(prefix) > 0) {
@@ -334,14 +400,10 @@ m_config_add_option(m_config_t *config, const m_option_t *arg, const char* prefi
   } else {
     m_config_option_t *i;
     // Check if there is already an option pointing to this address
-    if(arg->p) {
-      for(i = config->opts ; i ; i = i->next ) {
-	if(i->opt->p == arg->p) { // So we don't save the same vars more than 1 time
-	  co->slots = i->slots;
-	  co->flags |= M_CFG_OPT_ALIAS;
-	  break;
-	}
-      }
+    if(arg->p && (i = m_config_find_var(config, arg->p))) {
+      // So we don't save the same vars more than 1 time
+      co->slots = i->slots;
+      co->flags |= M_CFG_OPT_ALIAS;
     }
     if(!(co->flags & M_CFG_OPT_ALIAS)) {
     // Allocate a slot for the defaults
@@ -363,6 +425,13 @@ m_config_add_option(m_config_t *config, const m_option_t *arg, const char* prefi
   }
   co->next = config->opts;
   config->opts = co;
+  co->id = config->num_opts++;
+  m_config_hash_option(config, co);
+  if(is_wildcard(co)) {
+    config->wildcards = realloc(config->wildcards,
+                                (config->num_wildcards + 1) * sizeof(*config->wildcards));
+    config->wildcards[config->num_wildcards++] = co;
+  }
 }
 
 int
@@ -383,18 +452,24 @@ m_config_register_options(m_config_t *config, const m_option_t *args) {
 
 static m_config_option_t*
 m_config_get_co(const m_config_t *config, char *arg) {
-  m_config_option_t *co;
+  m_config_option_t *co = NULL;
+  int i;
 
-  for(co = config->opts ; co ; co = co->next ) {
-    int l = strlen(co->name) - 1;
-    if((co->opt->type->flags & M_OPT_TYPE_ALLOW_WILDCARD) &&
-       (co->name[l] == '*')) {
-      if(strncasecmp(co->name,arg,l) == 0)
-	return co;
-    } else if(strcasecmp(co->name,arg) == 0)
-      return co;
+  if(config->hash_size) {
+    unsigned int mask = config->hash_size - 1;
+    i = m_option_hash_name(arg, INT_MAX) & mask;
+    while(config->name_hash[i] && strcasecmp(config->name_hash[i]->name, arg))
+      i = (i + 1) & mask;
+    co = config->name_hash[i];
   }
-  return NULL;
+  // a wildcard registered later takes precedence
+  for(i = 0 ; i < config->num_wildcards ; i++) {
+    m_config_option_t *w = config->wildcards[i];
+    if((!co || w->id > co->id) &&
+       strncasecmp(w->name, arg, strlen(w->name) - 1) == 0)
+      co = w;
+  }
+  return co;
 }
 
 static int
@@ -57,6 +57,8 @@ struct m_config_option {
   m_config_save_slot_t* slots;
   /// See \ref ConfigOptionFlags.
   unsigned int flags;
+  /// Registration order, later options hide earlier ones of the same name.
+  int id;
 };
 
 /// \defgroup ConfigProfiles Config profiles
@@ -96,6 +98,16 @@ typedef struct m_config {
   int profile_depth;
   /// Options defined by the config itself.
   struct m_option* self_opts;
+  /// Number of registered options.
+  int num_opts;
+  /// Hash tables of hash_size entries finding the options by name and
+  /// by variable address.
+  m_config_option_t** name_hash;
+  m_config_option_t** var_hash;
+  int hash_size;
+  /// Options with wildcard names, they are not in name_hash.
+  m_config_option_t** wildcards;
+  int num_wildcards;
 } m_config_t;
 
 /// \defgroup ConfigOptionFlags Config option flags
@@ -0,0 +1,239 @@
+/*
+ * check and time the option and property name lookups
+ *
+ * A few thousand options are registered in several tables, some of them
+ * shadowing earlier names, sharing variables or using wildcards.  Every
+ * lookup has to give the same result as a walk over the whole list, then
+ * both are timed, for options as when parsing a command line and for
+ * properties as in slave mode queries.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "mp_msg.h"
+#include "osdep/timer.h"
+#include "m_option.h"
+#include "m_config.h"
+#include "m_property.h"
+
+#define TABLES   4
+#define PER_TABLE 500
+#define NAMES    (TABLES * PER_TABLE)
+#define PROPS    200
+#define ROUNDS   50
+
+static int vars[NAMES];
+static char **wild_var;
+static char *names[NAMES + 2];
+static m_option_t tables[TABLES][PER_TABLE + 2];
+static m_option_t props[PROPS + 3];
+
+/// the lookup as it was done before the name indexes
+static const m_option_t *linear_get_option(const m_config_t *config, const char *arg)
+{
+    m_config_option_t *co;
+    for (co = config->opts; co; co = co->next) {
+        int l = strlen(co->name) - 1;
+        if ((co->opt->type->flags & M_OPT_TYPE_ALLOW_WILDCARD) &&
+            co->name[l] == '*') {
+            if (strncasecmp(co->name, arg, l) == 0)
+                return co->opt;
+        } else if (strcasecmp(co->name, arg) == 0)
+            return co->opt;
+    }
+    return NULL;
+}
+
+static m_config_t *build_config(void)
+{
+    m_config_t *config = m_config_new();
+    int t, i;
+
+    for (i = 0; i < NAMES; i++) {
+        names[i] = malloc(16);
+        // upper case letters make sure the lookup ignores the case
+        sprintf(names[i], i & 1 ? "opt%d" : "OPT%d", i);
+    }
+    names[NAMES]     = "nosuchoption";
+    names[NAMES + 1] = "opt1x";
+    for (t = 0; t < TABLES; t++) {
+        for (i = 0; i < PER_TABLE; i++) {
+            int n = t * PER_TABLE + i;
+            m_option_t *o = &tables[t][i];
+            // later tables shadow some names and share some variables
+            o->name = names[t && !(i % 7) ? i : n];
+            o->type = CONF_TYPE_INT;
+            o->p    = &vars[t && !(i % 11) ? i : n];
+        }
+        if (t == 2) {
+            // hides opt17, opt170.. registered before, not the ones after
+            tables[t][PER_TABLE].name = "opt17*";
+            tables[t][PER_TABLE].type = CONF_TYPE_STRING_LIST;
+            tables[t][PER_TABLE].p    = &wild_var;
+        }
+        m_config_register_options(config, tables[t]);
+    }
+    return config;
+}
+
+static int check_options(m_config_t *config)
+{
+    int i, fail = 0, aliases = 0;
+    m_config_option_t *co;
+
+    for (i = 0; i < NAMES + 2; i++) {
+        const m_option_t *a = m_config_get_option(config, names[i]);
+        const m_option_t *b = linear_get_option(config, names[i]);
+        if (a != b) {
+            printf("options: %s gives %s instead of %s\n", names[i],
+                   a ? a->name : "nothing", b ? b->name : "nothing");
+            fail = 1;
+        }
+    }
+    // options sharing a variable must share the saved values too
+    for (co = config->opts; co; co = co->next) {
+        m_config_option_t *o;
+        for (o = co->next; o && o->opt->p != co->opt->p; o = o->next)
+            /* NOTHING */;
+        if (!o || co->opt->p == &wild_var)
+            continue;
+        aliases++;
+        if (!(co->flags & M_CFG_OPT_ALIAS)) {
+            printf("options: %s is not an alias of %s\n", co->name, o->name);
+            fail = 1;
+        }
+    }
+    for (i = 0; i < NAMES && !fail; i++) {
+        const m_option_t *o = m_config_get_option(config, names[i]);
+        char val[16];
+        if (!o || o->p != &vars[i])
+            continue;
+        sprintf(val, "%d", i + 1);
+        if (m_config_set_option(config, names[i], val) < 0 || vars[i] != i + 1) {
+            printf("options: setting %s failed\n", names[i]);
+            fail = 1;
+        }
+    }
+    printf("options: %s, %d names, %d aliases\n", fail ? "FAILED" : "ok",
+           NAMES, aliases);
+    return fail;
+}
+
+static void bench_options(m_config_t *config)
+{
+    unsigned int t, hashed, linear;
+    int r, i;
+
+    t = GetTimer();
+    for (r = 0; r < ROUNDS; r++)
+        for (i = 0; i < NAMES; i++)
+            m_config_get_option(config, names[i]);
+    hashed = GetTimer() - t;
+    t = GetTimer();
+    for (r = 0; r < ROUNDS; r++)
+        for (i = 0; i < NAMES; i++)
+            linear_get_option(config, names[i]);
+    linear = GetTimer() - t;
+    printf("options: %.1f ns per lookup, %.1f ns walking the list\n",
+           hashed * 1000.0 / (ROUNDS * NAMES), linear * 1000.0 / (ROUNDS * NAMES));
+}
+
+static int prop_get(const m_option_t *prop, int action, void *arg, void *ctx)
+{
+    if (action != M_PROPERTY_GET)
+        return M_PROPERTY_NOT_IMPLEMENTED;
+    *(int *)arg = prop - props;
+    return M_PROPERTY_OK;
+}
+
+static void build_props(void)
+{
+    int i;
+    for (i = 0; i < PROPS + 2; i++) {
+        props[i].name = names[i];
+        props[i].p    = prop_get;
+        props[i].type = CONF_TYPE_INT;
+    }
+    // shadows opt3, opt30.. except opt3 itself, which comes first
+    props[10].name = "opt3*";
+    props[10].type = CONF_TYPE_STRING_LIST;
+    // the first of two entries with the same name wins
+    props[PROPS + 1].name = names[20];
+}
+
+static int check_props(void)
+{
+    int i, fail = 0;
+
+    for (i = 0; i < NAMES + 2; i++) {
+        const m_option_t *a = NULL, *b = m_option_list_find(props, names[i]);
+        int r = m_property_do(props, names[i], M_PROPERTY_GET_TYPE, &a, NULL);
+        if (a != b || (r == M_PROPERTY_UNKNOWN) != !b) {
+            printf("properties: %s gives %s instead of %s\n", names[i],
+                   a ? a->name : "nothing", b ? b->name : "nothing");
+            fail = 1;
+        }
+    }
+    printf("properties: %s, %d properties\n", fail ? "FAILED" : "ok", PROPS + 2);
+    return fail;
+}
+
+static void bench_props(void)
+{
+    unsigned int t, hashed, linear;
+    int r, i, val;
+
+    t = GetTimer();
+    for (r = 0; r < ROUNDS * 10; r++)
+        for (i = 0; i < PROPS; i++)
+            m_property_do(props, names[i], M_PROPERTY_GET, &val, NULL);
+    hashed = GetTimer() - t;
+    t = GetTimer();
+    for (r = 0; r < ROUNDS * 10; r++)
+        for (i = 0; i < PROPS; i++) {
+            const m_option_t *p = m_option_list_find(props, names[i]);
+            if (p)
+                ((m_property_ctrl_f)p->p)(p, M_PROPERTY_GET, &val, NULL);
+        }
+    linear = GetTimer() - t;
+    printf("properties: %.1f ns per get, %.1f ns walking the list\n",
+           hashed * 1000.0 / (ROUNDS * 10 * PROPS),
+           linear * 1000.0 / (ROUNDS * 10 * PROPS));
+}
+
+int main(int argc, char **argv)
+{
+    m_config_t *config;
+    int fail = 0;
+
+    mp_msg_init();
+    if (argc > 1 && !strcmp(argv[1], "-v"))
+        verbose = 1;
+    config = build_config();
+    fail |= check_options(config);
+    bench_options(config);
+    build_props();
+    fail |= check_props();
+    bench_props();
+    m_config_free(config);
+    return fail;
+}
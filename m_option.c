@@ -28,6 +28,7 @@
 #include <stdarg.h>
 #include <inttypes.h>
 #include <unistd.h>
+#include <ctype.h>
 
 #include "m_option.h"
 //#include "m_config.h"
@@ -55,6 +56,14 @@ const m_option_t* m_option_list_find(const m_option_t* list,const char* name) {
   return NULL;
 }
 
+unsigned int m_option_hash_name(const char* name, int len) {
+  // FNV-1a
+  unsigned int h = 2166136261U;
+  while(len-- > 0 && *name)
+    h = (h ^ tolower(*(const unsigned char*)name++)) * 16777619U;
+  return h;
+}
+
 // Default function that just does a memcpy
 
 static void copy_opt(const m_option_t* opt,void* dst,const void* src) {
@@ -481,6 +481,10 @@ struct m_option {
  */
 const m_option_t* m_option_list_find(const m_option_t* list,const char* name);
 
+/// Case insensitive hash of the first \p len characters of \p name,
+/// for the name indexes of options, properties and commands.
+unsigned int m_option_hash_name(const char* name, int len);
+
 /// Helper to parse options, see \ref m_option_type::parse.
 inline static int
 m_option_parse(const m_option_t* opt,const char *name, const char *param, void* dst, int src) {
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include <inttypes.h>
 #include <unistd.h>
 
@@ -33,6 +34,81 @@
 #include "mpcommon.h"
 #include "help_mp.h"
 
+/// Name index of a property list, built on the first lookup in it.
+typedef struct prop_index {
+    const m_option_t* list;
+    const m_option_t** hash;
+    unsigned int mask;
+    const m_option_t** wildcards;
+    int num_wildcards;
+    struct prop_index* next;
+} prop_index_t;
+
+static prop_index_t* prop_indexes;
+
+static int is_wildcard(const m_option_t* opt) {
+    int l = strlen(opt->name) - 1;
+    return (opt->type->flags & M_OPT_TYPE_ALLOW_WILDCARD) &&
+           l > 0 && opt->name[l] == '*';
+}
+
+static prop_index_t* get_index(const m_option_t* list) {
+    prop_index_t* idx;
+    int i, n, size = 16;
+
+    for(idx = prop_indexes ; idx ; idx = idx->next)
+        if(idx->list == list) return idx;
+
+    for(n = 0 ; list[n].name ; n++);
+    while(size < 2*n) size *= 2;
+    idx = calloc(1,sizeof(*idx));
+    idx->hash = calloc(size,sizeof(*idx->hash));
+    idx->wildcards = calloc(n+1,sizeof(*idx->wildcards));
+    if(!idx->hash || !idx->wildcards) {
+        free(idx->hash);
+        free(idx->wildcards);
+        free(idx);
+        return NULL;
+    }
+    idx->list = list;
+    idx->mask = size - 1;
+    for(i = 0 ; i < n ; i++) {
+        unsigned int h;
+        if(is_wildcard(&list[i])) {
+            idx->wildcards[idx->num_wildcards++] = &list[i];
+            continue;
+        }
+        h = m_option_hash_name(list[i].name, INT_MAX) & idx->mask;
+        while(idx->hash[h] && strcasecmp(idx->hash[h]->name,list[i].name))
+            h = (h + 1) & idx->mask;
+        // the first entry of a name wins, as in m_option_list_find()
+        if(!idx->hash[h]) idx->hash[h] = &list[i];
+    }
+    idx->next = prop_indexes;
+    prop_indexes = idx;
+    return idx;
+}
+
+static const m_option_t* find_prop(const m_option_t* list, const char* name) {
+    prop_index_t* idx = get_index(list);
+    const m_option_t* prop;
+    unsigned int h;
+    int i;
+
+    if(!idx) return m_option_list_find(list, name);
+    h = m_option_hash_name(name, INT_MAX) & idx->mask;
+    while((prop = idx->hash[h]) && strcasecmp(prop->name,name))
+        h = (h + 1) & idx->mask;
+    // a wildcard placed before the exact match takes precedence
+    for(i = 0 ; i < idx->num_wildcards ; i++) {
+        const m_option_t* w = idx->wildcards[i];
+        if(prop && w > prop) break;
+        if(strncasecmp(w->name,name,strlen(w->name)-1) == 0)
+            return w;
+    }
+    return prop;
+}
+
 static int do_action(const m_option_t* prop_list, const char* name,
                      int action, void* arg, void *ctx) {
     const char* sep;
@@ -44,14 +120,14 @@ static int do_action(const m_option_t* prop_list, const char* name,
         char base[len+1];
         memcpy(base,name,len);
         base[len] = 0;
-        prop = m_option_list_find(prop_list, base);
+        prop = find_prop(prop_list, base);
         ka.key = sep+1;
         ka.action = action;
         ka.arg = arg;
         action = M_PROPERTY_KEY_ACTION;
         arg = &ka;
     } else
-        prop = m_option_list_find(prop_list, name);
+        prop = find_prop(prop_list, name);
     if(!prop) return M_PROPERTY_UNKNOWN;
     r = ((m_property_ctrl_f)prop->p)(prop,action,arg,ctx);
     if(action == M_PROPERTY_GET_TYPE && r < 0) {
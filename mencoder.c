@@ -46,6 +46,7 @@
 #include "config.h"
 
 #include <inttypes.h>
+#include <math.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -54,8 +55,13 @@
 #if defined(__MINGW32__) || defined(__CYGWIN__)
 #include <windows.h>
 #endif
+#ifndef __MINGW32__
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #include "input/input.h"
+#include "libaf/af.h"
 #include "libaf/af_format.h"
 #include "libao2/audio_out.h"
 #include "libavcodec/avcodec.h"
@@ -112,6 +118,10 @@ int stream_cache_size=-1;
 float stream_cache_min_percent=20.0;
 float stream_cache_seek_min_percent=50.0;
 #endif
+// output write cache, kB
+static int write_cache_size=4096;
+// decoded audio blocks queued for the audio encoding thread
+static int audio_queue=8;
 
 int audio_id=-1;
 int video_id=-1;
@@ -237,6 +247,24 @@ static m_time_size_t end_at = { .type = END_AT_NONE, .pos = 0 };
 
 static char * frameno_filename=NULL;
 
+#define MAX_SEGMENTS 64
+static int segments=1;
+// first frame of this and the next segment when encoding one of several
+static double segment_start=MP_NOPTS_VALUE;
+static double segment_end=MP_NOPTS_VALUE;
+static int segment_tail=-1;
+static m_entry_t *segment_files=NULL;
+// the audio a segment encodes, reported to the parent through a pipe
+typedef struct {
+    int n;
+    double start, end;
+} segment_audio_t;
+static segment_audio_t segment_audio = { -1, MP_NOPTS_VALUE, MP_NOPTS_VALUE };
+static int segment_report_fd=-1;
+static int64_t segment_audio_left=-1; ///< decoded bytes up to segment_end
+static int64_t segment_audio_done;    ///< decoded bytes encoded so far
+static double segment_audio_bps;
+
 typedef struct {
     unsigned char* start;
     int in_size;
@@ -289,6 +317,9 @@ static void parse_cfgfiles( m_config_t* conf )
 static int dec_audio(sh_audio_t *sh_audio,unsigned char* buffer,int total){
     int size=0;
     int at_eof=0;
+    // the samples from segment_end on are encoded by the next segment
+    if (segment_audio_left >= 0 && total > segment_audio_left)
+        total = segment_audio_left;
     while(size<total && !at_eof){
 	int len=total-size;
 		if(len>MAX_OUTBURST) len=MAX_OUTBURST;
@@ -300,6 +331,9 @@ static int dec_audio(sh_audio_t *sh_audio,unsigned char* buffer,int total){
 		if(sh_audio->a_out_buffer_len>0)
 		    memmove(sh_audio->a_out_buffer,&sh_audio->a_out_buffer[len],sh_audio->a_out_buffer_len);
     }
+    if (segment_audio_left >= 0)
+        segment_audio_left -= size;
+    segment_audio_done += size;
     return size;
 }
 
@@ -387,6 +421,14 @@ static float stop_time(demuxer_t* demuxer, muxer_stream_t* mux_v)
 			}
 		}
 	}
+	// the next segment continues with the audio from its first frame on,
+	// decoded audio is cut exactly by dec_audio() instead
+	if (segment_end != MP_NOPTS_VALUE && segment_audio_left < 0 &&
+	    demuxer && demuxer->video) {
+		float tmp = adjusted_muxer_time(mux_v) + segment_end - demuxer->video->pts;
+		if (timeleft == -1 || timeleft > tmp)
+			timeleft = tmp;
+	}
 	return timeleft;
 }
 
@@ -529,6 +571,282 @@ static int edl_seek(edl_record_ptr next_edl_record, demuxer_t *demuxer,
 }
 
 
+/**
+ * \brief show where the encoding time went
+ * \param video video decoding, filtering and encoding
+ * \param decode the part of video spent in the decoder
+ *
+ * File writes done by the write cache thread overlap with everything else,
+ * only the time the encoder had to wait for it is part of the other stages.
+ */
+static void print_stage_times(double total, double demux, double decode,
+                              double video, double audio, double audio_encode,
+                              double audio_wait, stream_t *ostream)
+{
+    const char *name[] = { "demux", "video decode", "filters+video encode",
+                           "audio", "audio encode", "file writes" };
+    double t[6] = { demux, decode, FFMAX(video - decode, 0), audio, audio_encode, 0 };
+    double wait = 0;
+    int i, max = 0;
+
+#if HAVE_PTHREADS
+    stream_write_cache_stats(ostream, &t[5], &wait);
+#endif
+    if (total <= 0)
+        return;
+    mp_msg(MSGT_MENCODER, MSGL_INFO, "Stage times: ");
+    for (i = 0; i < 6; i++) {
+        mp_msg(MSGT_MENCODER, MSGL_INFO, "%s%s %.1fs (%.0f%%)", i ? ", " : "",
+               name[i], t[i], 100 * t[i] / total);
+        if (t[i] > t[max])
+            max = i;
+    }
+    mp_msg(MSGT_MENCODER, MSGL_INFO, "\n");
+    if (audio_encode > 0)
+        mp_msg(MSGT_MENCODER, MSGL_INFO, "Waited %.1fs for the audio encoding thread.\n", audio_wait);
+    if (ostream->write_cache)
+        mp_msg(MSGT_MENCODER, MSGL_INFO, "Waited %.1fs for the write cache.\n", wait);
+    mp_msg(MSGT_MENCODER, MSGL_INFO, "Slowest stage: %s\n", name[max]);
+}
+
+#if HAVE_PTHREADS
+/// mux the audio chunks the encoding thread has finished
+static void mux_encoded_audio(audio_encoder_t *aencoder, muxer_stream_t *mux_a, int initial)
+{
+    int len;
+
+    while ((len = ae_thread_get(aencoder, mux_a->buffer, mux_a->buffer_size)) > 0) {
+        muxer_write_chunk(mux_a, len, AVIIF_KEYFRAME, MP_NOPTS_VALUE, MP_NOPTS_VALUE);
+        if (initial)
+            mux_a->h.dwInitialFrames++;
+        if (!mux_a->h.dwSampleSize && mux_a->timer > 0)
+            mux_a->wf->nAvgBytesPerSec = 0.5f + (double)mux_a->size / adjusted_muxer_time(mux_a); // avg bps (VBR)
+    }
+}
+#endif
+
+/**
+ * \brief cut the decoded audio to the time of the segment
+ *
+ * Drops the samples before segment_start and limits dec_audio() to those
+ * before segment_end, both shifted by the audio delay like the video.
+ * The first segment keeps the audio before its first frame, the last one
+ * everything up to the end of the file.
+ */
+static void segment_audio_init(sh_audio_t *sh_audio, demux_stream_t *d_audio)
+{
+    int frame = ao_data.channels * (af_fmt2bits(ao_data.format) / 8);
+    int64_t skip = 0, dropped = 0;
+    double pos;
+
+    segment_audio_bps = ao_data.samplerate / playback_speed * frame;
+    if (mp_decode_audio(sh_audio, MAX_OUTBURST) < 0 && !sh_audio->a_out_buffer_len)
+        return;
+    pos = calc_a_pts(sh_audio, d_audio);
+    if (pos == MP_NOPTS_VALUE)
+        return;
+    // timestamp of the first sample in a_out_buffer
+    pos -= sh_audio->a_buffer_len / (double)sh_audio->o_bps +
+           (af_calc_delay(sh_audio->afilter) + sh_audio->a_out_buffer_len) / segment_audio_bps;
+    if (segment_start != MP_NOPTS_VALUE)
+        skip = (int64_t)((segment_start + audio_delay - pos) * segment_audio_bps / frame + 0.5) * frame;
+    while (dropped < skip) {
+        int len;
+        if (!sh_audio->a_out_buffer_len &&
+            mp_decode_audio(sh_audio, FFMIN(skip - dropped, MAX_OUTBURST)) < 0 &&
+            !sh_audio->a_out_buffer_len)
+            break;
+        len = FFMIN(skip - dropped, sh_audio->a_out_buffer_len);
+        sh_audio->a_out_buffer_len -= len;
+        memmove(sh_audio->a_out_buffer, sh_audio->a_out_buffer + len, sh_audio->a_out_buffer_len);
+        dropped += len;
+    }
+    segment_audio.start = pos + dropped / segment_audio_bps;
+    if (segment_end != MP_NOPTS_VALUE)
+        segment_audio_left = FFMAX((int64_t)((segment_end + audio_delay - segment_audio.start) *
+                                             segment_audio_bps / frame + 0.5), 0) * frame;
+    segment_audio_done = 0;
+}
+
+#ifndef __MINGW32__
+/// name of part n of the output file, e.g. movie-part00.avi
+static char *segment_filename(int n)
+{
+    const char *ext = strrchr(mp_basename(out_filename), '.');
+    int base = ext ? ext - out_filename : strlen(out_filename);
+    char *name = malloc(strlen(out_filename) + 8);
+    sprintf(name, "%.*s-part%02d%s", base, out_filename, n, ext ? ext : "");
+    return name;
+}
+
+/**
+ * \brief find the split points for -segments
+ *
+ * Seeks to n evenly spaced times and takes the frame the demuxer lands on,
+ * which is a keyframe for all formats with an index.  Segment i seeks to
+ * seek[i] and its first frame has the timestamp start[i].
+ */
+static int segment_points(char *filename, double *seek, double *start, int n)
+{
+    int file_format = DEMUXER_TYPE_UNKNOWN;
+    stream_t *stream = open_stream(filename, 0, &file_format);
+    demuxer_t *demuxer = NULL;
+    sh_video_t *sh;
+    float frame_time;
+    unsigned char *data;
+    double len;
+    int i = 0;
+
+    if (stream)
+        demuxer = demux_open(stream, file_format, -2, video_id, -2, filename);
+    if (demuxer && demuxer->seekable && (sh = demuxer->video->sh) &&
+        video_read_properties(sh) && (len = demuxer_get_time_length(demuxer)) > 0 &&
+        video_read_frame(sh, &frame_time, &data, 0) >= 0) {
+        seek[0]  = 0;
+        start[0] = sh->pts;
+        for (i = 1; i < n; i++) {
+            seek[i] = len * i / n;
+            if (!demux_seek(demuxer, seek[i], 0, SEEK_ABSOLUTE) ||
+                video_read_frame(sh, &frame_time, &data, 0) < 0)
+                break;
+            start[i] = sh->pts;
+            // not enough keyframes for this many segments
+            if (start[i] <= start[i - 1])
+                break;
+        }
+    }
+    if (demuxer) free_demuxer(demuxer);
+    if (stream) free_stream(stream);
+    return i == n;
+}
+
+/// check that the audio of the segments joins without gaps or overlaps
+static void segment_audio_check(int fd)
+{
+    segment_audio_t a[MAX_SEGMENTS], r;
+    double joined = 0;
+    int i;
+
+    for (i = 0; i < segments; i++)
+        a[i].start = MP_NOPTS_VALUE;
+    while (read(fd, &r, sizeof(r)) == sizeof(r))
+        if (r.n >= 0 && r.n < segments)
+            a[r.n] = r;
+    for (i = 0; i < segments; i++) {
+        // no audio or copied audio, which cannot be cut at a sample
+        if (a[i].start == MP_NOPTS_VALUE)
+            return;
+        joined += a[i].end - a[i].start;
+    }
+    mp_msg(MSGT_MENCODER, MSGL_INFO, "Joined audio: %.3fs, source audio: %.3fs\n",
+           joined, a[segments - 1].end - a[0].start);
+    for (i = 1; i < segments; i++)
+        if (fabs(a[i].start - a[i - 1].end) > 0.001)
+            mp_msg(MSGT_MENCODER, MSGL_WARN, "Audio of segment %d ends at %.3fs, segment %d starts at %.3fs.\n",
+                   i - 1, a[i - 1].end, i, a[i].start);
+}
+
+/**
+ * \brief encode the input as -segments parts in parallel processes
+ *
+ * Returns in every child with the settings to encode its own part and in
+ * the parent, once all children are done, with those for joining the parts
+ * into the output file by stream copy.  Does nothing if the input cannot
+ * be split.
+ */
+static void encode_segments(m_entry_t **filelist)
+{
+    double seek[MAX_SEGMENTS], start[MAX_SEGMENTS];
+    pid_t pid[MAX_SEGMENTS];
+    char *filename = (*filelist)[0].name;
+    int i, n, failed = 0;
+    int report[2];
+
+    if (!filename || (*filelist)[1].name || (*filelist)[0].opts[0] ||
+        seek_to_sec || seek_to_byte || end_at.type != END_AT_NONE ||
+        play_n_frames_mf >= 0 || dvd_chapter > 1 || dvd_last_chapter > 0 ||
+        frameno_filename || vobsub_out || out_video_codec == VCODEC_COPY) {
+        mp_msg(MSGT_MENCODER, MSGL_WARN, "-segments needs a single complete input file and video encoding, encoding sequentially.\n");
+        return;
+    }
+    if (!segment_points(filename, seek, start, segments)) {
+        mp_msg(MSGT_MENCODER, MSGL_WARN, "Cannot split %s into %d segments, encoding sequentially.\n",
+               filename, segments);
+        return;
+    }
+
+    if (pipe(report)) {
+        mp_msg(MSGT_MENCODER, MSGL_WARN, "Cannot create a pipe, encoding sequentially.\n");
+        return;
+    }
+    fflush(stdout);
+    for (n = 0; n < segments; n++) {
+        pid[n] = fork();
+        if (pid[n] < 0) {
+            mp_msg(MSGT_MENCODER, MSGL_ERR, "Cannot start encoding of segment %d.\n", n);
+            failed = 1;
+            break;
+        }
+        if (!pid[n]) {
+            char *log = malloc(strlen(passtmpfile) + 4);
+            sprintf(log, "%s.%02d", passtmpfile, n);
+            passtmpfile  = log;
+            out_filename = segment_filename(n);
+            seek_to_sec  = seek[n];
+            // the first segment also has the audio before the first frame
+            segment_start = n ? start[n] : MP_NOPTS_VALUE;
+            segment_end   = n + 1 < segments ? start[n + 1] : MP_NOPTS_VALUE;
+            segment_audio.n   = n;
+            segment_report_fd = report[1];
+            close(report[0]);
+            quiet = 1;
+            return;
+        }
+        if (n + 1 < segments)
+            mp_msg(MSGT_MENCODER, MSGL_INFO, "Segment %d: %.3fs - %.3fs\n", n, start[n], start[n + 1]);
+        else
+            mp_msg(MSGT_MENCODER, MSGL_INFO, "Segment %d: %.3fs - end\n", n, start[n]);
+    }
+    close(report[1]);
+    for (i = 0; i < n; i++) {
+        int status;
+        if (waitpid(pid[i], &status, 0) != pid[i] || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            mp_msg(MSGT_MENCODER, MSGL_ERR, "Encoding of segment %d failed.\n", i);
+            failed = 1;
+        }
+    }
+    if (failed)
+        mencoder_exit(1, NULL);
+    segment_audio_check(report[0]);
+    close(report[0]);
+
+    // join the parts, all options affecting decoding or encoding have
+    // already been applied by the children
+    segment_files = calloc(segments + 1, sizeof(*segment_files));
+    for (i = 0; i < segments; i++) {
+        segment_files[i].name = segment_filename(i);
+        segment_files[i].opts = calloc(1, sizeof(char *));
+    }
+    *filelist = segment_files;
+    out_video_codec   = VCODEC_COPY;
+    out_audio_codec   = ACODEC_COPY;
+    force_fps         = 0;
+    force_ofps        = 0;
+    force_fourcc      = NULL;
+    force_audiofmttag = -1;
+    playback_speed    = 1.0;
+    audio_delay       = 0;
+    audio_delay_fix   = 0;
+    keyframes_only    = 0;
+    edl_filename      = NULL;
+    demuxer_name      = NULL;
+    ts_prog           = 0;
+    audio_id = video_id = -1;
+    dvdsub_id = -2;
+}
+#endif
+
+
 int main(int argc,char* argv[]){
 
 stream_t* stream=NULL;
@@ -549,6 +867,8 @@ s_frame_data frame_data = { .start = NULL, .in_size = 0, .frame_time = 0., .alre
 uint32_t ptimer_start;
 uint32_t audiorate=0;
 uint32_t videorate=0;
+double demux_time=0;
+double audio_encode_time=0, audio_wait_time=0;
 uint32_t audiosamples=1;
 uint32_t videosamples=1;
 uint32_t skippedframes=0;
@@ -634,6 +954,11 @@ if (frameno_filename) {
   }
 }
 
+#ifndef __MINGW32__
+  if (segments > 1)
+    encode_segments(&filelist);
+#endif
+
   /* HACK, for some weird reason, push() has to be called twice,
      otherwise options are not saved correctly */
   m_config_push(mconfig);
@@ -679,6 +1004,11 @@ if(stream->type==STREAMTYPE_DVDNAV){
   if(stream_cache_size>0) stream_enable_cache(stream,stream_cache_size*1024,0,0);
 
   if(demuxer2) audio_id=-2; /* do NOT read audio packets... */
+  if(keyframes_only){
+    // one output frame per keyframe, the audio would not fit anyway
+    audio_id=-2;
+    skip_limit=0;
+  }
 
   demuxer=demux_open(stream,file_format,audio_id,video_id,dvdsub_id,filename);
   if(!demuxer){
@@ -815,6 +1145,13 @@ if(!ostream) {
   mp_msg(MSGT_MENCODER, MSGL_FATAL, MSGTR_CannotOpenOutputFile, out_filename);
   mencoder_exit(1,NULL);
 }
+#if HAVE_PTHREADS
+// let a separate thread do the file writes
+if (write_cache_size && stream_enable_write_cache(ostream, write_cache_size * 1024) < 0) {
+  mp_msg(MSGT_MENCODER, MSGL_FATAL, MSGTR_CannotOpenOutputFile, out_filename);
+  mencoder_exit(1,NULL);
+}
+#endif
 
 muxer=muxer_new_muxer(out_file_format,ostream);
 if(!muxer) {
@@ -1217,6 +1554,16 @@ if (edl_filename) {
 
 if (sh_audio && audio_delay != 0.) fixdelay(d_video, d_audio, mux_a, &frame_data, mux_v->codec==VCODEC_COPY);
 
+if (segment_report_fd >= 0 && sh_audio && aencoder)
+    segment_audio_init(sh_audio, d_audio);
+
+#if HAVE_PTHREADS
+if (sh_audio && aencoder &&
+    ae_thread_start(aencoder, audio_queue, (double)ao_data.samplerate * ao_data.channels *
+                                           (af_fmt2bits(ao_data.format) / 8)) < 0)
+    mp_msg(MSGT_MENCODER, MSGL_WARN, "Cannot start the audio encoding thread, encoding audio in the main thread.\n");
+#endif
+
 while(!at_eof){
 
     int blit_frame=0;
@@ -1283,6 +1630,13 @@ goto_redo_edl:
 
 
 if(sh_audio){
+#if HAVE_PTHREADS
+    // audio queued for the encoding thread counts as muxed
+    if (aencoder && aencoder->thread) {
+        mux_encoded_audio(aencoder, mux_a, v_muxer_time == 0);
+        a_muxer_time = adjusted_muxer_time(mux_a) + ae_thread_delay(aencoder);
+    }
+#endif
     // get audio:
     while(a_muxer_time-audio_preload<v_muxer_time){
         float tottime;
@@ -1301,6 +1655,25 @@ if(sh_audio){
 	// let's not output more audio than necessary
 	if (tottime <= 0) break;
 
+#if HAVE_PTHREADS
+	if (aencoder && aencoder->thread) {
+		// only decode here, the thread encodes
+		if (mux_a->h.dwSampleSize && aencoder->set_decoded_len) {
+			len = mux_a->h.dwSampleSize*(int)(mux_a->h.dwRate*tottime);
+			aencoder->set_decoded_len(aencoder, len);
+		} else
+			len = aencoder->decode_buffer_size;
+		len = dec_audio(sh_audio, aencoder->decode_buffer, len);
+		if (len > 0)
+			ae_thread_put(aencoder, aencoder->decode_buffer, len);
+		mux_encoded_audio(aencoder, mux_a, v_muxer_time == 0);
+		a_muxer_time = adjusted_muxer_time(mux_a) + ae_thread_delay(aencoder);
+		audiosamples++;
+		audiorate+= (GetTimerMS() - ptimer_start);
+		if (len <= 0) break; // EOF?
+		continue;
+	}
+#endif
 	if(aencoder)
 	{
 		if(mux_a->h.dwSampleSize) /* CBR */
@@ -1385,11 +1758,19 @@ if(sh_audio){
     // get video frame!
 
     if (!frame_data.already_read) {
+        unsigned int t = GetTimer();
         frame_data.in_size=video_read_frame(sh_video,&frame_data.frame_time,&frame_data.start,force_fps);
         sh_video->timer+=frame_data.frame_time;
+        demux_time += (GetTimer() - t) * 0.000001;
     }
     frame_data.frame_time /= playback_speed;
     if(frame_data.in_size<0){ at_eof=1; break; }
+    // the next segment starts here, only feed the decoder the frames it
+    // needs to return the delayed frames of this one
+    if (segment_tail < 0 && segment_end != MP_NOPTS_VALUE &&
+        sh_video->pts >= segment_end - sh_video->frametime / 2)
+        segment_tail = FFMAX(get_current_video_decoder_lag(sh_video), 0);
+    if (segment_tail >= 0 && !segment_tail--) { at_eof=1; break; }
     ++decoded_frameno;
 
     v_timer_corr-=frame_data.frame_time-(float)mux_v->h.dwScale/mux_v->h.dwRate;
@@ -1611,6 +1992,16 @@ if(sh_audio && !demuxer2){
 
 } // while(!at_eof)
 
+// at the end of the input the decoder still holds frames back
+if (!interrupted && frame_data.in_size < 0 && sh_video &&
+    mux_v->codec != VCODEC_COPY && mux_v->codec != VCODEC_FRAMENO) {
+    void *decoded_frame;
+    while ((decoded_frame = decode_video_drain(sh_video))) {
+        ++decoded_frameno;
+        filter_video(sh_video, decoded_frame, MP_NOPTS_VALUE);
+    }
+}
+
 if (!interrupted && filelist[++curfile].name != 0) {
 	if (sh_video && sh_video->vfilter) { // Before uniniting sh_video and the filter chain, break apart the VE.
  		vf_instance_t * ve; // this will be the filter right before the ve.
@@ -1632,7 +2023,6 @@ if (!interrupted && filelist[++curfile].name != 0) {
 }
 
 /* Emit the remaining frames in the video system */
-/*TODO emit frmaes delayed by decoder lag*/
 if(sh_video && sh_video->vfilter){
 	mp_msg(MSGT_MENCODER, MSGL_INFO, MSGTR_FlushingVideoFrames);
 	if (!((vf_instance_t *)sh_video->vfilter)->fmt.have_configured)
@@ -1642,10 +2032,28 @@ if(sh_video && sh_video->vfilter){
     	                                              VFCTRL_FLUSH_FRAMES, 0);
 }
 
+#if HAVE_PTHREADS
+if (aencoder && aencoder->thread) {
+    ae_thread_flush(aencoder);
+    mux_encoded_audio(aencoder, mux_a, 0);
+    ae_thread_stats(aencoder, &audio_encode_time, &audio_wait_time);
+    ae_thread_uninit(aencoder);
+}
+#endif
+
 if(aencoder)
     if(aencoder->fixup)
         aencoder->fixup(aencoder);
 
+#ifndef __MINGW32__
+if (segment_report_fd >= 0) {
+    if (segment_audio.start != MP_NOPTS_VALUE)
+        segment_audio.end = segment_audio.start + segment_audio_done / segment_audio_bps;
+    write(segment_report_fd, &segment_audio, sizeof(segment_audio));
+    close(segment_report_fd);
+}
+#endif
+
 /* flush muxer just in case, this is a no-op unless
  * we created a stream but never wrote frames to it... */
 muxer_flush(muxer);
@@ -1653,6 +2061,12 @@ if (muxer->cont_write_index) muxer_write_index(muxer);
 muxer_f_size=stream_tell(muxer->stream);
 stream_seek(muxer->stream,0);
 if (muxer->cont_write_header) muxer_write_header(muxer); // update header
+#if HAVE_PTHREADS
+if (muxer->stream->write_cache && !stream_write_cache_flush(muxer->stream)) {
+    mp_msg(MSGT_MENCODER,MSGL_FATAL,MSGTR_ErrorWritingFile, out_filename);
+    mencoder_exit(1, NULL);
+}
+#endif
 #if 0
 if(ferror(muxer_f) || fclose(muxer_f) != 0) {
     mp_msg(MSGT_MENCODER,MSGL_FATAL,MSGTR_ErrorWritingFile, out_filename);
@@ -1677,10 +2091,19 @@ if(sh_audio)
 mp_msg(MSGT_MENCODER, MSGL_INFO, MSGTR_AudioStreamResult,
     (float)(mux_a->size/mux_a->timer*8.0f/1000.0f), (int)(mux_a->size/mux_a->timer), (uint64_t)mux_a->size, (float)mux_a->timer);
 
+print_stage_times((GetTimerMS() - timer_start) * 0.001, demux_time,
+                  mux_v->codec == VCODEC_COPY ? 0 : video_time_usage,
+                  videorate * 0.001, audiorate * 0.001, audio_encode_time,
+                  audio_wait_time, muxer->stream);
+
 if(sh_audio){ uninit_audio(sh_audio);sh_audio=NULL; }
 if(sh_video){ uninit_video(sh_video);sh_video=NULL; }
 if(demuxer) free_demuxer(demuxer);
 if(stream) free_stream(stream); // kill cache thread
 
+if (segment_files)
+    for (i = 0; segment_files[i].name; i++)
+        unlink(segment_files[i].name);
+
 return interrupted;
 }
@@ -0,0 +1,298 @@
+/*
+ * SSE optimized dct36() working on two neighbouring subbands at once
+ *
+ * The four SIMD lanes hold the even and odd 9 point transforms of
+ * both subbands, so the NEW_DCT9 algorithm from dct36.c runs unchanged
+ * and in the same operation order on all of them.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* included from layer3.c, uses its static tables */
+
+#include "libavutil/mem.h"
+
+/*
+ * 0-7: COS6_2, cos9[0..2], cos18[0..2], COS6_1
+ * 8:   mask selecting the odd lanes
+ * 9-17: output scale, 1.0 for the even and tfcos36[v] for the odd lanes
+ */
+static real __attribute__((aligned(16))) dct36_sse_tab[18][4];
+
+static void init_dct36_sse(void)
+{
+    static const union { int i; float f; } ones = { -1 };
+    int i;
+    for (i = 0; i < 4; i++) {
+        int v;
+        dct36_sse_tab[0][i] = COS6_2;
+        dct36_sse_tab[1][i] = cos9[0];
+        dct36_sse_tab[2][i] = cos9[1];
+        dct36_sse_tab[3][i] = cos9[2];
+        dct36_sse_tab[4][i] = cos18[0];
+        dct36_sse_tab[5][i] = cos18[1];
+        dct36_sse_tab[6][i] = cos18[2];
+        dct36_sse_tab[7][i] = COS6_1;
+        dct36_sse_tab[8][i] = i < 2 ? 0 : ones.f;
+        for (v = 0; v < 9; v++)
+            dct36_sse_tab[9 + v][i] = i < 2 ? 1.0 : tfcos36[v];
+    }
+}
+
+/**
+ * \brief windowing and overlap for four outputs of one subband
+ * \param sd sum and difference of the even and odd transforms
+ * \param w, o1, o2, ts pointers to the first of the four outputs
+ */
+static inline void dct36_sse_out(const real *sd, const real *w,
+                                 const real *o1, real *o2, real *ts)
+{
+    __asm__ volatile(
+        "movaps    %4, %%xmm0              \n\t"
+        "movups    72(%0), %%xmm1          \n\t"
+        "mulps     %%xmm0, %%xmm1          \n\t"
+        "movups    %%xmm1, (%2)            \n\t"
+        "movaps    %5, %%xmm0              \n\t"
+        "movups    (%0), %%xmm1            \n\t"
+        "mulps     %%xmm0, %%xmm1          \n\t"
+        "movups    (%1), %%xmm2            \n\t"
+        "addps     %%xmm1, %%xmm2          \n\t"
+        "movss     %%xmm2, (%3)            \n\t"
+        "shufps    $0x39, %%xmm2, %%xmm2   \n\t"
+        "movss     %%xmm2, 128(%3)         \n\t"
+        "shufps    $0x39, %%xmm2, %%xmm2   \n\t"
+        "movss     %%xmm2, 256(%3)         \n\t"
+        "shufps    $0x39, %%xmm2, %%xmm2   \n\t"
+        "movss     %%xmm2, 384(%3)         \n\t"
+        :
+        :"r"(w), "r"(o1), "r"(o2), "r"(ts), "m"(sd[0]), "m"(sd[4])
+        :"memory" XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2")
+    );
+}
+
+/**
+ * \brief dct36() of inbuf[0..17] and inbuf[18..35]
+ *
+ * The second subband uses o1 + 18, o2 + 18, wintab1 and tsbuf + 1,
+ * exactly like the two dct36() calls in III_hybrid().
+ */
+static void dct36x2_sse(real *inbuf, real *o1, real *o2, real *wintab,
+                        real *wintab1, real *tsbuf)
+{
+    DECLARE_ALIGNED(16, real, x[9][4]);
+    DECLARE_ALIGNED(16, real, t[9][4]);
+    DECLARE_ALIGNED(16, real, sd[8][4]);
+    real *in = inbuf;
+    real *xp = x[0];
+    int i = 9;
+    int v0, sb;
+
+    /* Interleave {a[2k], b[2k], a[2k+1], b[2k+1]} and do the two
+     * running sums at the start of dct36(). */
+    __asm__ volatile(
+        "xorps     %%xmm6, %%xmm6          \n\t"
+        "xorps     %%xmm7, %%xmm7          \n\t"
+        "movaps    %3, %%xmm5              \n\t"
+        ASMALIGN(4)
+        "1:                                \n\t"
+        "movlps    (%1), %%xmm0            \n\t"
+        "movlps    72(%1), %%xmm1          \n\t"
+        "unpcklps  %%xmm1, %%xmm0          \n\t"
+        "movaps    %%xmm6, %%xmm2          \n\t"
+        "shufps    $0x4e, %%xmm0, %%xmm2   \n\t"
+        "movaps    %%xmm0, %%xmm6          \n\t"
+        "addps     %%xmm2, %%xmm0          \n\t"
+        "andps     %%xmm5, %%xmm7          \n\t"
+        "movaps    %%xmm0, %%xmm3          \n\t"
+        "addps     %%xmm7, %%xmm0          \n\t"
+        "movaps    %%xmm3, %%xmm7          \n\t"
+        "movaps    %%xmm0, (%0)            \n\t"
+        "add       $8, %1                  \n\t"
+        "add       $16, %0                 \n\t"
+        "decl      %2                      \n\t"
+        "jnz       1b                      \n\t"
+        :"+r"(xp), "+r"(in), "+r"(i)
+        :"m"(dct36_sse_tab[8][0])
+        :"memory" XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                               "%xmm5", "%xmm6", "%xmm7")
+    );
+
+    /* the 9 point transforms, see dct36.c for the scalar version */
+    __asm__ volatile(
+        "movaps    96(%0), %%xmm0          \n\t"
+        "mulps     (%2), %%xmm0            \n\t"
+        "movaps    64(%0), %%xmm1          \n\t"
+        "addps     128(%0), %%xmm1         \n\t"
+        "subps     32(%0), %%xmm1          \n\t"
+        "mulps     (%2), %%xmm1            \n\t"
+        "movaps    (%0), %%xmm2            \n\t"
+        "addps     %%xmm0, %%xmm2          \n\t"
+        "movaps    (%0), %%xmm3            \n\t"
+        "subps     %%xmm0, %%xmm3          \n\t"
+        "subps     %%xmm0, %%xmm3          \n\t"
+        "movaps    %%xmm3, %%xmm4          \n\t"
+        "subps     %%xmm1, %%xmm4          \n\t"
+        "movaps    32(%0), %%xmm5          \n\t"
+        "addps     64(%0), %%xmm5          \n\t"
+        "mulps     16(%2), %%xmm5          \n\t"
+        "movaps    64(%0), %%xmm0          \n\t"
+        "subps     128(%0), %%xmm0         \n\t"
+        "mulps     32(%2), %%xmm0          \n\t"
+        "addps     %%xmm1, %%xmm3          \n\t"
+        "addps     %%xmm1, %%xmm3          \n\t"
+        "mulps     208(%2), %%xmm3         \n\t"
+        "movaps    %%xmm3, 64(%1)          \n\t"
+        "movaps    32(%0), %%xmm1          \n\t"
+        "addps     128(%0), %%xmm1         \n\t"
+        "mulps     48(%2), %%xmm1          \n\t"
+        "movaps    %%xmm2, %%xmm3          \n\t"
+        "subps     %%xmm5, %%xmm3          \n\t"
+        "subps     %%xmm1, %%xmm3          \n\t"
+        "movaps    %%xmm2, %%xmm6          \n\t"
+        "addps     %%xmm0, %%xmm6          \n\t"
+        "addps     %%xmm6, %%xmm5          \n\t"
+        "subps     %%xmm0, %%xmm1          \n\t"
+        "addps     %%xmm1, %%xmm2          \n\t"
+
+        "movaps    16(%0), %%xmm0          \n\t"
+        "addps     80(%0), %%xmm0          \n\t"
+        "mulps     64(%2), %%xmm0          \n\t"
+        "movaps    80(%0), %%xmm1          \n\t"
+        "subps     112(%0), %%xmm1         \n\t"
+        "mulps     80(%2), %%xmm1          \n\t"
+        "movaps    48(%0), %%xmm6          \n\t"
+        "mulps     112(%2), %%xmm6         \n\t"
+        "movaps    %%xmm0, %%xmm7          \n\t"
+        "addps     %%xmm1, %%xmm7          \n\t"
+        "addps     %%xmm6, %%xmm7          \n\t"
+        "movaps    %%xmm7, (%1)            \n\t"
+        "addps     %%xmm5, %%xmm7          \n\t"
+        "subps     (%1), %%xmm5            \n\t"
+        "mulps     144(%2), %%xmm7         \n\t"
+        "mulps     272(%2), %%xmm5         \n\t"
+        "movaps    %%xmm7, (%1)            \n\t"
+        "movaps    %%xmm5, 128(%1)         \n\t"
+        "movaps    16(%0), %%xmm5          \n\t"
+        "addps     112(%0), %%xmm5         \n\t"
+        "mulps     96(%2), %%xmm5          \n\t"
+        "movaps    %%xmm5, %%xmm7          \n\t"
+        "subps     %%xmm6, %%xmm7          \n\t"
+        "addps     %%xmm7, %%xmm0          \n\t"
+        "movaps    %%xmm2, %%xmm7          \n\t"
+        "addps     %%xmm0, %%xmm7          \n\t"
+        "mulps     192(%2), %%xmm7         \n\t"
+        "movaps    %%xmm7, 48(%1)          \n\t"
+        "subps     %%xmm0, %%xmm2          \n\t"
+        "mulps     224(%2), %%xmm2         \n\t"
+        "movaps    %%xmm2, 80(%1)          \n\t"
+
+        "movaps    80(%0), %%xmm0          \n\t"
+        "addps     112(%0), %%xmm0         \n\t"
+        "subps     16(%0), %%xmm0          \n\t"
+        "mulps     112(%2), %%xmm0         \n\t"
+        "addps     %%xmm6, %%xmm5          \n\t"
+        "subps     %%xmm5, %%xmm1          \n\t"
+        "movaps    %%xmm4, %%xmm2          \n\t"
+        "subps     %%xmm0, %%xmm2          \n\t"
+        "mulps     160(%2), %%xmm2         \n\t"
+        "movaps    %%xmm2, 16(%1)          \n\t"
+        "addps     %%xmm0, %%xmm4          \n\t"
+        "mulps     256(%2), %%xmm4         \n\t"
+        "movaps    %%xmm4, 112(%1)         \n\t"
+        "movaps    %%xmm3, %%xmm2          \n\t"
+        "addps     %%xmm1, %%xmm2          \n\t"
+        "mulps     176(%2), %%xmm2         \n\t"
+        "movaps    %%xmm2, 32(%1)          \n\t"
+        "subps     %%xmm1, %%xmm3          \n\t"
+        "mulps     240(%2), %%xmm3         \n\t"
+        "movaps    %%xmm3, 96(%1)          \n\t"
+        :
+        :"r"(x), "r"(t), "r"(dct36_sse_tab)
+        :"memory" XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                               "%xmm4", "%xmm5", "%xmm6", "%xmm7")
+    );
+
+    for (v0 = 0; v0 < 8; v0 += 4) {
+        /* transpose four outputs of each transform into one register and
+         * form the sum and difference of the even and odd transforms */
+        __asm__ volatile(
+            "movaps    (%0), %%xmm0            \n\t"
+            "movaps    16(%0), %%xmm1          \n\t"
+            "movaps    32(%0), %%xmm2          \n\t"
+            "movaps    48(%0), %%xmm3          \n\t"
+            "movaps    %%xmm0, %%xmm4          \n\t"
+            "unpcklps  %%xmm1, %%xmm0          \n\t"
+            "unpckhps  %%xmm1, %%xmm4          \n\t"
+            "movaps    %%xmm2, %%xmm5          \n\t"
+            "unpcklps  %%xmm3, %%xmm2          \n\t"
+            "unpckhps  %%xmm3, %%xmm5          \n\t"
+            "movaps    %%xmm0, %%xmm1          \n\t"
+            "movlhps   %%xmm2, %%xmm0          \n\t"
+            "movhlps   %%xmm1, %%xmm2          \n\t"
+            "movaps    %%xmm4, %%xmm3          \n\t"
+            "movlhps   %%xmm5, %%xmm4          \n\t"
+            "movhlps   %%xmm3, %%xmm5          \n\t"
+            "movaps    %%xmm0, %%xmm1          \n\t"
+            "addps     %%xmm4, %%xmm1          \n\t"
+            "subps     %%xmm4, %%xmm0          \n\t"
+            "movaps    %%xmm2, %%xmm3          \n\t"
+            "addps     %%xmm5, %%xmm3          \n\t"
+            "subps     %%xmm5, %%xmm2          \n\t"
+            "movaps    %%xmm1, (%1)            \n\t"
+            "movaps    %%xmm0, 16(%1)          \n\t"
+            "movaps    %%xmm3, 64(%1)          \n\t"
+            "movaps    %%xmm2, 80(%1)          \n\t"
+            "shufps    $0x1b, %%xmm1, %%xmm1   \n\t"
+            "shufps    $0x1b, %%xmm0, %%xmm0   \n\t"
+            "shufps    $0x1b, %%xmm3, %%xmm3   \n\t"
+            "shufps    $0x1b, %%xmm2, %%xmm2   \n\t"
+            "movaps    %%xmm1, 32(%1)          \n\t"
+            "movaps    %%xmm0, 48(%1)          \n\t"
+            "movaps    %%xmm3, 96(%1)          \n\t"
+            "movaps    %%xmm2, 112(%1)         \n\t"
+            :
+            :"r"(t[v0]), "r"(sd)
+            :"memory" XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                                   "%xmm4", "%xmm5")
+        );
+        /* outputs 9 + v and, in reverse order, 8 - v */
+        dct36_sse_out(sd[0], wintab + 9 + v0, o1 + 9 + v0, o2 + 9 + v0,
+                      tsbuf + SBLIMIT * (9 + v0));
+        dct36_sse_out(sd[2], wintab + 5 - v0, o1 + 5 - v0, o2 + 5 - v0,
+                      tsbuf + SBLIMIT * (5 - v0));
+        dct36_sse_out(sd[4], wintab1 + 9 + v0, o1 + 27 + v0, o2 + 27 + v0,
+                      tsbuf + 1 + SBLIMIT * (9 + v0));
+        dct36_sse_out(sd[6], wintab1 + 5 - v0, o1 + 23 - v0, o2 + 23 - v0,
+                      tsbuf + 1 + SBLIMIT * (5 - v0));
+    }
+
+    /* last output pair, MACRO(8) of dct36.c */
+    for (sb = 0; sb < 2; sb++) {
+        real *out1 = o1 + 18 * sb;
+        real *out2 = o2 + 18 * sb;
+        real *w    = sb ? wintab1 : wintab;
+        real *ts   = tsbuf + sb;
+        real sum0  = t[8][sb];
+        real sum1  = t[8][sb + 2];
+        real tmpval;
+        out2[17] = (tmpval = sum0 + sum1) * w[35];
+        out2[0]  = tmpval * w[18];
+        sum0 -= sum1;
+        ts[0]           = out1[0]  + sum0 * w[0];
+        ts[SBLIMIT * 17] = out1[17] + sum0 * w[17];
+    }
+}
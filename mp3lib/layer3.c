@@ -1131,6 +1131,76 @@ maybe still wrong??? (copy 12 to 13?) */
       } /* ... */
 }
 
+typedef void (*antialias_func_t)(real *xr1, int sblim);
+
+/* 8 butterflies between each pair of the sblim+1 lowest subbands,
+ * xr1 points to the second subband */
+static void antialias_c(real *xr1, int sblim) {
+   int sb;
+
+   for(sb=sblim;sb;sb--,xr1+=10) {
+     int ss;
+     real *cs=aa_cs,*ca=aa_ca;
+     real *xr2 = xr1;
+
+     for(ss=7;ss>=0;ss--) {    /* upper and lower butterfly inputs */
+       register real bu = *--xr2,bd = *xr1;
+       *xr2   = (bu * (*cs)   ) - (bd * (*ca)   );
+       *xr1++ = (bd * (*cs++) ) + (bu * (*ca++) );
+     }
+   }
+}
+
+#if HAVE_SSE
+/* 8 butterflies on xr1[-8..-1] and xr1[0..7], same operation order
+ * as antialias_c() */
+static void antialias_sse(real *xr1, int sblim) {
+   int sb;
+
+   for(sb=sblim;sb;sb--,xr1+=18)
+     __asm__ volatile(
+       "movups   (%0), %%xmm0            \n\t"
+       "movups   -16(%0), %%xmm1         \n\t"
+       "shufps   $0x1b, %%xmm1, %%xmm1   \n\t"
+       "movups   (%1), %%xmm2            \n\t"
+       "movups   (%2), %%xmm3            \n\t"
+       "movaps   %%xmm1, %%xmm4          \n\t"
+       "mulps    %%xmm2, %%xmm4          \n\t"
+       "movaps   %%xmm0, %%xmm5          \n\t"
+       "mulps    %%xmm3, %%xmm5          \n\t"
+       "subps    %%xmm5, %%xmm4          \n\t"
+       "mulps    %%xmm2, %%xmm0          \n\t"
+       "mulps    %%xmm3, %%xmm1          \n\t"
+       "addps    %%xmm1, %%xmm0          \n\t"
+       "shufps   $0x1b, %%xmm4, %%xmm4   \n\t"
+       "movups   %%xmm0, (%0)            \n\t"
+       "movups   %%xmm4, -16(%0)         \n\t"
+       "movups   16(%0), %%xmm0          \n\t"
+       "movups   -32(%0), %%xmm1         \n\t"
+       "shufps   $0x1b, %%xmm1, %%xmm1   \n\t"
+       "movups   16(%1), %%xmm2          \n\t"
+       "movups   16(%2), %%xmm3          \n\t"
+       "movaps   %%xmm1, %%xmm4          \n\t"
+       "mulps    %%xmm2, %%xmm4          \n\t"
+       "movaps   %%xmm0, %%xmm5          \n\t"
+       "mulps    %%xmm3, %%xmm5          \n\t"
+       "subps    %%xmm5, %%xmm4          \n\t"
+       "mulps    %%xmm2, %%xmm0          \n\t"
+       "mulps    %%xmm3, %%xmm1          \n\t"
+       "addps    %%xmm1, %%xmm0          \n\t"
+       "shufps   $0x1b, %%xmm4, %%xmm4   \n\t"
+       "movups   %%xmm0, 16(%0)          \n\t"
+       "movups   %%xmm4, -32(%0)         \n\t"
+       :
+       :"r"(xr1), "r"(aa_cs), "r"(aa_ca)
+       :"memory" XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                              "%xmm4", "%xmm5")
+     );
+}
+#endif
+
+static antialias_func_t antialias_func;
+
 static void III_antialias(real xr[SBLIMIT][SSLIMIT],struct gr_info_s *gr_info) {
    int sblim;
 
@@ -1145,29 +1215,15 @@ static void III_antialias(real xr[SBLIMIT][SSLIMIT],struct gr_info_s *gr_info) {
 
    /* 31 alias-reduction operations between each pair of sub-bands */
    /* with 8 butterflies between each pair                         */
-
-   {
-     int sb;
-     real *xr1=(real *) xr[1];
-
-     for(sb=sblim;sb;sb--,xr1+=10) {
-       int ss;
-       real *cs=aa_cs,*ca=aa_ca;
-       real *xr2 = xr1;
-
-       for(ss=7;ss>=0;ss--) {    /* upper and lower butterfly inputs */
-         register real bu = *--xr2,bd = *xr1;
-         *xr2   = (bu * (*cs)   ) - (bd * (*ca)   );
-         *xr1++ = (bd * (*cs++) ) + (bu * (*ca++) );
-       }
-     }
-
-  }
+   (*antialias_func)((real *) xr[1],sblim);
 }
 
 #include "dct64.c"
 #include "dct36.c"
 #include "dct12.c"
+#if HAVE_SSE
+#include "dct36_sse.c"
+#endif
 
 #include "decod386.c"
 
@@ -1177,6 +1233,18 @@ static void III_antialias(real xr[SBLIMIT][SSLIMIT],struct gr_info_s *gr_info) {
 
 static dct36_func_t dct36_func;
 
+typedef void (*dct36x2_func_t)(real *, real *, real *, real *, real *, real *);
+
+/* dct36() of two neighbouring subbands */
+static void dct36x2(real *inbuf, real *o1, real *o2, real *wintab,
+                    real *wintab1, real *tsbuf)
+{
+  (*dct36_func)(inbuf,o1,o2,wintab,tsbuf);
+  (*dct36_func)(inbuf+18,o1+18,o2+18,wintab1,tsbuf+1);
+}
+
+static dct36x2_func_t dct36x2_func;
+
 static void III_hybrid(real fsIn[SBLIMIT][SSLIMIT],real tsOut[SSLIMIT][SBLIMIT],
    int ch,struct gr_info_s *gr_info)
 {
@@ -1197,8 +1265,7 @@ static void III_hybrid(real fsIn[SBLIMIT][SSLIMIT],real tsOut[SSLIMIT][SBLIMIT],
 
    if(gr_info->mixed_block_flag) {
      sb = 2;
-     (*dct36_func)(fsIn[0],rawout1,rawout2,win[0],tspnt);
-     (*dct36_func)(fsIn[1],rawout1+18,rawout2+18,win1[0],tspnt+1);
+     (*dct36x2_func)(fsIn[0],rawout1,rawout2,win[0],win1[0],tspnt);
      rawout1 += 36; rawout2 += 36; tspnt += 2;
    }
 
@@ -1211,8 +1278,7 @@ static void III_hybrid(real fsIn[SBLIMIT][SSLIMIT],real tsOut[SSLIMIT][SBLIMIT],
    }
    else {
      for (; sb<gr_info->maxb; sb+=2,tspnt+=2,rawout1+=36,rawout2+=36) {
-       (*dct36_func)(fsIn[sb],rawout1,rawout2,win[bt],tspnt);
-       (*dct36_func)(fsIn[sb+1],rawout1+18,rawout2+18,win1[bt],tspnt+1);
+       (*dct36x2_func)(fsIn[sb],rawout1,rawout2,win[bt],win1[bt],tspnt);
      }
    }
 
@@ -127,7 +127,6 @@ int synth_1to1_MMX_s(real *, int, short *, short *, int *);
 
 void dct36_3dnow(real *, real *, real *, real *, real *);
 void dct36_3dnowex(real *, real *, real *, real *, real *);
-void dct36_sse(real *, real *, real *, real *, real *);
 
 void dct64_MMX(short *, short *, real *);
 void dct64_MMX_3dnow(short *, short *, real *);
@@ -401,6 +401,8 @@ void MP3_Init(void){
 
     _has_mmx = 0;
     dct36_func = dct36;
+    dct36x2_func = dct36x2;
+    antialias_func = antialias_c;
 
     make_decode_tables(outscale);
 
@@ -412,6 +414,12 @@ void MP3_Init(void){
     }
 #endif
 
+#if HAVE_SSE
+    // whichever dct36() is picked below
+    if (gCpuCaps.hasSSE)
+        antialias_func = antialias_sse;
+#endif
+
 #if HAVE_AMD3DNOWEXT
     if (gCpuCaps.has3DNowExt)
     {
@@ -434,6 +442,7 @@ void MP3_Init(void){
     if (gCpuCaps.hasSSE)
     {
         dct64_MMX_func = dct64_sse;
+        dct36x2_func = dct36x2_sse;
         mp_msg(MSGT_DECAUDIO,MSGL_V,"mp3lib: using SSE optimized decore!\n");
     }
     else
@@ -482,6 +491,10 @@ void MP3_Init(void){
 
     init_layer2();
     init_layer3(fr.down_sample_sblimit);
+#if HAVE_SSE
+    if (dct36x2_func == dct36x2_sse)
+        init_dct36_sse();
+#endif
     mp_msg(MSGT_DECAUDIO,MSGL_V,"MP3lib: init layer2&3 finished, tables done\n");
 }
 
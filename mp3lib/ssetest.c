@@ -0,0 +1,180 @@
+/*
+ * check the mp3lib SSE layer3 code against the C versions
+ *
+ * dct36x2_sse() and antialias_sse() have to be bit-identical to dct36()
+ * and antialias_c(), so both are fed the same random spectra with every
+ * window type and subband count the decoder uses, then timed against
+ * the C versions.  The decoder itself is included to get at its static
+ * functions and tables, MP3_Init() sets them up as for playback.
+ *
+ * Whole files are checked with the decoder:
+ *   mplayer -ac mp3 -benchmark -ao pcm:fast:md5:file=/dev/null <file>
+ * must print the same md5 with and without SSE.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <sys/time.h>
+
+#include "sr1.c"
+
+#define RUNS       2000
+#define BENCH_RUNS 200000
+
+int mplayer_audio_read(char *buf, int size)
+{
+    return 0;
+}
+
+#if HAVE_SSE
+static real in[SBLIMIT][SSLIMIT];
+static real in_c[SBLIMIT][SSLIMIT], in_s[SBLIMIT][SSLIMIT];
+static real o1_c[36], o1_s[36], o2_c[36], o2_s[36];
+static real ts_c[SSLIMIT * SBLIMIT], ts_s[SSLIMIT * SBLIMIT];
+
+static unsigned int GetTimer(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/// spectral values as dequantized by layer3, some of them zero
+static void fill(void)
+{
+    int i, j;
+    for (i = 0; i < SBLIMIT; i++)
+        for (j = 0; j < SSLIMIT; j++)
+            in[i][j] = rand() % 4 ? (rand() - RAND_MAX / 2) * (32768.0 / RAND_MAX) : 0;
+}
+
+static void dct36x2_c(real *inbuf, real *o1, real *o2, real *wintab,
+                      real *wintab1, real *tsbuf)
+{
+    dct36(inbuf, o1, o2, wintab, tsbuf);
+    dct36(inbuf + 18, o1 + 18, o2 + 18, wintab1, tsbuf + 1);
+}
+
+static int compare(const char *name, const real *c, const real *s, int n,
+                   int run)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        if (memcmp(&c[i], &s[i], sizeof(real))) {
+            printf("%s: run %d differs at %d: %.9g instead of %.9g\n",
+                   name, run, i, s[i], c[i]);
+            return 1;
+        }
+    return 0;
+}
+
+static int test_dct36(void)
+{
+    int run, fail = 0;
+    unsigned int t, c_time, sse_time;
+
+    for (run = 0; run < RUNS && !fail; run++) {
+        // block types 0, 1 and 3, short blocks go through dct12()
+        int bt = (run % 3) + (run % 3 == 2);
+        int i;
+        fill();
+        memcpy(in_c, in, sizeof(in));
+        memcpy(in_s, in, sizeof(in));
+        for (i = 0; i < 36; i++)
+            o2_c[i] = o2_s[i] = in[SBLIMIT - 1][i % SSLIMIT];
+        memset(ts_c, 0, sizeof(ts_c));
+        memset(ts_s, 0, sizeof(ts_s));
+        dct36x2_c(in_c[0], o1_c, o2_c, win[bt], win1[bt], ts_c);
+        dct36x2_sse(in_s[0], o1_s, o2_s, win[bt], win1[bt], ts_s);
+        fail = compare("dct36 out1", o1_c, o1_s, 36, run) ||
+               compare("dct36 out2", o2_c, o2_s, 36, run) ||
+               compare("dct36 ts", ts_c, ts_s, SSLIMIT * SBLIMIT, run);
+    }
+
+    fill();
+    t = GetTimer();
+    for (run = 0; run < BENCH_RUNS; run++) {
+        memcpy(in_c[0], in[0], 36 * sizeof(real));
+        dct36x2_c(in_c[0], o1_c, o2_c, win[0], win1[0], ts_c);
+    }
+    c_time = GetTimer() - t;
+    t = GetTimer();
+    for (run = 0; run < BENCH_RUNS; run++) {
+        memcpy(in_s[0], in[0], 36 * sizeof(real));
+        dct36x2_sse(in_s[0], o1_s, o2_s, win[0], win1[0], ts_s);
+    }
+    sse_time = GetTimer() - t;
+    printf("dct36x2: %s, %.1f ns per call, %.1f ns in C\n",
+           fail ? "FAILED" : "ok", sse_time * 1000.0 / BENCH_RUNS,
+           c_time * 1000.0 / BENCH_RUNS);
+    return fail;
+}
+
+static int test_antialias(void)
+{
+    int run, fail = 0;
+    unsigned int t, c_time, sse_time;
+
+    for (run = 0; run < RUNS && !fail; run++) {
+        // mixed blocks reduce one pair only, long blocks up to all 31
+        int sblim = run < SBLIMIT ? run : rand() % SBLIMIT;
+        fill();
+        memcpy(in_c, in, sizeof(in));
+        memcpy(in_s, in, sizeof(in));
+        antialias_c(in_c[1], sblim);
+        antialias_sse(in_s[1], sblim);
+        fail = compare("antialias", in_c[0], in_s[0], SBLIMIT * SSLIMIT, run);
+    }
+
+    fill();
+    memcpy(in_c, in, sizeof(in));
+    t = GetTimer();
+    for (run = 0; run < BENCH_RUNS / 10; run++)
+        antialias_c(in_c[1], SBLIMIT - 1);
+    c_time = GetTimer() - t;
+    t = GetTimer();
+    for (run = 0; run < BENCH_RUNS / 10; run++)
+        antialias_sse(in_c[1], SBLIMIT - 1);
+    sse_time = GetTimer() - t;
+    printf("antialias: %s, %.1f ns per granule, %.1f ns in C\n",
+           fail ? "FAILED" : "ok", sse_time * 10000.0 / BENCH_RUNS,
+           c_time * 10000.0 / BENCH_RUNS);
+    return fail;
+}
+#endif
+
+int main(void)
+{
+    int fail = 0;
+
+    GetCpuCaps(&gCpuCaps);
+    srand(1);
+#ifdef CONFIG_FAKE_MONO
+    MP3_Init(0);
+#else
+    MP3_Init();
+#endif
+#if HAVE_SSE
+    if (gCpuCaps.hasSSE) {
+        init_dct36_sse();
+        fail |= test_dct36();
+        fail |= test_antialias();
+    } else
+#endif
+        printf("no SSE, nothing to check\n");
+    return fail;
+}
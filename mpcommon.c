@@ -457,6 +457,8 @@ static void sanitize_os(void)
  */
 int common_init(void)
 {
+    char *cache_path;
+
 #if (defined(__MINGW32__) || defined(__CYGWIN__)) && defined(CONFIG_WIN32DLL)
     set_path_env();
 #endif
@@ -470,12 +472,14 @@ int common_init(void)
         set_codec_path(codec_path);
 
     /* Check codecs.conf. */
-    if (!codecs_file || !parse_codec_cfg(codecs_file)) {
+    cache_path = get_path("codecs.cache");
+    if (!codecs_file || !parse_codec_cfg_cached(codecs_file, cache_path)) {
         char *conf_path = get_path("codecs.conf");
-        if (!parse_codec_cfg(conf_path)) {
-            if (!parse_codec_cfg(MPLAYER_CONFDIR "/codecs.conf")) {
+        if (!parse_codec_cfg_cached(conf_path, cache_path)) {
+            if (!parse_codec_cfg_cached(MPLAYER_CONFDIR "/codecs.conf", cache_path)) {
                 if (!parse_codec_cfg(NULL)) {
                     free(conf_path);
+                    free(cache_path);
                     return 0;
                 }
                 mp_msg(MSGT_CPLAYER,MSGL_V,MSGTR_BuiltinCodecsConf);
@@ -483,6 +487,7 @@ int common_init(void)
         }
         free(conf_path);
     }
+    free(cache_path);
 
     // check font
 #ifdef CONFIG_FREETYPE
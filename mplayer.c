@@ -127,6 +127,7 @@
 #include "osdep/timer.h"
 
 #include "udp_sync.h"
+#include "binary_slave.h"
 
 #ifdef CONFIG_X11
 #include "libvo/x11_common.h"
@@ -711,6 +712,7 @@ void exit_player_with_rc(enum exit_reason how, int rc)
 #ifdef CONFIG_NETWORKING
     if (udp_master)
         send_udp(udp_ip, udp_port, "bye");
+    binary_slave_uninit();
 #endif /* CONFIG_NETWORKING */
 
     if (mpctx->user_muted && !mpctx->edl_muted)
@@ -834,6 +836,7 @@ static void exit_sighandler(int x)
         case SIGTERM:
         case SIGKILL:
             async_quit_request = 1;
+            mp_input_wakeup();
             return; // killed from keyboard (^C) or killed [-9]
         case SIGILL:
 #if CONFIG_RUNTIME_CPUDETECT
@@ -1789,7 +1792,6 @@ static int generate_video_frame(sh_video_t *sh_video, demux_stream_t *d_video)
 {
     unsigned char *start;
     int in_size;
-    int hit_eof = 0;
     double pts;
 
     while (1) {
@@ -1802,16 +1804,17 @@ static int generate_video_frame(sh_video_t *sh_video, demux_stream_t *d_video)
             break;
         current_module = "video_read_frame";
         in_size = ds_get_packet_pts(d_video, &start, &pts);
+        current_module = "decode video";
         if (in_size < 0) {
-            // try to extract last frames in case of decoder lag
-            in_size = 0;
-            pts     = MP_NOPTS_VALUE;
-            hit_eof = 1;
+            // extract the last frames in case of decoder lag, one at a time
+            decoded_frame = decode_video_drain(sh_video);
+            if (!decoded_frame)
+                return 0;
+        } else {
+            if (in_size > max_framesize)
+                max_framesize = in_size;
+            decoded_frame = decode_video(sh_video, start, in_size, drop_frame, pts, NULL);
         }
-        if (in_size > max_framesize)
-            max_framesize = in_size;
-        current_module = "decode video";
-        decoded_frame  = decode_video(sh_video, start, in_size, drop_frame, pts, NULL);
         if (decoded_frame) {
             update_subtitles(sh_video, sh_video->pts, mpctx->d_sub, 0);
             update_teletext(sh_video, mpctx->demuxer, 0);
@@ -1821,8 +1824,6 @@ static int generate_video_frame(sh_video_t *sh_video, demux_stream_t *d_video)
                 break;
         } else if (drop_frame)
             return -1;
-        if (hit_eof)
-            return 0;
     }
     return 1;
 }
@@ -2418,32 +2419,39 @@ static double update_video(int *blit_frame)
             frame_time     = sh_video->next_frame_time;
             in_size = video_read_frame(sh_video, &sh_video->next_frame_time,
                                        &start, force_fps);
-#ifdef CONFIG_DVDNAV
-            // wait, still frame or EOF
-            if (mpctx->stream->type == STREAMTYPE_DVDNAV && in_size < 0) {
-                if (mp_dvdnav_is_eof(mpctx->stream))
+            if (in_size < 0 && mpctx->stream->type != STREAMTYPE_DVDNAV) {
+                // the frames held back by the decoder come last
+                current_module = "decode_video";
+                decoded_frame  = decode_video_drain(sh_video);
+                if (!decoded_frame)
                     return -1;
-                if (mpctx->d_video)
-                    mpctx->d_video->eof = 0;
-                if (mpctx->d_audio)
-                    mpctx->d_audio->eof = 0;
-                mpctx->stream->eof = 0;
-            } else
+                full_frame = 1;
+            } else {
+#ifdef CONFIG_DVDNAV
+                // wait, still frame or EOF
+                if (in_size < 0) {
+                    if (mp_dvdnav_is_eof(mpctx->stream))
+                        return -1;
+                    if (mpctx->d_video)
+                        mpctx->d_video->eof = 0;
+                    if (mpctx->d_audio)
+                        mpctx->d_audio->eof = 0;
+                    mpctx->stream->eof = 0;
+                }
 #endif
-            if (in_size < 0)
-                return -1;
-            if (in_size > max_framesize)
-                max_framesize = in_size;  // stats
-            drop_frame     = check_framedrop(frame_time);
-            current_module = "decode_video";
+                if (in_size > max_framesize)
+                    max_framesize = in_size;  // stats
+                drop_frame     = check_framedrop(frame_time);
+                current_module = "decode_video";
 #ifdef CONFIG_DVDNAV
-            full_frame    = 1;
-            decoded_frame = mp_dvdnav_restore_smpi(&in_size, &start, decoded_frame);
-            // still frame has been reached, no need to decode
-            if (in_size > 0 && !decoded_frame)
+                full_frame    = 1;
+                decoded_frame = mp_dvdnav_restore_smpi(&in_size, &start, decoded_frame);
+                // still frame has been reached, no need to decode
+                if (in_size > 0 && !decoded_frame)
 #endif
-            decoded_frame = decode_video(sh_video, start, in_size, drop_frame,
-                                         sh_video->pts, &full_frame);
+                decoded_frame = decode_video(sh_video, start, in_size, drop_frame,
+                                             sh_video->pts, &full_frame);
+            }
 
             if (full_frame) {
                 sh_video->timer += frame_time;
@@ -2583,7 +2591,9 @@ static void pause_loop(void)
 #endif
         if (mpctx->sh_video)
             handle_udp_master(mpctx->sh_video->pts);
-        usec_sleep(20000);
+#ifdef CONFIG_NETWORKING
+        binary_slave_update(mpctx);
+#endif /* CONFIG_NETWORKING */
     }
     if (cmd && cmd->id == MP_CMD_PAUSE) {
         cmd = mp_input_get_cmd(0, 1, 0);
@@ -2898,6 +2908,7 @@ int main(int argc, char *argv[])
         printf("\n");
         opt_exit = 1;
     }
+    af_cfg.benchmark = benchmark;
 #ifdef CONFIG_X11
     if (vo_fstype_list && strcmp(vo_fstype_list[0], "help") == 0) {
         fstype_help();
@@ -3129,10 +3140,12 @@ play_next_file:
         mp_cmd_t *cmd;
         if (mpctx->video_out && vo_config_count)
             mpctx->video_out->control(VOCTRL_PAUSE, NULL);
-        while (!(cmd = mp_input_get_cmd(0, 1, 0))) { // wait for command
+        while (!(cmd = mp_input_get_cmd(20, 1, 0))) { // wait for command
             if (mpctx->video_out && vo_config_count)
                 mpctx->video_out->check_events();
-            usec_sleep(20000);
+#ifdef CONFIG_NETWORKING
+            binary_slave_update(mpctx);
+#endif /* CONFIG_NETWORKING */
         }
         switch (cmd->id) {
         case MP_CMD_LOADFILE:
@@ -3351,6 +3364,9 @@ goto_enable_cache:
 //============ Open DEMUXERS --- DETECT file type =======================
     current_module = "demux_open";
 
+    // keyframes only playback has no use for the audio
+    if (keyframes_only)
+        audio_id = -2;
     mpctx->demuxer = demux_open(mpctx->stream, mpctx->file_format, audio_id, video_id, dvdsub_id, filename);
 
     // HACK to get MOV Reference Files working
@@ -3942,6 +3958,9 @@ goto_enable_cache:
             {
                 mp_cmd_t *cmd;
                 int brk_cmd = 0;
+#ifdef CONFIG_NETWORKING
+                binary_slave_update(mpctx);
+#endif /* CONFIG_NETWORKING */
                 while (!brk_cmd && (cmd = mp_input_get_cmd(0, 0, 0)) != NULL) {
                     brk_cmd = run_command(mpctx, cmd);
                     if (cmd->id == MP_CMD_EDL_LOADFILE) {
@@ -94,6 +94,9 @@ typedef struct {
   volatile off_t control_new_pos;
   volatile double stream_time_length;
   volatile double stream_time_pos;
+  // reconnect statistics of the stream read by the cache process/thread
+  volatile int reconnects, reconnect_retries;
+  volatile double reconnect_time;
 } cache_vars_t;
 
 static int min_fill=0;
@@ -245,6 +248,9 @@ static int cache_fill(cache_vars_t *s)
   } else
   len = stream_read_internal(s->stream, &s->buffer[pos], space);
   s->eof= !len;
+  s->reconnects        = s->stream->reconnects;
+  s->reconnect_retries = s->stream->reconnect_retries;
+  s->reconnect_time    = s->stream->reconnect_time;
 
   s->max_filepos+=len;
   if(pos+len>=s->buffer_size){
@@ -351,9 +357,14 @@ static cache_vars_t* cache_init(int size,int sector){
 
 void cache_uninit(stream_t *s) {
   cache_vars_t* c = s->cache_data;
+#if !FORKED_CACHE
+  int stopped = 1;
+#endif
   if(s->cache_pid) {
 #if !FORKED_CACHE
     cache_do_control(s, -2, NULL);
+    // interrupted, the thread may still use its stream
+    stopped = c->control == -1;
 #else
     kill(s->cache_pid,SIGKILL);
     waitpid(s->cache_pid,NULL,0);
@@ -361,6 +372,12 @@ void cache_uninit(stream_t *s) {
     s->cache_pid = 0;
   }
   if(!c) return;
+#if !FORKED_CACHE
+  if (stopped && c->stream && c->stream != s) {
+    free(c->stream->buffer);
+    free(c->stream);
+  }
+#endif
   shared_free(c->buffer, c->buffer_size);
   c->buffer = NULL;
   c->stream = NULL;
@@ -451,7 +468,15 @@ int stream_enable_cache(stream_t *stream,int size,int min,int seek_limit){
 #else
   {
     stream_t* stream2=malloc(sizeof(stream_t));
+    if (!stream2)
+      goto err_out;
     memcpy(stream2,s->stream,sizeof(stream_t));
+    // the thread reads into the buffer for wrap-arounds
+    stream2->buffer=malloc(stream2->buffer_size);
+    if (!stream2->buffer) {
+      free(stream2);
+      goto err_out;
+    }
     s->stream=stream2;
 #if defined(__MINGW32__)
     stream->cache_pid = _beginthread( ThreadProc, 0, s );
@@ -527,6 +552,9 @@ int cache_stream_fill_buffer(stream_t *s){
   }
 
   len=cache_read(s->cache_data,s->buffer, sector_size);
+  s->reconnects        = ((cache_vars_t*)s->cache_data)->reconnects;
+  s->reconnect_retries = ((cache_vars_t*)s->cache_data)->reconnect_retries;
+  s->reconnect_time    = ((cache_vars_t*)s->cache_data)->reconnect_time;
   //printf("cache_stream_fill_buffer->read -> %d\n",len);
 
   if(len<=0){ s->eof=1; s->buf_pos=s->buf_len=0; return 0; }
@@ -294,6 +294,66 @@ static int nop_streaming_start( stream_t *stream ) {
 	return 0;
 }
 
+/**
+ * \brief open a new connection to a stream that cannot seek
+ *
+ * Live streams just continue with whatever the server sends now, the
+ * metadata interval of shoutcast streams starts over with the new response.
+ */
+static int http_reconnect_live( stream_t *stream ) {
+	streaming_ctrl_t *ctrl = stream->streaming_ctrl;
+	HTTP_header_t *http_hdr;
+	int fd;
+
+	if( stream->fd>=0 ) closesocket( stream->fd );
+	stream->fd = -1;
+	free( ctrl->buffer );
+	ctrl->buffer = NULL;
+	ctrl->buffer_size = ctrl->buffer_pos = 0;
+
+	fd = http_send_request( ctrl->url, 0 );
+	if( fd<0 ) return STREAM_ERROR;
+	http_hdr = http_read_response( fd );
+	if( http_hdr==NULL || http_hdr->status_code!=200 ) {
+		if( http_hdr )
+			mp_msg(MSGT_NETWORK,MSGL_V,"Reconnect answered with %d %s\n", http_hdr->status_code, http_hdr->reason_phrase );
+		http_free( http_hdr );
+		closesocket( fd );
+		return STREAM_ERROR;
+	}
+	if( ctrl->streaming_read==scast_streaming_read ) {
+		scast_data_t *sd = ctrl->data;
+		char *metaint = http_get_field( http_hdr, "Icy-MetaInt" );
+		sd->metapos = 0;
+		sd->metaint = metaint && !sd->is_ultravox ? atoi( metaint ) : 0;
+		if( !sd->is_ultravox && sd->metaint<=0 ) {
+			http_free( http_hdr );
+			closesocket( fd );
+			return STREAM_ERROR;
+		}
+	}
+	if( http_hdr->body_size>0 &&
+	    streaming_bufferize( ctrl, http_hdr->body, http_hdr->body_size )<0 ) {
+		http_free( http_hdr );
+		closesocket( fd );
+		return STREAM_ERROR;
+	}
+	http_free( http_hdr );
+	stream->fd = fd;
+	return STREAM_OK;
+}
+
+static int http_control( stream_t *stream, int cmd, void *arg ) {
+	switch( cmd ) {
+		case STREAM_CTRL_RECONNECT:
+			// a Range request continues exactly where reading stopped
+			if( stream->seek )
+				return http_reconnect( stream );
+			return http_reconnect_live( stream );
+	}
+	return STREAM_UNSUPPORTED;
+}
+
 HTTP_header_t *
 http_new_header(void) {
 	HTTP_header_t *http_hdr;
@@ -883,6 +943,7 @@ static int fixup_open(stream_t *stream,int seekable) {
 		return STREAM_UNSUPPORTED;
 	}
 
+	stream->control = http_control;
 	fixup_network_stream_cache(stream);
 	return STREAM_OK;
 }
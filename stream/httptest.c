@@ -0,0 +1,447 @@
+/*
+ * check HTTP range requests on kept-alive connections over the loopback
+ * interface
+ *
+ * A small HTTP/1.1 server runs in a thread of its own and serves a file
+ * of known content.  Seeks and reads through http_seek() have to return
+ * exactly that content while the server
+ *  - keeps the connections open: reading over several ranges must not
+ *    connect again and an idle connection must be reused from the pool,
+ *  - cuts a response off in the middle: the rest must be requested with a
+ *    range starting where the data ended, also by a reconnect,
+ *  - closes every connection after one response without announcing it,
+ *  - ignores the ranges: seeking and reconnecting must fail.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include "config.h"
+#if !HAVE_WINSOCK2_H
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#else
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+#include "mp_msg.h"
+#include "libavutil/common.h"
+#include "stream.h"
+#include "network.h"
+#include "http.h"
+#include "url.h"
+
+// linking hacks
+const char *mplayer_version = "httptest";
+int stream_cache_size = -1;
+
+int stream_check_interrupt(int time)
+{
+    return 0;
+}
+
+#if HAVE_PTHREADS
+#define FILE_SIZE (4 << 20)
+
+static unsigned char data[FILE_SIZE];
+
+static struct {
+    pthread_mutex_t lock;
+    int port;
+    int close_after;    ///< responses per connection, 0 for no limit
+    int cut_at;         ///< cut the next range response covering it, -1 for none
+    int cut_done;
+    int resumed;        ///< a range request started where a response was cut
+    int ignore_range;   ///< answer range requests with the whole file
+    int connections, requests;
+    int ranges;         ///< range requests answered in full
+    long long range_len[64];
+} server;
+
+static int send_all(int fd, const unsigned char *buf, int len)
+{
+    while (len > 0) {
+        int n = send(fd, buf, len, 0);
+        if (n <= 0)
+            return -1;
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/// answer the requests of one connection, they may be pipelined
+static void *serve(void *arg)
+{
+    int fd = (intptr_t)arg, fill = 0, answered = 0;
+    char req[4096];
+
+    while (1) {
+        char hdr[256], *end, *range;
+        long long start = 0, last = FILE_SIZE - 1;
+        int close_conn, stop, len;
+
+        req[fill] = 0;
+        while (!(end = strstr(req, "\r\n\r\n"))) {
+            if (fill == sizeof(req) - 1)
+                goto out;
+            len = recv(fd, req + fill, sizeof(req) - 1 - fill, 0);
+            if (len <= 0)
+                goto out;
+            fill += len;
+            req[fill] = 0;
+        }
+        *end = 0;
+        range = strstr(req, "\r\nRange: bytes=");
+        if (range && sscanf(range, "\r\nRange: bytes=%lld-%lld", &start, &last) < 1)
+            range = NULL;
+        last = FFMIN(last, FILE_SIZE - 1);
+        close_conn = strstr(req, "\r\nConnection: close") != NULL;
+        fill -= end + 4 - req;
+        memmove(req, end + 4, fill);
+
+        pthread_mutex_lock(&server.lock);
+        server.requests++;
+        if (server.ignore_range) {
+            range = NULL;
+            start = 0;
+            last  = FILE_SIZE - 1;
+        }
+        if (range && start == server.cut_done)
+            server.resumed = 1;
+        if (range && server.ranges < FF_ARRAY_ELEMS(server.range_len))
+            server.range_len[server.ranges++] = last - start + 1;
+        stop = range && server.cut_at > start && server.cut_at <= last;
+        if (stop) {
+            server.cut_done = server.cut_at;
+            server.cut_at = -1;
+        }
+        pthread_mutex_unlock(&server.lock);
+
+        if (range)
+            snprintf(hdr, sizeof(hdr), "HTTP/1.1 206 Partial Content\r\n"
+                     "Content-Range: bytes %lld-%lld/%d\r\n"
+                     "Content-Length: %lld\r\n\r\n",
+                     start, last, FILE_SIZE, last - start + 1);
+        else
+            snprintf(hdr, sizeof(hdr), "HTTP/1.1 200 OK\r\n"
+                     "Content-Length: %d\r\n\r\n", FILE_SIZE);
+        len = stop ? server.cut_done - start : last - start + 1;
+        if (send_all(fd, hdr, strlen(hdr)) || send_all(fd, data + start, len))
+            break;
+        answered++;
+        if (stop || close_conn || answered == server.close_after)
+            break;
+    }
+out:
+    closesocket(fd);
+    return NULL;
+}
+
+static void *listen_thread(void *arg)
+{
+    int l = (intptr_t)arg;
+    while (1) {
+        pthread_t thread;
+        int fd = accept(l, NULL, NULL);
+        if (fd < 0)
+            break;
+        pthread_mutex_lock(&server.lock);
+        server.connections++;
+        pthread_mutex_unlock(&server.lock);
+        if (pthread_create(&thread, NULL, serve, (void *)(intptr_t)fd))
+            closesocket(fd);
+        else
+            pthread_detach(thread);
+    }
+    return NULL;
+}
+
+static void start_server(void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    pthread_t thread;
+    int l, i;
+
+    for (i = 0; i < FILE_SIZE; i++)
+        data[i] = i * 7 + (i >> 9);
+    pthread_mutex_init(&server.lock, NULL);
+    server.cut_at = server.cut_done = -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    l = socket(AF_INET, SOCK_STREAM, 0);
+    if (l < 0 || bind(l, (struct sockaddr *)&addr, sizeof(addr)) ||
+        getsockname(l, (struct sockaddr *)&addr, &len) || listen(l, 16) ||
+        pthread_create(&thread, NULL, listen_thread, (void *)(intptr_t)l)) {
+        perror("server");
+        exit(1);
+    }
+    server.port = ntohs(addr.sin_port);
+}
+
+static int count(int *counter)
+{
+    int n;
+    pthread_mutex_lock(&server.lock);
+    n = *counter;
+    pthread_mutex_unlock(&server.lock);
+    return n;
+}
+
+/// what stream_http does to open the file, without the stream layer
+static stream_t *http_open(void)
+{
+    stream_t *s = calloc(1, sizeof(*s));
+    HTTP_header_t *http_hdr = NULL;
+    char url[64];
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/file", server.port);
+    s->streaming_ctrl = streaming_ctrl_new();
+    s->streaming_ctrl->url = url_new(url);
+    s->streaming_ctrl->streaming_read = nop_streaming_read;
+    s->fd = http_send_request(s->streaming_ctrl->url, 0);
+    if (s->fd >= 0)
+        http_hdr = http_read_response(s->fd);
+    if (!http_hdr || http_hdr->status_code != 200) {
+        printf("cannot open %s\n", url);
+        exit(1);
+    }
+    if (http_hdr->body_size)
+        streaming_bufferize(s->streaming_ctrl, http_hdr->body, http_hdr->body_size);
+    http_free(http_hdr);
+    s->end_pos = FILE_SIZE;
+    return s;
+}
+
+static void http_close(stream_t *s)
+{
+    if (s->close)
+        s->close(s);
+    if (s->fd >= 0)
+        closesocket(s->fd);
+    streaming_ctrl_free(s->streaming_ctrl);
+    free(s);
+}
+
+/// seek to pos and read len bytes, nonzero if they are not those of the file
+static int check_read(stream_t *s, int pos, int len)
+{
+    static unsigned char buf[FILE_SIZE];
+    streaming_ctrl_t *ctrl = s->streaming_ctrl;
+    int done = 0;
+
+    if (http_seek(s, pos) != 1) {
+        printf("seek to %d failed\n", pos);
+        return 1;
+    }
+    while (done < len) {
+        int n = ctrl->streaming_read(s->fd, buf + done,
+                                     FFMIN(len - done, 32768), ctrl);
+        if (n <= 0) {
+            printf("read at %d failed\n", pos + done);
+            return 1;
+        }
+        done += n;
+    }
+    s->pos = pos + len;
+    if (memcmp(buf, data + pos, len)) {
+        printf("wrong data read at %d\n", pos);
+        return 1;
+    }
+    return 0;
+}
+
+static int test_reuse(void)
+{
+    stream_t *s = http_open();
+    int fail, conns, reqs;
+
+    conns = count(&server.connections);
+    reqs  = count(&server.requests);
+    fail  = check_read(s, 100000, 1 << 20);
+    if (!fail && (count(&server.connections) != conns + 1 ||
+                  count(&server.requests) < reqs + 4)) {
+        printf("reading over several ranges took %d connections for %d requests\n",
+               count(&server.connections) - conns, count(&server.requests) - reqs);
+        fail = 1;
+    }
+    // up to the end leaves nothing pending, the connection is pooled
+    fail |= check_read(s, FILE_SIZE - 65536, 65536);
+    http_close(s);
+
+    s = http_open();
+    conns = count(&server.connections);
+    fail |= check_read(s, 5000, 10000);
+    if (!fail && count(&server.connections) != conns) {
+        printf("the idle connection was not reused\n");
+        fail = 1;
+    }
+    http_close(s);
+    printf("reuse: %s\n", fail ? "FAILED" : "ok");
+    return fail;
+}
+
+static int test_resume(void)
+{
+    stream_t *s = http_open();
+    int fail;
+
+    server.cut_at = 300000;
+    fail = check_read(s, 200000, 300000);
+    if (!fail && (server.cut_done != 300000 || !count(&server.resumed))) {
+        printf("the cut off range was not resumed at %d\n", server.cut_done);
+        fail = 1;
+    }
+    http_close(s);
+    printf("resume: %s\n", fail ? "FAILED" : "ok");
+    return fail;
+}
+
+static int test_reconnect(void)
+{
+    stream_t *s = http_open();
+    int fail, reqs;
+
+    // the first range after the seek is 64 kB, read up to the cut only
+    server.cut_at  = 1030000;
+    server.resumed = 0;
+    fail = check_read(s, 1000000, 30000);
+    reqs = count(&server.requests);
+    if (!fail && http_reconnect(s) != STREAM_OK) {
+        printf("reconnect at %d failed\n", 1030000);
+        fail = 1;
+    }
+    if (!fail && (count(&server.requests) != reqs + 1 || !count(&server.resumed))) {
+        printf("the reconnect did not ask for the data at %d\n", 1030000);
+        fail = 1;
+    }
+    fail |= check_read(s, 1030000, 100000);
+    http_close(s);
+    printf("reconnect: %s\n", fail ? "FAILED" : "ok");
+    return fail;
+}
+
+static int test_no_range(void)
+{
+    stream_t *s = http_open();
+    int fail = 0;
+
+    server.ignore_range = 1;
+    if (http_seek(s, 100000) > 0) {
+        printf("seek succeeded with the ranges ignored\n");
+        fail = 1;
+    }
+    s->pos = 100000;
+    if (http_reconnect(s) != STREAM_ERROR) {
+        printf("reconnect succeeded with the ranges ignored\n");
+        fail = 1;
+    }
+    server.ignore_range = 0;
+    http_close(s);
+    printf("no range: %s\n", fail ? "FAILED" : "ok");
+    return fail;
+}
+
+/// a range asked for again after a lost connection must not grow twice
+static int test_range_growth(void)
+{
+    stream_t *s = http_open();
+    int fail, i;
+
+    server.close_after = 1;
+    server.ranges = 0;
+    fail = check_read(s, 1000, 2 << 20);
+    server.close_after = 0;
+    http_close(s);
+    for (i = 1; i < count(&server.ranges) && !fail; i++) {
+        long long want = FFMIN(2 * server.range_len[i - 1], network_http_range * 1024LL);
+        if (server.range_len[i] > want) {
+            printf("range %d is %lld bytes after %lld\n", i,
+                   server.range_len[i], server.range_len[i - 1]);
+            fail = 1;
+        }
+    }
+    printf("range growth: %s\n", fail ? "FAILED" : "ok");
+    return fail;
+}
+
+static int test_server_close(void)
+{
+    stream_t *s = http_open();
+    int fail = 0, i, conns = count(&server.connections);
+    int reqs = count(&server.requests);
+
+    server.close_after = 1;
+    for (i = 0; i < 20 && !fail; i++)
+        fail = check_read(s, rand() % (FILE_SIZE - 300000), rand() % 300000);
+    fail |= check_read(s, FILE_SIZE - 65536, 65536);
+    http_close(s);
+    // the pooled connection is closed as well by now
+    s = http_open();
+    fail |= check_read(s, 12345, 54321);
+    http_close(s);
+    server.close_after = 0;
+    printf("server close: %s, %d connections for %d requests\n",
+           fail ? "FAILED" : "ok", count(&server.connections) - conns,
+           count(&server.requests) - reqs);
+    return fail;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    int fail = 0;
+#if HAVE_WINSOCK2_H
+    WSADATA wsdata;
+    WSAStartup(0x0202, &wsdata);
+#endif
+
+    mp_msg_init();
+    if (argc > 1 && !strcmp(argv[1], "-v"))
+        verbose = 1;
+    else
+        // lost connections are expected here
+        mp_msg_levels[MSGT_NETWORK] = MSGL_FATAL;
+#ifdef SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    srand(1);
+#if HAVE_PTHREADS
+    start_server();
+    fail |= test_reuse();
+    fail |= test_resume();
+    fail |= test_reconnect();
+    fail |= test_range_growth();
+    fail |= test_server_close();
+    fail |= test_no_range();
+#else
+    printf("no threads for the server, nothing to check\n");
+#endif
+    return fail;
+}
@@ -116,6 +116,7 @@ rtp_session_new (void)
   st->rtcp_socket = -1;
   st->control_url = NULL;
   st->count = 0;
+  st->jitter = NULL;
 
   return st;
 }
@@ -131,6 +132,7 @@ rtp_session_free (struct rtp_rtsp_session_t *st)
   if (st->rtcp_socket != -1)
     close (st->rtcp_socket);
 
+  rtp_jitter_free (st->jitter);
   free (st->control_url);
   free (st);
 }
@@ -144,6 +146,8 @@ rtp_session_set_fd (struct rtp_rtsp_session_t *st,
 
   st->rtp_socket = rtp_sock;
   st->rtcp_socket = rtcp_sock;
+  if (rtp_sock != -1)
+    st->jitter = rtp_jitter_new (rtp_sock);
 }
 
 static int
@@ -23,6 +23,7 @@
 
 #include <sys/types.h>
 #include "rtsp.h"
+#include "stream/rtp.h"
 
 #define MAX_PREVIEW_SIZE 4096
 
@@ -31,6 +32,7 @@ struct rtp_rtsp_session_t {
   int rtcp_socket;
   char *control_url;
   int count;
+  rtp_jitter_t *jitter;
 };
 
 struct rtp_rtsp_session_t *rtp_setup_and_play (rtsp_t* rtsp_session);
@@ -294,7 +294,8 @@ int rtsp_session_read (rtsp_session_t *this, char *data, int len) {
   {
     int l = 0;
 
-    l = read_rtp_from_server (this->rtp_session->rtp_socket, data, len);
+    if (this->rtp_session->jitter)
+      l = rtp_jitter_read (this->rtp_session->jitter, data, len);
     /* send RTSP and RTCP keepalive  */
     rtcp_send_rr (this->s, this->rtp_session);
 
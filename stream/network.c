@@ -47,6 +47,7 @@
 #include "http.h"
 #include "cookies.h"
 #include "url.h"
+#include "libavutil/common.h"
 
 /* Variables for the command line option -user, -passwd, -bandwidth,
    -user-agent and -nocookies */
@@ -62,6 +63,9 @@ char **network_http_header_fields=NULL;
 /* IPv6 options */
 int   network_ipv4_only_proxy = 0;
 
+/* largest HTTP range request in kBytes, 0 disables keep-alive connections */
+int   network_http_range = 4096;
+
 
 const mime_struct_t mime_type_table[] = {
 #ifdef CONFIG_FFMPEG
@@ -185,16 +189,25 @@ check4proxies( URL_t *url ) {
 	return url_out;
 }
 
-int
-http_send_request( URL_t *url, off_t pos ) {
+/**
+ * \brief send a GET request for the bytes pos to end (inclusive)
+ * \param end -1 for everything from pos on, on a connection of its own,
+ *            otherwise the connection is kept alive
+ * \param fd connection to send the request on, -1 to connect
+ * \return the connection or -1, a given fd is not closed on errors
+ */
+static int
+http_send_range_request( URL_t *url, off_t pos, off_t end, int fd ) {
 	HTTP_header_t *http_hdr;
 	URL_t *server_url;
 	char str[256];
-	int fd = -1;
+	int own_fd = fd < 0;
 	int ret;
 	int proxy = 0;		// Boolean
 
 	http_hdr = http_new_header();
+	if( end>=0 )
+		http_hdr->http_minor_version = 1;
 
 	if( !strcasecmp(url->protocol, "http_proxy") ) {
 		proxy = 1;
@@ -239,7 +252,10 @@ http_send_request( URL_t *url, off_t pos ) {
 	if( strcasecmp(url->protocol, "noicyx") )
 	    http_set_field(http_hdr, "Icy-MetaData: 1");
 
-	if(pos>0) {
+	if(end>=0) {
+	    snprintf(str, sizeof(str), "Range: bytes=%"PRId64"-%"PRId64, (int64_t)pos, (int64_t)end);
+	    http_set_field(http_hdr, str);
+	} else if(pos>0) {
 	// Extend http_send_request with possibility to do partial content retrieval
 	    snprintf(str, sizeof(str), "Range: bytes=%"PRId64"-", (int64_t)pos);
 	    http_set_field(http_hdr, str);
@@ -253,7 +269,7 @@ http_send_request( URL_t *url, off_t pos ) {
 			http_set_field(http_hdr, network_http_header_fields[i++]);
 	}
 
-	http_set_field( http_hdr, "Connection: close");
+	http_set_field( http_hdr, end>=0 ? "Connection: keep-alive" : "Connection: close");
 	if (proxy)
 		http_add_basic_proxy_authentication(http_hdr, url->username, url->password);
 	http_add_basic_authentication(http_hdr, server_url->username, server_url->password);
@@ -263,12 +279,14 @@ http_send_request( URL_t *url, off_t pos ) {
 
 	if( proxy ) {
 		if( url->port==0 ) url->port = 8080;			// Default port for the proxy server
-		fd = connect2Server( url->hostname, url->port,1 );
+		if( own_fd )
+			fd = connect2Server( url->hostname, url->port,1 );
 		url_free( server_url );
 		server_url = NULL;
 	} else {
 		if( server_url->port==0 ) server_url->port = 80;	// Default port for the web server
-		fd = connect2Server( server_url->hostname, server_url->port,1 );
+		if( own_fd )
+			fd = connect2Server( server_url->hostname, server_url->port,1 );
 	}
 	if( fd<0 ) {
 		goto err_out;
@@ -285,13 +303,18 @@ http_send_request( URL_t *url, off_t pos ) {
 
 	return fd;
 err_out:
-	if (fd > 0) closesocket(fd);
+	if (own_fd && fd > 0) closesocket(fd);
 	http_free(http_hdr);
 	if (proxy && server_url)
 		url_free(server_url);
 	return -1;
 }
 
+int
+http_send_request( URL_t *url, off_t pos ) {
+	return http_send_range_request( url, pos, -1, -1 );
+}
+
 HTTP_header_t *
 http_read_response( int fd ) {
 	HTTP_header_t *http_hdr;
@@ -371,13 +394,326 @@ http_authenticate(HTTP_header_t *http_hdr, URL_t *url, int *auth_retry) {
 	return 0;
 }
 
+/*
+ * Once a seekable HTTP stream is seeked in, it is read as a series of range
+ * requests on a kept-alive HTTP/1.1 connection.  The request for the next
+ * range is sent shortly before the current one ends, a seek reads the rest
+ * of a small range instead of dropping the connection.  Idle connections
+ * are kept in a small pool for later requests to the same server.
+ */
+
+#define HTTP_POOL_SIZE		4
+#define HTTP_RANGE_MIN		(64*1024)	// first range after a seek
+#define HTTP_PIPELINE_AHEAD	(32*1024)	// ask for the next range this early
+#define HTTP_DRAIN_MAX		(64*1024)	// read this much rather than reconnect
+
+typedef struct {
+	int fd;
+	int reusable;		// the server did not announce to close the connection
+	int reused;		// fd answered requests before, the server may have closed it
+	int failed;		// the server does not answer range requests properly
+	off_t pos;		// stream position of the next byte on the connection
+	off_t remaining;	// bytes of the current range not received yet
+	off_t end;		// stream size, 0 if unknown
+	off_t chunk;		// size of the next range request
+	int pending;		// a request was sent but its answer not read yet
+	off_t pending_pos;
+} http_range_t;
+
+static struct {
+	char *host;
+	int port;
+	int fd;
+} http_pool[HTTP_POOL_SIZE];
+
+static void
+http_pool_remove( int i ) {
+	free(http_pool[i].host);
+	memmove(http_pool+i, http_pool+i+1, (HTTP_POOL_SIZE-i-1)*sizeof(*http_pool));
+	http_pool[HTTP_POOL_SIZE-1].host = NULL;
+}
+
+static void
+http_pool_put( URL_t *url, int fd ) {
+	int i;
+	for( i=0 ; i<HTTP_POOL_SIZE && http_pool[i].host ; i++ );
+	if( i==HTTP_POOL_SIZE ) {
+		closesocket(http_pool[0].fd);
+		http_pool_remove(0);
+		i--;
+	}
+	http_pool[i].host = strdup(url->hostname);
+	if( !http_pool[i].host ) {
+		closesocket(fd);
+		return;
+	}
+	http_pool[i].port = url->port;
+	http_pool[i].fd = fd;
+}
+
+/// an idle connection to the server of url, -1 if there is none
+static int
+http_pool_get( URL_t *url ) {
+	int i;
+	for( i=HTTP_POOL_SIZE-1 ; i>=0 ; i-- ) {
+		int fd = http_pool[i].fd;
+#ifdef MSG_DONTWAIT
+		char c;
+		int ret;
+#endif
+		if( !http_pool[i].host || http_pool[i].port!=url->port ||
+		    strcasecmp(http_pool[i].host, url->hostname) )
+			continue;
+		http_pool_remove(i);
+#ifdef MSG_DONTWAIT
+		// anything but "nothing to read yet" means it was closed
+		ret = recv( fd, &c, 1, MSG_PEEK|MSG_DONTWAIT );
+		if( ret>=0 || (errno!=EAGAIN && errno!=EWOULDBLOCK) ) {
+			closesocket(fd);
+			continue;
+		}
+#endif
+		return fd;
+	}
+	return -1;
+}
+
+static int
+http_range_request( streaming_ctrl_t *ctrl, off_t pos ) {
+	http_range_t *r = ctrl->data;
+	off_t end = pos + r->chunk - 1;
+	int fd;
+
+	if( r->end>0 && end>=r->end ) end = r->end - 1;
+	if( r->fd<0 ) {
+		r->fd = http_pool_get(ctrl->url);
+		r->reused = r->fd>=0;
+	}
+	fd = http_send_range_request( ctrl->url, pos, end, r->fd );
+	if( fd<0 && r->fd>=0 ) {
+		// the server closed the connection in the meantime
+		closesocket(r->fd);
+		fd = http_send_range_request( ctrl->url, pos, end, -1 );
+		r->reused = 0;
+	}
+	r->fd = fd;
+	if( fd<0 ) return -1;
+	r->pending = 1;
+	r->pending_pos = pos;
+	return 0;
+}
+
+/// read the answer to the pending request
+static int
+http_range_response( streaming_ctrl_t *ctrl ) {
+	http_range_t *r = ctrl->data;
+	HTTP_header_t *http_hdr;
+	const char *field;
+	int64_t start = -1, last = -1, total = 0;
+	off_t len, body;
+
+	r->pending = 0;
+	http_hdr = http_read_response( r->fd );
+	if( !http_hdr && r->reused ) {
+		closesocket(r->fd);
+		r->fd = -1;
+		r->reused = 0;
+		if( http_range_request( ctrl, r->pending_pos )<0 ) return -1;
+		r->pending = 0;
+		http_hdr = http_read_response( r->fd );
+	}
+	if( !http_hdr ) {
+		closesocket(r->fd);
+		r->fd = -1;
+		return -1;
+	}
+	if( mp_msg_test(MSGT_NETWORK,MSGL_DBG2) )
+		http_debug_hdr( http_hdr );
+
+	field = http_get_field( http_hdr, "Content-Range" );
+	if( field )
+		sscanf( field, "bytes %"SCNd64"-%"SCNd64"/%"SCNd64, &start, &last, &total );
+	len = last - start + 1;
+	field = http_get_field( http_hdr, "Content-Length" );
+	if( http_hdr->status_code!=206 || start!=r->pending_pos || last<start ||
+	    (field && atoll(field)!=len) || http_get_field(http_hdr, "Transfer-Encoding") ) {
+		mp_msg(MSGT_NETWORK,MSGL_V,"HTTP range request answered with %d %s, reconnecting for every seek\n",
+		       http_hdr->status_code, http_hdr->reason_phrase);
+		http_free( http_hdr );
+		closesocket(r->fd);
+		r->fd = -1;
+		r->failed = 1;
+		return -1;
+	}
+	field = http_get_field( http_hdr, "Connection" );
+	r->reusable = field ? strcasecmp(field, "close")!=0 : http_hdr->http_minor_version>=1;
+	if( total>0 ) r->end = total;
+
+	body = FFMIN((off_t)http_hdr->body_size, len);
+	if( body>0 && streaming_bufferize( ctrl, http_hdr->body, body )<0 ) {
+		http_free( http_hdr );
+		return -1;
+	}
+	http_free( http_hdr );
+	r->pos = start + body;
+	r->remaining = len - body;
+	r->reused = 1;
+	// grow the ranges only once a request was answered, not per attempt
+	r->chunk = FFMIN(2*r->chunk, FFMAX((off_t)network_http_range*1024, HTTP_RANGE_MIN));
+	return 0;
+}
+
+static int
+http_range_read( int fd, char *buffer, int size, streaming_ctrl_t *ctrl ) {
+	http_range_t *r = ctrl->data;
+	int len, retry = 1;
+
+	while( !ctrl->buffer_size ) {
+		if( !r->remaining ) {
+			if( r->end>0 && r->pos>=r->end ) return 0;
+			if( !r->reusable && r->fd>=0 ) {
+				closesocket(r->fd);
+				r->fd = -1;
+			}
+			if( (!r->pending && http_range_request( ctrl, r->pos )<0) ||
+			    http_range_response( ctrl )<0 )
+				return -1;
+			continue;
+		}
+		len = recv( r->fd, buffer, FFMIN(size, r->remaining), 0 );
+		if( len>0 ) {
+			r->remaining -= len;
+			r->pos += len;
+			if( !r->pending && r->reusable && r->remaining<=HTTP_PIPELINE_AHEAD &&
+			    (r->end<=0 || r->pos+r->remaining<r->end) )
+				http_range_request( ctrl, r->pos+r->remaining );
+			return len;
+		}
+		if( !retry-- ) return -1;
+		// connection lost, ask for the rest of the range again
+		mp_msg(MSGT_NETWORK,MSGL_V,"HTTP connection lost at %"PRId64", reconnecting\n", (int64_t)r->pos);
+		closesocket(r->fd);
+		r->fd = -1;
+		r->remaining = 0;
+		r->pending = 0;
+	}
+
+	len = FFMIN(size, ctrl->buffer_size-ctrl->buffer_pos);
+	memcpy( buffer, ctrl->buffer+ctrl->buffer_pos, len );
+	ctrl->buffer_pos += len;
+	if( ctrl->buffer_pos>=ctrl->buffer_size ) {
+		free( ctrl->buffer );
+		ctrl->buffer = NULL;
+		ctrl->buffer_size = 0;
+		ctrl->buffer_pos = 0;
+	}
+	return len;
+}
+
+static void
+http_range_close( stream_t *stream ) {
+	streaming_ctrl_t *ctrl = stream->streaming_ctrl;
+	http_range_t *r = ctrl ? ctrl->data : NULL;
+	if( !r ) return;
+	if( r->fd>=0 ) {
+		if( r->reusable && !r->pending && !r->remaining )
+			http_pool_put( ctrl->url, r->fd );
+		else
+			closesocket(r->fd);
+	}
+	free(r);
+	ctrl->data = NULL;
+}
+
+/// \return -1 if the server cannot do it this way
+static int
+http_range_seek( stream_t *stream, off_t pos ) {
+	streaming_ctrl_t *ctrl = stream->streaming_ctrl;
+	http_range_t *r = ctrl->data;
+	off_t cur;
+
+	if( !r ) {
+		r = calloc(1, sizeof(*r));
+		if( !r ) return -1;
+		// the first request was not limited, it cannot be reused
+		if( stream->fd>0 ) closesocket(stream->fd);
+		stream->fd = -1;
+		r->fd = -1;
+		r->end = stream->end_pos;
+		ctrl->data = r;
+		ctrl->streaming_read = http_range_read;
+		stream->close = http_range_close;
+		free( ctrl->buffer );
+		ctrl->buffer = NULL;
+		ctrl->buffer_size = ctrl->buffer_pos = 0;
+	}
+	if( r->failed ) return -1;
+
+	// a short skip forward is cheaper than a new request
+	cur = r->pos - (ctrl->buffer_size - ctrl->buffer_pos);
+	if( pos>=cur && pos-cur<=HTTP_DRAIN_MAX && pos<=r->pos+r->remaining ) {
+		char buf[4096];
+		while( cur<pos ) {
+			int len = http_range_read( -1, buf, FFMIN((off_t)sizeof(buf), pos-cur), ctrl );
+			if( len<=0 ) break;
+			cur += len;
+		}
+		if( cur==pos ) {
+			stream->pos = pos;
+			return 1;
+		}
+	}
+
+	free( ctrl->buffer );
+	ctrl->buffer = NULL;
+	ctrl->buffer_size = ctrl->buffer_pos = 0;
+	if( r->fd>=0 && (r->pending || !r->reusable || r->remaining>HTTP_DRAIN_MAX) ) {
+		closesocket(r->fd);
+		r->fd = -1;
+	}
+	// finish the current range to keep the connection
+	while( r->fd>=0 && r->remaining>0 ) {
+		char buf[4096];
+		int len = recv( r->fd, buf, FFMIN((off_t)sizeof(buf), r->remaining), 0 );
+		if( len<=0 ) {
+			closesocket(r->fd);
+			r->fd = -1;
+		} else
+			r->remaining -= len;
+	}
+	r->pending = 0;
+	r->remaining = 0;
+	r->pos = pos;
+	r->chunk = HTTP_RANGE_MIN;
+	stream->pos = pos;
+	if( r->end>0 && pos>=r->end ) return 1;
+	if( http_range_request( ctrl, pos )<0 || http_range_response( ctrl )<0 ) {
+		if( !r->failed ) return 0;
+		ctrl->streaming_read = nop_streaming_read;
+		return -1;
+	}
+	return 1;
+}
+
 int
 http_seek( stream_t *stream, off_t pos ) {
 	HTTP_header_t *http_hdr = NULL;
+	const char *range;
+	int64_t start = 0;
 	int fd;
 	if( stream==NULL ) return 0;
 
+	if( network_http_range>0 ) {
+		int ret = http_range_seek( stream, pos );
+		if( ret>=0 ) return ret;
+	}
+
 	if( stream->fd>0 ) closesocket(stream->fd); // need to reconnect to seek in http-stream
+	stream->fd = -1;
+	// whatever is left of the old response is from the wrong position
+	free( stream->streaming_ctrl->buffer );
+	stream->streaming_ctrl->buffer = NULL;
+	stream->streaming_ctrl->buffer_size = stream->streaming_ctrl->buffer_pos = 0;
 	fd = http_send_request( stream->streaming_ctrl->url, pos );
 	if( fd<0 ) return 0;
 
@@ -389,8 +725,18 @@ http_seek( stream_t *stream, off_t pos ) {
 		http_debug_hdr( http_hdr );
 
 	switch( http_hdr->status_code ) {
-		case 200:
-		case 206: // OK
+		case 206:
+			range = http_get_field( http_hdr, "Content-Range" );
+			if( !range || sscanf( range, "bytes %"SCNd64, &start )!=1 )
+				start = -1;
+			// fall through
+		case 200: // OK, a 200 ignored the Range and starts at the beginning
+			if( start!=pos ) {
+				mp_msg(MSGT_NETWORK,MSGL_V,"HTTP server did not continue at %"PRId64"\n", (int64_t)pos);
+				http_free( http_hdr );
+				closesocket( fd );
+				return 0;
+			}
 			mp_msg(MSGT_NETWORK,MSGL_V,"Content-Type: [%s]\n", http_get_field(http_hdr, "Content-Type") );
 			mp_msg(MSGT_NETWORK,MSGL_V,"Content-Length: [%s]\n", http_get_field(http_hdr, "Content-Length") );
 			if( http_hdr->body_size>0 ) {
@@ -402,21 +748,51 @@ http_seek( stream_t *stream, off_t pos ) {
 			break;
 		default:
 			mp_msg(MSGT_NETWORK,MSGL_ERR,MSGTR_MPDEMUX_NW_ErrServerReturned, http_hdr->status_code, http_hdr->reason_phrase );
+			http_free( http_hdr );
 			closesocket( fd );
-			fd = -1;
+			return 0;
 	}
 	stream->fd = fd;
 
-	if( http_hdr ) {
-		http_free( http_hdr );
-		stream->streaming_ctrl->data = NULL;
-	}
+	http_free( http_hdr );
 
 	stream->pos=pos;
 
 	return 1;
 }
 
+/**
+ * \brief connect again after the connection was lost
+ * \return STREAM_OK if the data continues exactly at stream->pos
+ */
+int
+http_reconnect( stream_t *stream ) {
+	streaming_ctrl_t *ctrl = stream->streaming_ctrl;
+	http_range_t *r = ctrl->data;
+	off_t pos = stream->pos;
+
+	if( !r || r->failed )
+		return http_seek( stream, pos )>0 ? STREAM_OK : STREAM_ERROR;
+
+	// nothing of the old connection can be trusted, not even a short
+	// skip forward on it
+	if( r->fd>=0 )
+		closesocket(r->fd);
+	r->fd = -1;
+	r->pending = 0;
+	r->remaining = 0;
+	free( ctrl->buffer );
+	ctrl->buffer = NULL;
+	ctrl->buffer_size = ctrl->buffer_pos = 0;
+	r->pos = pos;
+	r->chunk = HTTP_RANGE_MIN;
+	if( r->end>0 && pos>=r->end ) return STREAM_OK;
+	// http_range_response() rejects anything but a 206 starting at pos
+	if( http_range_request( ctrl, pos )<0 || http_range_response( ctrl )<0 )
+		return STREAM_ERROR;
+	return STREAM_OK;
+}
+
 
 int
 streaming_bufferize( streaming_ctrl_t *streaming_ctrl, char *buffer, int size) {
@@ -71,6 +71,7 @@ extern char **network_http_header_fields;
 extern int   network_bandwidth;
 extern int   network_cookies_enabled;
 extern int   network_ipv4_only_proxy;
+extern int   network_http_range;
 
 streaming_ctrl_t *streaming_ctrl_new(void);
 int streaming_bufferize( streaming_ctrl_t *streaming_ctrl, char *buffer, int size);
@@ -87,5 +88,6 @@ URL_t* check4proxies(URL_t *url);
 
 void fixup_network_stream_cache(stream_t *stream);
 int http_seek(stream_t *stream, off_t pos);
+int http_reconnect(stream_t *stream);
 
 #endif /* MPLAYER_NETWORK_H */
@@ -0,0 +1,299 @@
+/*
+ * asynchronous readahead for local files and devices
+ *
+ * A few threads keep reads of the blocks following the current position in
+ * flight, so devices that only reach their full speed with several
+ * outstanding requests (RAID, NVMe) are not limited to one synchronous read
+ * at a time.  The reader only copies from finished blocks.  Jumping
+ * somewhere else drops the queued blocks and starts again from there.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "config.h"
+#include "mp_msg.h"
+#include "libavutil/common.h"
+#include "stream.h"
+
+#define MAX_THREADS 16
+
+enum { BLOCK_FREE, BLOCK_QUEUED, BLOCK_BUSY, BLOCK_DONE };
+
+typedef struct {
+    off_t pos;
+    int len;            ///< bytes read, less than block_size at EOF, -1 on errors
+    int state;
+    int stale;          ///< dropped while being read, free it when done
+    unsigned char *data;
+} prefetch_block_t;
+
+struct stream_prefetch {
+    int fd;
+    off_t size;
+    int block_size;
+    int num_blocks;
+    prefetch_block_t *blocks;
+    off_t next;         ///< position of the next block to queue
+    pthread_mutex_t lock;
+    pthread_cond_t queued, done;
+    pthread_t threads[MAX_THREADS];
+    int num_threads;
+    int quit;
+    pid_t pid;          ///< process the threads run in
+    int hits, waits, restarts;
+};
+
+#ifdef __MINGW32__
+// no pread(), the threads must not move the file position under each other
+static pthread_mutex_t seek_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static ssize_t pread(int fd, void *buf, size_t count, off_t pos)
+{
+    ssize_t r = -1;
+    pthread_mutex_lock(&seek_lock);
+    if (lseek(fd, pos, SEEK_SET) == pos)
+        r = read(fd, buf, count);
+    pthread_mutex_unlock(&seek_lock);
+    return r;
+}
+#endif
+
+/// pread() until size bytes or EOF
+static int read_block(int fd, unsigned char *buf, int size, off_t pos)
+{
+    int done = 0;
+    while (done < size) {
+        ssize_t r = pread(fd, buf + done, size - done, pos + done);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0)
+            return done ? done : -1;
+        if (r == 0)
+            break;
+        done += r;
+    }
+    return done;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    stream_prefetch_t *p = arg;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->quit) {
+        prefetch_block_t *b = NULL;
+        int i, len;
+        // oldest first, the reader needs that one next
+        for (i = 0; i < p->num_blocks; i++)
+            if (p->blocks[i].state == BLOCK_QUEUED &&
+                (!b || p->blocks[i].pos < b->pos))
+                b = &p->blocks[i];
+        if (!b) {
+            pthread_cond_wait(&p->queued, &p->lock);
+            continue;
+        }
+        b->state = BLOCK_BUSY;
+        pthread_mutex_unlock(&p->lock);
+
+        len = read_block(p->fd, b->data, p->block_size, b->pos);
+
+        pthread_mutex_lock(&p->lock);
+        b->len   = len;
+        b->state = b->stale ? BLOCK_FREE : BLOCK_DONE;
+        b->stale = 0;
+        pthread_cond_broadcast(&p->done);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static void prefetch_start(stream_prefetch_t *p)
+{
+    int i, threads = FFMIN(p->num_blocks, MAX_THREADS);
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->queued, NULL);
+    pthread_cond_init(&p->done, NULL);
+    p->quit = 0;
+    p->pid  = getpid();
+    for (i = 0; i < p->num_blocks; i++) {
+        p->blocks[i].state = BLOCK_FREE;
+        p->blocks[i].stale = 0;
+    }
+    for (p->num_threads = 0; p->num_threads < threads; p->num_threads++)
+        if (pthread_create(&p->threads[p->num_threads], NULL, prefetch_thread, p))
+            break;
+}
+
+static void queue_blocks(stream_prefetch_t *p)
+{
+    int i;
+    for (i = 0; i < p->num_blocks && p->next < p->size; i++) {
+        prefetch_block_t *b = &p->blocks[i];
+        if (b->state != BLOCK_FREE)
+            continue;
+        b->pos   = p->next;
+        b->state = BLOCK_QUEUED;
+        p->next += p->block_size;
+    }
+    pthread_cond_broadcast(&p->queued);
+}
+
+/// drop everything queued and read ahead from pos instead
+static void restart(stream_prefetch_t *p, off_t pos)
+{
+    int i;
+    for (i = 0; i < p->num_blocks; i++) {
+        prefetch_block_t *b = &p->blocks[i];
+        if (b->state == BLOCK_BUSY)
+            b->stale = 1;
+        else
+            b->state = BLOCK_FREE;
+    }
+    p->next = pos - pos % p->block_size;
+    p->restarts++;
+    queue_blocks(p);
+}
+
+static prefetch_block_t *find_block(stream_prefetch_t *p, off_t pos)
+{
+    int i;
+    for (i = 0; i < p->num_blocks; i++) {
+        prefetch_block_t *b = &p->blocks[i];
+        if (b->state != BLOCK_FREE && !b->stale &&
+            pos >= b->pos && pos < b->pos + p->block_size)
+            return b;
+    }
+    return NULL;
+}
+
+/**
+ * \brief set up readahead of num_blocks blocks of block_size bytes on fd
+ * \param size file size, nothing is read ahead beyond it
+ */
+stream_prefetch_t *stream_prefetch_init(int fd, off_t size, int num_blocks,
+                                        int block_size)
+{
+    stream_prefetch_t *p;
+    int i;
+
+    if (num_blocks <= 0 || block_size <= 0)
+        return NULL;
+    p = calloc(1, sizeof(*p));
+    if (!p)
+        return NULL;
+    p->fd         = fd;
+    p->size       = size;
+    p->block_size = block_size;
+    p->num_blocks = num_blocks;
+    p->blocks     = calloc(num_blocks, sizeof(*p->blocks));
+    for (i = 0; p->blocks && i < num_blocks; i++)
+        if (!(p->blocks[i].data = malloc(block_size)))
+            break;
+    if (!p->blocks || i < num_blocks) {
+        while (p->blocks && i--)
+            free(p->blocks[i].data);
+        free(p->blocks);
+        free(p);
+        return NULL;
+    }
+    prefetch_start(p);
+    mp_msg(MSGT_STREAM, MSGL_V, "Readahead: %d blocks of %d bytes, %d threads\n",
+           num_blocks, block_size, p->num_threads);
+    return p;
+}
+
+/**
+ * \brief read up to len bytes at pos from the finished blocks
+ * \return bytes read, 0 at EOF, -1 on errors
+ */
+int stream_prefetch_read(stream_prefetch_t *p, off_t pos, void *buf, int len)
+{
+    prefetch_block_t *b;
+    int i, off, n;
+
+    // after a fork (the cache process) only the memory was copied
+    if (p->pid != getpid())
+        prefetch_start(p);
+    if (!p->num_threads)
+        return read_block(p->fd, buf, len, pos);
+
+    pthread_mutex_lock(&p->lock);
+    b = find_block(p, pos);
+    if (b)
+        p->hits += b->state == BLOCK_DONE;
+    else {
+        restart(p, pos);
+        b = find_block(p, pos);
+    }
+    if (!b) {
+        // beyond the size known at open time, the file may have grown
+        pthread_mutex_unlock(&p->lock);
+        return read_block(p->fd, buf, len, pos);
+    }
+    if (b->state != BLOCK_DONE)
+        p->waits++;
+    while (b->state != BLOCK_DONE)
+        pthread_cond_wait(&p->done, &p->lock);
+
+    off = pos - b->pos;
+    n   = b->len < 0 ? -1 : FFMAX(FFMIN(len, b->len - off), 0);
+    if (n > 0)
+        memcpy(buf, b->data + off, n);
+    // recycle the blocks that were used up or skipped over
+    for (i = 0; i < p->num_blocks; i++) {
+        prefetch_block_t *o = &p->blocks[i];
+        if ((o->state == BLOCK_DONE || o->state == BLOCK_QUEUED) &&
+            (o->pos + p->block_size <= pos + FFMAX(n, 0) ||
+             (o == b && off + n >= b->len)))
+            o->state = BLOCK_FREE;
+    }
+    queue_blocks(p);
+    pthread_mutex_unlock(&p->lock);
+    return n;
+}
+
+void stream_prefetch_uninit(stream_prefetch_t *p)
+{
+    int i;
+
+    if (!p)
+        return;
+    if (p->pid == getpid()) {
+        pthread_mutex_lock(&p->lock);
+        p->quit = 1;
+        pthread_cond_broadcast(&p->queued);
+        pthread_mutex_unlock(&p->lock);
+        for (i = 0; i < p->num_threads; i++)
+            pthread_join(p->threads[i], NULL);
+        pthread_cond_destroy(&p->queued);
+        pthread_cond_destroy(&p->done);
+        pthread_mutex_destroy(&p->lock);
+        mp_msg(MSGT_STREAM, MSGL_V, "Readahead: %d blocks ready, %d waited for, %d restarts\n",
+               p->hits, p->waits, p->restarts);
+    }
+    for (i = 0; i < p->num_blocks; i++)
+        free(p->blocks[i].data);
+    free(p->blocks);
+    free(p);
+}
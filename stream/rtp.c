@@ -24,6 +24,10 @@
 #include <errno.h>
 #include "network.h"
 #include "stream.h"
+#include "udp.h"
+#include "osdep/timer.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
 
 /* MPEG-2 TS RTP stack */
 
@@ -33,223 +37,248 @@
 
 // RTP reorder routines
 // Also handling of repeated UDP packets (a bug of ExtremeNetworks switches firmware)
-// rtpreord procedures
-// write rtp packets in cache
-// get rtp packets reordered
-
-#define MAXRTPPACKETSIN 32   // The number of max packets being reordered
-
-struct rtpbits {
-  unsigned int v:2;           /* version: 2 */
-  unsigned int p:1;           /* is there padding appended: 0 */
-  unsigned int x:1;           /* number of extension headers: 0 */
-  unsigned int cc:4;          /* number of CSRC identifiers: 0 */
-  unsigned int m:1;           /* marker: 0 */
-  unsigned int pt:7;          /* payload type: 33 for MPEG2 TS - RFC 1890 */
-  unsigned int sequence:16;   /* sequence number: random */
+//
+// Every stream has its own jitter buffer, a ring of slots indexed by the
+// sequence number.  Packets are returned in sequence order; when one is
+// missing, the reader waits at most rtp_jitter_ms for it before giving it
+// up as lost.  The ring grows with the packet rate, up to RTP_SLOTS_MAX.
+
+#define RTP_PACKET_MAX STREAM_BUFFER_SIZE // payload kept per packet
+#define RTP_SLOTS_MIN  64
+#define RTP_SLOTS_MAX  8192
+
+int rtp_jitter_ms = 50;
+
+enum { SLOT_EMPTY, SLOT_FULL, SLOT_DONE, SLOT_LOST };
+
+typedef struct {
+  unsigned char data[RTP_PACKET_MAX];
+  int len;
+  unsigned short seq;
+  int state;
+} rtp_slot_t;
+
+struct rtp_jitter {
+  udp_batch_t *rx;
+  rtp_slot_t *slots;
+  int size;                 ///< number of slots, a power of 2
+  int count;                ///< packets waiting in the ring
+  int started;
+  unsigned short next;      ///< sequence number to return next
+  unsigned short highest;   ///< highest sequence number received
+  unsigned int wait_start;  ///< when the reader started waiting for next, 0 if not
+  // statistics
+  uint64_t received, lost;
+  int reordered, duplicates, late, resets, grows;
 };
 
-struct rtpheader {	/* in network byte order */
-  struct rtpbits b;
-  int timestamp;	/* start: random */
-  int ssrc;		/* random */
-};
-
-struct rtpbuffer
+static rtp_slot_t *rtp_slot(rtp_jitter_t *j, unsigned short seq)
 {
-	unsigned char  data[MAXRTPPACKETSIN][STREAM_BUFFER_SIZE];
-	unsigned short  seq[MAXRTPPACKETSIN];
-	unsigned short  len[MAXRTPPACKETSIN];
-	unsigned short first;
-};
-static struct rtpbuffer rtpbuf;
+  return &j->slots[seq & (j->size - 1)];
+}
 
-static int getrtp2(int fd, struct rtpheader *rh, char** data, int* lengthData);
+/// double the ring, the waiting packets keep their sequence numbers
+static int rtp_grow(rtp_jitter_t *j)
+{
+  rtp_slot_t *old = j->slots;
+  int i, old_size = j->size;
 
-// RTP Reordering functions
-// Algorithm works as follows:
-// If next packet is in sequence just copy it to buffer
-// Otherwise copy it in cache according to its sequence number
-// Cache is a circular array where "rtpbuf.first" points to next sequence slot
-// and keeps track of expected sequence
+  if (j->size >= RTP_SLOTS_MAX)
+    return 0;
+  j->slots = calloc(2 * j->size, sizeof(*j->slots));
+  if (!j->slots) {
+    j->slots = old;
+    return 0;
+  }
+  j->size *= 2;
+  for (i = 0; i < old_size; i++)
+    if (old[i].state == SLOT_FULL)
+      *rtp_slot(j, old[i].seq) = old[i];
+  free(old);
+  j->grows++;
+  mp_msg(MSGT_NETWORK, MSGL_V, "RTP: jitter buffer grown to %d packets\n", j->size);
+  return 1;
+}
 
-// Initialize rtp cache
-static void rtp_cache_reset(unsigned short seq)
+/// forget everything and continue with seq
+static void rtp_reset(rtp_jitter_t *j, unsigned short seq)
 {
-	int i;
+  int i;
+  for (i = 0; i < j->size; i++)
+    j->slots[i].state = SLOT_EMPTY;
+  j->count = 0;
+  j->next = j->highest = seq;
+  j->wait_start = 0;
+  j->resets++;
+}
 
-	rtpbuf.first = 0;
-	rtpbuf.seq[0] = ++seq;
+/// strip the RTP header, 0 if this is not an RTP packet
+static int rtp_parse(unsigned char *buf, int len, unsigned short *seq,
+                     unsigned char **payload)
+{
+  int header = 12 + 4 * (buf[0] & 0x0f);
 
-	for (i=0; i<MAXRTPPACKETSIN; i++) {
-		rtpbuf.len[i] = 0;
-	}
+  if (len < 12 || (buf[0] >> 6) != 2) {
+    mp_msg(MSGT_NETWORK, MSGL_ERR, "rtp: packet too small (%d) or not version 2\n", len);
+    return 0;
+  }
+  if (buf[0] & 0x10) { // header extension
+    if (len < header + 4)
+      return 0;
+    header += 4 + 4 * AV_RB16(buf + header + 2);
+  }
+  if (buf[0] & 0x20) // padding
+    len -= buf[len - 1];
+  if (len <= header)
+    return 0;
+  *seq = AV_RB16(buf + 2);
+  *payload = buf + header;
+  return len - header;
 }
 
-// Write in a cache the rtp packet in right rtp sequence order
-static int rtp_cache(int fd, char *buffer, int length)
+/// put a received packet into the ring
+static void rtp_insert(rtp_jitter_t *j, unsigned char *buf, int len)
 {
-	struct rtpheader rh;
-	int newseq;
-	char *data;
-	unsigned short seq;
-	static int is_first = 1;
-
-	getrtp2(fd, &rh, &data, &length);
-	if(!length)
-		return 0;
-	seq = rh.b.sequence;
-
-	newseq = seq - rtpbuf.seq[rtpbuf.first];
-
-	if ((newseq == 0) || is_first)
-	{
-		is_first = 0;
-
-		//mp_msg(MSGT_NETWORK, MSGL_DBG4, "RTP (seq[%d]=%d seq=%d, newseq=%d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq);
-		rtpbuf.first = ( 1 + rtpbuf.first ) % MAXRTPPACKETSIN;
-		rtpbuf.seq[rtpbuf.first] = ++seq;
-		goto feed;
-	}
-
-	if (newseq > MAXRTPPACKETSIN)
-	{
-		mp_msg(MSGT_NETWORK, MSGL_DBG2, "Overrun(seq[%d]=%d seq=%d, newseq=%d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq);
-		rtp_cache_reset(seq);
-		goto feed;
-	}
-
-	if (newseq < 0)
-	{
-		int i;
-
-		// Is it a stray packet re-sent to network?
-		for (i=0; i<MAXRTPPACKETSIN; i++) {
-			if (rtpbuf.seq[i] == seq) {
-				mp_msg(MSGT_NETWORK, MSGL_ERR, "Stray packet (seq[%d]=%d seq=%d, newseq=%d found at %d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq, i);
-				return  0; // Yes, it is!
-			}
-		}
-		// Some heuristic to decide when to drop packet or to restart everything
-		if (newseq > -(3 * MAXRTPPACKETSIN)) {
-			mp_msg(MSGT_NETWORK, MSGL_ERR, "Too Old packet (seq[%d]=%d seq=%d, newseq=%d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq);
-			return  0; // Yes, it is!
-		}
-
-		mp_msg(MSGT_NETWORK, MSGL_ERR,  "Underrun(seq[%d]=%d seq=%d, newseq=%d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq);
-
-		rtp_cache_reset(seq);
-		goto feed;
-	}
-
-	mp_msg(MSGT_NETWORK, MSGL_DBG4, "Out of Seq (seq[%d]=%d seq=%d, newseq=%d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq);
-	newseq = ( newseq + rtpbuf.first ) % MAXRTPPACKETSIN;
-	memcpy (rtpbuf.data[newseq], data, length);
-	rtpbuf.len[newseq] = length;
-	rtpbuf.seq[newseq] = seq;
-
-	return 0;
-
-feed:
-	memcpy (buffer, data, length);
-	return length;
+  unsigned char *payload;
+  unsigned short seq;
+  rtp_slot_t *slot;
+  int dist;
+
+  len = rtp_parse(buf, len, &seq, &payload);
+  if (!len)
+    return;
+  if (len > RTP_PACKET_MAX) {
+    mp_msg(MSGT_NETWORK, MSGL_ERR, "rtp: %d byte payload truncated\n", len);
+    len = RTP_PACKET_MAX;
+  }
+  j->received++;
+  if (!j->started) {
+    j->started = 1;
+    j->next = j->highest = seq;
+  }
+  if ((short)(seq - j->highest) < 0)
+    j->reordered++;
+  else
+    j->highest = seq;
+
+  dist = (short)(seq - j->next);
+  if (dist < 0) {
+    // already returned or given up on, or the sender restarted
+    slot = rtp_slot(j, seq);
+    if (dist >= -j->size && slot->seq == seq && slot->state != SLOT_EMPTY) {
+      if (slot->state == SLOT_LOST)
+        j->late++;
+      else
+        j->duplicates++;
+      return;
+    }
+    if (dist > -3 * j->size) {
+      j->late++;
+      return;
+    }
+    mp_msg(MSGT_NETWORK, MSGL_V, "RTP: sequence jumped back from %hu to %hu\n", j->next, seq);
+    rtp_reset(j, seq);
+    dist = 0;
+  }
+  while (dist >= j->size)
+    if (!rtp_grow(j)) {
+      mp_msg(MSGT_NETWORK, MSGL_V, "RTP: sequence jumped from %hu to %hu\n", j->next, seq);
+      j->lost += dist;
+      rtp_reset(j, seq);
+      dist = 0;
+    }
+  slot = rtp_slot(j, seq);
+  if (slot->state == SLOT_FULL && slot->seq == seq) {
+    j->duplicates++;
+    return;
+  }
+  memcpy(slot->data, payload, len);
+  slot->len   = len;
+  slot->seq   = seq;
+  slot->state = SLOT_FULL;
+  j->count++;
 }
 
-// Get next packet in cache
-// Look in cache to get first packet in sequence
-static int rtp_get_next(int fd, char *buffer, int length)
+rtp_jitter_t *rtp_jitter_new(int fd)
 {
-	int i;
-	unsigned short nextseq;
-
-	// If we have empty buffer we loop to fill it
-	for (i=0; i < MAXRTPPACKETSIN -3; i++) {
-		if (rtpbuf.len[rtpbuf.first] != 0) break;
-
-		length = rtp_cache(fd, buffer, length) ;
-
-		// returns on first packet in sequence
-		if (length > 0) {
-			//mp_msg(MSGT_NETWORK, MSGL_DBG4, "Getting rtp [%d] %hu\n", i, rtpbuf.first);
-			return length;
-		} else if (length < 0) break;
-
-		// Only if length == 0 loop continues!
-	}
-
-	i = rtpbuf.first;
-	while (rtpbuf.len[i] == 0) {
-		mp_msg(MSGT_NETWORK, MSGL_ERR,  "Lost packet %hu\n", rtpbuf.seq[i]);
-		i = ( 1 + i ) % MAXRTPPACKETSIN;
-		if (rtpbuf.first == i) break;
-	}
-	rtpbuf.first = i;
-
-	// Copy next non empty packet from cache
-	mp_msg(MSGT_NETWORK, MSGL_DBG4, "Getting rtp from cache [%d] %hu\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first]);
-	memcpy (buffer, rtpbuf.data[rtpbuf.first], rtpbuf.len[rtpbuf.first]);
-	length = rtpbuf.len[rtpbuf.first]; // can be zero?
-
-	// Reset fisrt slot and go next in cache
-	rtpbuf.len[rtpbuf.first] = 0;
-	nextseq = rtpbuf.seq[rtpbuf.first];
-	rtpbuf.first = ( 1 + rtpbuf.first ) % MAXRTPPACKETSIN;
-	rtpbuf.seq[rtpbuf.first] = nextseq + 1;
-
-	return length;
+  rtp_jitter_t *j = calloc(1, sizeof(*j));
+
+  if (!j)
+    return NULL;
+  j->size  = RTP_SLOTS_MIN;
+  j->slots = calloc(j->size, sizeof(*j->slots));
+  j->rx    = udp_batch_new(fd);
+  if (!j->slots || !j->rx) {
+    rtp_jitter_free(j);
+    return NULL;
+  }
+  return j;
 }
 
+/**
+ * \brief read the payload of the next packet in sequence
+ * \return payload length, 0 on errors
+ */
+int rtp_jitter_read(rtp_jitter_t *j, char *buffer, int length)
+{
+  // Following test is ASSERT (i.e. uneuseful if code is correct)
+  if (buffer == NULL || length < RTP_PACKET_MAX) {
+    mp_msg(MSGT_NETWORK, MSGL_ERR, "RTP buffer invalid; no data return from network\n");
+    return 0;
+  }
 
-// Read next rtp packet using cache
-int read_rtp_from_server(int fd, char *buffer, int length) {
-	// Following test is ASSERT (i.e. uneuseful if code is correct)
-	if(buffer==NULL || length<STREAM_BUFFER_SIZE) {
-		mp_msg(MSGT_NETWORK, MSGL_ERR, "RTP buffer invalid; no data return from network\n");
-		return 0;
-	}
-
-	// loop just to skip empty packets
-	while ((length = rtp_get_next(fd, buffer, length)) == 0) {
-		mp_msg(MSGT_NETWORK, MSGL_ERR, "Got empty packet from RTP cache!?\n");
-	}
-
-	return length;
+  while (1) {
+    rtp_slot_t *slot = rtp_slot(j, j->next);
+    unsigned char *data;
+    int len, timeout = -1;
+
+    if (j->started && slot->state == SLOT_FULL && slot->seq == j->next) {
+      memcpy(buffer, slot->data, slot->len);
+      slot->state = SLOT_DONE;
+      j->count--;
+      j->next++;
+      j->wait_start = 0;
+      return slot->len;
+    }
+    if (j->count) {
+      // later packets are here, give the missing one a little time
+      unsigned int now = GetTimerMS();
+      if (!j->wait_start)
+        j->wait_start = now;
+      timeout = rtp_jitter_ms - (int)(now - j->wait_start);
+      if (timeout <= 0) {
+        int lost = 0;
+        while (!(slot->state == SLOT_FULL && slot->seq == j->next)) {
+          slot->seq   = j->next++;
+          slot->state = SLOT_LOST;
+          slot = rtp_slot(j, j->next);
+          lost++;
+        }
+        j->lost += lost;
+        j->wait_start = 0;
+        mp_msg(MSGT_NETWORK, MSGL_DBG2, "RTP: lost %d packets before %hu\n", lost, j->next);
+        continue;
+      }
+    }
+    len = udp_batch_recv(j->rx, &data, timeout);
+    if (len < 0)
+      return 0;
+    if (len)
+      rtp_insert(j, data, len);
+  }
 }
 
-static int getrtp2(int fd, struct rtpheader *rh, char** data, int* lengthData) {
-  static char buf[1600];
-  unsigned int intP;
-  char* charP = (char*) &intP;
-  int headerSize;
-  int lengthPacket;
-  lengthPacket=recv(fd,buf,1590,0);
-  if (lengthPacket<0)
-    mp_msg(MSGT_NETWORK,MSGL_ERR,"rtp: socket read error\n");
-  else if (lengthPacket<12)
-    mp_msg(MSGT_NETWORK,MSGL_ERR,"rtp: packet too small (%d) to be an rtp frame (>12bytes)\n", lengthPacket);
-  if(lengthPacket<12) {
-    *lengthData = 0;
-    return 0;
-  }
-  rh->b.v  = (unsigned int) ((buf[0]>>6)&0x03);
-  rh->b.p  = (unsigned int) ((buf[0]>>5)&0x01);
-  rh->b.x  = (unsigned int) ((buf[0]>>4)&0x01);
-  rh->b.cc = (unsigned int) ((buf[0]>>0)&0x0f);
-  rh->b.m  = (unsigned int) ((buf[1]>>7)&0x01);
-  rh->b.pt = (unsigned int) ((buf[1]>>0)&0x7f);
-  intP = 0;
-  memcpy(charP+2,&buf[2],2);
-  rh->b.sequence = ntohl(intP);
-  intP = 0;
-  memcpy(charP,&buf[4],4);
-  rh->timestamp = ntohl(intP);
-
-  headerSize = 12 + 4*rh->b.cc; /* in bytes */
-
-  *lengthData = lengthPacket - headerSize;
-  *data = (char*) buf + headerSize;
-
-  //  mp_msg(MSGT_NETWORK,MSGL_DBG2,"Reading rtp: v=%x p=%x x=%x cc=%x m=%x pt=%x seq=%x ts=%x lgth=%d\n",rh->b.v,rh->b.p,rh->b.x,rh->b.cc,rh->b.m,rh->b.pt,rh->b.sequence,rh->timestamp,lengthPacket);
-
-  return 0;
+void rtp_jitter_free(rtp_jitter_t *j)
+{
+  if (!j)
+    return;
+  if (j->received)
+    mp_msg(MSGT_NETWORK, MSGL_V,
+           "RTP: %"PRIu64" packets, %"PRIu64" lost, %d reordered, %d duplicates, "
+           "%d late, %d resets, jitter buffer %d packets\n",
+           j->received, j->lost, j->reordered, j->duplicates,
+           j->late, j->resets, j->size);
+  udp_batch_free(j->rx);
+  free(j->slots);
+  free(j);
 }
@@ -19,6 +19,12 @@
 #ifndef MPLAYER_RTP_H
 #define MPLAYER_RTP_H
 
-int read_rtp_from_server(int fd, char *buffer, int length);
+typedef struct rtp_jitter rtp_jitter_t;
+
+extern int rtp_jitter_ms;
+
+rtp_jitter_t *rtp_jitter_new(int fd);
+int rtp_jitter_read(rtp_jitter_t *j, char *buffer, int length);
+void rtp_jitter_free(rtp_jitter_t *j);
 
 #endif /* MPLAYER_RTP_H */
@@ -0,0 +1,181 @@
+/*
+ * check the RTP jitter buffer over the loopback interface
+ *
+ * Packets are sent reordered, duplicated and with gaps, the reader has to
+ * return every packet that was sent exactly once and in order.  A second
+ * run measures the receive cost per packet at MPEG-TS packet sizes.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#if !HAVE_WINSOCK2_H
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#else
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+#include "mp_msg.h"
+#include "osdep/timer.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "network.h"
+#include "rtp.h"
+
+#define BURST      48
+#define REORDER_RUNS 200
+#define BENCH_PACKETS 200000
+#define TS_PAYLOAD 1316
+
+static int tx, rx;
+static struct sockaddr_in addr;
+
+static void open_sockets(void)
+{
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    rx = socket(AF_INET, SOCK_DGRAM, 0);
+    tx = socket(AF_INET, SOCK_DGRAM, 0);
+    if (rx < 0 || tx < 0 || bind(rx, (struct sockaddr *)&addr, sizeof(addr)) ||
+        getsockname(rx, (struct sockaddr *)&addr, &len)) {
+        perror("socket");
+        exit(1);
+    }
+}
+
+static void send_rtp(unsigned short seq, int size)
+{
+    unsigned char pkt[12 + TS_PAYLOAD];
+    memset(pkt, 0, 12 + size);
+    pkt[0] = 0x80;
+    pkt[1] = 33;
+    AV_WB16(pkt + 2, seq);
+    AV_WB32(pkt + 12, seq); // the payload says which packet it is
+    sendto(tx, (char *)pkt, 12 + size, 0, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+/// shuffle, drop and repeat packets, the last one of a burst always arrives
+static int test_reorder(void)
+{
+    rtp_jitter_t *j;
+    unsigned short seq = 65000; // wraps around during the test
+    int run, i, fail = 0, sent = 0, lost = 0;
+    char buf[2048];
+
+    open_sockets();
+    j = rtp_jitter_new(rx);
+    // the first packet received starts the sequence
+    send_rtp(seq - 1, 188);
+    rtp_jitter_read(j, buf, sizeof(buf));
+    for (run = 0; run < REORDER_RUNS && !fail; run++) {
+        unsigned short order[BURST];
+        int keep[BURST], expect = 0;
+        for (i = 0; i < BURST; i++) {
+            order[i] = seq + i;
+            keep[i]  = i == BURST - 1 || rand() % 16;
+        }
+        for (i = 0; i < BURST - 1; i++) {
+            int k = i + rand() % FFMIN(4, BURST - 1 - i);
+            unsigned short t = order[i];
+            order[i] = order[k];
+            order[k] = t;
+        }
+        for (i = 0; i < BURST; i++) {
+            int n = (unsigned short)(order[i] - seq);
+            if (!keep[n])
+                continue;
+            send_rtp(order[i], 188);
+            if (!(rand() % 20))
+                send_rtp(order[i], 188);
+        }
+        for (i = 0; i < BURST; i++) {
+            int len;
+            if (!keep[i]) {
+                lost++;
+                continue;
+            }
+            len = rtp_jitter_read(j, buf, sizeof(buf));
+            if (len != 188 || AV_RB32(buf) != (unsigned short)(seq + i)) {
+                printf("reorder: expected packet %d, got %d bytes of %d\n",
+                       (unsigned short)(seq + i), len, len >= 4 ? (int)AV_RB32(buf) : -1);
+                fail = 1;
+                break;
+            }
+            expect++;
+        }
+        sent += expect;
+        seq  += BURST;
+    }
+    printf("reorder: %s, %d packets in order, %d lost\n",
+           fail ? "FAILED" : "ok", sent, lost);
+    rtp_jitter_free(j);
+    closesocket(tx);
+    closesocket(rx);
+    return fail;
+}
+
+static int bench(void)
+{
+    rtp_jitter_t *j;
+    char buf[2048];
+    unsigned int t, busy = 0;
+    int i, k, fail = 0;
+
+    open_sockets();
+    j = rtp_jitter_new(rx);
+    for (i = 0; i < BENCH_PACKETS && !fail; i += BURST) {
+        for (k = 0; k < BURST; k++)
+            send_rtp(i + k, TS_PAYLOAD);
+        t = GetTimer();
+        for (k = 0; k < BURST && !fail; k++)
+            fail = rtp_jitter_read(j, buf, sizeof(buf)) != TS_PAYLOAD;
+        busy += GetTimer() - t;
+    }
+    printf("bench: %s, %d packets of %d bytes, %.1f ns per packet\n",
+           fail ? "FAILED" : "ok", i, TS_PAYLOAD, busy * 1000.0 / i);
+    rtp_jitter_free(j);
+    closesocket(tx);
+    closesocket(rx);
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    int fail = 0;
+#if HAVE_WINSOCK2_H
+    WSADATA wsdata;
+    WSAStartup(0x0202, &wsdata);
+#endif
+
+    mp_msg_init();
+    if (argc > 1 && !strcmp(argv[1], "-v"))
+        verbose = 1;
+    srand(1);
+    rtp_jitter_ms = 5;
+    fail |= test_reorder();
+    fail |= bench();
+    return fail;
+}
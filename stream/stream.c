@@ -53,6 +53,13 @@
 
 static int (*stream_check_interrupt_cb)(int time) = NULL;
 
+int stream_buffer_max = STREAM_BUFFER_MAX / 1024;
+int stream_reconnect_max = 5;
+
+/// delays between reconnect attempts in ms, doubling up to the maximum
+#define RECONNECT_DELAY_MIN 250
+#define RECONNECT_DELAY_MAX 4000
+
 extern const stream_info_t stream_info_bd;
 extern const stream_info_t stream_info_vcd;
 extern const stream_info_t stream_info_cdda;
@@ -281,6 +288,48 @@ void stream_capture_do(stream_t *s)
   }
 }
 
+/**
+ * \brief reopen the connection of a stream whose read failed
+ * \return 1 if reading can continue, 0 if it failed, -1 if the stream
+ *         has no STREAM_CTRL_RECONNECT
+ */
+static int stream_reconnect(stream_t *s)
+{
+  unsigned int t = GetTimer();
+  int delay = RECONNECT_DELAY_MIN;
+  int attempt, res = STREAM_ERROR;
+
+  if (!s->control)
+    return -1;
+  for (attempt = 0; attempt < stream_reconnect_max; attempt++) {
+    if (attempt) {
+      // in the cache process/thread the user interface is not ours to poll,
+      // the player keeps going on what is already cached meanwhile
+      if (s->cache_data)
+        usec_sleep(delay * 1000);
+      else if (stream_check_interrupt(delay))
+        break;
+      delay = FFMIN(2 * delay, RECONNECT_DELAY_MAX);
+    }
+    res = s->control(s, STREAM_CTRL_RECONNECT, NULL);
+    if (res != STREAM_ERROR)
+      break;
+    s->reconnect_retries++;
+    mp_msg(MSGT_STREAM, MSGL_WARN, "Reconnect attempt %d of %d failed\n",
+           attempt + 1, stream_reconnect_max);
+  }
+  t = GetTimer() - t;
+  if (res == STREAM_UNSUPPORTED)
+    return -1;
+  s->reconnect_time += t * 0.000001;
+  if (res != STREAM_OK)
+    return 0;
+  s->reconnects++;
+  mp_msg(MSGT_STREAM, MSGL_INFO, "Reconnected at %"PRId64" after %u ms\n",
+         (int64_t)s->pos, t / 1000);
+  return 1;
+}
+
 int stream_read_internal(stream_t *s, void *buf, int len)
 {
   int orig_len = len;
@@ -305,19 +354,26 @@ int stream_read_internal(stream_t *s, void *buf, int len)
   default:
     len= s->fill_buffer ? s->fill_buffer(s, buf, len) : 0;
   }
+  s->read_calls++;
   if(len<=0){
     // dvdnav has some horrible hacks to "suspend" reads,
     // we need to skip this code or seeks will hang.
-    if (!s->eof && s->type != STREAMTYPE_DVDNAV) {
+    // nothing to reconnect for at the known end of the stream
+    if (!s->eof && s->type != STREAMTYPE_DVDNAV &&
+        (!s->end_pos || s->pos < s->end_pos)) {
       // just in case this is an error e.g. due to network
       // timeout reset and retry
-      // Seeking is used as a hack to make network streams
-      // reopen the connection, ideally they would implement
-      // e.g. a STREAM_CTRL_RECONNECT to do this
       off_t pos = s->pos;
+      int res = stream_reconnect_max > 0 ? stream_reconnect(s) : -1;
       s->eof=1;
-      stream_reset(s);
-      stream_seek_internal(s, pos);
+      if (!res)
+        return 0;
+      // Seeking is used as a hack to make network streams without
+      // STREAM_CTRL_RECONNECT reopen the connection
+      if (res < 0) {
+        stream_reset(s);
+        stream_seek_internal(s, pos);
+      }
       // make sure EOF is set to ensure no endless loops
       s->eof=1;
       return stream_read_internal(s, buf, orig_len);
@@ -329,11 +385,64 @@ int stream_read_internal(stream_t *s, void *buf, int len)
   // This e.g. avoids issues with eof getting stuck when lavf seeks in MPEG-TS
   s->eof=0;
   s->pos+=len;
+  s->read_bytes+=len;
   return len;
 }
 
+/**
+ * \brief read into mem bypassing the stream buffer, which must be empty
+ * \return number of bytes read, may be less than len
+ */
+int stream_read_direct(stream_t *s, char *mem, int len){
+  s->buf_pos=s->buf_len=0;
+  return stream_read_internal(s, mem, len);
+}
+
+/**
+ * \brief get the next len bytes without copying them
+ * \return pointer to the data, which stays valid as long as the stream is
+ *         open, or NULL if the stream cannot provide one, stream_read() has
+ *         to be used then.  The stream position is only advanced on success.
+ */
+unsigned char *stream_read_ptr(stream_t *s, int len){
+  off_t pos = stream_tell(s);
+  if(!s->map || s->cache_data || s->capture_file || len < 0 ||
+     pos < 0 || pos + len > s->map_size)
+    return NULL;
+  s->pos = pos + len;
+  s->buf_pos = s->buf_len = 0;
+  s->eof = 0;
+  return s->map + pos;
+}
+
+/**
+ * \brief read more at once while the stream is read sequentially
+ *
+ * Only plain files, other streams may block until they can return all
+ * that was asked for, and sector based streams need exact sizes.
+ */
+static void stream_grow_fill_size(stream_t *s){
+  int max = FFMAX(stream_buffer_max * 1024, STREAM_BUFFER_SIZE);
+  int size;
+  if(s->type != STREAMTYPE_FILE || s->sector_size || s->fill_size >= max)
+    return;
+  size = FFMIN(2 * s->fill_size, max);
+  if(size > s->buffer_size){
+    unsigned char *buf = realloc(s->buffer, size);
+    if(!buf)
+      return;
+    s->buffer = buf;
+    s->buffer_size = size;
+  }
+  s->fill_size = size;
+}
+
 int stream_fill_buffer(stream_t *s){
-  int len = stream_read_internal(s, s->buffer, STREAM_BUFFER_SIZE);
+  int len;
+  // everything read last time was used
+  if(s->buf_len && s->buf_pos >= s->buf_len)
+    stream_grow_fill_size(s);
+  len = stream_read_internal(s, s->buffer, s->fill_size);
   if (len <= 0)
     return 0;
   s->buf_pos=0;
@@ -348,6 +457,11 @@ int stream_write_buffer(stream_t *s, unsigned char *buf, int len) {
   int rd;
   if(!s->write_buffer)
     return -1;
+#if HAVE_PTHREADS
+  if(s->write_cache)
+    rd = stream_write_cache_put(s, buf, len);
+  else
+#endif
   rd = s->write_buffer(s, buf, len);
   if(rd < 0)
     return -1;
@@ -410,9 +524,16 @@ off_t newpos=0;
 
 //  if( mp_msg_test(MSGT_STREAM,MSGL_DBG3) ) printf("seek_long to 0x%X\n",(unsigned int)pos);
 
+  // jumping around, large reads would mostly be thrown away
+  if(pos < s->pos || pos >= s->pos + s->fill_size)
+    s->fill_size = FFMAX(s->fill_size / 2, STREAM_BUFFER_SIZE);
   s->buf_pos=s->buf_len=0;
 
   if(s->mode == STREAM_WRITE) {
+#if HAVE_PTHREADS
+    if(s->write_cache && !stream_write_cache_flush(s))
+      return 0;
+#endif
     if(!s->seek || !s->seek(s,pos))
       return 0;
     return 1;
@@ -476,7 +597,15 @@ stream_t* new_memory_stream(unsigned char* data,int len){
 
   if(len < 0)
     return NULL;
-  s=calloc(1, sizeof(stream_t)+len);
+  s=calloc(1, sizeof(stream_t));
+  if(s==NULL) return NULL;
+  s->buffer=malloc(FFMAX(len, 1));
+  if(s->buffer==NULL){
+    free(s);
+    return NULL;
+  }
+  s->buffer_size=len;
+  s->fill_size=STREAM_BUFFER_SIZE;
   s->fd=-1;
   s->type=STREAMTYPE_MEMORY;
   s->buf_pos=0; s->buf_len=len;
@@ -490,6 +619,13 @@ stream_t* new_memory_stream(unsigned char* data,int len){
 stream_t* new_stream(int fd,int type){
   stream_t *s=calloc(1, sizeof(stream_t));
   if(s==NULL) return NULL;
+  s->buffer_size=FFMAX(STREAM_BUFFER_SIZE, STREAM_MAX_SECTOR_SIZE);
+  s->fill_size=STREAM_BUFFER_SIZE;
+  s->buffer=malloc(s->buffer_size);
+  if(s->buffer==NULL){
+    free(s);
+    return NULL;
+  }
 
 #if HAVE_WINSOCK2_H
   {
@@ -512,8 +648,14 @@ stream_t* new_stream(int fd,int type){
 
 void free_stream(stream_t *s){
 //  printf("\n*** free_stream() called ***\n");
+  if(s->read_calls)
+    mp_msg(MSGT_STREAM,MSGL_V,"Stream: %"PRIu64" bytes in %"PRIu64" reads, %"PRIu64" bytes per read, last read size %d\n",
+           s->read_bytes, s->read_calls, s->read_bytes / s->read_calls, s->fill_size);
 #ifdef CONFIG_STREAM_CACHE
     cache_uninit(s);
+#endif
+#if HAVE_PTHREADS
+  stream_write_cache_uninit(s);
 #endif
   if (s->capture_file) {
     fclose(s->capture_file);
@@ -537,6 +679,7 @@ void free_stream(stream_t *s){
   // streams should destroy their priv on close
   //free(s->priv);
   free(s->url);
+  free(s->buffer);
   free(s);
 }
 
@@ -55,8 +55,11 @@
 #define STREAMTYPE_BLURAY 20
 #define STREAMTYPE_BD 21
 
+/// initial and smallest amount of data read at once into the stream buffer
 #define STREAM_BUFFER_SIZE 2048
 #define STREAM_MAX_SECTOR_SIZE (8*1024)
+/// default for the largest amount, reached while reading sequentially
+#define STREAM_BUFFER_MAX (256*1024)
 
 #define VCD_SECTOR_SIZE 2352
 #define VCD_SECTOR_OFFS 24
@@ -98,6 +101,9 @@
 #define STREAM_CTRL_GET_NUM_ANGLES 9
 #define STREAM_CTRL_GET_ANGLE 10
 #define STREAM_CTRL_SET_ANGLE 11
+/// reopen a broken connection and continue at s->pos,
+/// STREAM_ERROR means the attempt failed but may be retried
+#define STREAM_CTRL_RECONNECT 12
 
 
 typedef enum {
@@ -161,12 +167,20 @@ typedef struct stream {
   int mode; //STREAM_READ or STREAM_WRITE
   unsigned int cache_pid;
   void* cache_data;
+  void* write_cache;
+  unsigned char *map; // the whole stream mapped into memory, read only
+  off_t map_size;
   void* priv; // used for DVD, TV, RTSP etc
   char* url;  // strdup() of filename/url
 #ifdef CONFIG_NETWORKING
   streaming_ctrl_t *streaming_ctrl;
 #endif
-  unsigned char buffer[STREAM_BUFFER_SIZE>STREAM_MAX_SECTOR_SIZE?STREAM_BUFFER_SIZE:STREAM_MAX_SECTOR_SIZE];
+  unsigned char *buffer;
+  int buffer_size; // allocated size of buffer
+  int fill_size;   // bytes stream_fill_buffer() asks for, adapts to the access pattern
+  uint64_t read_calls, read_bytes; // statistics of the actual reads
+  int reconnects, reconnect_retries; // successful and failed STREAM_CTRL_RECONNECTs
+  double reconnect_time; // seconds spent reconnecting
   FILE *capture_file;
 } stream_t;
 
@@ -188,6 +202,19 @@ int cache_stream_seek_long(stream_t *s,off_t pos);
 #define cache_stream_seek_long(x,y) stream_seek_long(x,y)
 #define stream_enable_cache(x,y,z,w) 1
 #endif
+#if HAVE_PTHREADS
+int stream_enable_write_cache(stream_t *s, int size);
+int stream_write_cache_put(stream_t *s, unsigned char *buf, int len);
+int stream_write_cache_flush(stream_t *s);
+void stream_write_cache_stats(stream_t *s, double *write_time, double *wait_time);
+void stream_write_cache_uninit(stream_t *s);
+typedef struct stream_prefetch stream_prefetch_t;
+stream_prefetch_t *stream_prefetch_init(int fd, off_t size, int num_blocks, int block_size);
+int stream_prefetch_read(stream_prefetch_t *p, off_t pos, void *buf, int len);
+void stream_prefetch_uninit(stream_prefetch_t *p);
+#else
+#define stream_enable_write_cache(x,y) 0
+#endif
 int stream_write_buffer(stream_t *s, unsigned char *buf, int len);
 
 inline static int stream_read_char(stream_t *s){
@@ -261,12 +288,23 @@ inline static unsigned int stream_read_int24(stream_t *s){
   return y;
 }
 
+int stream_read_direct(stream_t *s, char *mem, int len);
+unsigned char *stream_read_ptr(stream_t *s, int len);
+
 inline static int stream_read(stream_t *s,char* mem,int total){
   int len=total;
   while(len>0){
     int x;
     x=s->buf_len-s->buf_pos;
     if(x==0){
+      // large reads of files go straight to mem instead of through s->buffer
+      if(len>=s->fill_size && s->type==STREAMTYPE_FILE &&
+         !s->cache_data && !s->capture_file && !s->sector_size){
+        x=stream_read_direct(s,mem,len);
+        if(x<=0) return total-len; // EOF
+        mem+=x; len-=x;
+        continue;
+      }
       if(!cache_stream_fill_buffer(s)) return total-len; // EOF
       x=s->buf_len-s->buf_pos;
     }
@@ -346,6 +384,12 @@ int stream_read_internal(stream_t *s, void *buf, int len);
 /// Internal seek function bypassing the stream buffer
 int stream_seek_internal(stream_t *s, off_t newpos);
 
+extern int stream_file_mmap;
+extern int stream_buffer_max;
+extern int stream_reconnect_max;
+extern int stream_readahead_file;
+extern int stream_readahead_device;
+extern int stream_readahead_size;
 extern int bluray_angle;
 extern int bluray_chapter;
 extern int dvd_speed;
@@ -19,16 +19,26 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #include "mp_msg.h"
 #include "stream.h"
 #include "help_mp.h"
 #include "m_option.h"
 #include "m_struct.h"
+#include "libavutil/common.h"
+
+int stream_file_mmap = 0;
+int stream_readahead_file = 0;
+int stream_readahead_device = 0;
+int stream_readahead_size = 256;
 
 static struct stream_priv_s {
   char* filename;
@@ -52,7 +62,26 @@ static const struct m_struct_st stream_opts = {
 };
 
 static int fill_buffer(stream_t *s, char* buffer, int max_len){
-  int r = read(s->fd,buffer,max_len);
+  int r;
+#if HAVE_PTHREADS
+  if (s->priv) {
+    r = stream_prefetch_read(s->priv, s->pos, buffer, max_len);
+    return (r <= 0) ? -1 : r;
+  }
+#endif
+#if HAVE_SYS_MMAN_H
+  if (s->map) {
+    if (s->pos < s->map_size) {
+      r = FFMIN(max_len, s->map_size - s->pos);
+      memcpy(buffer, s->map + s->pos, r);
+      return r;
+    }
+    // the file has grown since it was mapped
+    if (lseek(s->fd, s->pos, SEEK_SET) < 0)
+      return -1;
+  }
+#endif
+  r = read(s->fd,buffer,max_len);
   return (r <= 0) ? -1 : r;
 }
 
@@ -93,6 +122,50 @@ static int seek_forward(stream_t *s,off_t newpos) {
   return 1;
 }
 
+#if HAVE_SYS_MMAN_H
+// larger files are read(), the address space of 32 bit systems is small
+#define MAP_MAX_SIZE (sizeof(void *) > 4 ? (off_t)1 << 40 : (off_t)256 << 20)
+
+/**
+ * \brief map the whole file, reads are then only a memcpy from the page cache
+ *
+ * Only done on request (-mmap): truncating or replacing the file while it
+ * is mapped kills the player with SIGBUS.
+ */
+static void map_file(stream_t *s, off_t len) {
+  void *map;
+  if (!stream_file_mmap || len <= 0)
+    return;
+  if (len > MAP_MAX_SIZE) {
+    mp_msg(MSGT_OPEN, MSGL_V, "[file] File too large to map, using read()\n");
+    return;
+  }
+  map = mmap(NULL, len, PROT_READ, MAP_SHARED, s->fd, 0);
+  if (map == MAP_FAILED) {
+    mp_msg(MSGT_OPEN, MSGL_V, "[file] Cannot map file, using read()\n");
+    return;
+  }
+#ifdef MADV_SEQUENTIAL
+  madvise(map, len, MADV_SEQUENTIAL);
+#endif
+  s->map = map;
+  s->map_size = len;
+}
+
+#endif
+
+static void close_f(stream_t *s) {
+#if HAVE_SYS_MMAN_H
+  if (s->map)
+    munmap(s->map, s->map_size);
+  s->map = NULL;
+#endif
+#if HAVE_PTHREADS
+  stream_prefetch_uninit(s->priv);
+  s->priv = NULL;
+#endif
+}
+
 static int control(stream_t *s, int cmd, void *arg) {
   switch(cmd) {
     case STREAM_CTRL_GET_SIZE: {
@@ -188,6 +261,26 @@ static int open_f(stream_t *stream,int mode, void* opts, int* file_format) {
     stream->seek = seek;
     stream->end_pos = len;
     stream->type = STREAMTYPE_FILE;
+    if (mode == STREAM_READ) {
+#if HAVE_PTHREADS
+      struct stat st;
+      int blocks = stream_readahead_file;
+#endif
+#ifdef POSIX_FADV_SEQUENTIAL
+      posix_fadvise(f, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#if HAVE_PTHREADS
+      if (!fstat(f, &st) && S_ISBLK(st.st_mode))
+        blocks = stream_readahead_device;
+      stream->priv = stream_prefetch_init(f, len, blocks,
+                                          stream_readahead_size * 1024);
+#endif
+#if HAVE_SYS_MMAN_H
+      if (!stream->priv)
+        map_file(stream, len);
+#endif
+      stream->close = close_f;
+    }
   }
 
   mp_msg(MSGT_OPEN,MSGL_V,"[file] File size is %"PRId64" bytes\n", (int64_t)len);
@@ -30,6 +30,20 @@
 #include "url.h"
 #include "udp.h"
 
+static int
+udp_streaming_read (int fd, char *buffer,
+                    int size, streaming_ctrl_t *streaming_ctrl)
+{
+  return udp_batch_read (streaming_ctrl->data, buffer, size);
+}
+
+static void
+udp_stream_close (stream_t *stream)
+{
+  udp_batch_free (stream->streaming_ctrl->data);
+  stream->streaming_ctrl->data = NULL;
+}
+
 static int
 udp_streaming_start (stream_t *stream)
 {
@@ -50,7 +64,10 @@ udp_streaming_start (stream_t *stream)
     stream->fd = fd;
   }
 
-  streaming_ctrl->streaming_read = nop_streaming_read;
+  streaming_ctrl->data = udp_batch_new (fd);
+  if (!streaming_ctrl->data)
+    return -1;
+  streaming_ctrl->streaming_read = udp_streaming_read;
   streaming_ctrl->streaming_seek = nop_streaming_seek;
   streaming_ctrl->prebuffer_size = 64 * 1024; /* 64 KBytes */
   streaming_ctrl->buffering = 0;
@@ -93,6 +110,7 @@ udp_stream_open (stream_t *stream, int mode, void *opts, int *file_format)
   }
 
   stream->type = STREAMTYPE_STREAM;
+  stream->close = udp_stream_close;
   fixup_network_stream_cache (stream);
 
   return STREAM_OK;
@@ -20,6 +20,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+// recvmmsg()
+#define _GNU_SOURCE
 #include "config.h"
 
 #include <stdlib.h>
@@ -45,6 +47,26 @@
 #include "network.h"
 #include "url.h"
 #include "udp.h"
+#include "libavutil/common.h"
+
+/// datagrams fetched with one system call
+#define UDP_BATCH 64
+#define UDP_RCVBUF (4 * 1024 * 1024)
+
+struct udp_batch {
+  int fd;
+  unsigned char *buf;       ///< UDP_BATCH slots of UDP_PACKET_MAX bytes
+  int len[UDP_BATCH];
+  int num, cur;             ///< datagrams received, next one to return
+  int offset;               ///< bytes of datagram cur already returned by udp_batch_read
+  uint64_t packets, bytes, calls;
+  int truncated;
+#if HAVE_RECVMMSG
+  int no_mmsg;              ///< kernel without recvmmsg()
+  struct mmsghdr msgs[UDP_BATCH];
+  struct iovec iov[UDP_BATCH];
+#endif
+};
 
 int reuse_socket=0;
 
@@ -142,14 +164,26 @@ udp_open_socket (URL_t *url)
   }
 #endif /* HAVE_WINSOCK2_H */
 
-  /* Increase the socket rx buffer size to maximum -- this is UDP */
-  rxsockbufsz = 240 * 1024;
+  /* Increase the socket rx buffer size to maximum -- this is UDP,
+     multicast at tens of Mbit/s overflows small buffers while the
+     player is busy decoding */
+  rxsockbufsz = UDP_RCVBUF;
+#ifdef SO_RCVBUFFORCE
+  /* beyond net.core.rmem_max, only allowed with CAP_NET_ADMIN */
+  if (setsockopt (socket_server_fd, SOL_SOCKET, SO_RCVBUFFORCE,
+                  &rxsockbufsz, sizeof (rxsockbufsz)))
+#endif
   if (setsockopt (socket_server_fd, SOL_SOCKET, SO_RCVBUF,
                   &rxsockbufsz, sizeof (rxsockbufsz)))
   {
     mp_msg (MSGT_NETWORK, MSGL_ERR,
             "Couldn't set receive socket buffer size\n");
   }
+  err_len = sizeof (rxsockbufsz);
+  if (!getsockopt (socket_server_fd, SOL_SOCKET, SO_RCVBUF,
+                   &rxsockbufsz, &err_len))
+    mp_msg (MSGT_NETWORK, MSGL_V,
+            "Socket receive buffer: %d bytes\n", rxsockbufsz);
 
   if ((ntohl (server_address.sin_addr.s_addr) >> 28) == 0xe)
   {
@@ -199,3 +233,169 @@ udp_open_socket (URL_t *url)
 
   return socket_server_fd;
 }
+
+udp_batch_t *
+udp_batch_new (int fd)
+{
+  udp_batch_t *b = calloc (1, sizeof (*b));
+#if HAVE_RECVMMSG
+  int i;
+#endif
+
+  if (!b)
+    return NULL;
+  b->fd = fd;
+  b->buf = malloc (UDP_BATCH * UDP_PACKET_MAX);
+  if (!b->buf)
+  {
+    free (b);
+    return NULL;
+  }
+#if HAVE_RECVMMSG
+  for (i = 0; i < UDP_BATCH; i++)
+  {
+    b->iov[i].iov_base = b->buf + i * UDP_PACKET_MAX;
+    b->iov[i].iov_len = UDP_PACKET_MAX;
+    b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+    b->msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+#endif
+  return b;
+}
+
+/// wait up to timeout ms for data, 1 if there is some
+static int
+udp_wait (int fd, int timeout)
+{
+  fd_set set;
+  struct timeval tv;
+
+  FD_ZERO (&set);
+  FD_SET (fd, &set);
+  tv.tv_sec = timeout / 1000;
+  tv.tv_usec = (timeout % 1000) * 1000;
+  return select (fd + 1, &set, NULL, NULL, &tv) > 0;
+}
+
+/**
+ * \brief fetch all queued datagrams, at least one
+ * \param timeout ms to wait for the first one, -1 blocks
+ * \return number of datagrams, 0 on timeout, -1 on errors
+ */
+static int
+udp_batch_fill (udp_batch_t *b, int timeout)
+{
+  int n = -1;
+
+  if (timeout >= 0 && !udp_wait (b->fd, timeout))
+    return 0;
+#if HAVE_RECVMMSG
+  if (!b->no_mmsg)
+  {
+    n = recvmmsg (b->fd, b->msgs, UDP_BATCH, MSG_WAITFORONE, NULL);
+    if (n < 0 && errno == ENOSYS)
+      b->no_mmsg = 1;
+    else
+    {
+      int i;
+      for (i = 0; i < n; i++)
+      {
+        b->len[i] = b->msgs[i].msg_len;
+        if (b->msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+          b->truncated++;
+      }
+    }
+  }
+  if (b->no_mmsg)
+#endif
+  {
+    n = recv (b->fd, b->buf, UDP_PACKET_MAX, 0);
+    if (n >= 0)
+    {
+      b->len[0] = n;
+      n = 1;
+    }
+  }
+  b->calls++;
+  if (n < 0)
+  {
+    if (errno == EINTR || errno == EAGAIN)
+      return 0;
+    mp_msg (MSGT_NETWORK, MSGL_ERR, "UDP receive error: %s\n", strerror (errno));
+    return -1;
+  }
+  b->num = n;
+  b->cur = b->offset = 0;
+  b->packets += n;
+  while (n--)
+    b->bytes += b->len[n];
+  return b->num;
+}
+
+/**
+ * \brief next datagram, valid until the next call
+ * \param timeout ms to wait if none is queued, -1 blocks
+ * \return its length, 0 on timeout, -1 on errors
+ */
+int
+udp_batch_recv (udp_batch_t *b, unsigned char **data, int timeout)
+{
+  do {
+    if (b->cur >= b->num)
+    {
+      int res = udp_batch_fill (b, timeout);
+      if (res <= 0)
+        return res;
+    }
+    *data = b->buf + b->cur * UDP_PACKET_MAX;
+  } while (!b->len[b->cur++]); // empty datagrams are no data
+  return b->len[b->cur - 1];
+}
+
+/**
+ * \brief read the datagrams as a byte stream
+ *
+ * Only blocks while nothing was read, the rest is filled from what is
+ * already queued.
+ */
+int
+udp_batch_read (udp_batch_t *b, char *buffer, int size)
+{
+  int done = 0;
+
+  while (done < size)
+  {
+    int n;
+    if (b->cur >= b->num)
+    {
+      if (done)
+        break;
+      if (udp_batch_fill (b, -1) < 0)
+        return -1;
+      continue;
+    }
+    n = FFMIN (size - done, b->len[b->cur] - b->offset);
+    memcpy (buffer + done, b->buf + b->cur * UDP_PACKET_MAX + b->offset, n);
+    done += n;
+    b->offset += n;
+    if (b->offset >= b->len[b->cur])
+    {
+      b->cur++;
+      b->offset = 0;
+    }
+  }
+  return done;
+}
+
+void
+udp_batch_free (udp_batch_t *b)
+{
+  if (!b)
+    return;
+  if (b->calls)
+    mp_msg (MSGT_NETWORK, MSGL_V,
+            "UDP: %"PRIu64" datagrams, %"PRIu64" bytes in %"PRIu64" receive calls, %d truncated\n",
+            b->packets, b->bytes, b->calls, b->truncated);
+  free (b->buf);
+  free (b);
+}
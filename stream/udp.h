@@ -29,4 +29,14 @@ extern int reuse_socket;
 
 int udp_open_socket (URL_t *url);
 
+/// largest datagram the batched receiver keeps, longer ones are truncated
+#define UDP_PACKET_MAX 9216
+
+typedef struct udp_batch udp_batch_t;
+
+udp_batch_t *udp_batch_new (int fd);
+int udp_batch_recv (udp_batch_t *b, unsigned char **data, int timeout);
+int udp_batch_read (udp_batch_t *b, char *buffer, int size);
+void udp_batch_free (udp_batch_t *b);
+
 #endif /* MPLAYER_UDP_H */
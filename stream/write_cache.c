@@ -0,0 +1,198 @@
+/*
+ * write-behind cache for output streams
+ *
+ * Muxers write many small pieces (chunk headers, index entries) straight
+ * to the output stream.  With the cache, those only get copied into a ring
+ * buffer and a separate thread does the actual writing, so the encoder does
+ * not wait for the disk.  Seeking (e.g. to update a header) first waits
+ * until everything queued has been written.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "config.h"
+#include "mp_msg.h"
+#include "libavutil/common.h"
+#include "osdep/timer.h"
+#include "stream.h"
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;    ///< signalled whenever start, fill or quit change
+    unsigned char *buffer;
+    int size;
+    int start, fill;        ///< queued data, may wrap around
+    int busy;               ///< the thread is writing
+    int quit;
+    int error;
+    double write_time, wait_time; ///< seconds
+} write_cache_t;
+
+static void *write_thread(void *arg)
+{
+    stream_t *s = arg;
+    write_cache_t *c = s->write_cache;
+
+    pthread_mutex_lock(&c->lock);
+    while (1) {
+        unsigned int t;
+        int len;
+        while (!c->fill && !c->quit)
+            pthread_cond_wait(&c->cond, &c->lock);
+        if (!c->fill)
+            break;
+        // the writer only appends behind the queued data, so this part
+        // stays untouched while the lock is released
+        len = FFMIN(c->fill, c->size - c->start);
+        c->busy = 1;
+        pthread_mutex_unlock(&c->lock);
+
+        t = GetTimer();
+        if (!c->error && s->write_buffer(s, c->buffer + c->start, len) != len) {
+            mp_msg(MSGT_STREAM, MSGL_ERR, "Write error on %s\n", s->url);
+            c->error = 1;
+        }
+        t = GetTimer() - t;
+
+        pthread_mutex_lock(&c->lock);
+        c->write_time += t * 0.000001;
+        c->start = (c->start + len) % c->size;
+        c->fill -= len;
+        c->busy  = 0;
+        pthread_cond_broadcast(&c->cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+/**
+ * \brief queue writes to s in a buffer of size bytes written by a thread
+ * \return 1 if the cache is active, 0 if s cannot use one,
+ *         -1 if it could not be set up
+ */
+int stream_enable_write_cache(stream_t *s, int size)
+{
+    write_cache_t *c;
+
+    if (s->mode != STREAM_WRITE || !s->write_buffer || s->write_cache || size <= 0)
+        return 0;
+    c = calloc(1, sizeof(*c));
+    if (!c)
+        return -1;
+    c->buffer = malloc(size);
+    c->size   = size;
+    if (!c->buffer) {
+        free(c);
+        return -1;
+    }
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    s->write_cache = c;
+    if (pthread_create(&c->thread, NULL, write_thread, s)) {
+        pthread_cond_destroy(&c->cond);
+        pthread_mutex_destroy(&c->lock);
+        free(c->buffer);
+        free(c);
+        s->write_cache = NULL;
+        return -1;
+    }
+    mp_msg(MSGT_STREAM, MSGL_V, "Write cache: %d bytes\n", size);
+    return 1;
+}
+
+int stream_write_cache_put(stream_t *s, unsigned char *buf, int len)
+{
+    write_cache_t *c = s->write_cache;
+    int done = 0, ret;
+
+    pthread_mutex_lock(&c->lock);
+    while (done < len && !c->error) {
+        int end = (c->start + c->fill) % c->size;
+        int n   = FFMIN(len - done, c->size - c->fill);
+        if (!n) {
+            unsigned int t = GetTimer();
+            pthread_cond_wait(&c->cond, &c->lock);
+            c->wait_time += (GetTimer() - t) * 0.000001;
+            continue;
+        }
+        n = FFMIN(n, c->size - end);
+        memcpy(c->buffer + end, buf + done, n);
+        c->fill += n;
+        done    += n;
+        pthread_cond_broadcast(&c->cond);
+    }
+    ret = c->error ? -1 : len;
+    pthread_mutex_unlock(&c->lock);
+    return ret;
+}
+
+/// wait until everything queued is written, 0 on write errors
+int stream_write_cache_flush(stream_t *s)
+{
+    write_cache_t *c = s->write_cache;
+    unsigned int t = GetTimer();
+    int ret;
+
+    pthread_mutex_lock(&c->lock);
+    while (c->fill || c->busy)
+        pthread_cond_wait(&c->cond, &c->lock);
+    c->wait_time += (GetTimer() - t) * 0.000001;
+    ret = !c->error;
+    pthread_mutex_unlock(&c->lock);
+    return ret;
+}
+
+/**
+ * \brief time spent writing and waiting for the cache
+ * \param write_time seconds the write thread spent in actual writes
+ * \param wait_time seconds the caller was blocked by a full cache or a flush
+ */
+void stream_write_cache_stats(stream_t *s, double *write_time, double *wait_time)
+{
+    write_cache_t *c = s->write_cache;
+
+    *write_time = *wait_time = 0;
+    if (!c)
+        return;
+    pthread_mutex_lock(&c->lock);
+    *write_time = c->write_time;
+    *wait_time  = c->wait_time;
+    pthread_mutex_unlock(&c->lock);
+}
+
+void stream_write_cache_uninit(stream_t *s)
+{
+    write_cache_t *c = s->write_cache;
+
+    if (!c)
+        return;
+    pthread_mutex_lock(&c->lock);
+    c->quit = 1;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    pthread_join(c->thread, NULL);
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->lock);
+    free(c->buffer);
+    free(c);
+    s->write_cache = NULL;
+}
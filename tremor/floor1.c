@@ -25,6 +25,7 @@
 #include "codebook.h"
 #include "misc.h"
 #include "block.h"
+#include "sse2.h"
 
 #define floor1_rangedB 140 /* floor 1 fixed at -140dB to 0dB range */
 
@@ -282,7 +283,9 @@ static const ogg_int32_t FLOOR_fromdB_LOOKUP[256]={
   XdB(0x69f80e9a), XdB(0x70dafda8), XdB(0x78307d76), XdB(0x7fffffff),
 };
 
-static void render_line(int x0,int x1,int y0,int y1,ogg_int32_t *d){
+/* with f set only the floor curve is stored there, d is left alone */
+static void render_line(int x0,int x1,int y0,int y1,ogg_int32_t *d,
+			ogg_int32_t *f){
   int dy=y1-y0;
   int adx=x1-x0;
   int ady=abs(dy);
@@ -294,6 +297,21 @@ static void render_line(int x0,int x1,int y0,int y1,ogg_int32_t *d){
 
   ady-=abs(base*adx);
 
+  if(f){
+    f[x]=FLOOR_fromdB_LOOKUP[y];
+    while(++x<x1){
+      err=err+ady;
+      if(err>=adx){
+	err-=adx;
+	y+=sy;
+      }else{
+	y+=base;
+      }
+      f[x]=FLOOR_fromdB_LOOKUP[y];
+    }
+    return;
+  }
+
   d[x]= MULT31_SHIFT15(d[x],FLOOR_fromdB_LOOKUP[y]);
 
   while(++x<x1){
@@ -410,6 +428,11 @@ static int floor1_inverse2(vorbis_block *vb,vorbis_look_floor *in,void *memo,
     int hx=0;
     int lx=0;
     int ly=fit_value[0]*info->mult;
+    ogg_int32_t *f=NULL;
+#if TREMOR_SSE2
+    if(gCpuCaps.hasSSE2)
+      f=(ogg_int32_t *)_vorbis_block_alloc(vb,look->n*sizeof(*f));
+#endif
     for(j=1;j<look->posts;j++){
       int current=look->forward_index[j];
       int hy=fit_value[current]&0x7fff;
@@ -418,12 +441,16 @@ static int floor1_inverse2(vorbis_block *vb,vorbis_look_floor *in,void *memo,
 	hy*=info->mult;
 	hx=info->postlist[current];
 
-	render_line(lx,hx,ly,hy,out);
+	render_line(lx,hx,ly,hy,out,f);
 
 	lx=hx;
 	ly=hy;
       }
     }
+#if TREMOR_SSE2
+    if(f)
+      tremor_mult31_shift15_sse2(out,f,hx);
+#endif
     for(j=hx;j<n;j++)out[j]*=ly; /* be certain */
     return(1);
   }
@@ -0,0 +1,154 @@
+/*
+ * SSE2 versions of the Tremor fixed point DSP loops
+ *
+ * SSE2 only has an unsigned 32x32->64 bit multiply, the signed high half
+ * is obtained by subtracting (a < 0 ? b : 0) + (b < 0 ? a : 0) from the
+ * unsigned one.  Everything is computed modulo 2^32 exactly like the C
+ * versions in misc.h, so the output is bit-identical.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "sse2.h"
+
+#if TREMOR_SSE2
+
+#include "cpudetect.h"
+#include "misc.h"
+
+/*
+ * t0 = MULT32(a, b) for four lanes, t1-t3 are scratch registers.
+ */
+#define MULT32_SSE2(a, b, t0, t1, t2, t3)       \
+    "movdqa    "a", "t0"          \n\t"         \
+    "pmuludq   "b", "t0"          \n\t"         \
+    "movdqa    "a", "t1"          \n\t"         \
+    "psrlq     $32, "t1"          \n\t"         \
+    "movdqa    "b", "t2"          \n\t"         \
+    "psrlq     $32, "t2"          \n\t"         \
+    "pmuludq   "t2", "t1"         \n\t"         \
+    "pshufd    $0x0d, "t0", "t0"  \n\t"         \
+    "pshufd    $0x0d, "t1", "t1"  \n\t"         \
+    "punpckldq "t1", "t0"         \n\t"         \
+    "movdqa    "a", "t2"          \n\t"         \
+    "psrad     $31, "t2"          \n\t"         \
+    "pand      "b", "t2"          \n\t"         \
+    "movdqa    "b", "t3"          \n\t"         \
+    "psrad     $31, "t3"          \n\t"         \
+    "pand      "a", "t3"          \n\t"         \
+    "paddd     "t3", "t2"         \n\t"         \
+    "psubd     "t2", "t0"         \n\t"
+
+void tremor_mult31_sse2(ogg_int32_t *d, LOOKUP_T *w, int n)
+{
+    int n4 = n & ~3;
+    x86_reg i = -4 * n4;
+    if (n4)
+        __asm__ volatile(
+            "1:                            \n\t"
+            "movdqu    (%1,%0), %%xmm0     \n\t"
+            "movdqu    (%2,%0), %%xmm1     \n\t"
+            MULT32_SSE2("%%xmm0", "%%xmm1", "%%xmm2", "%%xmm3", "%%xmm4", "%%xmm5")
+            "pslld     $1, %%xmm2          \n\t"
+            "movdqu    %%xmm2, (%1,%0)     \n\t"
+            "add       $16, %0             \n\t"
+            "jl        1b                  \n\t"
+            :"+&r"(i)
+            :"r"(d + n4), "r"(w + n4)
+            :"memory" XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                                   "%xmm4", "%xmm5")
+        );
+    for (i = n4; i < n; i++)
+        d[i] = MULT31(d[i], w[i]);
+}
+
+void tremor_mult31_rev_sse2(ogg_int32_t *d, LOOKUP_T *w, int n)
+{
+    int n4 = n & ~3;
+    x86_reg i = -4 * n4;
+    LOOKUP_T *wp = w - 3;
+    if (n4)
+        __asm__ volatile(
+            "1:                            \n\t"
+            "movdqu    (%2,%0), %%xmm0     \n\t"
+            "movdqu    (%1), %%xmm1        \n\t"
+            "pshufd    $0x1b, %%xmm1, %%xmm1 \n\t"
+            MULT32_SSE2("%%xmm0", "%%xmm1", "%%xmm2", "%%xmm3", "%%xmm4", "%%xmm5")
+            "pslld     $1, %%xmm2          \n\t"
+            "movdqu    %%xmm2, (%2,%0)     \n\t"
+            "sub       $16, %1             \n\t"
+            "add       $16, %0             \n\t"
+            "jl        1b                  \n\t"
+            :"+&r"(i), "+&r"(wp)
+            :"r"(d + n4)
+            :"memory" XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                                   "%xmm4", "%xmm5")
+        );
+    for (i = n4; i < n; i++)
+        d[i] = MULT31(d[i], w[-i]);
+}
+
+void tremor_mult31_shift15_sse2(ogg_int32_t *d, const ogg_int32_t *f, int n)
+{
+    int n4 = n & ~3;
+    x86_reg i = -4 * n4;
+    if (n4)
+        __asm__ volatile(
+            "1:                            \n\t"
+            "movdqu    (%1,%0), %%xmm0     \n\t"
+            "movdqu    (%2,%0), %%xmm1     \n\t"
+            "movdqa    %%xmm0, %%xmm2      \n\t"
+            "pmuludq   %%xmm1, %%xmm2      \n\t"
+            "movdqa    %%xmm0, %%xmm3      \n\t"
+            "psrlq     $32, %%xmm3         \n\t"
+            "movdqa    %%xmm1, %%xmm4      \n\t"
+            "psrlq     $32, %%xmm4         \n\t"
+            "pmuludq   %%xmm4, %%xmm3      \n\t"
+            // low halves of the products
+            "pshufd    $0x08, %%xmm2, %%xmm4 \n\t"
+            "pshufd    $0x08, %%xmm3, %%xmm5 \n\t"
+            "punpckldq %%xmm5, %%xmm4      \n\t"
+            // signed high halves
+            "pshufd    $0x0d, %%xmm2, %%xmm2 \n\t"
+            "pshufd    $0x0d, %%xmm3, %%xmm3 \n\t"
+            "punpckldq %%xmm3, %%xmm2      \n\t"
+            "movdqa    %%xmm0, %%xmm3      \n\t"
+            "psrad     $31, %%xmm3         \n\t"
+            "pand      %%xmm1, %%xmm3      \n\t"
+            "movdqa    %%xmm1, %%xmm5      \n\t"
+            "psrad     $31, %%xmm5         \n\t"
+            "pand      %%xmm0, %%xmm5      \n\t"
+            "paddd     %%xmm5, %%xmm3      \n\t"
+            "psubd     %%xmm3, %%xmm2      \n\t"
+            // (lo >> 15) | (hi << 17)
+            "psrld     $15, %%xmm4         \n\t"
+            "pslld     $17, %%xmm2         \n\t"
+            "por       %%xmm4, %%xmm2      \n\t"
+            "movdqu    %%xmm2, (%1,%0)     \n\t"
+            "add       $16, %0             \n\t"
+            "jl        1b                  \n\t"
+            :"+&r"(i)
+            :"r"(d + n4), "r"(f + n4)
+            :"memory" XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                                   "%xmm4", "%xmm5")
+        );
+    for (i = n4; i < n; i++)
+        d[i] = MULT31_SHIFT15(d[i], f[i]);
+}
+
+#endif /* TREMOR_SSE2 */
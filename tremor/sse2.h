@@ -0,0 +1,43 @@
+/*
+ * SSE2 versions of the Tremor fixed point DSP loops
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPLAYER_TREMOR_SSE2_H
+#define MPLAYER_TREMOR_SSE2_H
+
+#include "config.h"
+
+/* The full accuracy build only, results are bit-identical to misc.h. */
+#if HAVE_SSE2 && !defined(_LOW_ACCURACY_)
+#define TREMOR_SSE2 1
+
+#include "cpudetect.h"
+#include "os_types.h"
+
+/* d[i] = MULT31(d[i], w[i]) */
+void tremor_mult31_sse2(ogg_int32_t *d, LOOKUP_T *w, int n);
+/* d[i] = MULT31(d[i], w[-i]) */
+void tremor_mult31_rev_sse2(ogg_int32_t *d, LOOKUP_T *w, int n);
+/* d[i] = MULT31_SHIFT15(d[i], f[i]) */
+void tremor_mult31_shift15_sse2(ogg_int32_t *d, const ogg_int32_t *f, int n);
+#else
+#define TREMOR_SSE2 0
+#endif
+
+#endif /* MPLAYER_TREMOR_SSE2_H */
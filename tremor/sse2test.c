@@ -0,0 +1,156 @@
+/*
+ * check the Tremor SSE2 loops against the C macros of misc.h
+ *
+ * The SSE2 versions have to be bit-identical, so they are fed random
+ * input mixed with the values where a signed multiply built from an
+ * unsigned one goes wrong first (0, -1, INT_MIN, INT_MAX) and at every
+ * length and misalignment the callers can produce.  The loops are timed
+ * against the C ones afterwards.
+ *
+ * Whole files are checked with the decoder itself:
+ *   mplayer -ac tremor -benchmark -ao pcm:fast:md5:file=/dev/null <file>
+ * must print the same md5 with and without SSE2.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "config.h"
+#include "cpudetect.h"
+#include "sse2.h"
+#include "misc.h"
+
+#define LEN_MAX    4096
+#define RUNS       2000
+#define BENCH_RUNS 20000
+
+#if TREMOR_SSE2
+static ogg_int32_t src[LEN_MAX + 4], win[LEN_MAX + 4];
+static ogg_int32_t dst_c[LEN_MAX + 4], dst_s[LEN_MAX + 4];
+
+static unsigned int GetTimer(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static ogg_int32_t random_value(void)
+{
+    static const ogg_int32_t corner[] = {
+        0, 1, -1, 0x7fffffff, -0x7fffffff - 1, 0x40000000, -0x40000000
+    };
+    if (!(rand() % 8))
+        return corner[rand() % (sizeof(corner) / sizeof(*corner))];
+    return (ogg_int32_t)((unsigned)rand() << 16 ^ (unsigned)rand());
+}
+
+static void fill(int n)
+{
+    int i;
+    for (i = 0; i < n + 4; i++) {
+        src[i] = random_value();
+        win[i] = random_value();
+    }
+}
+
+/* which: 0 = MULT31, 1 = MULT31 with a reversed window, 2 = MULT31_SHIFT15 */
+static void run_c(int which, ogg_int32_t *d, int off, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        switch (which) {
+        case 0:  d[off + i] = MULT31(d[off + i], win[off + i]);            break;
+        case 1:  d[off + i] = MULT31(d[off + i], win[off + n - 1 - i]);    break;
+        default: d[off + i] = MULT31_SHIFT15(d[off + i], win[off + i]);    break;
+        }
+}
+
+static void run_sse2(int which, ogg_int32_t *d, int off, int n)
+{
+    switch (which) {
+    case 0:  tremor_mult31_sse2(d + off, win + off, n);                break;
+    case 1:  tremor_mult31_rev_sse2(d + off, win + off + n - 1, n);    break;
+    default: tremor_mult31_shift15_sse2(d + off, win + off, n);        break;
+    }
+}
+
+static int test(int which, const char *name)
+{
+    int run, fail = 0;
+    unsigned int t, c_time, sse2_time;
+
+    for (run = 0; run < RUNS && !fail; run++) {
+        // short and odd lengths for the floor lines, up to a long block
+        int n   = run < 64 ? run : rand() % (LEN_MAX + 1);
+        int off = rand() % 4;
+        int i;
+        fill(n);
+        memcpy(dst_c, src, sizeof(src));
+        memcpy(dst_s, src, sizeof(src));
+        run_c(which, dst_c, off, n);
+        run_sse2(which, dst_s, off, n);
+        for (i = 0; i < LEN_MAX + 4; i++)
+            if (dst_c[i] != dst_s[i]) {
+                printf("%s: length %d offset %d differs at %d: "
+                       "%08x * %08x gives %08x instead of %08x\n",
+                       name, n, off, i, src[i],
+                       which == 1 && i >= off && i < off + n ?
+                           win[2 * off + n - 1 - i] : win[i],
+                       dst_s[i], dst_c[i]);
+                fail = 1;
+                break;
+            }
+    }
+
+    fill(1024);
+    memcpy(dst_c, src, sizeof(src));
+    t = GetTimer();
+    for (run = 0; run < BENCH_RUNS; run++)
+        run_c(which, dst_c, 0, 1024);
+    c_time = GetTimer() - t;
+    t = GetTimer();
+    for (run = 0; run < BENCH_RUNS; run++)
+        run_sse2(which, dst_c, 0, 1024);
+    sse2_time = GetTimer() - t;
+    printf("%s: %s, %.2f ns per sample, %.2f ns in C\n", name,
+           fail ? "FAILED" : "ok", sse2_time * 1000.0 / (BENCH_RUNS * 1024),
+           c_time * 1000.0 / (BENCH_RUNS * 1024));
+    return fail;
+}
+#endif
+
+int main(void)
+{
+    int fail = 0;
+
+    GetCpuCaps(&gCpuCaps);
+    srand(1);
+#if TREMOR_SSE2
+    if (gCpuCaps.hasSSE2) {
+        fail |= test(0, "mult31");
+        fail |= test(1, "mult31_rev");
+        fail |= test(2, "mult31_shift15");
+    } else
+#endif
+        printf("no SSE2, nothing to check\n");
+    return fail;
+}
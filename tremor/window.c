@@ -21,6 +21,7 @@
 #include "misc.h"
 #include "window.h"
 #include "window_lookup.h"
+#include "sse2.h"
 
 const void *_vorbis_window(int type, int left){
 
@@ -73,11 +74,20 @@ void _vorbis_apply_window(ogg_int32_t *d,const void *window_p[2],
   for(i=0;i<leftbegin;i++)
     d[i]=0;
 
+#if TREMOR_SSE2
+  if(gCpuCaps.hasSSE2){
+    tremor_mult31_sse2(d+leftbegin,window[lW],ln/2);
+    tremor_mult31_rev_sse2(d+rightbegin,window[nW]+rn/2-1,rn/2);
+    i=rightend;
+  }else
+#endif
+  {
   for(p=0;i<leftend;i++,p++)
     d[i]=MULT31(d[i],window[lW][p]);
 
   for(i=rightbegin,p=rn/2-1;i<rightend;i++,p--)
     d[i]=MULT31(d[i],window[nW][p]);
+  }
 
   for(;i<n;i++)
     d[i]=0;